@@ -7,15 +7,39 @@ namespace Theater
 {
 	namespace
 	{
-		constexpr wchar_t APP_WINDOWCLASS_NAME[] = L"TheaterWindow";
-		constexpr wchar_t APP_WINDOW_NAME[]      = L"TheaterWindow";
+		constexpr wchar_t  APP_WINDOWCLASS_NAME[] = L"TheaterWindow";
+		constexpr wchar_t  APP_WINDOW_NAME[]      = L"TheaterWindow";
+		constexpr UINT_PTR FADE_TIMER_ID          = 1;
+		constexpr UINT_PTR TRACK_TIMER_ID         = 2;
+		constexpr UINT     DEFAULT_FRAME_PERIOD   = 16;
+		constexpr UINT     WM_APP_FOREGROUND      = WM_APP + 1;
+		constexpr UINT     WM_APP_SETTINGSFILE    = WM_APP + 2;
+		constexpr wchar_t  TRACE_FILENAME[]       = L"trace.json";
+		constexpr wchar_t  EVENT_LOG_FILENAME[]   = L"events.thlog";
+
+		PlatformRect ToPlatformRect( const RECT& rc )
+		{
+			return { rc.left, rc.top, rc.right, rc.bottom };
+		}
+
+		// tick the fades once per composited frame
+		UINT GetFramePeriodMs()
+		{
+			DWM_TIMING_INFO timingInfo = {};
+			timingInfo.cbSize          = sizeof( timingInfo );
+			if ( ::DwmGetCompositionTimingInfo( nullptr, &timingInfo ) != S_OK || timingInfo.qpcRefreshPeriod == 0 )
+				return DEFAULT_FRAME_PERIOD;
+
+			LARGE_INTEGER frequency = {};
+			::QueryPerformanceFrequency( &frequency );
+			const auto periodMs = timingInfo.qpcRefreshPeriod * 1000 / frequency.QuadPart;
+			return static_cast<UINT>( std::max<LONGLONG>( USER_TIMER_MINIMUM, periodMs ) );
+		}
 
-		BOOL CALLBACK EnumWindowsProc( _In_ HWND hwnd, _In_ LPARAM lParam )
+		uint64_t GetTimeMs()
 		{
-			auto topLevelWindows = reinterpret_cast<std::vector<HWND>*>( lParam );
-			if ( ::IsWindowVisible( hwnd ) )
-				topLevelWindows->emplace_back( hwnd );
-			return TRUE;
+			const auto now = std::chrono::steady_clock::now().time_since_epoch();
+			return static_cast<uint64_t>( std::chrono::duration_cast<std::chrono::milliseconds>( now ).count() );
 		}
 
 		App s_app;
@@ -36,35 +60,108 @@ namespace Theater
 		return this->settings;
 	}
 
+	bool App::SaveTrace() const
+	{
+		wchar_t filename[MAX_PATH];
+		_snwprintf_s( filename, MAX_PATH, L"%s\\%s", this->settings.GetDirectory(), TRACE_FILENAME );
+
+		std::string json;
+		WriteTraceJson( json );
+		return WriteFileAtomic( filename, reinterpret_cast<const uint8_t*>( json.data() ), json.size(), nullptr );
+	}
+
+	bool App::RecordEvents( bool state )
+	{
+		std::lock_guard<std::mutex> lock( this->eventLogLock );
+		if ( state == this->eventLogRecording.load() )
+			return true;
+
+		if ( state )
+		{
+			this->eventLog.Begin( this->platform, ::GetCurrentProcessId(), this->settings.GetProcessNames(),
+			                      this->settings.GetCompanionNames() );
+			this->eventLogRecording.store( true );
+			return true;
+		}
+
+		this->eventLogRecording.store( false );
+
+		wchar_t filename[MAX_PATH];
+		_snwprintf_s( filename, MAX_PATH, L"%s\\%s", this->settings.GetDirectory(), EVENT_LOG_FILENAME );
+
+		const auto& bytes  = this->eventLog.GetBytes();
+		const bool  result = WriteFileAtomic( filename, bytes.data(), bytes.size(), nullptr );
+		this->eventLog.Clear();
+		return result;
+	}
+
+	bool App::IsRecordingEvents() const
+	{
+		return this->eventLogRecording.load();
+	}
+
 	void App::TheaterStart( HWND hwnd )
 	{
+		TraceScope trace( "theater-start", reinterpret_cast<Platform::WindowId>( hwnd ) );
+
 		const bool wasTheaterShown = this->theaterShown;
 		this->theaterShown         = true;
+		this->theaterTarget        = hwnd;
 
 		if ( !wasTheaterShown )
 		{
-			this->timerID    = ::SetTimer( this->messageWindow, this->timerID, 16, nullptr );
-			this->timerStart = std::chrono::high_resolution_clock::now();
-			this->dimmer.SetAlpha( 0 );
-			this->dimmer.Show( true );
-		}
+			// a fade out might still be running, in which case we fade back in from where it is
+			if ( !this->dimmerShown )
+			{
+				TraceScope showTrace( "dimmer-show" );
+				this->fade.Reset( 0.0f );
+				this->dimmer.SetAlpha( 0 );
+				this->dimmer.Show( true );
+				this->dimmerShown = true;
+			}
 
-		this->topLevelWindows.clear();
-		this->topLevelWindows.reserve( 256 );
-		::EnumWindows( EnumWindowsProc, reinterpret_cast<LPARAM>( &this->topLevelWindows ) );
+			FadeStart( this->settings.GetAlpha() / 255.0f );
+		}
 
-		HDWP dwp = ::BeginDeferWindowPos( static_cast<int>( this->topLevelWindows.size() ) );
-		if ( dwp == nullptr )
+		// gradients and the hole follow the target, the spotlight dimmers sit above everything so nothing to reorder
+		this->dimmer.SetTarget( hwnd );
+		TrackStart( hwnd );
+		if ( this->dimmer.IsSpotlightEnabled() )
 			return;
 
-		for ( auto topLevelWnd : this->topLevelWindows )
+		// the worker might already be on another session, then hwnd is on its own until that one is posted
+		const auto target = reinterpret_cast<Platform::WindowId>( hwnd );
 		{
-			if ( topLevelWnd == hwnd || this->dimmer.IsDimmerWindow( topLevelWnd ) )
-				continue;
-			::DeferWindowPos( dwp, topLevelWnd, HWND_BOTTOM, 0, 0, 0, 0, SWP_NOMOVE | SWP_NOSIZE | SWP_NOACTIVATE );
+			std::lock_guard<std::mutex> lock( this->targetLock );
+			this->publishedSession.GetCompanions( target, this->zOrderCompanions );
 		}
 
-		::EndDeferWindowPos( dwp );
+		UpdateZOrderDimmers();
+		this->zOrderArranger.Arrange( this->platform, target, this->zOrderCompanions, this->windowRegistry,
+		                              &this->registryLock );
+	}
+
+	void App::TheaterSwitch( HWND hwnd )
+	{
+		TraceScope trace( "theater-switch", reinterpret_cast<Platform::WindowId>( hwnd ) );
+
+		// focus moved within the session, all of its windows are above the dimmers already
+		this->theaterTarget = hwnd;
+		this->dimmer.SetTarget( hwnd );
+		TrackStart( hwnd );
+	}
+
+	void App::UpdateZOrderDimmers()
+	{
+		const size_t dimmerCount = this->dimmer.GetWindowCount();
+		this->zOrderDimmers.resize( dimmerCount );
+		for ( size_t i = 0; i < dimmerCount; i++ )
+		{
+			this->zOrderDimmers[i].window  = reinterpret_cast<Platform::WindowId>( this->dimmer.GetWindowHandle( i ) );
+			this->zOrderDimmers[i].monitor = ToPlatformRect( this->dimmer.GetMonitorRect( i ) );
+		}
+
+		this->zOrderArranger.SetDimmers( this->zOrderDimmers );
 	}
 
 	void App::TheaterStop()
@@ -72,8 +169,127 @@ namespace Theater
 		if ( !this->theaterShown )
 			return;
 
-		this->dimmer.Show( false );
+		// the dimmer gets hidden once faded out
 		this->theaterShown = false;
+		TrackStop();
+		FadeStart( 0.0f );
+	}
+
+	void App::FadeStart( float alpha )
+	{
+		this->fade.Start( alpha );
+		if ( this->fadeTimerRunning )
+			return;
+
+		this->fadeTimerRunning = ::SetTimer( this->messageWindow, FADE_TIMER_ID, GetFramePeriodMs(), nullptr ) != 0;
+
+		// no timer, jump to the end of the fade
+		if ( !this->fadeTimerRunning )
+		{
+			this->fade.Reset( alpha );
+			this->dimmer.SetAlpha( alpha );
+			FadeFinish();
+		}
+	}
+
+	void App::FadeTick()
+	{
+		TraceScope trace( "fade-tick" );
+
+		uint8_t alpha = 0;
+		if ( this->fade.Tick( alpha ) )
+			this->dimmer.SetAlpha( alpha / 255.0f );
+
+		if ( this->fade.IsRunning() )
+			return;
+
+		::KillTimer( this->messageWindow, FADE_TIMER_ID );
+		this->fadeTimerRunning = false;
+		FadeFinish();
+	}
+
+	void App::FadeFinish()
+	{
+		if ( !this->theaterShown && this->dimmerShown )
+		{
+			this->dimmer.Show( false );
+			this->dimmerShown = false;
+		}
+	}
+
+	void App::TrackStart( HWND hwnd )
+	{
+		// plain dimmers stay as they are wherever the target goes, no need to hear about it
+		if ( !this->dimmer.IsFollowingTarget() )
+		{
+			TrackStop();
+			return;
+		}
+
+		std::vector<PlatformRect> monitorRects( this->dimmer.GetWindowCount() );
+		for ( size_t i = 0; i < monitorRects.size(); i++ )
+			monitorRects[i] = ToPlatformRect( this->dimmer.GetMonitorRect( i ) );
+
+		this->targetTracker.SetFramePeriod( GetFramePeriodMs() );
+		this->targetTracker.SetMonitors( monitorRects );
+
+		const auto target = reinterpret_cast<Platform::WindowId>( hwnd );
+		if ( !this->targetTracker.Track( this->platform, target ) )
+		{
+			TrackStop();
+			return;
+		}
+
+		// a switch within the session may stay on the same process, the hook is kept then
+		this->platform.StartLocationHook( this->platform.GetWindowProcessId( target ) );
+	}
+
+	void App::TrackStop()
+	{
+		this->targetTracker.Clear();
+		this->platform.StopLocationHook();
+
+		if ( this->trackTimerRunning )
+		{
+			::KillTimer( this->messageWindow, TRACK_TIMER_ID );
+			this->trackTimerRunning = false;
+		}
+	}
+
+	void App::TrackUpdate()
+	{
+		const uint64_t now     = GetTimeMs();
+		uint32_t       changes = 0;
+		if ( this->targetTracker.Pop( this->platform, now, changes ) )
+		{
+			TraceScope trace( "target-track", this->targetTracker.GetWindow() );
+
+			// the surfaces are only redone from scratch when the target changed size or monitors
+			if ( changes & ( TargetTracker::TARGET_RESIZED | TargetTracker::TARGET_MONITORS_CHANGED ) )
+				this->dimmer.SetTarget( this->theaterTarget );
+			else
+				this->dimmer.MoveTarget( this->targetTracker.GetMonitorMask() );
+		}
+
+		// one shot, re-armed while the target keeps moving. It never fires early so the next update is due by then.
+		const uint32_t timeout = this->targetTracker.GetTimeout( now );
+		if ( timeout != TargetTracker::NO_TIMEOUT )
+		{
+			const UINT elapse       = std::max<UINT>( USER_TIMER_MINIMUM, timeout );
+			this->trackTimerRunning = ::SetTimer( this->messageWindow, TRACK_TIMER_ID, elapse, nullptr ) != 0;
+		}
+		else if ( this->trackTimerRunning )
+		{
+			::KillTimer( this->messageWindow, TRACK_TIMER_ID );
+			this->trackTimerRunning = false;
+		}
+	}
+
+	void App::OnTargetLocationChanged( const WindowEvent& event )
+	{
+		// while the timer runs the next frame takes it, re-arming it would only push that frame back
+		if ( this->targetTracker.Push( event, GetTimeMs() ) && !this->trackTimerRunning )
+			TrackUpdate();
 	}
 
 	LRESULT App::OnMessage( UINT message, WPARAM wParam, LPARAM lParam )
@@ -81,19 +297,45 @@ namespace Theater
 		switch ( message )
 		{
 		case WM_TIMER: {
-			const auto currentTime = std::chrono::high_resolution_clock::now();
-			const auto elapsedMs =
-			    std::chrono::duration_cast<std::chrono::milliseconds>( currentTime - this->timerStart ).count();
-			if ( elapsedMs >= 500 )
+			if ( wParam == FADE_TIMER_ID )
 			{
-				::KillTimer( this->messageWindow, this->timerID );
-				this->timerID = 0;
+				FadeTick();
+				return 0;
+			}
+			if ( wParam == TRACK_TIMER_ID )
+			{
+				TrackUpdate();
+				return 0;
 			}
-
-			const float alpha = ( this->settings.GetAlpha() / 255.0f ) * std::min( 1.0f, elapsedMs / 500.0f );
-			this->dimmer.SetAlpha( alpha );
 			break;
 		}
+		case WM_APP_SETTINGSFILE: {
+			this->settings.Reload();
+			return 0;
+		}
+		case WM_APP_FOREGROUND: {
+			// the hooks might have been removed while the worker was resolving it
+			if ( !this->hooksActive )
+				return 0;
+
+			const HWND hwnd       = reinterpret_cast<HWND>( lParam );
+			const auto transition = static_cast<TheaterSession::Transition>( wParam );
+			if ( transition == TheaterSession::Transition::Stop ||
+			     !this->platform.IsWindow( static_cast<Platform::WindowId>( lParam ) ) )
+			{
+				TheaterStop();
+			}
+			else if ( transition == TheaterSession::Transition::Switch && this->theaterShown )
+			{
+				TheaterSwitch( hwnd );
+			}
+			else
+			{
+				TheaterStart( hwnd );
+			}
+
+			return 0;
+		}
 		}
 
 		return ::DefWindowProc( this->messageWindow, message, wParam, lParam );
@@ -139,55 +381,176 @@ namespace Theater
 		}
 	}
 
-	void App::OnWinEvent( HWINEVENTHOOK hWinEventHook, DWORD event, HWND hwnd, LONG idObject, LONG idChild,
-	                      DWORD idEventThread, DWORD dwmsEventTime )
+	void App::OnPlatformEvent( const WindowEvent& event )
 	{
-		UNREFERENCED_PARAMETER( hWinEventHook );
-		UNREFERENCED_PARAMETER( dwmsEventTime );
-		UNREFERENCED_PARAMETER( idEventThread );
+		TraceScope trace( "hook", event.window );
 
-		switch ( event )
+		// the target's moves come at the mouse rate, the hook is scoped to its process and they are coalesced here
+		if ( event.type == WindowEventType::LocationChanged )
 		{
-		case EVENT_SYSTEM_FOREGROUND: {
-			if ( hwnd == nullptr )
-				return;
+			OnTargetLocationChanged( event );
+			return;
+		}
 
-			if ( idObject != OBJID_WINDOW || idChild != CHILDID_SELF )
-				return;
+		// only record what happened, the worker does the rest
+		if ( !this->windowEvents.Push( event ) )
+			this->windowEventsOverflowed.store( true );
 
-			DWORD wndProcessId = 0;
-			::GetWindowThreadProcessId( hwnd, &wndProcessId );
+		::SetEvent( this->eventWorkerWake );
+	}
 
-			HANDLE processHandle = ::OpenProcess( PROCESS_QUERY_LIMITED_INFORMATION, FALSE, wndProcessId );
-			if ( processHandle == nullptr )
-				return;
+	void App::PlatformEventCallback( const WindowEvent& event )
+	{
+		App::Current().OnPlatformEvent( event );
+	}
 
-			wchar_t processPath[_MAX_PATH];
-			DWORD   processPathLen     = _MAX_PATH;
-			auto    queryResult        = ::QueryFullProcessImageNameW( processHandle, 0, processPath, &processPathLen );
-			processPath[_MAX_PATH - 1] = 0;
-			::CloseHandle( processHandle );
-			if ( queryResult == 0 )
-				return;
+	bool App::EventWorkerStart()
+	{
+		this->eventWorkerWake = ::CreateEventW( nullptr, FALSE, FALSE, nullptr );
+		if ( this->eventWorkerWake == nullptr )
+			return false;
 
-			wchar_t filename[_MAX_FNAME];
-			_wsplitpath_s( processPath, nullptr, 0, nullptr, 0, filename, _MAX_FNAME, nullptr, 0 );
-			filename[_MAX_FNAME - 1] = 0;
-			std::transform( std::begin( filename ), std::end( filename ), std::begin( filename ),
-			                []( wchar_t c ) -> wchar_t { return static_cast<wchar_t>( std::tolower( c ) ); } );
+		this->eventWorkerExit.store( false );
+		this->eventWorker = std::thread( &App::EventWorkerRun, this );
+		return true;
+	}
 
-			if ( this->processNameSet.find( filename ) != this->processNameSet.cend() )
+	void App::EventWorkerStop()
+	{
+		if ( this->eventWorker.joinable() )
+		{
+			this->eventWorkerExit.store( true );
+			::SetEvent( this->eventWorkerWake );
+			this->eventWorker.join();
+		}
+
+		if ( this->eventWorkerWake != nullptr )
+		{
+			::CloseHandle( this->eventWorkerWake );
+			this->eventWorkerWake = nullptr;
+		}
+	}
+
+	void App::EventWorkerRun()
+	{
+		SetTraceThreadName( "event-worker" );
+
+		WindowEvent event = {};
+		while ( !this->eventWorkerExit.load() )
+		{
+			const uint32_t timeout = this->windowEventCoalescer.GetTimeout( GetTimeMs() );
+			::WaitForSingleObject( this->eventWorkerWake,
+			                       timeout == WindowEventCoalescer::NO_TIMEOUT ? INFINITE : timeout );
+
+			TakeTargetUpdates();
+
+			// events were dropped, whatever we know about windows can't be trusted anymore
+			if ( this->windowEventsOverflowed.exchange( false ) )
 			{
-				TheaterStart( hwnd );
+				{
+					std::lock_guard<std::mutex> lock( this->registryLock );
+					if ( this->windowRegistry.IsInitialized() )
+						this->windowRegistry.Init( &this->platform );
+				}
+
+				this->targetResolver.Clear();
+				this->theaterSession.Reset();
+				PublishSession();
 			}
-			else
+
+			while ( this->windowEvents.Pop( event ) )
 			{
-				TheaterStop();
+				if ( this->eventLogRecording.load() )
+				{
+					std::lock_guard<std::mutex> lock( this->eventLogLock );
+					if ( this->eventLogRecording.load() )
+						this->eventLog.Write( this->platform, event );
+				}
+
+				if ( this->windowEventCoalescer.Push( event, GetTimeMs() ) )
+					OnWindowEvent( event );
 			}
 
-			break;
+			if ( this->windowEventCoalescer.PopForeground( GetTimeMs(), event ) )
+				OnForegroundEvent( event );
 		}
+	}
+
+	void App::OnWindowEvent( const WindowEvent& event )
+	{
+		{
+			std::lock_guard<std::mutex> lock( this->registryLock );
+			this->windowRegistry.OnWindowEvent( event );
+		}
+
+		if ( event.type == WindowEventType::Destroyed )
+			this->targetResolver.RemoveWindow( event.window );
+
+		// only a session can change here, windows never start or end one
+		this->theaterSession.OnWindowEvent( event, this->targetResolver, this->windowRegistry, &this->registryLock );
+		if ( this->theaterSession.IsActive() )
+			PublishSession();
+	}
+
+	void App::OnForegroundEvent( const WindowEvent& event )
+	{
+		TheaterSession::Transition transition = TheaterSession::Transition::Stop;
+		if ( !this->theaterSession.OnForeground( event.window, this->targetResolver, this->windowRegistry,
+		                                         &this->registryLock, transition ) )
+			return;
+
+		PublishSession();
+
+		// dimmers and z-order belong to the UI thread
+		::PostMessageW( this->messageWindow, WM_APP_FOREGROUND, static_cast<WPARAM>( transition ),
+		                static_cast<LPARAM>( event.window ) );
+	}
+
+	void App::TakeTargetUpdates()
+	{
+		uint32_t          changes = 0;
+		bool              reset   = false;
+		ProcessNameSet    processNames;
+		std::vector<Rule> rules;
+		ProcessNameSet    companionNames;
+		{
+			std::lock_guard<std::mutex> lock( this->targetLock );
+			if ( this->pendingTargetChanges == 0 && !this->pendingTargetReset )
+				return;
+
+			changes = this->pendingTargetChanges;
+			reset   = this->pendingTargetReset;
+			std::swap( processNames, this->pendingProcessNames );
+			std::swap( rules, this->pendingRules );
+			std::swap( companionNames, this->pendingCompanionNames );
+			this->pendingTargetChanges = 0;
+			this->pendingTargetReset   = false;
+		}
+
+		// the matchers are rebuilt unlocked, the UI thread goes on meanwhile
+		if ( changes & ( SETTINGS_CHANGE_PROCESSES | SETTINGS_CHANGE_RULES ) )
+			this->targetResolver.Configure( processNames, rules );
+		if ( changes & SETTINGS_CHANGE_COMPANIONS )
+			this->targetResolver.ConfigureCompanions( companionNames );
+
+		// whichever windows the session holds were picked by the former settings
+		if ( reset )
+		{
+			this->targetResolver.Clear();
+			this->theaterSession.Reset();
+		}
+		else
+		{
+			this->theaterSession.Clear();
 		}
+
+		PublishSession();
+	}
+
+	void App::PublishSession()
+	{
+		std::lock_guard<std::mutex> lock( this->targetLock );
+		this->publishedSession = this->theaterSession;
 	}
 
 	void App::TheaterEnable( bool state )
@@ -203,57 +566,143 @@ namespace Theater
 		}
 	}
 
-	void App::WinEventHookProc( HWINEVENTHOOK hWinEventHook, DWORD event, HWND hwnd, LONG idObject, LONG idChild,
-	                            DWORD idEventThread, DWORD dwmsEventTime )
-	{
-		App::Current().OnWinEvent( hWinEventHook, event, hwnd, idObject, idChild, idEventThread, dwmsEventTime );
-	}
-
 	bool App::HookRegister()
 	{
-		if ( this->winEventHook != nullptr )
+		if ( this->hooksActive )
 			return true;
 
-		this->winEventHook =
-		    ::SetWinEventHook( EVENT_SYSTEM_FOREGROUND, EVENT_SYSTEM_FOREGROUND, nullptr, App::WinEventHookProc, 0, 0,
-		                       WINEVENT_OUTOFCONTEXT | WINEVENT_SKIPOWNPROCESS );
+		this->hooksActive = true;
+		const bool result = this->platform.StartEventHooks( App::PlatformEventCallback );
+
+		// only enumerate once, the hooks keep the registry up to date from now on
+		{
+			std::lock_guard<std::mutex> lock( this->registryLock );
+			this->windowRegistry.Init( &this->platform );
+		}
 
-		return this->winEventHook != nullptr;
+		return result;
 	}
 
 	void App::HookUnregister()
 	{
-		if ( this->winEventHook != nullptr )
+		this->platform.StopEventHooks();
+		this->hooksActive = false;
+
+		// we can't see windows being created or destroyed anymore, cached entries would go stale
+		{
+			std::lock_guard<std::mutex> lock( this->registryLock );
+			this->windowRegistry.Close();
+		}
+
+		{
+			std::lock_guard<std::mutex> lock( this->targetLock );
+			this->pendingTargetReset = true;
+		}
+
+		::SetEvent( this->eventWorkerWake );
+	}
+
+	void App::OnTargetSettingsChanged( uint32_t changes )
+	{
+		// the settings belong to the UI thread, the worker gets a copy and rebuilds the matchers on its own
+		{
+			std::lock_guard<std::mutex> lock( this->targetLock );
+			if ( changes & ( SETTINGS_CHANGE_PROCESSES | SETTINGS_CHANGE_RULES ) )
+			{
+				this->pendingProcessNames = this->settings.GetProcessNames();
+				this->pendingRules        = this->settings.GetRules();
+			}
+			if ( changes & SETTINGS_CHANGE_COMPANIONS )
+				this->pendingCompanionNames = this->settings.GetCompanionNames();
+
+			this->pendingTargetChanges |= changes;
+		}
+
+		::SetEvent( this->eventWorkerWake );
+	}
+
+	void App::TargetSettingsChangedCallback( uint32_t changes )
+	{
+		App::Current().OnTargetSettingsChanged( changes );
+	}
+
+	void App::OnSettingsChanged( uint32_t changes )
+	{
+		// Apply only what changed, a reload of settings.json usually touches a single value
+		if ( changes & SETTINGS_CHANGE_FADE )
+		{
+			this->fade.SetDuration( this->settings.GetFadeDuration() );
+			this->fade.SetEasing( this->settings.GetFadeEasing() );
+		}
+
+		if ( changes & SETTINGS_CHANGE_ALPHA )
 		{
-			::UnhookWinEvent( this->winEventHook );
-			this->winEventHook = nullptr;
+			if ( this->theaterShown )
+				FadeStart( this->settings.GetAlpha() / 255.0f );
 		}
+
+		if ( changes & ( SETTINGS_CHANGE_ALPHA | SETTINGS_CHANGE_MONITORS ) )
+			this->dimmer.SetLevels( this->settings.GetAlpha(), this->settings.GetMonitorLevels() );
+
+		if ( changes & SETTINGS_CHANGE_COLOR )
+			this->dimmer.SetColor( this->settings.GetColor() );
+
+		if ( changes & SETTINGS_CHANGE_SPOTLIGHT )
+			this->dimmer.SetSpotlight( this->settings.IsSpotlightEnabled(), this->settings.GetSpotlightFeather() );
+
+		if ( changes & SETTINGS_CHANGE_GRADIENT )
+			this->dimmer.SetGradient( this->settings.GetGradient() );
+
+		// the surfaces might just have been turned on or off
+		if ( ( changes & ( SETTINGS_CHANGE_SPOTLIGHT | SETTINGS_CHANGE_GRADIENT ) ) && this->theaterShown )
+			TrackStart( this->theaterTarget );
+
+		if ( changes & SETTINGS_CHANGE_ENABLED )
+			TheaterEnable( this->settings.IsTheaterEnabled() );
 	}
 
-	void App::OnSettingsChanged()
+	void App::SettingsChangedCallback( uint32_t changes )
 	{
-		// Apply settings
-		const wchar_t* processNames[256] = {};
-		const auto     processNameCount  = this->settings.GetProcessNames( processNames, 256 );
+		App::Current().OnSettingsChanged( changes );
+	}
+
+	bool App::SettingsWatcherStart()
+	{
+		if ( !this->settings.OpenWatcher( this->settingsWatcher ) )
+			return false;
 
-		this->processNameSet.clear();
-		for ( size_t i = 0; i < processNameCount; i++ )
+		this->settingsWatcherThread = std::thread( &App::SettingsWatcherRun, this );
+		return true;
+	}
+
+	void App::SettingsWatcherStop()
+	{
+		if ( this->settingsWatcherThread.joinable() )
 		{
-			std::wstring name( processNames[i] );
-			std::transform( name.begin(), name.end(), name.begin(),
-			                []( wchar_t c ) { return static_cast<wchar_t>( std::tolower( c ) ); } );
-			this->processNameSet.insert( std::move( name ) );
+			this->settingsWatcher.Wake();
+			this->settingsWatcherThread.join();
 		}
 
-		this->dimmer.SetAlpha( this->settings.GetAlpha() );
-		this->dimmer.SetColor( this->settings.GetColor() );
+		this->settingsWatcher.Close();
+	}
+
+	void App::SettingsWatcherRun()
+	{
+		// the settings are owned by the UI thread, the watcher only tells it to have a look
+		while ( this->settingsWatcher.Wait() == FileWatcher::WaitResult::Changed )
+			::PostMessageW( this->messageWindow, WM_APP_SETTINGSFILE, 0, 0 );
+	}
 
-		TheaterEnable( this->settings.IsTheaterEnabled() );
+	void App::OnTopologyChanged()
+	{
+		// new or moved dimmer windows are not ordered against the target yet
+		if ( this->theaterShown && ::IsWindow( this->theaterTarget ) )
+			TheaterStart( this->theaterTarget );
 	}
 
-	void App::SettingsChangedCallback()
+	void App::TopologyChangedCallback()
 	{
-		App::Current().OnSettingsChanged();
+		App::Current().OnTopologyChanged();
 	}
 
 	bool App::Init()
@@ -262,22 +711,38 @@ namespace Theater
 		if ( result != S_OK && result != S_FALSE )
 			return false;
 
+		SetTraceThreadName( "ui" );
+
 		this->settings.Load();
 
+		// not fatal, settings are still written on exit
+		this->settings.StartAutoSave( SettingsPersister::DEFAULT_DELAY );
+
 		if ( !this->tray.Init() )
 			return false;
 
 		if ( !MessageWindowCreate() )
 			return false;
 
-		if ( !this->dimmer.Init() )
+		if ( !this->dimmer.Init( &this->platform ) )
+			return false;
+		this->dimmer.SetTopologyChangedCallback( App::TopologyChangedCallback );
+
+		this->targetResolver.SetPlatform( &this->platform );
+		if ( !EventWorkerStart() )
 			return false;
 
 		if ( !HookRegister() )
 			return false;
 
-		this->settings.RegisterChangedCallback( App::SettingsChangedCallback );
-		this->settings.NotifyChanges();
+		// the worker gets the new targets before the dimmer is updated, it takes them ahead of its next event
+		this->settings.RegisterChangedCallback( App::TargetSettingsChangedCallback, SETTINGS_CHANGE_TARGET );
+		this->settings.RegisterChangedCallback( App::SettingsChangedCallback,
+		                                        SETTINGS_CHANGE_ALL & ~SETTINGS_CHANGE_TARGET );
+		this->settings.NotifyChanges( SETTINGS_CHANGE_ALL );
+
+		// not fatal, settings just won't be reloaded
+		SettingsWatcherStart();
 
 		return true;
 	}
@@ -296,9 +761,14 @@ namespace Theater
 
 	void App::Close()
 	{
+		SettingsWatcherStop();
 		this->settings.UnregisterChangedCallback( App::SettingsChangedCallback );
+		this->settings.UnregisterChangedCallback( App::TargetSettingsChangedCallback );
 		this->settings.Save();
+		this->settings.StopAutoSave();
 		HookUnregister();
+		EventWorkerStop();
+		RecordEvents( false );
 		MessageWindowDestroy();
 		this->dimmer.Close();
 		this->tray.Close();
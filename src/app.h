@@ -15,13 +15,32 @@ namespace Theater
 		Settings&       GetSettings();
 		const Settings& GetSettings() const;
 
+		// Writes the recorded spans to trace.json next to the settings
+		bool SaveTrace() const;
+
+		// Records the hook events from now on, stopping writes them to events.thlog next to the settings
+		bool RecordEvents( bool state );
+		bool IsRecordingEvents() const;
+
 		static App& Current();
 
 	private:
 		void TheaterStart( HWND hwnd );
+		void TheaterSwitch( HWND hwnd );
 		void TheaterStop();
 		void TheaterEnable( bool state );
 
+		void FadeStart( float alpha );
+		void FadeTick();
+		void FadeFinish();
+
+		void TrackStart( HWND hwnd );
+		void TrackStop();
+		void TrackUpdate();
+		void OnTargetLocationChanged( const WindowEvent& event );
+
+		void UpdateZOrderDimmers();
+
 		bool                    MessageWindowCreate();
 		void                    MessageWindowDestroy();
 		LRESULT                 OnMessage( UINT message, WPARAM wParam, LPARAM lParam );
@@ -29,13 +48,27 @@ namespace Theater
 
 		bool        HookRegister();
 		void        HookUnregister();
-		void        OnWinEvent( HWINEVENTHOOK hWinEventHook, DWORD event, HWND hwnd, LONG idObject, LONG idChild,
-		                        DWORD idEventThread, DWORD dwmsEventTime );
-		static void WinEventHookProc( HWINEVENTHOOK hWinEventHook, DWORD event, HWND hwnd, LONG idObject, LONG idChild,
-		                              DWORD idEventThread, DWORD dwmsEventTime );
+		void        OnPlatformEvent( const WindowEvent& event );
+		static void PlatformEventCallback( const WindowEvent& event );
+
+		bool EventWorkerStart();
+		void EventWorkerStop();
+		void EventWorkerRun();
+		void OnWindowEvent( const WindowEvent& event );
+		void OnForegroundEvent( const WindowEvent& event );
+		void TakeTargetUpdates();
+		void PublishSession();
+
+		bool SettingsWatcherStart();
+		void SettingsWatcherStop();
+		void SettingsWatcherRun();
 
-		void        OnSettingsChanged();
-		static void SettingsChangedCallback();
+		void        OnTargetSettingsChanged( uint32_t changes );
+		static void TargetSettingsChangedCallback( uint32_t changes );
+		void        OnSettingsChanged( uint32_t changes );
+		static void SettingsChangedCallback( uint32_t changes );
+		void        OnTopologyChanged();
+		static void TopologyChangedCallback();
 
 	private:
 		App( const App& ) = delete;
@@ -45,14 +78,55 @@ namespace Theater
 
 	private:
 		HWND messageWindow = nullptr;
+		HWND theaterTarget = nullptr;
 		bool theaterShown  = false;
+		bool dimmerShown   = false;
+
+		FadeAnimation fade;
+		bool          fadeTimerRunning = false;
+
+		// location changes of the target's process are handled on the UI thread, they never reach the worker
+		TargetTracker targetTracker;
+		bool          trackTimerRunning = false;
+
+		Win32Platform platform;
+		bool          hooksActive = false;
+
+		// filled by the hooks on the UI thread, drained by the worker
+		SpscRing<WindowEvent, 1024> windowEvents;
+		std::atomic<bool>           windowEventsOverflowed{ false };
+		WindowEventCoalescer        windowEventCoalescer;
+		std::thread                 eventWorker;
+		HANDLE                      eventWorkerWake = nullptr;
+		std::atomic<bool>           eventWorkerExit{ false };
+
+		// the resolver and the session belong to the worker, which resolves without holding any lock. The UI thread
+		// hands over settings changes and reads the session the worker published, both under targetLock.
+		// The registry is used by both threads under registryLock, the two locks are never held together.
+		TargetResolver     targetResolver;
+		TheaterSession     theaterSession;
+		std::mutex         targetLock;
+		TheaterSession     publishedSession;
+		uint32_t           pendingTargetChanges = 0;
+		bool               pendingTargetReset   = false;
+		ProcessNameSet     pendingProcessNames;
+		std::vector<Rule>  pendingRules;
+		ProcessNameSet     pendingCompanionNames;
+		mutable std::mutex registryLock;
+		WindowRegistry     windowRegistry;
+
+		// written by the worker while recording, started and saved on the UI thread
+		std::mutex        eventLogLock;
+		EventLogWriter    eventLog;
+		std::atomic<bool> eventLogRecording{ false };
 
-		UINT_PTR                                       timerID = 0;
-		std::chrono::high_resolution_clock::time_point timerStart;
+		// external edits of settings.json are picked up on the UI thread
+		FileWatcher settingsWatcher;
+		std::thread settingsWatcherThread;
 
-		HWINEVENTHOOK                    winEventHook = nullptr;
-		std::vector<HWND>                topLevelWindows;
-		std::unordered_set<std::wstring> processNameSet;
+		ZOrderArranger                  zOrderArranger;
+		std::vector<ZOrderDimmer>       zOrderDimmers;
+		std::vector<Platform::WindowId> zOrderCompanions;
 
 		Dimmer   dimmer;
 		Tray     tray;
@@ -0,0 +1,142 @@
+#include "theater.h"
+#include "atomicfile.h"
+
+#if !defined( _WIN32 )
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace Theater
+{
+#if defined( _WIN32 )
+	bool WriteFileAtomic( const wchar_t* filename, const uint8_t* bytes, size_t size, const wchar_t* backupFilename )
+	{
+		const std::wstring temporary = filename + std::wstring( L".tmp" );
+
+		HANDLE file = ::CreateFileW( temporary.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+		                             FILE_ATTRIBUTE_NORMAL, nullptr );
+		if ( file == INVALID_HANDLE_VALUE )
+			return false;
+
+		bool success = true;
+		while ( success && size > 0 )
+		{
+			const DWORD chunk   = static_cast<DWORD>( std::min<size_t>( size, 1u << 30 ) );
+			DWORD       written = 0;
+			success             = ::WriteFile( file, bytes, chunk, &written, nullptr ) && written == chunk;
+			bytes += written;
+			size -= written;
+		}
+
+		// the rename must not reach the disk before the content does
+		success = success && ::FlushFileBuffers( file );
+		::CloseHandle( file );
+
+		if ( success )
+		{
+			// ReplaceFileW keeps the former file as the backup in the same step, it needs filename to exist though
+			if ( backupFilename != nullptr && ::GetFileAttributesW( filename ) != INVALID_FILE_ATTRIBUTES )
+				success = ::ReplaceFileW( filename, temporary.c_str(), backupFilename, REPLACEFILE_IGNORE_MERGE_ERRORS,
+				                          nullptr, nullptr ) != FALSE;
+			else
+				success = ::MoveFileExW( temporary.c_str(), filename,
+				                         MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH ) != FALSE;
+		}
+
+		if ( !success )
+			::DeleteFileW( temporary.c_str() );
+
+		return success;
+	}
+#else
+	namespace
+	{
+		bool GetNativePath( const std::wstring& path, std::string& nativePath )
+		{
+			nativePath.assign( path.size() * MB_CUR_MAX + 1, '\0' );
+			const size_t length = wcstombs( &nativePath[0], path.c_str(), nativePath.size() );
+			if ( length == static_cast<size_t>( -1 ) )
+				return false;
+
+			nativePath.resize( length );
+			return true;
+		}
+
+		bool WriteAll( int fd, const uint8_t* bytes, size_t size )
+		{
+			while ( size > 0 )
+			{
+				const ssize_t written = write( fd, bytes, size );
+				if ( written < 0 && errno == EINTR )
+					continue;
+
+				if ( written <= 0 )
+					return false;
+
+				bytes += written;
+				size -= static_cast<size_t>( written );
+			}
+
+			return true;
+		}
+
+		// A rename is only durable once the directory holding it is flushed
+		void SyncDirectory( const std::string& path )
+		{
+			const size_t      separator = path.find_last_of( '/' );
+			const std::string directory = separator == std::string::npos ? "." : path.substr( 0, separator + 1 );
+
+			const int fd = open( directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC );
+			if ( fd < 0 )
+				return;
+
+			fsync( fd );
+			close( fd );
+		}
+	} // namespace
+
+	bool WriteFileAtomic( const wchar_t* filename, const uint8_t* bytes, size_t size, const wchar_t* backupFilename )
+	{
+		std::string path;
+		std::string backup;
+		if ( !GetNativePath( filename, path ) )
+			return false;
+
+		if ( backupFilename != nullptr && !GetNativePath( backupFilename, backup ) )
+			return false;
+
+		const std::string temporary = path + ".tmp";
+
+		const int fd = open( temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644 );
+		if ( fd < 0 )
+			return false;
+
+		// the rename must not reach the disk before the content does
+		bool success = WriteAll( fd, bytes, size ) && fsync( fd ) == 0;
+		success      = close( fd ) == 0 && success;
+
+		if ( success && backupFilename != nullptr )
+		{
+			// a second link keeps filename in place the whole time and is renamed over the former backup,
+			// a missing filename just means there is nothing to back up yet
+			const std::string backupLink = backup + ".tmp";
+			unlink( backupLink.c_str() );
+			if ( link( path.c_str(), backupLink.c_str() ) == 0 )
+				success = rename( backupLink.c_str(), backup.c_str() ) == 0;
+			else
+				success = errno == ENOENT;
+		}
+
+		success = success && rename( temporary.c_str(), path.c_str() ) == 0;
+		if ( !success )
+		{
+			unlink( temporary.c_str() );
+			return false;
+		}
+
+		SyncDirectory( path );
+		return true;
+	}
+#endif
+} // namespace Theater
@@ -0,0 +1,10 @@
+#pragma once
+
+namespace Theater
+{
+	// Replaces filename with bytes so that a crash or power loss at any point leaves either the complete former
+	// or the complete new content behind, never a truncated file. The bytes go to a temporary file next to it
+	// which is flushed to disk and then renamed over filename.
+	// With a backupFilename the former content is kept there, one generation deep.
+	bool WriteFileAtomic( const wchar_t* filename, const uint8_t* bytes, size_t size, const wchar_t* backupFilename );
+} // namespace Theater
\ No newline at end of file
@@ -0,0 +1,70 @@
+#include "theater.h"
+#include "changebus.h"
+
+namespace Theater
+{
+	void ChangeBus::Subscribe( CHANGECALLBACK callback, uint32_t mask )
+	{
+		this->listeners.emplace_back( Listener{ callback, mask } );
+	}
+
+	void ChangeBus::Unsubscribe( CHANGECALLBACK callback )
+	{
+		auto iter = std::find_if( this->listeners.begin(), this->listeners.end(),
+		                          [callback]( const Listener& listener ) { return listener.callback == callback; } );
+		if ( iter == this->listeners.end() )
+			return;
+
+		this->listeners.erase( iter );
+	}
+
+	void ChangeBus::Publish( uint32_t changes )
+	{
+		this->pending |= changes;
+		if ( this->depth == 0 )
+			Flush();
+	}
+
+	void ChangeBus::Begin()
+	{
+		this->depth++;
+	}
+
+	void ChangeBus::Commit()
+	{
+		if ( this->depth == 0 )
+			return;
+
+		this->depth--;
+		if ( this->depth == 0 )
+			Flush();
+	}
+
+	uint32_t ChangeBus::GetPending() const
+	{
+		return this->pending;
+	}
+
+	void ChangeBus::Flush()
+	{
+		// the outer Flush picks up whatever the listeners publish
+		if ( this->dispatching )
+			return;
+
+		this->dispatching = true;
+		while ( this->pending != 0 )
+		{
+			const uint32_t changes = this->pending;
+			this->pending          = 0;
+
+			// listeners may unsubscribe while being called
+			const std::vector<Listener> current = this->listeners;
+			for ( const auto& listener : current )
+			{
+				if ( ( listener.mask & changes ) != 0 )
+					listener.callback( listener.mask & changes );
+			}
+		}
+		this->dispatching = false;
+	}
+} // namespace Theater
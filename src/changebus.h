@@ -0,0 +1,41 @@
+#pragma once
+
+namespace Theater
+{
+	// Dispatches change bitmasks to listeners subscribed to some of the bits.
+	// Changes published inside a transaction are merged and delivered once when the outermost transaction commits,
+	// changes published by a listener while dispatching are delivered after the current round.
+	class ChangeBus
+	{
+	public:
+		typedef void ( *CHANGECALLBACK )( uint32_t changes );
+
+		ChangeBus()  = default;
+		~ChangeBus() = default;
+
+		// A listener only sees the changes in mask
+		void Subscribe( CHANGECALLBACK callback, uint32_t mask );
+		void Unsubscribe( CHANGECALLBACK callback );
+
+		void Publish( uint32_t changes );
+
+		void     Begin();
+		void     Commit();
+		uint32_t GetPending() const;
+
+	private:
+		void Flush();
+
+	private:
+		struct Listener
+		{
+			CHANGECALLBACK callback;
+			uint32_t       mask;
+		};
+
+		std::vector<Listener> listeners;
+		uint32_t              pending     = 0;
+		uint32_t              depth       = 0;
+		bool                  dispatching = false;
+	};
+} // namespace Theater
\ No newline at end of file
@@ -8,18 +8,34 @@ namespace Theater
 	{
 		constexpr wchar_t DIMMER_WINDOWCLASS_NAME[] = L"TheaterDimmerWindow";
 		constexpr wchar_t DIMMER_WINDOW_NAME[]      = L"TheaterDimmerWindow";
+		constexpr UINT    DIMMER_WM_RECONCILE       = WM_APP + 1;
+
+		RECT GetTargetRect( HWND target )
+		{
+			// the window rect includes the invisible resize borders
+			RECT rc = {};
+			if ( ::DwmGetWindowAttribute( target, DWMWA_EXTENDED_FRAME_BOUNDS, &rc, sizeof( rc ) ) != S_OK )
+				::GetWindowRect( target, &rc );
+
+			return rc;
+		}
 	} // namespace
 
 	BOOL Dimmer::EnumMonitorsProc( HMONITOR handle, HDC dc, LPRECT rc, LPARAM lParam )
 	{
 		UNREFERENCED_PARAMETER( dc );
 
-		auto dimmer = reinterpret_cast<Dimmer*>( lParam );
+		auto monitors = reinterpret_cast<std::vector<MonitorInstance>*>( lParam );
+
+		MONITORINFOEXW info = {};
+		info.cbSize         = sizeof( info );
+		::GetMonitorInfoW( handle, &info );
 
 		MonitorInstance monitor = {};
 		monitor.handle          = handle;
 		monitor.rc              = *rc;
-		dimmer->monitors.emplace_back( std::move( monitor ) );
+		monitor.device          = info.szDevice;
+		monitors->emplace_back( std::move( monitor ) );
 		return TRUE;
 	}
 
@@ -31,7 +47,14 @@ namespace Theater
 			PAINTSTRUCT ps;
 			HDC         dc = ::BeginPaint( hWnd, &ps );
 
-			const COLORREF oldDCBrushColor = ::SetDCBrushColor( dc, this->clearColor );
+			COLORREF color = RGB( 0, 0, 0 );
+			for ( size_t i = 0; i < this->monitors.size(); i++ )
+			{
+				if ( this->monitors[i].hwnd == hWnd )
+					color = this->levels.GetColor( i );
+			}
+
+			const COLORREF oldDCBrushColor = ::SetDCBrushColor( dc, color );
 			::FillRect( dc, &ps.rcPaint, static_cast<HBRUSH>( ::GetStockObject( DC_BRUSH ) ) );
 			::SetDCBrushColor( dc, oldDCBrushColor );
 
@@ -42,6 +65,21 @@ namespace Theater
 		case WM_ERASEBKGND: {
 			return TRUE;
 		}
+		case WM_DISPLAYCHANGE:
+		case WM_DPICHANGED: {
+			// every dimmer window gets notified, only reconcile once
+			if ( !this->reconcilePending )
+			{
+				this->reconcilePending = true;
+				::PostMessageW( hWnd, DIMMER_WM_RECONCILE, 0, 0 );
+			}
+			return 0;
+		}
+		case DIMMER_WM_RECONCILE: {
+			this->reconcilePending = false;
+			Reconcile();
+			return 0;
+		}
 		}
 
 		return ::DefWindowProc( hWnd, message, wParam, lParam );
@@ -67,7 +105,7 @@ namespace Theater
 	bool Dimmer::WindowsCreate()
 	{
 		// enum all monitors
-		if ( !::EnumDisplayMonitors( nullptr, nullptr, EnumMonitorsProc, reinterpret_cast<LPARAM>(this) ))
+		if ( !::EnumDisplayMonitors( nullptr, nullptr, EnumMonitorsProc, reinterpret_cast<LPARAM>( &this->monitors ) ) )
 			return false;
 
 		const HINSTANCE hInstance = ::GetModuleHandleW( nullptr );
@@ -92,57 +130,195 @@ namespace Theater
 
 		// for each monitor, create a window overlapping the entire region
 		for ( auto& monitor : this->monitors )
-		{
-			const DWORD exStyle = WS_EX_LAYERED | WS_EX_TRANSPARENT | WS_EX_NOACTIVATE;
-			const DWORD style   = WS_POPUP;
-			monitor.hwnd =
-			    ::CreateWindowExW( exStyle, DIMMER_WINDOWCLASS_NAME, DIMMER_WINDOW_NAME, style, monitor.rc.left,
-			                       monitor.rc.top, monitor.rc.right - monitor.rc.left,
-			                       monitor.rc.bottom - monitor.rc.top, nullptr, nullptr, hInstance, this );
-			::SetLayeredWindowAttributes( monitor.hwnd, 0, 0, LWA_ALPHA );
-		}
+			WindowCreate( monitor );
 
+		LevelsAssign();
+		LevelsApply();
 		return true;
 	}
 
 	void Dimmer::WindowsDestroy()
 	{
 		for ( auto& monitor : this->monitors )
+		{
+			SurfaceDestroy( monitor );
 			::DestroyWindow( monitor.hwnd );
+		}
+
+		for ( const auto hwnd : this->windowPool )
+			::DestroyWindow( hwnd );
 
 		this->monitors.clear();
+		this->windowPool.clear();
 	}
 
-	bool Dimmer::Init()
+	bool Dimmer::WindowCreate( MonitorInstance& monitor )
 	{
-		return WindowsCreate();
+		const int x      = monitor.rc.left;
+		const int y      = monitor.rc.top;
+		const int width  = monitor.rc.right - monitor.rc.left;
+		const int height = monitor.rc.bottom - monitor.rc.top;
+
+		// retired windows are kept around, reusing one is cheaper than creating a new layered window
+		if ( !this->windowPool.empty() )
+		{
+			monitor.hwnd = this->windowPool.back();
+			this->windowPool.pop_back();
+
+			// it might have been driven by UpdateLayeredWindow, start over from a plain layered window
+			const LONG_PTR exStyle = ::GetWindowLongPtrW( monitor.hwnd, GWL_EXSTYLE );
+			::SetWindowLongPtrW( monitor.hwnd, GWL_EXSTYLE, exStyle & ~WS_EX_LAYERED );
+			::SetWindowLongPtrW( monitor.hwnd, GWL_EXSTYLE, exStyle );
+			::SetWindowPos( monitor.hwnd, this->spotlight ? HWND_TOPMOST : HWND_NOTOPMOST, x, y, width, height,
+			                SWP_NOACTIVATE );
+		}
+		else
+		{
+			const DWORD exStyle = WS_EX_LAYERED | WS_EX_TRANSPARENT | WS_EX_NOACTIVATE;
+			const DWORD style   = WS_POPUP;
+			monitor.hwnd = ::CreateWindowExW( exStyle, DIMMER_WINDOWCLASS_NAME, DIMMER_WINDOW_NAME, style, x, y, width,
+			                                  height, nullptr, nullptr, ::GetModuleHandleW( nullptr ), this );
+			if ( monitor.hwnd == nullptr )
+				return false;
+
+			if ( this->spotlight )
+				::SetWindowPos( monitor.hwnd, HWND_TOPMOST, 0, 0, 0, 0, SWP_NOMOVE | SWP_NOSIZE | SWP_NOACTIVATE );
+		}
+
+		// alpha and color are applied once the monitor levels are bound
+		if ( !this->surfaces || !SurfaceCreate( monitor ) )
+			::SetLayeredWindowAttributes( monitor.hwnd, 0, 0, LWA_ALPHA );
+
+		if ( this->shown )
+			::ShowWindow( monitor.hwnd, SW_SHOWNOACTIVATE );
+
+		return true;
 	}
 
-	void Dimmer::Show( bool state )
+	void Dimmer::WindowMove( MonitorInstance& monitor, const RECT& formerRect )
 	{
-		for ( const auto& monitor : this->monitors )
-			::ShowWindow( monitor.hwnd, state ? SW_SHOWNOACTIVATE : SW_HIDE );
+		const int width  = monitor.rc.right - monitor.rc.left;
+		const int height = monitor.rc.bottom - monitor.rc.top;
+		::SetWindowPos( monitor.hwnd, nullptr, monitor.rc.left, monitor.rc.top, width, height,
+		                SWP_NOZORDER | SWP_NOACTIVATE );
+
+		if ( monitor.surfacePixels == nullptr )
+			return;
+
+		// a new size needs a new DIB section, otherwise only the target moved relative to the monitor
+		const bool resized =
+		    width != formerRect.right - formerRect.left || height != formerRect.bottom - formerRect.top;
+		if ( resized )
+		{
+			SurfaceCreate( monitor );
+		}
+		else
+		{
+			SurfaceSetTarget( monitor );
+		}
 	}
 
-	void Dimmer::SetAlpha( float alpha )
+	void Dimmer::WindowRetire( MonitorInstance& monitor )
 	{
-		const BYTE alpha256 =
-		    static_cast<BYTE>( std::min( static_cast<DWORD>( 255 ), static_cast<DWORD>( alpha * 255.0f + 0.5f ) ) );
-		for ( const auto& monitor : this->monitors )
-			::SetLayeredWindowAttributes( monitor.hwnd, 0, alpha256, LWA_ALPHA );
+		SurfaceDestroy( monitor );
+		::ShowWindow( monitor.hwnd, SW_HIDE );
+		this->windowPool.emplace_back( monitor.hwnd );
+		monitor.hwnd = nullptr;
 	}
 
-	void Dimmer::SetColor( COLORREF rgb )
+	void Dimmer::Reconcile()
 	{
-		this->clearColor = rgb;
+		std::vector<MonitorInstance> next;
+		if ( !::EnumDisplayMonitors( nullptr, nullptr, EnumMonitorsProc, reinterpret_cast<LPARAM>( &next ) ) )
+			return;
 
+		std::vector<MonitorLayout> formerLayouts;
+		std::vector<MonitorLayout> nextLayouts;
+		formerLayouts.reserve( this->monitors.size() );
+		nextLayouts.reserve( next.size() );
 		for ( const auto& monitor : this->monitors )
+			formerLayouts.emplace_back( MonitorLayout{ monitor.device, monitor.rc.left, monitor.rc.top,
+			                                           monitor.rc.right, monitor.rc.bottom } );
+		for ( const auto& monitor : next )
+			nextLayouts.emplace_back(
+			    MonitorLayout{ monitor.device, monitor.rc.left, monitor.rc.top, monitor.rc.right, monitor.rc.bottom } );
+
+		MonitorTopologyDiff diff;
+		DiffMonitorTopology( formerLayouts, nextLayouts, diff );
+
+		// retire first so created monitors can reuse those windows right away
+		for ( const size_t index : diff.retired )
+			WindowRetire( this->monitors[index] );
+
+		bool changed = !diff.retired.empty();
+		for ( size_t i = 0; i < next.size(); i++ )
 		{
-			if ( !::IsWindowVisible( monitor.hwnd ) )
+			const auto& entry = diff.entries[i];
+			if ( entry.action == MonitorAction::Create )
+			{
+				WindowCreate( next[i] );
+				changed = true;
 				continue;
+			}
 
-			::InvalidateRect( monitor.hwnd, nullptr, FALSE );
+			// take the former window and surface over, only the monitor identity comes from the new set
+			MonitorInstance monitor = std::move( this->monitors[entry.source] );
+			const RECT      former  = monitor.rc;
+			monitor.handle          = next[i].handle;
+			monitor.rc              = next[i].rc;
+			monitor.device          = std::move( next[i].device );
+			next[i]                 = std::move( monitor );
+
+			if ( entry.action == MonitorAction::Move )
+			{
+				WindowMove( next[i], former );
+				changed = true;
+			}
+		}
+
+		this->monitors = std::move( next );
+
+		// monitors taken over keep their levels, the others are presented once bound
+		LevelsAssign();
+		for ( size_t i = 0; i < diff.entries.size(); i++ )
+		{
+			if ( diff.entries[i].action != MonitorAction::Keep )
+				this->levels.Invalidate( i );
 		}
+		LevelsApply();
+
+		if ( changed && this->topologyCallback != nullptr )
+			this->topologyCallback();
+	}
+
+	void Dimmer::SetTopologyChangedCallback( TOPOLOGYCHANGEDCALLBACK callback )
+	{
+		this->topologyCallback = callback;
+	}
+
+	bool Dimmer::Init( Platform* value )
+	{
+		this->platform = value;
+		return WindowsCreate();
+	}
+
+	void Dimmer::Show( bool state )
+	{
+		this->shown = state;
+		for ( const auto& monitor : this->monitors )
+			::ShowWindow( monitor.hwnd, state ? SW_SHOWNOACTIVATE : SW_HIDE );
+	}
+
+	void Dimmer::SetAlpha( float alpha )
+	{
+		this->levels.SetFade( alpha );
+		LevelsApply();
+	}
+
+	void Dimmer::SetColor( COLORREF rgb )
+	{
+		this->levels.SetBaseColor( rgb );
+		LevelsApply();
 	}
 
 	void Dimmer::SetColor( float r, float g, float b )
@@ -156,6 +332,289 @@ namespace Theater
 		SetColor( RGB( r256, g256, b256 ) );
 	}
 
+	void Dimmer::SetLevels( BYTE alpha, const std::vector<MonitorLevel>& overrides )
+	{
+		this->levels.SetBaseAlpha( alpha );
+		this->levels.SetOverrides( overrides );
+		LevelsApply();
+	}
+
+	void Dimmer::LevelsAssign()
+	{
+		std::vector<std::wstring> devices;
+		devices.reserve( this->monitors.size() );
+		this->levelWindows.clear();
+		for ( const auto& monitor : this->monitors )
+		{
+			devices.emplace_back( monitor.device );
+			this->levelWindows.emplace_back( reinterpret_cast<Platform::WindowId>( monitor.hwnd ) );
+		}
+
+		this->levels.Assign( devices.data(), devices.size() );
+	}
+
+	void Dimmer::LevelsApply()
+	{
+		// called on every fade tick, only monitors whose quantized alpha or color changed are touched
+		if ( !this->surfaces )
+		{
+			if ( !this->levels.Apply( *this->platform, this->levelWindows.data(), this->levelChanges ) )
+				return;
+
+			for ( const auto& change : this->levelChanges )
+			{
+				const HWND hwnd = this->monitors[change.index].hwnd;
+				if ( ( change.flags & MonitorLevels::COLOR_CHANGED ) && ::IsWindowVisible( hwnd ) )
+					::InvalidateRect( hwnd, nullptr, FALSE );
+			}
+			return;
+		}
+
+		if ( !this->levels.Update( this->levelChanges ) )
+			return;
+
+		for ( const auto& change : this->levelChanges )
+		{
+			auto&          monitor = this->monitors[change.index];
+			const COLORREF color   = this->levels.GetColor( change.index );
+			if ( change.flags & MonitorLevels::COLOR_CHANGED )
+				monitor.surface.SetColor( GetRValue( color ), GetGValue( color ), GetBValue( color ) );
+			SurfacePresent( monitor, this->levels.GetAlpha( change.index ) );
+		}
+	}
+
+	bool Dimmer::SetSpotlight( bool state, uint32_t feather )
+	{
+		const bool wasSpotlight = this->spotlight;
+		this->spotlight         = state;
+		this->spotlightFeather  = feather;
+
+		const bool success = SurfacesUpdate();
+		if ( this->spotlight != wasSpotlight )
+		{
+			// with a hole in them the dimmers can stay on top of everything
+			for ( const auto& monitor : this->monitors )
+				::SetWindowPos( monitor.hwnd, this->spotlight ? HWND_TOPMOST : HWND_NOTOPMOST, 0, 0, 0, 0,
+				                SWP_NOMOVE | SWP_NOSIZE | SWP_NOACTIVATE );
+		}
+
+		for ( size_t i = 0; i < this->monitors.size(); i++ )
+		{
+			this->monitors[i].surface.SetHole( this->spotlight, this->spotlightFeather );
+			SurfacePresent( this->monitors[i], this->levels.GetAlpha( i ) );
+		}
+
+		return success;
+	}
+
+	bool Dimmer::IsSpotlightEnabled() const
+	{
+		return this->spotlight;
+	}
+
+	bool Dimmer::SetGradient( const GradientParams& params )
+	{
+		this->gradient = params;
+
+		const bool success = SurfacesUpdate();
+		for ( size_t i = 0; i < this->monitors.size(); i++ )
+		{
+			this->monitors[i].surface.SetGradient( this->gradient );
+			SurfacePresent( this->monitors[i], this->levels.GetAlpha( i ) );
+		}
+
+		return success;
+	}
+
+	void Dimmer::SetTarget( HWND hwnd )
+	{
+		this->target = hwnd;
+		if ( !this->surfaces )
+			return;
+
+		for ( size_t i = 0; i < this->monitors.size(); i++ )
+		{
+			SurfaceSetTarget( this->monitors[i] );
+			SurfacePresent( this->monitors[i], this->levels.GetAlpha( i ) );
+		}
+	}
+
+	void Dimmer::MoveTarget( uint64_t monitors )
+	{
+		if ( !this->surfaces )
+			return;
+
+		const bool gradient = this->gradient.kind != GradientKind::None;
+		for ( size_t i = 0; i < this->monitors.size(); i++ )
+		{
+			// monitors past the mask can't be told apart, they are always presented
+			if ( !gradient && i < 64 && ( monitors & ( 1ull << i ) ) == 0 )
+				continue;
+
+			SurfaceSetTarget( this->monitors[i] );
+			SurfacePresent( this->monitors[i], this->levels.GetAlpha( i ) );
+		}
+	}
+
+	bool Dimmer::IsFollowingTarget() const
+	{
+		return this->surfaces;
+	}
+
+	bool Dimmer::SurfacesUpdate()
+	{
+		const bool state = this->spotlight || this->gradient.kind != GradientKind::None;
+		if ( state == this->surfaces )
+			return true;
+
+		this->surfaces = state;
+
+		bool success = true;
+		for ( auto& monitor : this->monitors )
+		{
+			// a layered window is either driven by SetLayeredWindowAttributes or UpdateLayeredWindow,
+			// switching between the two needs the layered style to be reset
+			const LONG_PTR exStyle = ::GetWindowLongPtrW( monitor.hwnd, GWL_EXSTYLE );
+			::SetWindowLongPtrW( monitor.hwnd, GWL_EXSTYLE, exStyle & ~WS_EX_LAYERED );
+			::SetWindowLongPtrW( monitor.hwnd, GWL_EXSTYLE, exStyle );
+
+			if ( state )
+			{
+				success = success && SurfaceCreate( monitor );
+			}
+			else
+			{
+				SurfaceDestroy( monitor );
+			}
+		}
+
+		// out of GDI memory, back to the plain dimmers
+		if ( !success )
+		{
+			this->spotlight     = false;
+			this->gradient.kind = GradientKind::None;
+			SurfacesUpdate();
+		}
+
+		// the windows switched to the other layered mode, present them all again
+		this->levels.InvalidateAll();
+		LevelsApply();
+		return success;
+	}
+
+	bool Dimmer::SurfaceCreate( MonitorInstance& monitor )
+	{
+		SurfaceDestroy( monitor );
+
+		const LONG width  = monitor.rc.right - monitor.rc.left;
+		const LONG height = monitor.rc.bottom - monitor.rc.top;
+
+		BITMAPINFO bmi              = {};
+		bmi.bmiHeader.biSize        = sizeof( BITMAPINFOHEADER );
+		bmi.bmiHeader.biWidth       = width;
+		bmi.bmiHeader.biHeight      = -height; // top-down
+		bmi.bmiHeader.biPlanes      = 1;
+		bmi.bmiHeader.biBitCount    = 32;
+		bmi.bmiHeader.biCompression = BI_RGB;
+
+		monitor.surfaceDC = ::CreateCompatibleDC( nullptr );
+		if ( monitor.surfaceDC == nullptr )
+			return false;
+
+		void* bits            = nullptr;
+		monitor.surfaceBitmap = ::CreateDIBSection( monitor.surfaceDC, &bmi, DIB_RGB_COLORS, &bits, nullptr, 0 );
+		if ( monitor.surfaceBitmap == nullptr )
+		{
+			SurfaceDestroy( monitor );
+			return false;
+		}
+
+		monitor.surfaceOldBitmap = ::SelectObject( monitor.surfaceDC, monitor.surfaceBitmap );
+		monitor.surfacePixels    = static_cast<uint32_t*>( bits );
+
+		// a fresh surface is entirely dirty, the first present uploads all of it
+		monitor.surface = SpotlightSurface();
+		monitor.surface.Resize( static_cast<uint32_t>( width ), static_cast<uint32_t>( height ) );
+		monitor.surface.SetGradient( this->gradient );
+		monitor.surface.SetHole( this->spotlight, this->spotlightFeather );
+		SurfaceSetTarget( monitor );
+		return true;
+	}
+
+	void Dimmer::SurfaceSetTarget( MonitorInstance& monitor )
+	{
+		SpotlightSurface::Rect rect = {};
+		if ( this->target != nullptr && ::IsWindow( this->target ) )
+		{
+			// surface coordinates are relative to the monitor
+			const RECT targetRect = GetTargetRect( this->target );
+			rect.left             = targetRect.left - monitor.rc.left;
+			rect.top              = targetRect.top - monitor.rc.top;
+			rect.right            = targetRect.right - monitor.rc.left;
+			rect.bottom           = targetRect.bottom - monitor.rc.top;
+		}
+
+		monitor.surface.SetTarget( rect );
+	}
+
+	void Dimmer::SurfaceDestroy( MonitorInstance& monitor )
+	{
+		if ( monitor.surfaceDC != nullptr && monitor.surfaceOldBitmap != nullptr )
+			::SelectObject( monitor.surfaceDC, monitor.surfaceOldBitmap );
+
+		if ( monitor.surfaceBitmap != nullptr )
+			::DeleteObject( monitor.surfaceBitmap );
+
+		if ( monitor.surfaceDC != nullptr )
+			::DeleteDC( monitor.surfaceDC );
+
+		monitor.surfaceDC        = nullptr;
+		monitor.surfaceBitmap    = nullptr;
+		monitor.surfaceOldBitmap = nullptr;
+		monitor.surfacePixels    = nullptr;
+	}
+
+	void Dimmer::SurfacePresent( MonitorInstance& monitor, BYTE alpha )
+	{
+		if ( monitor.surfacePixels == nullptr )
+			return;
+
+		BLENDFUNCTION blend       = {};
+		blend.BlendOp             = AC_SRC_OVER;
+		blend.SourceConstantAlpha = alpha;
+		blend.AlphaFormat         = AC_SRC_ALPHA;
+
+		uint32_t firstRow = 0;
+		uint32_t rowCount = 0;
+		if ( !monitor.surface.GetDirtyRows( firstRow, rowCount ) )
+		{
+			// only the fade alpha changed, the window keeps its current content
+			::UpdateLayeredWindow( monitor.hwnd, nullptr, nullptr, nullptr, nullptr, nullptr, 0, &blend, ULW_ALPHA );
+			return;
+		}
+
+		monitor.surface.Render( monitor.surfacePixels, monitor.surface.GetWidth() );
+
+		const LONG width  = static_cast<LONG>( monitor.surface.GetWidth() );
+		const LONG height = static_cast<LONG>( monitor.surface.GetHeight() );
+
+		POINT dst   = { monitor.rc.left, monitor.rc.top };
+		POINT src   = { 0, 0 };
+		SIZE  size  = { width, height };
+		RECT  dirty = { 0, static_cast<LONG>( firstRow ), width, static_cast<LONG>( firstRow + rowCount ) };
+
+		UPDATELAYEREDWINDOWINFO info = {};
+		info.cbSize                  = sizeof( info );
+		info.pptDst                  = &dst;
+		info.psize                   = &size;
+		info.hdcSrc                  = monitor.surfaceDC;
+		info.pptSrc                  = &src;
+		info.pblend                  = &blend;
+		info.dwFlags                 = ULW_ALPHA;
+		info.prcDirty                = &dirty;
+		::UpdateLayeredWindowIndirect( monitor.hwnd, &info );
+	}
+
 	void Dimmer::Close()
 	{
 		WindowsDestroy();
@@ -172,4 +631,19 @@ namespace Theater
 		return false;
 	}
 
+	size_t Dimmer::GetWindowCount() const
+	{
+		return this->monitors.size();
+	}
+
+	HWND Dimmer::GetWindowHandle( size_t index ) const
+	{
+		return this->monitors[index].hwnd;
+	}
+
+	RECT Dimmer::GetMonitorRect( size_t index ) const
+	{
+		return this->monitors[index].rc;
+	}
+
 } // namespace Theater
@@ -7,34 +7,91 @@ namespace Theater
 		Dimmer()  = default;
 		~Dimmer() = default;
 
-		bool Init();
+		// Plain dimmer windows get their alpha through platform
+		bool Init( Platform* platform );
 		void Close();
 
-		void Show( bool state );
-		bool IsDimmerWindow( HWND hwnd ) const;
+		void   Show( bool state );
+		bool   IsDimmerWindow( HWND hwnd ) const;
+		size_t GetWindowCount() const;
+		HWND   GetWindowHandle( size_t index ) const;
+		RECT   GetMonitorRect( size_t index ) const;
 
 		void SetAlpha( float alpha );
 		void SetColor( COLORREF rgb );
 		void SetColor( float r, float g, float b );
 
+		// Per monitor overrides, alpha is where each monitor lands when the fade reaches the global alpha
+		void SetLevels( BYTE alpha, const std::vector<MonitorLevel>& overrides );
+
+		// Spotlight mode keeps the dimmers above everything and cuts a hole over the target instead
+		bool SetSpotlight( bool state, uint32_t feather );
+		bool IsSpotlightEnabled() const;
+		bool SetGradient( const GradientParams& params );
+		void SetTarget( HWND hwnd );
+
+		// The target moved without changing size or monitors, monitors has a bit per monitor it intersects.
+		// Only those are presented again unless a gradient centered on the target spans every monitor.
+		void MoveTarget( uint64_t monitors );
+
+		// Plain dimmers don't depend on where the target is
+		bool IsFollowingTarget() const;
+
+		// Called after display changes added, moved or retired dimmer windows
+		typedef void ( *TOPOLOGYCHANGEDCALLBACK )();
+		void SetTopologyChangedCallback( TOPOLOGYCHANGEDCALLBACK callback );
+
 	private:
 		struct MonitorInstance
 		{
-			HMONITOR handle;
-			RECT     rc;
-			HWND     hwnd;
+			HMONITOR     handle;
+			RECT         rc;
+			HWND         hwnd;
+			std::wstring device;
+
+			// spotlight or gradient only, the surface renders straight into the DIB section
+			HDC              surfaceDC;
+			HBITMAP          surfaceBitmap;
+			HGDIOBJ          surfaceOldBitmap;
+			uint32_t*        surfacePixels;
+			SpotlightSurface surface;
 		};
 
 		static BOOL EnumMonitorsProc( HMONITOR handle, HDC dc, LPRECT rc, LPARAM lParam );
 
 		bool                    WindowsCreate();
 		void                    WindowsDestroy();
+		bool                    WindowCreate( MonitorInstance& monitor );
+		void                    WindowMove( MonitorInstance& monitor, const RECT& formerRect );
+		void                    WindowRetire( MonitorInstance& monitor );
+		void                    Reconcile();
+		bool                    SurfaceCreate( MonitorInstance& monitor );
+		void                    SurfaceDestroy( MonitorInstance& monitor );
+		void                    SurfacePresent( MonitorInstance& monitor, BYTE alpha );
+		void                    SurfaceSetTarget( MonitorInstance& monitor );
+		bool                    SurfacesUpdate();
+		void                    LevelsAssign();
+		void                    LevelsApply();
 		LRESULT                 OnMessage( HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam );
 		static LRESULT CALLBACK WndProc( HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam );
 
 	private:
+		Platform*                    platform = nullptr;
 		std::vector<MonitorInstance> monitors;
-		COLORREF                     clearColor = RGB( 0, 0, 0 );
+		std::vector<HWND>            windowPool;
+		bool                         shown            = false;
+		bool                         reconcilePending = false;
+		TOPOLOGYCHANGEDCALLBACK      topologyCallback = nullptr;
+		HWND                         target           = nullptr;
+		bool                         surfaces         = false;
+		bool                         spotlight        = false;
+		uint32_t                     spotlightFeather = 0;
+		GradientParams               gradient         = { GradientKind::None, 0.0f, 0.0f };
+
+		// alpha and color of each monitor, indexed like monitors
+		MonitorLevels                      levels;
+		std::vector<MonitorLevels::Change> levelChanges;
+		std::vector<Platform::WindowId>    levelWindows;
 	};
 
 } // namespace Theater
\ No newline at end of file
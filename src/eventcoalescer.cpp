@@ -0,0 +1,71 @@
+#include "theater.h"
+#include "eventcoalescer.h"
+
+namespace Theater
+{
+	void WindowEventCoalescer::SetDelay( uint32_t delayMs )
+	{
+		this->delay = delayMs;
+	}
+
+	void WindowEventCoalescer::Clear()
+	{
+		this->pending    = {};
+		this->hasPending = false;
+		this->deadline   = 0;
+	}
+
+	bool WindowEventCoalescer::Push( const WindowEvent& event, uint64_t nowMs )
+	{
+		if ( event.type != WindowEventType::Foreground )
+		{
+			// no point in resolving a window that's gone, the next foreground change will follow anyway
+			if ( event.type == WindowEventType::Destroyed && this->hasPending && this->pending.window == event.window )
+			{
+				this->hasPending = false;
+				this->coalescedCount++;
+			}
+
+			return true;
+		}
+
+		if ( this->hasPending )
+		{
+			this->coalescedCount++;
+		}
+		else
+		{
+			this->hasPending = true;
+			this->deadline   = nowMs + this->delay;
+		}
+
+		this->pending = event;
+		return false;
+	}
+
+	bool WindowEventCoalescer::PopForeground( uint64_t nowMs, WindowEvent& event )
+	{
+		if ( !this->hasPending || nowMs < this->deadline )
+			return false;
+
+		event            = this->pending;
+		this->hasPending = false;
+		return true;
+	}
+
+	uint32_t WindowEventCoalescer::GetTimeout( uint64_t nowMs ) const
+	{
+		if ( !this->hasPending )
+			return NO_TIMEOUT;
+
+		if ( nowMs >= this->deadline )
+			return 0;
+
+		return static_cast<uint32_t>( this->deadline - nowMs );
+	}
+
+	size_t WindowEventCoalescer::GetCoalescedCount() const
+	{
+		return this->coalescedCount;
+	}
+} // namespace Theater
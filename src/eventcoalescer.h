@@ -0,0 +1,59 @@
+#pragma once
+
+namespace Theater
+{
+	enum class WindowEventType : uint8_t
+	{
+		Foreground,
+		Created,
+		Destroyed,
+		Shown,
+		Hidden,
+		Cloaked,
+		Uncloaked,
+		LocationChanged // only from the location hook, see Platform::StartLocationHook
+	};
+
+	// Compact record pushed by the event hook, everything else is queried later by whoever handles it
+	struct WindowEvent
+	{
+		WindowEventType type;
+		uint32_t        time;
+		uintptr_t       window;
+	};
+
+	// Holds foreground changes back for a short delay so a burst of them (alt-tab cycling, a launcher handing
+	// focus to its game) only acts on the last one. The delay starts with the first change of a burst and is
+	// not extended by the following ones, which bounds the added latency.
+	// Every other event goes through untouched and in order.
+	class WindowEventCoalescer
+	{
+	public:
+		static constexpr uint32_t NO_TIMEOUT    = 0xFFFFFFFFu;
+		static constexpr uint32_t DEFAULT_DELAY = 20;
+
+		WindowEventCoalescer()  = default;
+		~WindowEventCoalescer() = default;
+
+		void SetDelay( uint32_t delayMs );
+		void Clear();
+
+		// Returns true when the event should be handled right away, foreground changes are kept for PopForeground
+		bool Push( const WindowEvent& event, uint64_t nowMs );
+
+		// Latest foreground change once its burst delay elapsed
+		bool PopForeground( uint64_t nowMs, WindowEvent& event );
+
+		// Milliseconds until PopForeground can succeed, NO_TIMEOUT when nothing is pending
+		uint32_t GetTimeout( uint64_t nowMs ) const;
+
+		size_t GetCoalescedCount() const;
+
+	private:
+		WindowEvent pending        = {};
+		bool        hasPending     = false;
+		uint64_t    deadline       = 0;
+		uint32_t    delay          = DEFAULT_DELAY;
+		size_t      coalescedCount = 0;
+	};
+} // namespace Theater
\ No newline at end of file
@@ -0,0 +1,416 @@
+#include "theater.h"
+#include "eventlog.h"
+#include <limits>
+
+namespace Theater
+{
+	namespace
+	{
+		constexpr uint8_t  EVENT_LOG_MAGIC[]   = { 'T', 'H', 'E', 'L' };
+		constexpr uint32_t EVENT_LOG_VERSION   = 1;
+		constexpr uint32_t WINDOW_FLAG_VISIBLE = 1 << 0;
+		constexpr uint32_t WINDOW_FLAG_TOPMOST = 1 << 1;
+		constexpr uint32_t WINDOW_FLAG_CLOAKED = 1 << 2;
+
+		// strings are stored as UTF-16 code units whatever the size of wchar_t, logs move between platforms
+		void EncodeUtf16( const std::wstring& value, std::vector<uint16_t>& units )
+		{
+			units.clear();
+			for ( const wchar_t c : value )
+			{
+				const uint32_t codePoint = static_cast<uint32_t>( c );
+				if ( codePoint > 0xFFFF )
+				{
+					units.emplace_back( static_cast<uint16_t>( 0xD800 + ( ( codePoint - 0x10000 ) >> 10 ) ) );
+					units.emplace_back( static_cast<uint16_t>( 0xDC00 + ( ( codePoint - 0x10000 ) & 0x3FF ) ) );
+				}
+				else
+				{
+					units.emplace_back( static_cast<uint16_t>( codePoint ) );
+				}
+			}
+		}
+
+		void DecodeUtf16( const std::vector<uint16_t>& units, std::wstring& value )
+		{
+			value.clear();
+			value.reserve( units.size() );
+			for ( size_t i = 0; i < units.size(); i++ )
+			{
+				const uint32_t high = units[i];
+				const uint32_t low  = i + 1 < units.size() ? units[i + 1] : 0;
+				if ( sizeof( wchar_t ) == 4 && high >= 0xD800 && high < 0xDC00 && low >= 0xDC00 && low < 0xE000 )
+				{
+					value.push_back( static_cast<wchar_t>( 0x10000 + ( ( high - 0xD800 ) << 10 ) + ( low - 0xDC00 ) ) );
+					i++;
+					continue;
+				}
+
+				value.push_back( static_cast<wchar_t>( high ) );
+			}
+		}
+
+		class LogReader
+		{
+		public:
+			LogReader( const uint8_t* data, size_t size ) : current( data ), end( data + size )
+			{
+			}
+
+			bool IsAtEnd() const
+			{
+				return this->current == this->end;
+			}
+
+			bool ReadByte( uint8_t& value )
+			{
+				if ( this->current == this->end )
+					return false;
+
+				value = *this->current++;
+				return true;
+			}
+
+			bool ReadVarint( uint64_t& value )
+			{
+				value = 0;
+				for ( uint32_t shift = 0; shift < 64; shift += 7 )
+				{
+					uint8_t byte = 0;
+					if ( !ReadByte( byte ) )
+						return false;
+
+					value |= static_cast<uint64_t>( byte & 0x7F ) << shift;
+					if ( ( byte & 0x80 ) == 0 )
+						return true;
+				}
+
+				return false;
+			}
+
+			template<typename T>
+			bool Read( T& value )
+			{
+				uint64_t raw = 0;
+				if ( !ReadVarint( raw ) || raw > static_cast<uint64_t>( std::numeric_limits<T>::max() ) )
+					return false;
+
+				value = static_cast<T>( raw );
+				return true;
+			}
+
+			bool ReadSigned( int32_t& value )
+			{
+				uint64_t raw = 0;
+				if ( !ReadVarint( raw ) )
+					return false;
+
+				const int64_t decoded = static_cast<int64_t>( raw >> 1 ) ^ -static_cast<int64_t>( raw & 1 );
+				if ( decoded < std::numeric_limits<int32_t>::min() || decoded > std::numeric_limits<int32_t>::max() )
+					return false;
+
+				value = static_cast<int32_t>( decoded );
+				return true;
+			}
+
+			bool ReadRect( PlatformRect& rect )
+			{
+				return ReadSigned( rect.left ) && ReadSigned( rect.top ) && ReadSigned( rect.right ) &&
+				       ReadSigned( rect.bottom );
+			}
+
+			bool ReadStringRef( const std::vector<std::wstring>& strings, std::wstring& value )
+			{
+				size_t index = 0;
+				if ( !Read( index ) || index >= strings.size() )
+					return false;
+
+				value = strings[index];
+				return true;
+			}
+
+		private:
+			const uint8_t* current;
+			const uint8_t* end;
+		};
+	} // namespace
+
+	void EventLogWriter::Begin( const Platform& platform, uint32_t currentPid, const ProcessNameSet& targetNames,
+	                            const ProcessNameSet& companionNames )
+	{
+		Clear();
+		this->currentPid = currentPid;
+
+		this->bytes.insert( this->bytes.end(), std::begin( EVENT_LOG_MAGIC ), std::end( EVENT_LOG_MAGIC ) );
+		WriteVarint( EVENT_LOG_VERSION );
+
+		for ( const auto name : targetNames )
+		{
+			const uint32_t index = WriteString( std::wstring( name ) );
+			this->bytes.emplace_back( static_cast<uint8_t>( EventLogRecord::TargetName ) );
+			WriteVarint( index );
+		}
+
+		for ( const auto name : companionNames )
+		{
+			const uint32_t index = WriteString( std::wstring( name ) );
+			this->bytes.emplace_back( static_cast<uint8_t>( EventLogRecord::CompanionName ) );
+			WriteVarint( index );
+		}
+
+		std::vector<PlatformMonitor> monitors;
+		platform.EnumMonitors( monitors );
+		for ( const auto& monitor : monitors )
+		{
+			const uint32_t device = WriteString( monitor.device );
+			this->bytes.emplace_back( static_cast<uint8_t>( EventLogRecord::Monitor ) );
+			WriteVarint( device );
+			WriteRect( monitor.rect );
+		}
+
+		// bottom to top, a replay adding them in order ends up with the same z-order
+		std::vector<Platform::WindowId> zOrder;
+		for ( auto window = platform.GetTopWindow(); window != Platform::NO_WINDOW; )
+		{
+			zOrder.emplace_back( window );
+			window = platform.GetWindowBelow( window );
+		}
+
+		for ( auto window = zOrder.rbegin(); window != zOrder.rend(); ++window )
+			WriteWindow( platform, *window );
+	}
+
+	void EventLogWriter::Write( const Platform& platform, const WindowEvent& event )
+	{
+		// a window created before the snapshot but not in it is still worth knowing when it shows up
+		if ( event.type != WindowEventType::Destroyed && this->windows.count( event.window ) == 0 &&
+		     !WriteWindow( platform, event.window ) )
+			return;
+
+		this->bytes.emplace_back( static_cast<uint8_t>( EventLogRecord::Event ) );
+		this->bytes.emplace_back( static_cast<uint8_t>( event.type ) );
+		WriteVarint( this->hasTime ? static_cast<uint32_t>( event.time - this->lastTime ) : 0 );
+		WriteVarint( event.window );
+
+		this->lastTime = event.time;
+		this->hasTime  = true;
+
+		if ( event.type == WindowEventType::Destroyed )
+			this->windows.erase( event.window );
+	}
+
+	const std::vector<uint8_t>& EventLogWriter::GetBytes() const
+	{
+		return this->bytes;
+	}
+
+	void EventLogWriter::Clear()
+	{
+		this->bytes.clear();
+		this->strings.clear();
+		this->processes.clear();
+		this->windows.clear();
+		this->currentPid = 0;
+		this->lastTime   = 0;
+		this->hasTime    = false;
+	}
+
+	void EventLogWriter::WriteVarint( uint64_t value )
+	{
+		while ( value >= 0x80 )
+		{
+			this->bytes.emplace_back( static_cast<uint8_t>( value | 0x80 ) );
+			value >>= 7;
+		}
+
+		this->bytes.emplace_back( static_cast<uint8_t>( value ) );
+	}
+
+	void EventLogWriter::WriteSigned( int64_t value )
+	{
+		WriteVarint( ( static_cast<uint64_t>( value ) << 1 ) ^ static_cast<uint64_t>( value >> 63 ) );
+	}
+
+	void EventLogWriter::WriteRect( const PlatformRect& rect )
+	{
+		WriteSigned( rect.left );
+		WriteSigned( rect.top );
+		WriteSigned( rect.right );
+		WriteSigned( rect.bottom );
+	}
+
+	uint32_t EventLogWriter::WriteString( const std::wstring& value )
+	{
+		const auto iter = this->strings.find( value );
+		if ( iter != this->strings.end() )
+			return iter->second;
+
+		std::vector<uint16_t> units;
+		EncodeUtf16( value, units );
+
+		this->bytes.emplace_back( static_cast<uint8_t>( EventLogRecord::String ) );
+		WriteVarint( units.size() );
+		for ( const auto unit : units )
+			WriteVarint( unit );
+
+		const auto index = static_cast<uint32_t>( this->strings.size() );
+		this->strings.emplace( value, index );
+		return index;
+	}
+
+	void EventLogWriter::WriteProcess( const Platform& platform, uint32_t pid )
+	{
+		if ( !this->processes.insert( pid ).second )
+			return;
+
+		// the path of an elevated process can't be read, it is replayed as a process without a name
+		std::wstring path;
+		std::wstring name;
+		platform.QueryProcessPath( pid, path, name );
+
+		const uint32_t pathIndex = WriteString( path );
+		this->bytes.emplace_back( static_cast<uint8_t>( EventLogRecord::Process ) );
+		WriteVarint( pid );
+		WriteVarint( pathIndex );
+	}
+
+	bool EventLogWriter::WriteWindow( const Platform& platform, Platform::WindowId window )
+	{
+		const uint32_t pid = platform.GetWindowProcessId( window );
+		if ( pid == 0 || pid == this->currentPid )
+			return false;
+
+		WriteProcess( platform, pid );
+
+		wchar_t      buffer[256];
+		const size_t classLength = platform.GetWindowClassName( window, buffer, 256 );
+		const auto   className   = WriteString( std::wstring( buffer, classLength ) );
+		const size_t titleLength = platform.GetWindowTitle( window, buffer, 256 );
+		const auto   title       = WriteString( std::wstring( buffer, titleLength ) );
+
+		PlatformRect rect = {};
+		platform.GetWindowRect( window, rect );
+
+		uint32_t flags = 0;
+		if ( platform.IsWindowVisible( window ) )
+			flags |= WINDOW_FLAG_VISIBLE;
+		if ( platform.IsWindowTopmost( window ) )
+			flags |= WINDOW_FLAG_TOPMOST;
+		if ( platform.IsWindowCloaked( window ) )
+			flags |= WINDOW_FLAG_CLOAKED;
+
+		this->bytes.emplace_back( static_cast<uint8_t>( EventLogRecord::Window ) );
+		WriteVarint( window );
+		WriteVarint( platform.GetWindowOwner( window ) );
+		WriteVarint( pid );
+		WriteVarint( className );
+		WriteVarint( title );
+		WriteRect( rect );
+		WriteVarint( flags );
+
+		this->windows.insert( window );
+		return true;
+	}
+
+	bool ReadEventLog( const uint8_t* data, size_t size, EventLog& log )
+	{
+		log = EventLog();
+		if ( size < sizeof( EVENT_LOG_MAGIC ) || memcmp( data, EVENT_LOG_MAGIC, sizeof( EVENT_LOG_MAGIC ) ) != 0 )
+			return false;
+
+		LogReader reader( data + sizeof( EVENT_LOG_MAGIC ), size - sizeof( EVENT_LOG_MAGIC ) );
+		uint32_t  version = 0;
+		if ( !reader.Read( version ) || version != EVENT_LOG_VERSION )
+			return false;
+
+		std::vector<std::wstring> strings;
+		std::vector<uint16_t>     units;
+		while ( !reader.IsAtEnd() )
+		{
+			uint8_t record = 0;
+			reader.ReadByte( record );
+
+			switch ( static_cast<EventLogRecord>( record ) )
+			{
+			case EventLogRecord::String: {
+				size_t length = 0;
+				if ( !reader.Read( length ) || length > size )
+					return false;
+
+				units.resize( length );
+				for ( auto& unit : units )
+				{
+					if ( !reader.Read( unit ) )
+						return false;
+				}
+
+				strings.emplace_back();
+				DecodeUtf16( units, strings.back() );
+				break;
+			}
+			case EventLogRecord::TargetName: {
+				log.targetNames.emplace_back();
+				if ( !reader.ReadStringRef( strings, log.targetNames.back() ) )
+					return false;
+				break;
+			}
+			case EventLogRecord::CompanionName: {
+				log.companionNames.emplace_back();
+				if ( !reader.ReadStringRef( strings, log.companionNames.back() ) )
+					return false;
+				break;
+			}
+			case EventLogRecord::Monitor: {
+				PlatformMonitor monitor = {};
+				if ( !reader.ReadStringRef( strings, monitor.device ) || !reader.ReadRect( monitor.rect ) )
+					return false;
+
+				log.monitors.emplace_back( std::move( monitor ) );
+				break;
+			}
+			case EventLogRecord::Process: {
+				EventLogProcess process = {};
+				if ( !reader.Read( process.pid ) || !reader.ReadStringRef( strings, process.path ) )
+					return false;
+
+				log.steps.emplace_back( EventLogStep{ EventLogRecord::Process, log.processes.size() } );
+				log.processes.emplace_back( std::move( process ) );
+				break;
+			}
+			case EventLogRecord::Window: {
+				EventLogWindow window = {};
+				uint32_t       flags  = 0;
+				if ( !reader.Read( window.id ) || !reader.Read( window.owner ) || !reader.Read( window.pid ) ||
+				     !reader.ReadStringRef( strings, window.className ) ||
+				     !reader.ReadStringRef( strings, window.title ) || !reader.ReadRect( window.rect ) ||
+				     !reader.Read( flags ) )
+					return false;
+
+				window.visible = ( flags & WINDOW_FLAG_VISIBLE ) != 0;
+				window.topmost = ( flags & WINDOW_FLAG_TOPMOST ) != 0;
+				window.cloaked = ( flags & WINDOW_FLAG_CLOAKED ) != 0;
+
+				log.steps.emplace_back( EventLogStep{ EventLogRecord::Window, log.windows.size() } );
+				log.windows.emplace_back( std::move( window ) );
+				break;
+			}
+			case EventLogRecord::Event: {
+				EventLogEvent event = {};
+				uint8_t       type  = 0;
+				if ( !reader.ReadByte( type ) || type > static_cast<uint8_t>( WindowEventType::Uncloaked ) ||
+				     !reader.Read( event.delay ) || !reader.Read( event.window ) )
+					return false;
+
+				event.type = static_cast<WindowEventType>( type );
+				log.steps.emplace_back( EventLogStep{ EventLogRecord::Event, log.events.size() } );
+				log.events.emplace_back( event );
+				break;
+			}
+			default:
+				return false;
+			}
+		}
+
+		return true;
+	}
+} // namespace Theater
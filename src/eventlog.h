@@ -0,0 +1,105 @@
+#pragma once
+
+namespace Theater
+{
+	// Hook events as the event worker saw them, with enough of the desktop around them to replay them headless.
+	// A log is a header and a sequence of tagged records. Integers are LEB128 varints, signed ones zigzag encoded,
+	// event times are deltas to the previous event and strings are written once and then referred to by index.
+	// Windows of the recording process, the dimmers, are left out.
+	enum class EventLogRecord : uint8_t
+	{
+		String = 1,
+		TargetName,
+		Monitor,
+		Process,
+		Window,
+		Event,
+		CompanionName
+	};
+
+	struct EventLogProcess
+	{
+		uint32_t     pid;
+		std::wstring path;
+	};
+
+	struct EventLogWindow
+	{
+		Platform::WindowId id;
+		Platform::WindowId owner;
+		uint32_t           pid;
+		std::wstring       className;
+		std::wstring       title;
+		PlatformRect       rect;
+		bool               visible;
+		bool               topmost;
+		bool               cloaked;
+	};
+
+	struct EventLogEvent
+	{
+		WindowEventType    type;
+		uint32_t           delay; // milliseconds since the previous event
+		Platform::WindowId window;
+	};
+
+	struct EventLogStep
+	{
+		EventLogRecord record;
+		size_t         index;
+	};
+
+	struct EventLog
+	{
+		std::vector<std::wstring>    targetNames;
+		std::vector<std::wstring>    companionNames;
+		std::vector<PlatformMonitor> monitors;
+		std::vector<EventLogProcess> processes;
+		std::vector<EventLogWindow>  windows;
+		std::vector<EventLogEvent>   events;
+
+		// Processes, windows and events in the order they were written. The windows before the first event are
+		// the desktop at the start, bottom to top, the later ones were created while recording.
+		std::vector<EventLogStep> steps;
+	};
+
+	class EventLogWriter
+	{
+	public:
+		EventLogWriter()  = default;
+		~EventLogWriter() = default;
+
+		// Starts a new log with the current desktop, from the UI thread as it walks the z-order
+		void Begin( const Platform& platform, uint32_t currentPid, const ProcessNameSet& targetNames,
+		            const ProcessNameSet& companionNames );
+
+		// Created windows and processes seen for the first time are written ahead of their event
+		void Write( const Platform& platform, const WindowEvent& event );
+
+		const std::vector<uint8_t>& GetBytes() const;
+		void                        Clear();
+
+	private:
+		EventLogWriter( const EventLogWriter& ) = delete;
+		EventLogWriter& operator=( const EventLogWriter& ) = delete;
+
+		void     WriteVarint( uint64_t value );
+		void     WriteSigned( int64_t value );
+		void     WriteRect( const PlatformRect& rect );
+		uint32_t WriteString( const std::wstring& value );
+		void     WriteProcess( const Platform& platform, uint32_t pid );
+		bool     WriteWindow( const Platform& platform, Platform::WindowId window );
+
+	private:
+		std::vector<uint8_t>                       bytes;
+		std::unordered_map<std::wstring, uint32_t> strings;
+		std::unordered_set<uint32_t>               processes;
+		std::unordered_set<Platform::WindowId>     windows;
+		uint32_t                                   currentPid = 0;
+		uint32_t                                   lastTime   = 0;
+		bool                                       hasTime    = false;
+	};
+
+	// Fails on a log of another version, a truncated one or one referring to strings it didn't define
+	bool ReadEventLog( const uint8_t* data, size_t size, EventLog& log );
+} // namespace Theater
\ No newline at end of file
@@ -0,0 +1,333 @@
+#include "theater.h"
+#include "eventreplay.h"
+#include <rapidjson/rapidjson.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+
+namespace Theater
+{
+	namespace
+	{
+		constexpr uint32_t REPLAY_JSON_VERSION = 1;
+
+		uint64_t GetTimeNanoseconds()
+		{
+			const auto now = std::chrono::steady_clock::now().time_since_epoch();
+			return static_cast<uint64_t>( std::chrono::duration_cast<std::chrono::nanoseconds>( now ).count() );
+		}
+
+		const char* GetStrategyName( ZOrderStrategy strategy )
+		{
+			switch ( strategy )
+			{
+			case ZOrderStrategy::None:
+				return "none";
+			case ZOrderStrategy::InsertBelowTarget:
+				return "insert-below-target";
+			case ZOrderStrategy::PushToBottom:
+				return "push-to-bottom";
+			}
+
+			return "";
+		}
+
+		const char* GetTransitionName( TheaterSession::Transition transition )
+		{
+			switch ( transition )
+			{
+			case TheaterSession::Transition::Start:
+				return "start";
+			case TheaterSession::Transition::Switch:
+				return "switch";
+			case TheaterSession::Transition::Stop:
+				return "stop";
+			}
+
+			return "";
+		}
+
+		class Replay
+		{
+		public:
+			Replay( const EventLog& log, const ReplayOptions& options, ReplayReport& report )
+			    : log( log ), options( options ), report( report )
+			{
+			}
+
+			bool Run()
+			{
+				if ( this->log.monitors.empty() )
+					return false;
+
+				const uint64_t start = GetTimeNanoseconds();
+
+				CreateDesktop();
+				for ( const auto& step : this->log.steps )
+				{
+					switch ( step.record )
+					{
+					case EventLogRecord::Process:
+						AddProcess( this->log.processes[step.index] );
+						break;
+					case EventLogRecord::Window:
+						AddWindow( this->log.windows[step.index] );
+						break;
+					case EventLogRecord::Event:
+						Play( this->log.events[step.index] );
+						break;
+					default:
+						break;
+					}
+				}
+
+				// the last change still has to go through the coalescer
+				const uint32_t timeout = this->pipeline.GetTimeout( this->nowMs );
+				if ( timeout != WindowEventCoalescer::NO_TIMEOUT )
+					Wait( timeout );
+
+				this->report.coalescedCount  = this->pipeline.GetCoalescedCount();
+				this->report.zOrderMoveCount = this->desktop.GetZOrderMoveCount();
+				this->report.decisionTime    = SummarizeBenchmarkStage( "decision", this->decisionSamples );
+				this->report.durationMs      = ( GetTimeNanoseconds() - start ) / 1000000.0;
+
+				this->pipeline.Stop();
+				return true;
+			}
+
+		private:
+			void CreateDesktop()
+			{
+				ProcessNameSet targetNames;
+				ProcessNameSet companionNames;
+				for ( const auto& name : this->log.targetNames )
+					targetNames.Add( name );
+				for ( const auto& name : this->log.companionNames )
+					companionNames.Add( name );
+
+				this->pipeline.Configure( targetNames, companionNames );
+
+				// the recording left our own windows out, the replay brings its dimmers
+				std::vector<ZOrderDimmer> dimmers;
+				const uint32_t            self = this->desktop.StartProcess( L"theater" );
+				this->desktop.SetCurrentProcess( self );
+				for ( const auto& monitor : this->log.monitors )
+				{
+					this->desktop.AddMonitor( monitor.device, monitor.rect );
+
+					SimulatedDesktop::WindowParams params = {};
+					params.pid                            = self;
+					params.className                      = L"TheaterDimmerWindow";
+					params.rect                           = monitor.rect;
+
+					const auto window = this->desktop.AddWindow( params );
+					dimmers.emplace_back( ZOrderDimmer{ window, monitor.rect } );
+				}
+
+				this->pipeline.SetDimmers( dimmers );
+			}
+
+			void AddProcess( const EventLogProcess& process )
+			{
+				this->pids[process.pid] = this->desktop.StartProcess( process.path );
+			}
+
+			void AddWindow( const EventLogWindow& window )
+			{
+				const auto pid   = this->pids.find( window.pid );
+				const auto owner = this->windows.find( window.owner );
+				const bool owned = owner != this->windows.end();
+
+				// windows created while recording show up through their recorded events
+				SimulatedDesktop::WindowParams params = {};
+				params.pid                            = pid != this->pids.end() ? pid->second : 0;
+				params.owner                          = owned ? owner->second : Platform::NO_WINDOW;
+				params.className                      = window.className;
+				params.title                          = window.title;
+				params.rect                           = window.rect;
+				params.visible                        = !this->hooked && window.visible;
+				params.topmost                        = window.topmost;
+
+				const auto added = this->desktop.AddWindow( params );
+				if ( !this->hooked && window.cloaked )
+					this->desktop.SetWindowCloaked( added, true );
+
+				this->windows[window.id] = added;
+				this->recordedIds[added] = window.id;
+			}
+
+			void Play( const EventLogEvent& event )
+			{
+				// the windows ahead of the first event are the desktop the hooks were installed on
+				if ( !this->hooked )
+				{
+					this->pipeline.Start( &this->desktop );
+					this->hooked = true;
+				}
+
+				Wait( event.delay );
+
+				const auto window = this->windows.find( event.window );
+				if ( window != this->windows.end() )
+				{
+					switch ( event.type )
+					{
+					case WindowEventType::Foreground:
+						this->desktop.SetForegroundWindow( window->second );
+						break;
+					case WindowEventType::Created:
+					case WindowEventType::LocationChanged:
+						break;
+					case WindowEventType::Destroyed:
+						this->desktop.DestroyWindow( window->second );
+						this->recordedIds.erase( window->second );
+						this->windows.erase( window );
+						break;
+					case WindowEventType::Shown:
+					case WindowEventType::Hidden:
+						this->desktop.ShowWindow( window->second, event.type == WindowEventType::Shown );
+						break;
+					case WindowEventType::Cloaked:
+					case WindowEventType::Uncloaked:
+						this->desktop.SetWindowCloaked( window->second, event.type == WindowEventType::Cloaked );
+						break;
+					}
+				}
+
+				this->report.eventCount += this->pipeline.Dispatch( this->nowMs );
+			}
+
+			// a foreground change whose burst ended in between is decided on time
+			void Wait( uint32_t ms )
+			{
+				const uint32_t timeout = this->pipeline.GetTimeout( this->nowMs );
+				if ( timeout < ms )
+				{
+					Advance( timeout );
+					Decide();
+					ms -= timeout;
+				}
+
+				Advance( ms );
+				Decide();
+			}
+
+			void Advance( uint32_t ms )
+			{
+				if ( this->options.realTime && ms > 0 )
+					std::this_thread::sleep_for( std::chrono::milliseconds( ms ) );
+
+				this->desktop.Advance( ms );
+				this->nowMs += ms;
+			}
+
+			void Decide()
+			{
+				const uint64_t             start   = GetTimeNanoseconds();
+				HeadlessPipeline::Decision decided = {};
+				if ( !this->pipeline.Decide( this->nowMs, decided ) )
+					return;
+
+				this->pipeline.Arrange( decided );
+				this->decisionSamples.emplace_back( GetTimeNanoseconds() - start );
+
+				const auto recorded = this->recordedIds.find( decided.window );
+				const bool known    = recorded != this->recordedIds.end();
+
+				ReplayDecision decision = {};
+				decision.timeMs         = this->nowMs;
+				decision.window         = known ? recorded->second : Platform::NO_WINDOW;
+				decision.isTarget       = decided.isTarget;
+				decision.transition     = decided.transition;
+				decision.strategy       = decided.strategy;
+				this->report.decisions.emplace_back( decision );
+			}
+
+		private:
+			const EventLog&      log;
+			const ReplayOptions& options;
+			ReplayReport&        report;
+
+			SimulatedDesktop      desktop;
+			HeadlessPipeline      pipeline;
+			std::vector<uint64_t> decisionSamples;
+			uint64_t              nowMs  = 0;
+			bool                  hooked = false;
+
+			// recorded ids to the simulated ones and back
+			std::unordered_map<uint32_t, uint32_t>                     pids;
+			std::unordered_map<Platform::WindowId, Platform::WindowId> windows;
+			std::unordered_map<Platform::WindowId, Platform::WindowId> recordedIds;
+		};
+	} // namespace
+
+	bool ReplayEventLog( const EventLog& log, const ReplayOptions& options, ReplayReport& report )
+	{
+		report = ReplayReport();
+
+		Replay replay( log, options, report );
+		return replay.Run();
+	}
+
+	void WriteReplayJson( const ReplayReport& report, std::string& json )
+	{
+		rapidjson::StringBuffer                    buffer;
+		rapidjson::Writer<rapidjson::StringBuffer> writer( buffer );
+
+		writer.StartObject();
+		writer.Key( "version" );
+		writer.Uint( REPLAY_JSON_VERSION );
+		writer.Key( "events" );
+		writer.Uint64( report.eventCount );
+		writer.Key( "coalesced" );
+		writer.Uint64( report.coalescedCount );
+		writer.Key( "zorderMoves" );
+		writer.Uint64( report.zOrderMoveCount );
+		writer.Key( "durationMs" );
+		writer.Double( report.durationMs );
+
+		const auto& stage = report.decisionTime;
+		writer.Key( stage.name );
+		writer.StartObject();
+		writer.Key( "unit" );
+		writer.String( "us" );
+		writer.Key( "count" );
+		writer.Uint64( stage.count );
+		writer.Key( "min" );
+		writer.Double( stage.min );
+		writer.Key( "mean" );
+		writer.Double( stage.mean );
+		writer.Key( "p50" );
+		writer.Double( stage.p50 );
+		writer.Key( "p90" );
+		writer.Double( stage.p90 );
+		writer.Key( "p99" );
+		writer.Double( stage.p99 );
+		writer.Key( "p999" );
+		writer.Double( stage.p999 );
+		writer.Key( "max" );
+		writer.Double( stage.max );
+		writer.EndObject();
+
+		writer.Key( "decisions" );
+		writer.StartArray();
+		for ( const auto& decision : report.decisions )
+		{
+			writer.StartObject();
+			writer.Key( "time" );
+			writer.Uint64( decision.timeMs );
+			writer.Key( "window" );
+			writer.Uint64( decision.window );
+			writer.Key( "target" );
+			writer.Bool( decision.isTarget );
+			writer.Key( "session" );
+			writer.String( GetTransitionName( decision.transition ) );
+			writer.Key( "zorder" );
+			writer.String( GetStrategyName( decision.strategy ) );
+			writer.EndObject();
+		}
+		writer.EndArray();
+		writer.EndObject();
+
+		json.assign( buffer.GetString(), buffer.GetSize() );
+	}
+} // namespace Theater
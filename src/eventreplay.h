@@ -0,0 +1,41 @@
+#pragma once
+
+namespace Theater
+{
+	struct ReplayOptions
+	{
+		// wait out the recorded delays between events instead of running them back to back
+		bool realTime = false;
+	};
+
+	// What the theater did on a coalesced foreground change, windows are the ids of the recording
+	struct ReplayDecision
+	{
+		uint64_t                   timeMs; // since the first event
+		Platform::WindowId         window;
+		bool                       isTarget;
+		TheaterSession::Transition transition;
+		ZOrderStrategy             strategy;
+	};
+
+	struct ReplayReport
+	{
+		size_t                      eventCount;
+		size_t                      coalescedCount;
+		size_t                      zOrderMoveCount;
+		std::vector<ReplayDecision> decisions;
+
+		// from a coalesced foreground change to the dimmers in place
+		BenchmarkStage decisionTime;
+		double         durationMs;
+	};
+
+	// Rebuilds the recorded desktop on a SimulatedDesktop with a dimmer per monitor and feeds the recorded events
+	// through the same coalescer, registry, target resolution and z-order planning as the app. Decisions only
+	// depend on the log, a replay is repeatable between machines. Fails on a log without monitors.
+	bool ReplayEventLog( const EventLog& log, const ReplayOptions& options, ReplayReport& report );
+
+	// {"version":1,"events":...,"decisions":[{"time":...,"window":...,"target":true,"session":"start",
+	//  "zorder":"none"},...],...}
+	void WriteReplayJson( const ReplayReport& report, std::string& json );
+} // namespace Theater
\ No newline at end of file
@@ -0,0 +1,155 @@
+#include "theater.h"
+#include "fadeanimation.h"
+
+namespace Theater
+{
+	namespace
+	{
+		constexpr const wchar_t* EASING_NAMES[] = { L"linear", L"ease-in", L"ease-out", L"ease-in-out" };
+
+		SteadyAnimationClock s_steadyClock;
+	} // namespace
+
+	bool ParseEasing( std::wstring_view name, Easing& easing )
+	{
+		for ( size_t i = 0; i < std::size( EASING_NAMES ); i++ )
+		{
+			if ( name == EASING_NAMES[i] )
+			{
+				easing = static_cast<Easing>( i );
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	const wchar_t* GetEasingName( Easing easing )
+	{
+		return EASING_NAMES[static_cast<size_t>( easing )];
+	}
+
+	float ApplyEasing( Easing easing, float t )
+	{
+		t = std::max( 0.0f, std::min( 1.0f, t ) );
+
+		switch ( easing )
+		{
+		case Easing::Linear:
+			return t;
+		case Easing::EaseIn:
+			return t * t;
+		case Easing::EaseOut:
+			return 1.0f - ( 1.0f - t ) * ( 1.0f - t );
+		case Easing::EaseInOut:
+			return t * t * ( 3.0f - 2.0f * t );
+		}
+
+		return t;
+	}
+
+	uint64_t SteadyAnimationClock::GetTimeMicroseconds() const
+	{
+		const auto now = std::chrono::steady_clock::now().time_since_epoch();
+		return static_cast<uint64_t>( std::chrono::duration_cast<std::chrono::microseconds>( now ).count() );
+	}
+
+	FadeAnimation::FadeAnimation()
+		: clock( &s_steadyClock )
+	{
+	}
+
+	void FadeAnimation::SetClock( const AnimationClock* value )
+	{
+		this->clock = value != nullptr ? value : &s_steadyClock;
+	}
+
+	void FadeAnimation::SetDuration( uint32_t value )
+	{
+		this->durationMs = value;
+	}
+
+	void FadeAnimation::SetEasing( Easing value )
+	{
+		this->easing = value;
+	}
+
+	uint8_t FadeAnimation::Quantize( float value )
+	{
+		return static_cast<uint8_t>( std::max( 0.0f, std::min( 255.0f, value * 255.0f + 0.5f ) ) );
+	}
+
+	float FadeAnimation::Evaluate( uint64_t now ) const
+	{
+		if ( this->length == 0 || now >= this->startTime + this->length )
+			return this->toAlpha;
+
+		const float t = static_cast<float>( now - this->startTime ) / static_cast<float>( this->length );
+		return this->fromAlpha + ( this->toAlpha - this->fromAlpha ) * ApplyEasing( this->easing, t );
+	}
+
+	void FadeAnimation::Reset( float value )
+	{
+		this->running   = false;
+		this->fromAlpha = value;
+		this->toAlpha   = value;
+		this->alpha     = value;
+		this->alphaByte = Quantize( value );
+	}
+
+	void FadeAnimation::Start( float targetAlpha )
+	{
+		const uint64_t now = this->clock->GetTimeMicroseconds();
+
+		// continue from wherever the current fade is
+		if ( this->running )
+			this->alpha = Evaluate( now );
+
+		// a fade started at rest lasts durationMs whatever its distance, one retargeted mid-flight takes the share of
+		// that time the distance left is of the span of the fade at rest
+		const float distance = std::fabs( targetAlpha - this->alpha );
+		if ( !this->running || this->span <= 0.0f )
+			this->span = distance;
+		const float share = this->span > 0.0f ? std::min( 1.0f, distance / this->span ) : 0.0f;
+
+		this->fromAlpha = this->alpha;
+		this->toAlpha   = targetAlpha;
+		this->startTime = now;
+		this->length    = static_cast<uint64_t>( share * this->durationMs * 1000.0f );
+		this->running   = true;
+	}
+
+	bool FadeAnimation::Tick( uint8_t& value )
+	{
+		if ( !this->running )
+			return false;
+
+		const uint64_t now = this->clock->GetTimeMicroseconds();
+		this->alpha        = Evaluate( now );
+		if ( this->length == 0 || now >= this->startTime + this->length )
+			this->running = false;
+
+		const uint8_t quantized = Quantize( this->alpha );
+		if ( quantized == this->alphaByte )
+			return false;
+
+		this->alphaByte = quantized;
+		value           = quantized;
+		return true;
+	}
+
+	bool FadeAnimation::IsRunning() const
+	{
+		return this->running;
+	}
+
+	float FadeAnimation::GetAlpha() const
+	{
+		return this->alpha;
+	}
+
+	float FadeAnimation::GetTargetAlpha() const
+	{
+		return this->toAlpha;
+	}
+} // namespace Theater
\ No newline at end of file
@@ -0,0 +1,72 @@
+#pragma once
+
+namespace Theater
+{
+	enum class Easing
+	{
+		Linear,
+		EaseIn,
+		EaseOut,
+		EaseInOut
+	};
+
+	bool           ParseEasing( std::wstring_view name, Easing& easing );
+	const wchar_t* GetEasingName( Easing easing );
+	float          ApplyEasing( Easing easing, float t );
+
+	// Monotonic time source, can be replaced to drive animations from a virtual clock
+	class AnimationClock
+	{
+	public:
+		virtual ~AnimationClock() = default;
+
+		virtual uint64_t GetTimeMicroseconds() const = 0;
+	};
+
+	class SteadyAnimationClock final : public AnimationClock
+	{
+	public:
+		uint64_t GetTimeMicroseconds() const override;
+	};
+
+	// Alpha fade evaluated from the clock rather than counting ticks, so timer jitter never changes the curve.
+	// A fade started at rest lasts the configured duration. Starting a new one mid-flight retargets from the current
+	// value, over the share of the duration the distance left is of the span of the fade started at rest.
+	class FadeAnimation
+	{
+	public:
+		FadeAnimation();
+		~FadeAnimation() = default;
+
+		void SetClock( const AnimationClock* clock );
+		void SetDuration( uint32_t durationMs );
+		void SetEasing( Easing easing );
+
+		void Reset( float alpha );
+		void Start( float targetAlpha );
+
+		// Advances the fade, returns true and the new value only when its quantized byte changed
+		bool  Tick( uint8_t& alpha );
+		bool  IsRunning() const;
+		float GetAlpha() const;
+		float GetTargetAlpha() const;
+
+	private:
+		static uint8_t Quantize( float alpha );
+
+		float Evaluate( uint64_t now ) const;
+
+	private:
+		const AnimationClock* clock;
+		uint32_t              durationMs = 500;
+		Easing                easing     = Easing::Linear;
+		bool                  running    = false;
+		uint64_t              startTime  = 0;
+		uint64_t              length     = 0;
+		float                 span       = 0.0f; // distance of the fade started at rest
+		float                 fromAlpha  = 0.0f;
+		float                 toAlpha    = 0.0f;
+		float                 alpha      = 0.0f;
+		uint8_t               alphaByte  = 0;
+	};
+} // namespace Theater
\ No newline at end of file
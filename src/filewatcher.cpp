@@ -0,0 +1,246 @@
+#include "theater.h"
+#include "filewatcher.h"
+
+#if !defined( _WIN32 )
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace Theater
+{
+	FileWatcher::~FileWatcher()
+	{
+		Close();
+	}
+
+	void FileWatcher::SetDebounce( uint32_t delayMs )
+	{
+		this->debounce = delayMs;
+	}
+
+#if defined( _WIN32 )
+	bool FileWatcher::Open( const std::wstring& directory, const std::wstring& name )
+	{
+		Close();
+
+		this->filename = name;
+
+		// the directory is watched rather than the file so replacing it is noticed as well
+		const DWORD share     = FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE;
+		this->directoryHandle = ::CreateFileW( directory.c_str(), FILE_LIST_DIRECTORY, share, nullptr, OPEN_EXISTING,
+		                                       FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr );
+		if ( this->directoryHandle == INVALID_HANDLE_VALUE )
+			return false;
+
+		this->overlapped.hEvent = ::CreateEventW( nullptr, TRUE, FALSE, nullptr );
+		this->wakeEvent         = ::CreateEventW( nullptr, FALSE, FALSE, nullptr );
+		if ( this->overlapped.hEvent == nullptr || this->wakeEvent == nullptr || !Arm() )
+		{
+			Close();
+			return false;
+		}
+
+		return true;
+	}
+
+	void FileWatcher::Close()
+	{
+		if ( this->directoryHandle != INVALID_HANDLE_VALUE )
+		{
+			// the pending read has to be done before its buffer goes away
+			DWORD bytes = 0;
+			if ( ::CancelIoEx( this->directoryHandle, &this->overlapped ) )
+				::GetOverlappedResult( this->directoryHandle, &this->overlapped, &bytes, TRUE );
+			::CloseHandle( this->directoryHandle );
+		}
+
+		if ( this->overlapped.hEvent != nullptr )
+			::CloseHandle( this->overlapped.hEvent );
+
+		if ( this->wakeEvent != nullptr )
+			::CloseHandle( this->wakeEvent );
+
+		this->directoryHandle = INVALID_HANDLE_VALUE;
+		this->wakeEvent       = nullptr;
+		this->overlapped      = {};
+	}
+
+	bool FileWatcher::Arm()
+	{
+		::ResetEvent( this->overlapped.hEvent );
+
+		const DWORD filter = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE;
+		return ::ReadDirectoryChangesW( this->directoryHandle, this->buffer, sizeof( this->buffer ), FALSE, filter,
+		                                nullptr, &this->overlapped, nullptr ) != FALSE;
+	}
+
+	FileWatcher::WaitResult FileWatcher::Wait()
+	{
+		if ( this->directoryHandle == INVALID_HANDLE_VALUE )
+			return WaitResult::Error;
+
+		bool pending = false;
+		for ( ;; )
+		{
+			const DWORD  timeout   = pending ? static_cast<DWORD>( this->debounce ) : INFINITE;
+			const HANDLE handles[] = { this->overlapped.hEvent, this->wakeEvent };
+			const DWORD  result    = ::WaitForMultipleObjects( 2, handles, FALSE, timeout );
+			if ( result == WAIT_TIMEOUT )
+				return WaitResult::Changed;
+
+			if ( result == WAIT_OBJECT_0 + 1 )
+				return WaitResult::Woken;
+
+			if ( result != WAIT_OBJECT_0 )
+				return WaitResult::Error;
+
+			DWORD bytes = 0;
+			if ( !::GetOverlappedResult( this->directoryHandle, &this->overlapped, &bytes, FALSE ) )
+				return WaitResult::Error;
+
+			// zero bytes means the buffer overflowed, the file might be among the lost notifications
+			if ( bytes == 0 )
+				pending = true;
+
+			const uint8_t* iter = reinterpret_cast<const uint8_t*>( this->buffer );
+			while ( bytes != 0 )
+			{
+				const auto info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>( iter );
+				if ( IsWatchedName( info->FileName, info->FileNameLength / sizeof( wchar_t ) ) )
+					pending = true;
+
+				if ( info->NextEntryOffset == 0 )
+					break;
+
+				iter += info->NextEntryOffset;
+			}
+
+			if ( !Arm() )
+				return WaitResult::Error;
+		}
+	}
+
+	void FileWatcher::Wake()
+	{
+		if ( this->wakeEvent != nullptr )
+			::SetEvent( this->wakeEvent );
+	}
+
+	bool FileWatcher::IsWatchedName( const wchar_t* name, size_t length ) const
+	{
+		return ::CompareStringOrdinal( name, static_cast<int>( length ), this->filename.c_str(),
+		                               static_cast<int>( this->filename.size() ), TRUE ) == CSTR_EQUAL;
+	}
+#else
+	bool FileWatcher::Open( const std::wstring& directory, const std::wstring& name )
+	{
+		Close();
+
+		this->filename = name;
+
+		std::string path( directory.size() * MB_CUR_MAX + 1, '\0' );
+		const size_t length = wcstombs( &path[0], directory.c_str(), path.size() );
+		if ( length == static_cast<size_t>( -1 ) )
+			return false;
+		path.resize( length );
+
+		// the directory is watched rather than the file so replacing it is noticed as well
+		this->notifyFd = inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+		this->wakeFd   = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+		if ( this->notifyFd < 0 || this->wakeFd < 0 || !Arm() ||
+		     inotify_add_watch( this->notifyFd, path.c_str(),
+		                        IN_CLOSE_WRITE | IN_MODIFY | IN_CREATE | IN_MOVED_TO | IN_DELETE ) < 0 )
+		{
+			Close();
+			return false;
+		}
+
+		return true;
+	}
+
+	void FileWatcher::Close()
+	{
+		if ( this->notifyFd >= 0 )
+			close( this->notifyFd );
+
+		if ( this->wakeFd >= 0 )
+			close( this->wakeFd );
+
+		this->notifyFd = -1;
+		this->wakeFd   = -1;
+	}
+
+	bool FileWatcher::Arm()
+	{
+		// inotify stays armed, nothing to reissue
+		return true;
+	}
+
+	FileWatcher::WaitResult FileWatcher::Wait()
+	{
+		if ( this->notifyFd < 0 )
+			return WaitResult::Error;
+
+		bool pending = false;
+		for ( ;; )
+		{
+			const int timeout = pending ? static_cast<int>( this->debounce ) : -1;
+			pollfd    fds[2]  = { { this->notifyFd, POLLIN, 0 }, { this->wakeFd, POLLIN, 0 } };
+			const int result  = poll( fds, 2, timeout );
+			if ( result == 0 )
+				return WaitResult::Changed;
+
+			if ( result < 0 )
+				return WaitResult::Error;
+
+			if ( fds[1].revents & POLLIN )
+			{
+				uint64_t count = 0;
+				if ( read( this->wakeFd, &count, sizeof( count ) ) < 0 )
+					return WaitResult::Error;
+
+				return WaitResult::Woken;
+			}
+
+			alignas( inotify_event ) char buffer[4096];
+			const ssize_t bytes = read( this->notifyFd, buffer, sizeof( buffer ) );
+			if ( bytes <= 0 )
+				continue;
+
+			for ( ssize_t offset = 0; offset < bytes; )
+			{
+				const auto event = reinterpret_cast<const inotify_event*>( buffer + offset );
+				if ( event->mask & IN_Q_OVERFLOW )
+					pending = true;
+
+				if ( event->len > 0 )
+				{
+					wchar_t      name[256] = {};
+					const size_t length    = mbstowcs( name, event->name, 255 );
+					if ( length != static_cast<size_t>( -1 ) && IsWatchedName( name, length ) )
+						pending = true;
+				}
+
+				offset += sizeof( inotify_event ) + event->len;
+			}
+		}
+	}
+
+	void FileWatcher::Wake()
+	{
+		if ( this->wakeFd < 0 )
+			return;
+
+		const uint64_t count   = 1;
+		const ssize_t  written = write( this->wakeFd, &count, sizeof( count ) );
+		static_cast<void>( written );
+	}
+
+	bool FileWatcher::IsWatchedName( const wchar_t* name, size_t length ) const
+	{
+		return this->filename.compare( 0, std::wstring::npos, name, length ) == 0;
+	}
+#endif
+} // namespace Theater
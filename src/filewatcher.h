@@ -0,0 +1,53 @@
+#pragma once
+
+namespace Theater
+{
+	// Watches a single file for changes, including editors saving through a temporary file renamed over it.
+	// Wait blocks on a worker thread and only reports a change once the file stayed quiet for the debounce delay,
+	// so a burst of writes from a tool rewriting the file in place is reported once.
+	class FileWatcher
+	{
+	public:
+		static constexpr uint32_t DEFAULT_DEBOUNCE = 150;
+
+		enum class WaitResult
+		{
+			Changed,
+			Woken,
+			Error
+		};
+
+		FileWatcher() = default;
+		~FileWatcher();
+
+		bool Open( const std::wstring& directory, const std::wstring& filename );
+		void Close();
+		void SetDebounce( uint32_t delayMs );
+
+		WaitResult Wait();
+
+		// Makes a blocked or the next Wait return Woken, callable from any thread
+		void Wake();
+
+	private:
+		FileWatcher( const FileWatcher& ) = delete;
+		FileWatcher& operator=( const FileWatcher& ) = delete;
+
+		bool Arm();
+		bool IsWatchedName( const wchar_t* name, size_t length ) const;
+
+	private:
+		std::wstring filename;
+		uint32_t     debounce = DEFAULT_DEBOUNCE;
+
+#if defined( _WIN32 )
+		HANDLE     directoryHandle = INVALID_HANDLE_VALUE;
+		HANDLE     wakeEvent       = nullptr;
+		OVERLAPPED overlapped      = {};
+		DWORD      buffer[4096]    = {};
+#else
+		int notifyFd = -1;
+		int wakeFd   = -1;
+#endif
+	};
+} // namespace Theater
\ No newline at end of file
@@ -0,0 +1,232 @@
+#include "theater.h"
+#include "gradientkernel.h"
+
+#if defined( _M_X64 ) || defined( _M_IX86 ) || defined( __SSE2__ )
+#include <immintrin.h>
+#define THEATER_GRADIENT_X86 1
+#if defined( _MSC_VER )
+#include <intrin.h>
+#define THEATER_TARGET_AVX2
+#else
+#define THEATER_TARGET_AVX2 __attribute__( ( target( "avx2" ) ) )
+#endif
+#endif
+
+namespace Theater
+{
+	namespace
+	{
+		constexpr const wchar_t* GRADIENT_KIND_NAMES[] = { L"none", L"radial", L"linear" };
+		constexpr const char*    SIMD_LEVEL_NAMES[]    = { "scalar", "sse2", "avx2" };
+
+		// everything the kernels need, computed once per span
+		struct SpanConstants
+		{
+			float dy2;
+			float invRadius;
+			float inner;
+			float range;
+			float r;
+			float g;
+			float b;
+		};
+
+		SpanConstants MakeSpanConstants( float dy, const GradientParams& params, uint32_t color )
+		{
+			SpanConstants constants = {};
+			constants.dy2           = params.kind == GradientKind::Radial ? dy * dy : 0.0f;
+			constants.invRadius     = params.radius > 0.0f ? 1.0f / params.radius : 1.0e6f;
+			constants.inner         = std::max( 0.0f, std::min( 1.0f, params.innerCoverage ) );
+			constants.range         = 1.0f - constants.inner;
+			constants.r             = static_cast<float>( ( color >> 16 ) & 0xFF );
+			constants.g             = static_cast<float>( ( color >> 8 ) & 0xFF );
+			constants.b             = static_cast<float>( color & 0xFF );
+			return constants;
+		}
+
+		void RenderSpanScalar( uint32_t* row, size_t count, float dx, const SpanConstants& constants )
+		{
+			for ( size_t i = 0; i < count; i++ )
+			{
+				const float x        = dx + static_cast<float>( i );
+				const float d        = std::sqrt( x * x + constants.dy2 );
+				const float coverage = constants.inner + constants.range * std::min( d * constants.invRadius, 1.0f );
+
+				const uint32_t a = static_cast<uint32_t>( coverage * 255.0f + 0.5f );
+				const uint32_t r = static_cast<uint32_t>( coverage * constants.r + 0.5f );
+				const uint32_t g = static_cast<uint32_t>( coverage * constants.g + 0.5f );
+				const uint32_t b = static_cast<uint32_t>( coverage * constants.b + 0.5f );
+				row[i]           = ( a << 24 ) | ( r << 16 ) | ( g << 8 ) | b;
+			}
+		}
+
+#if THEATER_GRADIENT_X86
+		size_t RenderSpanSSE2( uint32_t* row, size_t count, float dx, const SpanConstants& constants )
+		{
+			const __m128 dy2   = _mm_set1_ps( constants.dy2 );
+			const __m128 inv   = _mm_set1_ps( constants.invRadius );
+			const __m128 inner = _mm_set1_ps( constants.inner );
+			const __m128 range = _mm_set1_ps( constants.range );
+			const __m128 one   = _mm_set1_ps( 1.0f );
+			const __m128 half  = _mm_set1_ps( 0.5f );
+			const __m128 alpha = _mm_set1_ps( 255.0f );
+			const __m128 red   = _mm_set1_ps( constants.r );
+			const __m128 green = _mm_set1_ps( constants.g );
+			const __m128 blue  = _mm_set1_ps( constants.b );
+			const __m128 step  = _mm_set1_ps( 4.0f );
+
+			__m128 xs = _mm_add_ps( _mm_set1_ps( dx ), _mm_setr_ps( 0.0f, 1.0f, 2.0f, 3.0f ) );
+			size_t i  = 0;
+			for ( ; i + 4 <= count; i += 4 )
+			{
+				const __m128 d        = _mm_sqrt_ps( _mm_add_ps( _mm_mul_ps( xs, xs ), dy2 ) );
+				const __m128 t        = _mm_min_ps( _mm_mul_ps( d, inv ), one );
+				const __m128 coverage = _mm_add_ps( inner, _mm_mul_ps( range, t ) );
+
+				const __m128i a = _mm_cvttps_epi32( _mm_add_ps( _mm_mul_ps( coverage, alpha ), half ) );
+				const __m128i r = _mm_cvttps_epi32( _mm_add_ps( _mm_mul_ps( coverage, red ), half ) );
+				const __m128i g = _mm_cvttps_epi32( _mm_add_ps( _mm_mul_ps( coverage, green ), half ) );
+				const __m128i b = _mm_cvttps_epi32( _mm_add_ps( _mm_mul_ps( coverage, blue ), half ) );
+
+				const __m128i pixels = _mm_or_si128( _mm_or_si128( _mm_slli_epi32( a, 24 ), _mm_slli_epi32( r, 16 ) ),
+				                                     _mm_or_si128( _mm_slli_epi32( g, 8 ), b ) );
+				_mm_storeu_si128( reinterpret_cast<__m128i*>( row + i ), pixels );
+
+				xs = _mm_add_ps( xs, step );
+			}
+
+			return i;
+		}
+
+		THEATER_TARGET_AVX2 size_t RenderSpanAVX2( uint32_t* row, size_t count, float dx,
+		                                           const SpanConstants& constants )
+		{
+			const __m256 dy2   = _mm256_set1_ps( constants.dy2 );
+			const __m256 inv   = _mm256_set1_ps( constants.invRadius );
+			const __m256 inner = _mm256_set1_ps( constants.inner );
+			const __m256 range = _mm256_set1_ps( constants.range );
+			const __m256 one   = _mm256_set1_ps( 1.0f );
+			const __m256 half  = _mm256_set1_ps( 0.5f );
+			const __m256 alpha = _mm256_set1_ps( 255.0f );
+			const __m256 red   = _mm256_set1_ps( constants.r );
+			const __m256 green = _mm256_set1_ps( constants.g );
+			const __m256 blue  = _mm256_set1_ps( constants.b );
+			const __m256 step  = _mm256_set1_ps( 8.0f );
+
+			// no FMA on purpose, the results have to match the other kernels bit for bit
+			__m256 xs =
+			    _mm256_add_ps( _mm256_set1_ps( dx ), _mm256_setr_ps( 0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f ) );
+			size_t i = 0;
+			for ( ; i + 8 <= count; i += 8 )
+			{
+				const __m256 d        = _mm256_sqrt_ps( _mm256_add_ps( _mm256_mul_ps( xs, xs ), dy2 ) );
+				const __m256 t        = _mm256_min_ps( _mm256_mul_ps( d, inv ), one );
+				const __m256 coverage = _mm256_add_ps( inner, _mm256_mul_ps( range, t ) );
+
+				const __m256i a = _mm256_cvttps_epi32( _mm256_add_ps( _mm256_mul_ps( coverage, alpha ), half ) );
+				const __m256i r = _mm256_cvttps_epi32( _mm256_add_ps( _mm256_mul_ps( coverage, red ), half ) );
+				const __m256i g = _mm256_cvttps_epi32( _mm256_add_ps( _mm256_mul_ps( coverage, green ), half ) );
+				const __m256i b = _mm256_cvttps_epi32( _mm256_add_ps( _mm256_mul_ps( coverage, blue ), half ) );
+
+				const __m256i pixels =
+				    _mm256_or_si256( _mm256_or_si256( _mm256_slli_epi32( a, 24 ), _mm256_slli_epi32( r, 16 ) ),
+				                     _mm256_or_si256( _mm256_slli_epi32( g, 8 ), b ) );
+				_mm256_storeu_si256( reinterpret_cast<__m256i*>( row + i ), pixels );
+
+				xs = _mm256_add_ps( xs, step );
+			}
+
+			return i;
+		}
+
+		SimdLevel DetectSimdLevel()
+		{
+#if defined( _MSC_VER )
+			int info[4] = {};
+			::__cpuid( info, 0 );
+			if ( info[0] < 7 )
+				return SimdLevel::SSE2;
+
+			// AVX2 also needs the OS to save the YMM registers
+			::__cpuid( info, 1 );
+			const bool osxsave = ( info[2] & ( 1 << 27 ) ) != 0;
+			const bool avx     = ( info[2] & ( 1 << 28 ) ) != 0;
+			if ( !osxsave || !avx || ( ::_xgetbv( 0 ) & 0x6 ) != 0x6 )
+				return SimdLevel::SSE2;
+
+			::__cpuidex( info, 7, 0 );
+			return ( info[1] & ( 1 << 5 ) ) != 0 ? SimdLevel::AVX2 : SimdLevel::SSE2;
+#else
+			__builtin_cpu_init();
+			return __builtin_cpu_supports( "avx2" ) ? SimdLevel::AVX2 : SimdLevel::SSE2;
+#endif
+		}
+#else
+		SimdLevel DetectSimdLevel()
+		{
+			return SimdLevel::Scalar;
+		}
+#endif
+	} // namespace
+
+	bool ParseGradientKind( std::wstring_view name, GradientKind& kind )
+	{
+		for ( size_t i = 0; i < std::size( GRADIENT_KIND_NAMES ); i++ )
+		{
+			if ( name == GRADIENT_KIND_NAMES[i] )
+			{
+				kind = static_cast<GradientKind>( i );
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	const wchar_t* GetGradientKindName( GradientKind kind )
+	{
+		return GRADIENT_KIND_NAMES[static_cast<size_t>( kind )];
+	}
+
+	SimdLevel GetSimdLevel()
+	{
+		static const SimdLevel s_level = DetectSimdLevel();
+		return s_level;
+	}
+
+	const char* GetSimdLevelName( SimdLevel level )
+	{
+		return SIMD_LEVEL_NAMES[static_cast<size_t>( level )];
+	}
+
+	void RenderGradientSpan( uint32_t* row, size_t count, float dx, float dy, const GradientParams& params,
+	                         uint32_t color )
+	{
+		RenderGradientSpan( GetSimdLevel(), row, count, dx, dy, params, color );
+	}
+
+	void RenderGradientSpan( SimdLevel level, uint32_t* row, size_t count, float dx, float dy,
+	                         const GradientParams& params, uint32_t color )
+	{
+		if ( params.kind == GradientKind::None )
+		{
+			std::fill( row, row + count, color );
+			return;
+		}
+
+		const SpanConstants constants = MakeSpanConstants( dy, params, color );
+
+		// the linear gradient is the radial one with no vertical distance, dy2 is zero
+		size_t done = 0;
+#if THEATER_GRADIENT_X86
+		if ( level == SimdLevel::AVX2 && GetSimdLevel() == SimdLevel::AVX2 )
+			done = RenderSpanAVX2( row, count, dx, constants );
+		else if ( level != SimdLevel::Scalar )
+			done = RenderSpanSSE2( row, count, dx, constants );
+#else
+		static_cast<void>( level );
+#endif
+
+		RenderSpanScalar( row + done, count - done, dx + static_cast<float>( done ), constants );
+	}
+} // namespace Theater
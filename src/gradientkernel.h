@@ -0,0 +1,43 @@
+#pragma once
+
+namespace Theater
+{
+	enum class GradientKind
+	{
+		// flat dimmer color
+		None,
+		// darker the further away from the target center
+		Radial,
+		// darker the further away from the target center horizontally
+		Linear
+	};
+
+	bool           ParseGradientKind( std::wstring_view name, GradientKind& kind );
+	const wchar_t* GetGradientKindName( GradientKind kind );
+
+	struct GradientParams
+	{
+		GradientKind kind;
+		float        radius;        // distance in pixels at which the full dimmer color is reached
+		float        innerCoverage; // coverage at the center, [0, 1]
+	};
+
+	enum class SimdLevel
+	{
+		Scalar,
+		SSE2,
+		AVX2
+	};
+
+	// Best instruction set supported by both the build and the running CPU, detected once
+	SimdLevel   GetSimdLevel();
+	const char* GetSimdLevelName( SimdLevel level );
+
+	// Renders count premultiplied BGRA pixels of a gradient towards the opaque color.
+	// dx and dy are the offsets of the first pixel center from the gradient center, following pixels go right.
+	// The kernel is picked from GetSimdLevel, all kernels round the same way and give identical results.
+	void RenderGradientSpan( uint32_t* row, size_t count, float dx, float dy, const GradientParams& params,
+	                         uint32_t color );
+	void RenderGradientSpan( SimdLevel level, uint32_t* row, size_t count, float dx, float dy,
+	                         const GradientParams& params, uint32_t color );
+} // namespace Theater
\ No newline at end of file
@@ -0,0 +1,169 @@
+#include "theater.h"
+#include "headlesspipeline.h"
+
+namespace Theater
+{
+	namespace
+	{
+		// hook callbacks carry no context
+		std::vector<WindowEvent>* s_pipelineEvents = nullptr;
+	} // namespace
+
+	void HeadlessPipeline::Start( SimulatedDesktop* desktop )
+	{
+		this->desktop = desktop;
+		this->registry.Init( desktop );
+		this->resolver.SetPlatform( desktop );
+		this->coalescer.Clear();
+
+		s_pipelineEvents = &this->events;
+		this->desktop->StartEventHooks( HeadlessPipeline::EventCallback );
+	}
+
+	void HeadlessPipeline::Stop()
+	{
+		if ( this->desktop == nullptr )
+			return;
+
+		this->desktop->StopEventHooks();
+		s_pipelineEvents = nullptr;
+
+		this->registry.Close();
+		this->resolver.Clear();
+		this->session.Reset();
+		this->tracker.Clear();
+		this->desktop = nullptr;
+	}
+
+	void HeadlessPipeline::Configure( const ProcessNameSet& targetNames, const ProcessNameSet& companionNames )
+	{
+		this->resolver.Configure( targetNames, std::vector<Rule>() );
+		this->resolver.ConfigureCompanions( companionNames );
+		this->session.Clear();
+	}
+
+	void HeadlessPipeline::SetDimmers( const std::vector<ZOrderDimmer>& dimmers )
+	{
+		this->arranger.SetDimmers( dimmers );
+
+		std::vector<PlatformRect> monitors;
+		for ( const auto& dimmer : dimmers )
+			monitors.emplace_back( dimmer.monitor );
+
+		this->tracker.SetMonitors( monitors );
+	}
+
+	size_t HeadlessPipeline::Dispatch( uint64_t nowMs )
+	{
+		this->events.clear();
+		this->desktop->DispatchEvents();
+
+		for ( const auto& event : this->events )
+		{
+			// the target's moves never reach the worker in the app either
+			if ( event.type == WindowEventType::LocationChanged )
+			{
+				this->tracker.Push( event, nowMs );
+				continue;
+			}
+
+			if ( !this->coalescer.Push( event, nowMs ) )
+				continue;
+
+			this->registry.OnWindowEvent( event );
+			if ( event.type == WindowEventType::Destroyed )
+				this->resolver.RemoveWindow( event.window );
+
+			this->session.OnWindowEvent( event, this->resolver, this->registry, nullptr );
+		}
+
+		return this->events.size();
+	}
+
+	uint32_t HeadlessPipeline::GetTimeout( uint64_t nowMs ) const
+	{
+		// both use NO_TIMEOUT as the largest value
+		return std::min( this->coalescer.GetTimeout( nowMs ), this->tracker.GetTimeout( nowMs ) );
+	}
+
+	bool HeadlessPipeline::Decide( uint64_t nowMs, Decision& decision )
+	{
+		WindowEvent foreground = {};
+		if ( !this->coalescer.PopForeground( nowMs, foreground ) )
+			return false;
+
+		decision          = {};
+		decision.window   = foreground.window;
+		decision.strategy = ZOrderStrategy::None;
+		if ( !this->session.OnForeground( foreground.window, this->resolver, this->registry, nullptr,
+		                                  decision.transition ) )
+			return false;
+
+		decision.isTarget = decision.transition != TheaterSession::Transition::Stop;
+		TrackTarget( decision );
+		return true;
+	}
+
+	void HeadlessPipeline::Arrange( Decision& decision )
+	{
+		decision.strategy = ZOrderStrategy::None;
+		if ( decision.transition != TheaterSession::Transition::Start )
+			return;
+
+		this->session.GetCompanions( decision.window, this->companions );
+		decision.strategy =
+		    this->arranger.Arrange( *this->desktop, decision.window, this->companions, this->registry, nullptr );
+	}
+
+	bool HeadlessPipeline::Track( uint64_t nowMs, uint32_t& changes )
+	{
+		return this->tracker.Pop( *this->desktop, nowMs, changes );
+	}
+
+	void HeadlessPipeline::TrackTarget( const Decision& decision )
+	{
+		if ( !decision.isTarget || !this->tracker.Track( *this->desktop, decision.window ) )
+		{
+			this->tracker.Clear();
+			this->desktop->StopLocationHook();
+			return;
+		}
+
+		this->desktop->StartLocationHook( this->desktop->GetWindowProcessId( decision.window ) );
+	}
+
+	const WindowRegistry& HeadlessPipeline::GetRegistry() const
+	{
+		return this->registry;
+	}
+
+	const ProcessCache& HeadlessPipeline::GetProcessCache() const
+	{
+		return this->resolver.GetProcessCache();
+	}
+
+	const ZOrderArranger& HeadlessPipeline::GetArranger() const
+	{
+		return this->arranger;
+	}
+
+	const TheaterSession& HeadlessPipeline::GetSession() const
+	{
+		return this->session;
+	}
+
+	const TargetTracker& HeadlessPipeline::GetTracker() const
+	{
+		return this->tracker;
+	}
+
+	size_t HeadlessPipeline::GetCoalescedCount() const
+	{
+		return this->coalescer.GetCoalescedCount();
+	}
+
+	void HeadlessPipeline::EventCallback( const WindowEvent& event )
+	{
+		s_pipelineEvents->emplace_back( event );
+	}
+} // namespace Theater
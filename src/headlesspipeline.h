@@ -0,0 +1,72 @@
+#pragma once
+
+namespace Theater
+{
+	// The event handling of the app on a SimulatedDesktop, without a UI thread. Hook events go through the
+	// coalescer into the registry, the resolver and the theater session, and a coalesced foreground change is
+	// decided and the dimmers moved in the z-order through the same ZOrderArranger as App::TheaterStart. The
+	// target's location changes go to a TargetTracker as they do with spotlight or gradient dimmers.
+	// Replays, soak runs and the benchmark drive it.
+	class HeadlessPipeline
+	{
+	public:
+		struct Decision
+		{
+			Platform::WindowId         window;
+			bool                       isTarget; // the theater is shown, on a target or another window of its session
+			TheaterSession::Transition transition;
+			ZOrderStrategy             strategy;
+		};
+
+		HeadlessPipeline()  = default;
+		~HeadlessPipeline() = default;
+
+		// Enumerates the desktop and installs the hooks, only one pipeline can be started at a time
+		void Start( SimulatedDesktop* desktop );
+		void Stop();
+
+		void Configure( const ProcessNameSet& targetNames, const ProcessNameSet& companionNames );
+		void SetDimmers( const std::vector<ZOrderDimmer>& dimmers );
+
+		// Delivers the queued hook events, returns how many
+		size_t Dispatch( uint64_t nowMs );
+
+		// Milliseconds until Decide or Track have something to do, NO_TIMEOUT when nothing is pending
+		uint32_t GetTimeout( uint64_t nowMs ) const;
+
+		// The session transition of a coalesced foreground change, what the app's worker posts to the UI thread
+		bool Decide( uint64_t nowMs, Decision& decision );
+
+		// Orders the z-order for a session start as App::TheaterStart does, fills in the strategy
+		void Arrange( Decision& decision );
+
+		// The target's rect at most once per frame, changes is a combination of TargetTracker::TARGET_ flags
+		bool Track( uint64_t nowMs, uint32_t& changes );
+
+		const WindowRegistry& GetRegistry() const;
+		const ProcessCache&   GetProcessCache() const;
+		const ZOrderArranger& GetArranger() const;
+		const TheaterSession& GetSession() const;
+		const TargetTracker&  GetTracker() const;
+		size_t                GetCoalescedCount() const;
+
+	private:
+		HeadlessPipeline( const HeadlessPipeline& ) = delete;
+		HeadlessPipeline& operator=( const HeadlessPipeline& ) = delete;
+
+		static void EventCallback( const WindowEvent& event );
+
+		void TrackTarget( const Decision& decision );
+
+	private:
+		SimulatedDesktop*               desktop = nullptr;
+		WindowRegistry                  registry;
+		TargetResolver                  resolver;
+		TheaterSession                  session;
+		TargetTracker                   tracker;
+		WindowEventCoalescer            coalescer;
+		std::vector<WindowEvent>        events;
+		ZOrderArranger                  arranger;
+		std::vector<Platform::WindowId> companions;
+	};
+} // namespace Theater
\ No newline at end of file
@@ -0,0 +1,158 @@
+#include "theater.h"
+#include "monitorlevels.h"
+
+namespace Theater
+{
+	namespace
+	{
+		uint8_t Quantize( float alpha )
+		{
+			return static_cast<uint8_t>( std::max( 0.0f, std::min( 255.0f, alpha * 255.0f + 0.5f ) ) );
+		}
+	} // namespace
+
+	void MonitorLevels::SetBaseAlpha( uint8_t value )
+	{
+		this->baseAlpha = value;
+
+		for ( size_t i = 0; i < this->devices.size(); i++ )
+			Resolve( i );
+	}
+
+	void MonitorLevels::SetBaseColor( uint32_t value )
+	{
+		this->baseColor = value;
+
+		for ( size_t i = 0; i < this->devices.size(); i++ )
+			Resolve( i );
+	}
+
+	void MonitorLevels::SetOverrides( const std::vector<MonitorLevel>& value )
+	{
+		this->overrides = value;
+
+		for ( size_t i = 0; i < this->devices.size(); i++ )
+			Resolve( i );
+	}
+
+	void MonitorLevels::Assign( const std::wstring* value, size_t count )
+	{
+		std::vector<std::wstring> formerDevices = std::move( this->devices );
+		std::vector<uint32_t>     formerColors  = std::move( this->colors );
+		std::vector<uint8_t>      formerAlphas  = std::move( this->alphas );
+		std::vector<uint8_t>      formerDirty   = std::move( this->dirty );
+
+		this->devices.assign( value, value + count );
+		this->scales.assign( count, 1.0f );
+		this->colors.assign( count, this->baseColor );
+		this->alphas.assign( count, 0 );
+		this->dirty.assign( count, ALPHA_CHANGED | COLOR_CHANGED );
+
+		for ( size_t i = 0; i < count; i++ )
+		{
+			const auto iter = std::find( formerDevices.begin(), formerDevices.end(), this->devices[i] );
+			if ( iter != formerDevices.end() )
+			{
+				const size_t former = static_cast<size_t>( iter - formerDevices.begin() );
+				this->colors[i]     = formerColors[former];
+				this->alphas[i]     = formerAlphas[former];
+				this->dirty[i]      = formerDirty[former];
+			}
+
+			Resolve( i );
+		}
+	}
+
+	void MonitorLevels::Invalidate( size_t index )
+	{
+		this->dirty[index] = ALPHA_CHANGED | COLOR_CHANGED;
+	}
+
+	void MonitorLevels::InvalidateAll()
+	{
+		std::fill( this->dirty.begin(), this->dirty.end(), static_cast<uint8_t>( ALPHA_CHANGED | COLOR_CHANGED ) );
+	}
+
+	void MonitorLevels::SetFade( float value )
+	{
+		this->fade = value;
+	}
+
+	bool MonitorLevels::Update( std::vector<Change>& changes )
+	{
+		changes.clear();
+
+		const size_t count = this->scales.size();
+		for ( size_t i = 0; i < count; i++ )
+		{
+			const uint8_t alpha = Quantize( this->fade * this->scales[i] );
+			uint8_t       flags = this->dirty[i];
+			if ( alpha != this->alphas[i] )
+				flags |= ALPHA_CHANGED;
+
+			if ( flags == 0 )
+				continue;
+
+			this->alphas[i] = alpha;
+			this->dirty[i]  = 0;
+			changes.emplace_back( Change{ static_cast<uint32_t>( i ), flags } );
+		}
+
+		return !changes.empty();
+	}
+
+	bool MonitorLevels::Apply( Platform& platform, const Platform::WindowId* windows, std::vector<Change>& changes )
+	{
+		if ( !Update( changes ) )
+			return false;
+
+		for ( const auto& change : changes )
+		{
+			if ( change.flags & ALPHA_CHANGED )
+				platform.SetWindowAlpha( windows[change.index], this->alphas[change.index] );
+		}
+
+		return true;
+	}
+
+	size_t MonitorLevels::GetCount() const
+	{
+		return this->scales.size();
+	}
+
+	uint8_t MonitorLevels::GetAlpha( size_t index ) const
+	{
+		return this->alphas[index];
+	}
+
+	uint32_t MonitorLevels::GetColor( size_t index ) const
+	{
+		return this->colors[index];
+	}
+
+	void MonitorLevels::Resolve( size_t index )
+	{
+		float    scale = 1.0f;
+		uint32_t color = this->baseColor;
+
+		for ( const auto& level : this->overrides )
+		{
+			if ( level.device != this->devices[index] )
+				continue;
+
+			// the fade runs towards the global alpha, overrides are relative to it
+			if ( level.alpha != MonitorLevel::GLOBAL )
+				scale = this->baseAlpha > 0 ? static_cast<float>( level.alpha ) / this->baseAlpha : 0.0f;
+			if ( level.color != MonitorLevel::GLOBAL )
+				color = static_cast<uint32_t>( level.color );
+			break;
+		}
+
+		this->scales[index] = scale;
+		if ( this->colors[index] != color )
+		{
+			this->colors[index] = color;
+			this->dirty[index] |= COLOR_CHANGED;
+		}
+	}
+} // namespace Theater
@@ -0,0 +1,73 @@
+#pragma once
+
+namespace Theater
+{
+	// Per monitor override from the settings, matched against the monitor device name
+	struct MonitorLevel
+	{
+		static constexpr int32_t GLOBAL = -1;
+
+		std::wstring device;         // e.g. \\.\DISPLAY2
+		int32_t      alpha = GLOBAL; // 0..255, GLOBAL follows the global alpha
+		int64_t      color = GLOBAL; // 0x00BBGGRR like a COLORREF, GLOBAL follows the global color
+	};
+
+	// Dim level and color of every dimmer window, as parallel arrays indexed like the dimmer monitors.
+	// The fade drives a single value, each monitor scales it so it lands on its own alpha when the fade completes.
+	// Update reports only the monitors whose quantized alpha or color differs from what was last applied,
+	// a fade tick over several monitors at the same level touches no window once the byte stops changing.
+	class MonitorLevels
+	{
+	public:
+		enum : uint8_t
+		{
+			ALPHA_CHANGED = 1 << 0,
+			COLOR_CHANGED = 1 << 1
+		};
+
+		struct Change
+		{
+			uint32_t index;
+			uint8_t  flags;
+		};
+
+		MonitorLevels()  = default;
+		~MonitorLevels() = default;
+
+		void SetBaseAlpha( uint8_t alpha );
+		void SetBaseColor( uint32_t color );
+		void SetOverrides( const std::vector<MonitorLevel>& overrides );
+
+		// Binds the slots to the monitors, monitors bound before keep their state, new ones are reported by Update
+		void Assign( const std::wstring* devices, size_t count );
+		void Invalidate( size_t index );
+		void InvalidateAll();
+
+		void SetFade( float fade );
+		bool Update( std::vector<Change>& changes );
+
+		// Update for plain layered windows, windows is indexed like the monitors. Windows whose alpha changed get it
+		// through the platform, those whose color changed are only reported and have to be repainted by the caller.
+		bool Apply( Platform& platform, const Platform::WindowId* windows, std::vector<Change>& changes );
+
+		size_t   GetCount() const;
+		uint8_t  GetAlpha( size_t index ) const;
+		uint32_t GetColor( size_t index ) const;
+
+	private:
+		void Resolve( size_t index );
+
+	private:
+		uint8_t                   baseAlpha = 0;
+		uint32_t                  baseColor = 0;
+		float                     fade      = 0.0f;
+		std::vector<MonitorLevel> overrides;
+
+		// one entry per monitor
+		std::vector<std::wstring> devices;
+		std::vector<float>        scales;
+		std::vector<uint32_t>     colors;
+		std::vector<uint8_t>      alphas; // last reported
+		std::vector<uint8_t>      dirty;
+	};
+} // namespace Theater
\ No newline at end of file
@@ -0,0 +1,100 @@
+#include "theater.h"
+#include "monitortopology.h"
+
+namespace Theater
+{
+	namespace
+	{
+		bool IsSameRect( const MonitorLayout& a, const MonitorLayout& b )
+		{
+			return a.left == b.left && a.top == b.top && a.right == b.right && a.bottom == b.bottom;
+		}
+
+		int64_t GetOverlapArea( const MonitorLayout& a, const MonitorLayout& b )
+		{
+			const int64_t width  = std::min( a.right, b.right ) - std::max( a.left, b.left );
+			const int64_t height = std::min( a.bottom, b.bottom ) - std::max( a.top, b.top );
+			return width > 0 && height > 0 ? width * height : 0;
+		}
+
+		struct Candidate
+		{
+			int64_t overlap;
+			size_t  former;
+			size_t  next;
+		};
+	} // namespace
+
+	void DiffMonitorTopology( const std::vector<MonitorLayout>& former, const std::vector<MonitorLayout>& next,
+	                          MonitorTopologyDiff& diff )
+	{
+		const MonitorTopologyDiff::Entry created = { MonitorAction::Create, MonitorTopologyDiff::NO_SOURCE };
+		diff.entries.assign( next.size(), created );
+		diff.retired.clear();
+
+		std::vector<uint8_t> taken( former.size(), 0 );
+
+		const auto assign = [&]( size_t nextIndex, size_t formerIndex ) {
+			const bool same         = IsSameRect( former[formerIndex], next[nextIndex] );
+			diff.entries[nextIndex] = { same ? MonitorAction::Keep : MonitorAction::Move, formerIndex };
+			taken[formerIndex]      = 1;
+		};
+
+		// same device, possibly moved or resized
+		for ( size_t i = 0; i < next.size(); i++ )
+		{
+			for ( size_t j = 0; j < former.size(); j++ )
+			{
+				if ( !taken[j] && !next[i].device.empty() && former[j].device == next[i].device )
+				{
+					assign( i, j );
+					break;
+				}
+			}
+		}
+
+		// same place under another name
+		for ( size_t i = 0; i < next.size(); i++ )
+		{
+			if ( diff.entries[i].source != MonitorTopologyDiff::NO_SOURCE )
+				continue;
+
+			for ( size_t j = 0; j < former.size(); j++ )
+			{
+				if ( !taken[j] && IsSameRect( former[j], next[i] ) )
+				{
+					assign( i, j );
+					break;
+				}
+			}
+		}
+
+		// whatever is left gets moved, the most overlapping pairs first so windows travel the least
+		std::vector<Candidate> candidates;
+		for ( size_t i = 0; i < next.size(); i++ )
+		{
+			if ( diff.entries[i].source != MonitorTopologyDiff::NO_SOURCE )
+				continue;
+
+			for ( size_t j = 0; j < former.size(); j++ )
+			{
+				if ( !taken[j] )
+					candidates.emplace_back( Candidate{ GetOverlapArea( former[j], next[i] ), j, i } );
+			}
+		}
+
+		std::stable_sort( candidates.begin(), candidates.end(),
+		                  []( const Candidate& a, const Candidate& b ) { return a.overlap > b.overlap; } );
+		for ( const auto& candidate : candidates )
+		{
+			if ( !taken[candidate.former] && diff.entries[candidate.next].source == MonitorTopologyDiff::NO_SOURCE )
+				assign( candidate.next, candidate.former );
+		}
+
+		for ( size_t j = 0; j < former.size(); j++ )
+		{
+			if ( !taken[j] )
+				diff.retired.emplace_back( j );
+		}
+	}
+} // namespace Theater
@@ -0,0 +1,43 @@
+#pragma once
+
+namespace Theater
+{
+	struct MonitorLayout
+	{
+		std::wstring device; // stable name of the display, e.g. \\.\DISPLAY1
+		int32_t      left;
+		int32_t      top;
+		int32_t      right;
+		int32_t      bottom;
+	};
+
+	enum class MonitorAction
+	{
+		// same place, the window is left alone
+		Keep,
+		// the window of a former monitor is moved and resized
+		Move,
+		// no former monitor left to take over, a window has to be created or taken from the pool
+		Create
+	};
+
+	struct MonitorTopologyDiff
+	{
+		static constexpr size_t NO_SOURCE = ~static_cast<size_t>( 0 );
+
+		struct Entry
+		{
+			MonitorAction action;
+			size_t        source; // former monitor index, NO_SOURCE when created
+		};
+
+		std::vector<Entry>  entries; // one per new monitor, in the new order
+		std::vector<size_t> retired; // former monitors nothing took over
+	};
+
+	// Maps the new monitor set onto the former one so as few dimmer windows as possible are touched.
+	// Monitors are matched by device name first, then by identical rect (renamed device), then by largest overlap,
+	// anything still unmatched on both sides is paired up so windows get moved rather than recreated.
+	void DiffMonitorTopology( const std::vector<MonitorLayout>& former, const std::vector<MonitorLayout>& next,
+	                          MonitorTopologyDiff& diff );
+} // namespace Theater
\ No newline at end of file
@@ -0,0 +1,403 @@
+#include "theater.h"
+#include "pipelinebenchmark.h"
+#include <rapidjson/rapidjson.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+#include <random>
+
+namespace Theater
+{
+	namespace
+	{
+		constexpr uint32_t BENCHMARK_JSON_VERSION = 1;
+		constexpr uint32_t FRAME_MICROSECONDS     = 16667;
+
+		// a single span is below the clock resolution, the tracing cost is the mean of a batch
+		constexpr uint32_t TRACE_BATCH = 64;
+
+		// every tenth process is a target, half the switches land on one of their windows
+		constexpr uint32_t TARGET_PROCESS_STRIDE = 10;
+
+		// the processes right after the first target are companions, like a launcher and a voice chat
+		constexpr uint32_t COMPANION_PROCESS_COUNT = 2;
+
+		// location changes of a window dragged with a 1 kHz mouse over one frame
+		constexpr uint32_t DRAG_MOVES_PER_FRAME = 16;
+
+		enum Stage : size_t
+		{
+			STAGE_ENUMERATE,
+			STAGE_RESOLVE,
+			STAGE_MATCH,
+			STAGE_ZORDER,
+			STAGE_FADE,
+			STAGE_PIPELINE,
+			STAGE_SESSION_START,
+			STAGE_SESSION_SWITCH,
+			STAGE_TRACK,
+			STAGE_TRACE_OFF,
+			STAGE_TRACE_ON,
+			STAGE_COUNT
+		};
+
+		const char* const STAGE_NAMES[STAGE_COUNT] = { "enumerate",     "resolve",        "match",
+		                                               "zorder",        "fade",           "pipeline",
+		                                               "session-start", "session-switch", "track",
+		                                               "trace-off",     "trace-on" };
+
+		class BenchmarkClock final : public AnimationClock
+		{
+		public:
+			uint64_t GetTimeMicroseconds() const override
+			{
+				return this->now;
+			}
+
+			void Advance( uint64_t microseconds )
+			{
+				this->now += microseconds;
+			}
+
+		private:
+			uint64_t now = 0;
+		};
+
+		uint64_t GetTimeNanoseconds()
+		{
+			const auto now = std::chrono::steady_clock::now().time_since_epoch();
+			return static_cast<uint64_t>( std::chrono::duration_cast<std::chrono::nanoseconds>( now ).count() );
+		}
+
+		uint64_t TimeTraceSpan()
+		{
+			const uint64_t start = GetTimeNanoseconds();
+			for ( uint32_t i = 0; i < TRACE_BATCH; i++ )
+				TraceScope trace( "benchmark", i );
+
+			return ( GetTimeNanoseconds() - start + TRACE_BATCH / 2 ) / TRACE_BATCH;
+		}
+
+		struct SyntheticDesktop
+		{
+			SimulatedDesktop                desktop;
+			ProcessNameSet                  targetNames;
+			ProcessNameSet                  companionNames;
+			std::vector<Platform::WindowId> windows;
+			std::vector<Platform::WindowId> targetWindows;
+			std::vector<ZOrderDimmer>       dimmers;
+			uint32_t                        processCount = 0;
+		};
+
+		void BuildDesktop( uint32_t windowCount, std::mt19937& random, SyntheticDesktop& synthetic )
+		{
+			auto& desktop = synthetic.desktop;
+
+			const PlatformRect monitors[] = { { 0, 0, 1920, 1080 }, { 1920, 0, 3840, 1080 } };
+			desktop.AddMonitor( L"\\\\.\\DISPLAY1", monitors[0] );
+			desktop.AddMonitor( L"\\\\.\\DISPLAY2", monitors[1] );
+
+			// our own dimmers, left out of the hook events like the real ones
+			const uint32_t self = desktop.StartProcess( L"C:\\Program Files\\Theater\\theater.exe" );
+			desktop.SetCurrentProcess( self );
+			for ( const auto& monitor : monitors )
+			{
+				SimulatedDesktop::WindowParams params = {};
+				params.pid                            = self;
+				params.className                      = L"TheaterDimmerWindow";
+				params.rect                           = monitor;
+
+				const auto window = desktop.AddWindow( params );
+				synthetic.dimmers.emplace_back( ZOrderDimmer{ window, monitor } );
+			}
+
+			// a few windows per process, like a desktop with some browsers and many small tools
+			synthetic.processCount = std::max<uint32_t>( 8, windowCount / 4 );
+			std::vector<uint32_t> pids;
+			for ( uint32_t i = 0; i < synthetic.processCount; i++ )
+			{
+				wchar_t name[32];
+				swprintf( name, 32, L"app%u", i );
+				pids.emplace_back( desktop.StartProcess( std::wstring( L"C:\\Apps\\" ) + name + L".exe" ) );
+
+				if ( i % TARGET_PROCESS_STRIDE == 0 )
+					synthetic.targetNames.Add( name );
+				else if ( i <= COMPANION_PROCESS_COUNT )
+					synthetic.companionNames.Add( name );
+			}
+
+			std::uniform_int_distribution<uint32_t> pickProcess( 0, synthetic.processCount - 1 );
+			std::uniform_int_distribution<int32_t>  pickX( -200, 3600 );
+			std::uniform_int_distribution<int32_t>  pickY( -100, 900 );
+			std::uniform_int_distribution<int32_t>  pickSize( 100, 1600 );
+			std::uniform_int_distribution<uint32_t> pickPercent( 0, 99 );
+			for ( uint32_t i = 0; i < windowCount; i++ )
+			{
+				const uint32_t process = pickProcess( random );
+				const int32_t  x       = pickX( random );
+				const int32_t  y       = pickY( random );
+
+				// a third of the top level windows are hidden, as on a real desktop, and a few stay on top
+				SimulatedDesktop::WindowParams params = {};
+				params.pid                            = pids[process];
+				params.className                      = L"AppWindow";
+				params.title                          = L"Window";
+				params.rect                           = { x, y, x + pickSize( random ), y + pickSize( random ) };
+				params.visible                        = pickPercent( random ) >= 33;
+				params.topmost                        = pickPercent( random ) < 2;
+
+				const auto window = desktop.AddWindow( params );
+				if ( !params.visible )
+					continue;
+
+				synthetic.windows.emplace_back( window );
+				if ( process % TARGET_PROCESS_STRIDE == 0 )
+					synthetic.targetWindows.emplace_back( window );
+			}
+		}
+
+		void RunDesktop( uint32_t windowCount, const BenchmarkOptions& options, std::mt19937& random,
+		                 BenchmarkRun& run )
+		{
+			SyntheticDesktop synthetic;
+			BuildDesktop( windowCount, random, synthetic );
+
+			auto& desktop = synthetic.desktop;
+
+			// the path under test is the one replays and soak runs take, the same the app takes
+			HeadlessPipeline pipeline;
+			pipeline.Start( &desktop );
+			pipeline.Configure( synthetic.targetNames, synthetic.companionNames );
+			pipeline.SetDimmers( synthetic.dimmers );
+
+			// only for the resolve stage, timed on its own
+			TargetResolver resolver;
+			resolver.SetPlatform( &desktop );
+			resolver.Configure( synthetic.targetNames, std::vector<Rule>() );
+
+			BenchmarkClock clock;
+			FadeAnimation  fade;
+			fade.SetClock( &clock );
+			fade.Reset( 0.0f );
+
+			std::vector<Platform::WindowId> companions;
+
+			std::vector<uint64_t> samples[STAGE_COUNT];
+			for ( auto& stageSamples : samples )
+				stageSamples.reserve( options.iterations );
+
+			WindowRegistry enumerated;
+			uint64_t       nowMs = 0;
+
+			std::uniform_int_distribution<uint32_t> pickPercent( 0, 99 );
+			for ( uint32_t i = 0; i < options.iterations; i++ )
+			{
+				const auto& candidates = ( pickPercent( random ) < 50 && !synthetic.targetWindows.empty() )
+				                             ? synthetic.targetWindows
+				                             : synthetic.windows;
+				std::uniform_int_distribution<size_t> pickWindow( 0, candidates.size() - 1 );
+				const auto                            window = candidates[pickWindow( random )];
+
+				// what the OS does is not ours to measure
+				desktop.SetForegroundWindow( window );
+				nowMs += 100;
+
+				const uint64_t pipelineStart = GetTimeNanoseconds();
+
+				pipeline.Dispatch( nowMs );
+
+				HeadlessPipeline::Decision decision = {};
+				decision.transition                 = TheaterSession::Transition::Stop;
+
+				const uint64_t decideStart = GetTimeNanoseconds();
+				if ( pipeline.Decide( nowMs + WindowEventCoalescer::DEFAULT_DELAY, decision ) &&
+				     decision.transition == TheaterSession::Transition::Start )
+					samples[STAGE_SESSION_START].emplace_back( GetTimeNanoseconds() - decideStart );
+
+				// only a new session is ordered, focus moving within one leaves the z-order alone
+				if ( decision.transition == TheaterSession::Transition::Start )
+				{
+					const uint64_t zOrderStart = GetTimeNanoseconds();
+					pipeline.Arrange( decision );
+					samples[STAGE_ZORDER].emplace_back( GetTimeNanoseconds() - zOrderStart );
+				}
+
+				// the first frame of the fade in, or out when the theater stops
+				const uint64_t fadeStart = GetTimeNanoseconds();
+				uint8_t        alpha     = 0;
+				fade.Start( decision.transition != TheaterSession::Transition::Stop ? 0.7f : 0.0f );
+				clock.Advance( FRAME_MICROSECONDS );
+				fade.Tick( alpha );
+				samples[STAGE_FADE].emplace_back( GetTimeNanoseconds() - fadeStart );
+
+				samples[STAGE_PIPELINE].emplace_back( GetTimeNanoseconds() - pipelineStart );
+
+				// focus moving to another window of the session, from the hook to the decision to leave things be
+				const auto& session = pipeline.GetSession();
+				if ( session.IsActive() && session.GetWindowCount() > 1 )
+				{
+					session.GetCompanions( session.GetFocus(), companions );
+					std::uniform_int_distribution<size_t> pickCompanion( 0, companions.size() - 1 );
+					desktop.SetForegroundWindow( companions[pickCompanion( random )] );
+					nowMs += 100;
+
+					const uint64_t switchStart = GetTimeNanoseconds();
+
+					pipeline.Dispatch( nowMs );
+					pipeline.Decide( nowMs + WindowEventCoalescer::DEFAULT_DELAY, decision );
+
+					samples[STAGE_SESSION_SWITCH].emplace_back( GetTimeNanoseconds() - switchStart );
+				}
+
+				// a frame of the target being dragged, over and back so it ends where it started
+				const auto focus = pipeline.GetTracker().GetWindow();
+				if ( focus != Platform::NO_WINDOW )
+				{
+					PlatformRect rect = pipeline.GetTracker().GetRect();
+					for ( uint32_t move = 0; move < DRAG_MOVES_PER_FRAME; move++ )
+					{
+						const int32_t dx = move < DRAG_MOVES_PER_FRAME / 2 ? 4 : -4;
+						rect             = { rect.left + dx, rect.top, rect.right + dx, rect.bottom };
+						desktop.SetWindowRect( focus, rect );
+					}
+					nowMs += 16;
+
+					const uint64_t trackStart = GetTimeNanoseconds();
+
+					pipeline.Dispatch( nowMs );
+
+					uint32_t changes = 0;
+					pipeline.Track( nowMs, changes );
+
+					samples[STAGE_TRACK].emplace_back( GetTimeNanoseconds() - trackStart );
+				}
+
+				// the pieces that are not on the path above, timed on their own
+				bool           isTarget     = false;
+				const uint64_t resolveStart = GetTimeNanoseconds();
+				resolver.Resolve( window, isTarget );
+				samples[STAGE_RESOLVE].emplace_back( GetTimeNanoseconds() - resolveStart );
+
+				std::wstring path;
+				std::wstring name;
+				if ( desktop.QueryProcessPath( desktop.GetWindowProcessId( window ), path, name ) )
+				{
+					const uint64_t matchStart = GetTimeNanoseconds();
+					const bool     matched    = synthetic.targetNames.Contains( name );
+					samples[STAGE_MATCH].emplace_back( GetTimeNanoseconds() - matchStart );
+					static_cast<void>( matched );
+				}
+
+				const uint64_t enumerateStart = GetTimeNanoseconds();
+				enumerated.Init( &desktop );
+				samples[STAGE_ENUMERATE].emplace_back( GetTimeNanoseconds() - enumerateStart );
+
+				samples[STAGE_TRACE_OFF].emplace_back( TimeTraceSpan() );
+				EnableTracing( true );
+				samples[STAGE_TRACE_ON].emplace_back( TimeTraceSpan() );
+				EnableTracing( false );
+			}
+
+			pipeline.Stop();
+
+			run.windowCount  = windowCount;
+			run.processCount = synthetic.processCount;
+			run.stages.clear();
+			for ( size_t stage = 0; stage < STAGE_COUNT; stage++ )
+				run.stages.emplace_back( SummarizeBenchmarkStage( STAGE_NAMES[stage], samples[stage] ) );
+		}
+	} // namespace
+
+	BenchmarkStage SummarizeBenchmarkStage( const char* name, std::vector<uint64_t>& samples )
+	{
+		BenchmarkStage stage = {};
+		stage.name           = name;
+		stage.count          = samples.size();
+		if ( samples.empty() )
+			return stage;
+
+		std::sort( samples.begin(), samples.end() );
+
+		const auto percentile = [&samples]( double p ) {
+			const size_t rank = static_cast<size_t>( std::ceil( p * samples.size() ) );
+			return samples[std::max<size_t>( rank, 1 ) - 1] / 1000.0;
+		};
+
+		uint64_t total = 0;
+		for ( const auto sample : samples )
+			total += sample;
+
+		stage.min  = samples.front() / 1000.0;
+		stage.mean = static_cast<double>( total ) / samples.size() / 1000.0;
+		stage.p50  = percentile( 0.50 );
+		stage.p90  = percentile( 0.90 );
+		stage.p99  = percentile( 0.99 );
+		stage.p999 = percentile( 0.999 );
+		stage.max  = samples.back() / 1000.0;
+		return stage;
+	}
+
+	void RunPipelineBenchmark( const BenchmarkOptions& options, std::vector<BenchmarkRun>& runs )
+	{
+		std::mt19937 random( options.seed );
+
+		runs.clear();
+		for ( const auto windowCount : options.windowCounts )
+		{
+			BenchmarkRun run = {};
+			RunDesktop( windowCount, options, random, run );
+			runs.emplace_back( std::move( run ) );
+		}
+	}
+
+	void WriteBenchmarkJson( const std::vector<BenchmarkRun>& runs, std::string& json )
+	{
+		rapidjson::StringBuffer                    buffer;
+		rapidjson::Writer<rapidjson::StringBuffer> writer( buffer );
+
+		writer.StartObject();
+		writer.Key( "version" );
+		writer.Uint( BENCHMARK_JSON_VERSION );
+		writer.Key( "unit" );
+		writer.String( "us" );
+		writer.Key( "runs" );
+		writer.StartArray();
+		for ( const auto& run : runs )
+		{
+			writer.StartObject();
+			writer.Key( "windows" );
+			writer.Uint( run.windowCount );
+			writer.Key( "processes" );
+			writer.Uint( run.processCount );
+			writer.Key( "stages" );
+			writer.StartObject();
+			for ( const auto& stage : run.stages )
+			{
+				writer.Key( stage.name );
+				writer.StartObject();
+				writer.Key( "count" );
+				writer.Uint64( stage.count );
+				writer.Key( "min" );
+				writer.Double( stage.min );
+				writer.Key( "mean" );
+				writer.Double( stage.mean );
+				writer.Key( "p50" );
+				writer.Double( stage.p50 );
+				writer.Key( "p90" );
+				writer.Double( stage.p90 );
+				writer.Key( "p99" );
+				writer.Double( stage.p99 );
+				writer.Key( "p999" );
+				writer.Double( stage.p999 );
+				writer.Key( "max" );
+				writer.Double( stage.max );
+				writer.EndObject();
+			}
+			writer.EndObject();
+			writer.EndObject();
+		}
+		writer.EndArray();
+		writer.EndObject();
+
+		json.assign( buffer.GetString(), buffer.GetSize() );
+	}
+} // namespace Theater
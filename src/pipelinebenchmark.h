@@ -0,0 +1,47 @@
+#pragma once
+
+namespace Theater
+{
+	// Latency of each stage between a foreground change and the dimmers being in place, measured against synthetic
+	// desktops of the simulated platform so runs compare between machines and releases.
+	// The pipeline stage runs a HeadlessPipeline through hook dispatch, the coalescer, the theater session, z-order
+	// and the first fade tick, the other stages time their piece of it on its own. Session start is the decision
+	// that starts a session on a new target, session switch a focus change between two windows of a session from
+	// the hook on. Track is a frame of the target being dragged at 1 kHz, its location changes coalesced into one
+	// read of its rect. The trace stages are the cost of one TraceScope with tracing off and on.
+	struct BenchmarkOptions
+	{
+		std::vector<uint32_t> windowCounts = { 50, 500, 5000 };
+		uint32_t              iterations   = 1000;
+		uint32_t              seed         = 1;
+	};
+
+	// Microseconds, percentiles by nearest rank
+	struct BenchmarkStage
+	{
+		const char* name;
+		uint64_t    count;
+		double      min;
+		double      mean;
+		double      p50;
+		double      p90;
+		double      p99;
+		double      p999;
+		double      max;
+	};
+
+	struct BenchmarkRun
+	{
+		uint32_t                    windowCount;
+		uint32_t                    processCount;
+		std::vector<BenchmarkStage> stages;
+	};
+
+	void RunPipelineBenchmark( const BenchmarkOptions& options, std::vector<BenchmarkRun>& runs );
+
+	// Samples are nanoseconds, sorted in place
+	BenchmarkStage SummarizeBenchmarkStage( const char* name, std::vector<uint64_t>& samples );
+
+	// {"version":1,"runs":[{"windows":50,"processes":12,"stages":{"resolve":{"count":...,"p50":...},...}},...]}
+	void WriteBenchmarkJson( const std::vector<BenchmarkRun>& runs, std::string& json );
+} // namespace Theater
\ No newline at end of file
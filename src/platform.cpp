@@ -0,0 +1,11 @@
+#include "theater.h"
+#include "platform.h"
+
+namespace Theater
+{
+	bool IntersectPlatformRects( const PlatformRect& a, const PlatformRect& b )
+	{
+		return std::max( a.left, b.left ) < std::min( a.right, b.right ) &&
+		       std::max( a.top, b.top ) < std::min( a.bottom, b.bottom );
+	}
+} // namespace Theater
@@ -0,0 +1,80 @@
+#pragma once
+
+namespace Theater
+{
+	struct PlatformRect
+	{
+		int32_t left;
+		int32_t top;
+		int32_t right;
+		int32_t bottom;
+	};
+
+	bool IntersectPlatformRects( const PlatformRect& a, const PlatformRect& b );
+
+	struct PlatformMonitor
+	{
+		std::wstring device;
+		PlatformRect rect;
+	};
+
+	// Everything the theater logic needs from the desktop, so it runs the same against Win32 and a simulated desktop.
+	// Windows are identified by their handle value, queries on a window that is gone fail or return defaults.
+	// Queries are callable from any thread, z-order, layered window and hook calls only from the UI thread.
+	class Platform
+	{
+	public:
+		typedef uintptr_t WindowId;
+		typedef void ( *WINDOWEVENTCALLBACK )( const WindowEvent& event );
+
+		static constexpr WindowId NO_WINDOW = 0;
+
+		virtual ~Platform() = default;
+
+		// Windows
+		virtual void     EnumTopLevelWindows( std::vector<WindowId>& windows ) const               = 0;
+		virtual bool     IsWindow( WindowId window ) const                                         = 0;
+		virtual bool     IsTopLevelWindow( WindowId window ) const                                 = 0;
+		virtual bool     IsWindowVisible( WindowId window ) const                                  = 0;
+		virtual bool     IsWindowCloaked( WindowId window ) const                                  = 0;
+		virtual bool     IsWindowTopmost( WindowId window ) const                                  = 0;
+		virtual WindowId GetWindowOwner( WindowId window ) const                                   = 0;
+		virtual bool     GetWindowRect( WindowId window, PlatformRect& rect ) const                = 0;
+		virtual size_t   GetWindowClassName( WindowId window, wchar_t* buffer, size_t size ) const = 0;
+		virtual size_t   GetWindowTitle( WindowId window, wchar_t* buffer, size_t size ) const     = 0;
+		virtual uint32_t GetWindowProcessId( WindowId window ) const                               = 0;
+
+		// Z-order, top to bottom
+		virtual WindowId GetTopWindow() const                    = 0;
+		virtual WindowId GetWindowAbove( WindowId window ) const = 0;
+		virtual WindowId GetWindowBelow( WindowId window ) const = 0;
+
+		// Chains windows right below insertAfter in order, as one batch
+		virtual bool MoveWindowsBelow( WindowId insertAfter, const WindowId* windows, size_t count ) = 0;
+
+		// Sends each window to the bottom in turn, the last one ends up lowest
+		virtual bool MoveWindowsToBottom( const WindowId* windows, size_t count ) = 0;
+
+		// Layered windows
+		virtual void ShowWindow( WindowId window, bool state )        = 0;
+		virtual void SetWindowAlpha( WindowId window, uint8_t alpha ) = 0;
+
+		// Monitors
+		virtual void EnumMonitors( std::vector<PlatformMonitor>& monitors ) const = 0;
+
+		// Processes, the id tells apart process instances reusing a pid
+		virtual bool QueryProcessId( uint32_t pid, ProcessCache::ProcessId& id ) const              = 0;
+		virtual bool QueryProcessPath( uint32_t pid, std::wstring& path, std::wstring& name ) const = 0;
+
+		// Foreground, creation, destruction, visibility and cloaking of top level windows of other processes.
+		// The callback runs on the UI thread and should only queue the event.
+		virtual bool StartEventHooks( WINDOWEVENTCALLBACK callback ) = 0;
+		virtual void StopEventHooks()                                = 0;
+
+		// Moves and resizes of the windows of a single process, reported to the hook callback as LocationChanged.
+		// Those come at the mouse rate, so they are never followed globally. Starting again switches the process,
+		// stopping the event hooks stops this one too.
+		virtual bool StartLocationHook( uint32_t pid ) = 0;
+		virtual void StopLocationHook()                = 0;
+	};
+} // namespace Theater
\ No newline at end of file
@@ -0,0 +1,157 @@
+#include "theater.h"
+#include "processcache.h"
+
+namespace Theater
+{
+	const ProcessCache::Window* ProcessCache::LookupWindow( WindowId window, uint32_t pid ) const
+	{
+		const auto iter = this->windows.find( window );
+		if ( iter == this->windows.cend() )
+			return nullptr;
+
+		// window ids can be recycled too, make sure it still belongs to the same process
+		if ( iter->second.process.pid != pid )
+			return nullptr;
+
+		return &iter->second;
+	}
+
+	bool ProcessCache::IsDecisionValid( const Window& window ) const
+	{
+		return window.generation == this->generation;
+	}
+
+	void ProcessCache::InsertWindow( WindowId window, const ProcessId& process, bool isTarget )
+	{
+		auto iter = this->windows.find( window );
+		if ( iter != this->windows.end() )
+		{
+			if ( iter->second.process == process )
+			{
+				iter->second.generation = this->generation;
+				iter->second.isTarget   = isTarget;
+				return;
+			}
+
+			RemoveWindow( window );
+		}
+
+		auto processIter = this->processes.find( process );
+		if ( processIter == this->processes.end() )
+			return;
+
+		processIter->second.windows.emplace_back( window );
+
+		Window entry     = {};
+		entry.process    = process;
+		entry.generation = this->generation;
+		entry.isTarget   = isTarget;
+		this->windows.emplace( window, entry );
+	}
+
+	void ProcessCache::UpdateDecision( WindowId window, bool isTarget )
+	{
+		auto iter = this->windows.find( window );
+		if ( iter == this->windows.end() )
+			return;
+
+		iter->second.generation = this->generation;
+		iter->second.isTarget   = isTarget;
+	}
+
+	void ProcessCache::RemoveWindow( WindowId window )
+	{
+		auto iter = this->windows.find( window );
+		if ( iter == this->windows.end() )
+			return;
+
+		const ProcessId process = iter->second.process;
+		this->windows.erase( iter );
+		ReleaseProcess( process, window );
+	}
+
+	const ProcessCache::Process* ProcessCache::LookupProcess( const ProcessId& process ) const
+	{
+		const auto iter = this->processes.find( process );
+		if ( iter == this->processes.cend() )
+			return nullptr;
+
+		return &iter->second;
+	}
+
+	void ProcessCache::InsertProcess( const ProcessId& process, std::wstring path, std::wstring name )
+	{
+		// a pid belongs to one live process at a time, entries under another creation time are for one that exited
+		// without all its windows being seen going away
+		if ( this->processes.find( process ) == this->processes.end() )
+			RemoveProcess( process.pid );
+
+		auto& entry = this->processes[process];
+		entry.path  = std::move( path );
+		entry.name  = std::move( name );
+	}
+
+	void ProcessCache::RemoveProcess( uint32_t pid )
+	{
+		for ( auto iter = this->windows.begin(); iter != this->windows.end(); )
+		{
+			if ( iter->second.process.pid == pid )
+				iter = this->windows.erase( iter );
+			else
+				++iter;
+		}
+
+		for ( auto iter = this->processes.begin(); iter != this->processes.end(); )
+		{
+			if ( iter->first.pid == pid )
+				iter = this->processes.erase( iter );
+			else
+				++iter;
+		}
+	}
+
+	void ProcessCache::InvalidateDecisions()
+	{
+		this->generation++;
+	}
+
+	void ProcessCache::Clear()
+	{
+		this->windows.clear();
+		this->processes.clear();
+		this->generation++;
+	}
+
+	size_t ProcessCache::GetWindowCount() const
+	{
+		return this->windows.size();
+	}
+
+	size_t ProcessCache::GetProcessCount() const
+	{
+		return this->processes.size();
+	}
+
+	void ProcessCache::ReleaseProcess( const ProcessId& process, WindowId window )
+	{
+		auto iter = this->processes.find( process );
+		if ( iter == this->processes.end() )
+			return;
+
+		// a handful of windows per process, order doesn't matter
+		auto& processWindows = iter->second.windows;
+		if ( processWindows.size() > 1 )
+		{
+			const auto windowIter = std::find( processWindows.begin(), processWindows.end(), window );
+			if ( windowIter != processWindows.end() )
+			{
+				*windowIter = processWindows.back();
+				processWindows.pop_back();
+			}
+			return;
+		}
+
+		// last window of that process is gone, so is the process most of the time
+		this->processes.erase( iter );
+	}
+} // namespace Theater
\ No newline at end of file
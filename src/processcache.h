@@ -0,0 +1,89 @@
+#pragma once
+
+namespace Theater
+{
+	// Two level cache used to avoid querying the OS on every foreground change:
+	// - processes are keyed by (pid, creation time) so a recycled pid can never hit a stale entry
+	// - windows map to their owning process and the last target decision taken for them
+	// A process entry lives as long as at least one cached window references it, and lists those windows.
+	class ProcessCache
+	{
+	public:
+		typedef uintptr_t WindowId;
+
+		struct ProcessId
+		{
+			uint32_t pid;
+			uint64_t creationTime;
+
+			bool operator==( const ProcessId& other ) const
+			{
+				return this->pid == other.pid && this->creationTime == other.creationTime;
+			}
+		};
+
+		struct Window
+		{
+			ProcessId process;
+			uint32_t  generation;
+			bool      isTarget;
+		};
+
+		struct Process
+		{
+			std::wstring          path;
+			std::wstring          name;
+			std::vector<WindowId> windows;
+		};
+
+		ProcessCache()  = default;
+		~ProcessCache() = default;
+
+		// Returns the cached window if it is still owned by pid, nullptr otherwise
+		const Window* LookupWindow( WindowId window, uint32_t pid ) const;
+		bool          IsDecisionValid( const Window& window ) const;
+		void          InsertWindow( WindowId window, const ProcessId& process, bool isTarget );
+		void          UpdateDecision( WindowId window, bool isTarget );
+		void          RemoveWindow( WindowId window );
+
+		const Process* LookupProcess( const ProcessId& process ) const;
+		// Evicts whatever is cached for another process instance that used the same pid
+		void           InsertProcess( const ProcessId& process, std::wstring path, std::wstring name );
+		void           RemoveProcess( uint32_t pid );
+
+		// Calls fn( const ProcessId&, const Process& ) for every cached process
+		template<typename Fn>
+		void ForEachProcess( Fn fn ) const;
+
+		// Invalidates all window decisions, process identities are kept
+		void   InvalidateDecisions();
+		void   Clear();
+		size_t GetWindowCount() const;
+		size_t GetProcessCount() const;
+
+	private:
+		struct ProcessIdHash
+		{
+			size_t operator()( const ProcessId& process ) const
+			{
+				const uint64_t h =
+				    ( static_cast<uint64_t>( process.pid ) * 0x9E3779B97F4A7C15ull ) ^ process.creationTime;
+				return static_cast<size_t>( h ^ ( h >> 32 ) );
+			}
+		};
+
+		void ReleaseProcess( const ProcessId& process, WindowId window );
+
+	private:
+		uint32_t                                              generation = 0;
+		std::unordered_map<WindowId, Window>                  windows;
+		std::unordered_map<ProcessId, Process, ProcessIdHash> processes;
+	};
+
+	template<typename Fn>
+	void ProcessCache::ForEachProcess( Fn fn ) const
+	{
+		for ( const auto& process : this->processes )
+			fn( process.first, process.second );
+	}
+} // namespace Theater
\ No newline at end of file
@@ -0,0 +1,272 @@
+#include "theater.h"
+#include "processnamematcher.h"
+
+#if defined( _M_X64 ) || defined( _M_IX86 ) || defined( __SSE2__ )
+#include <emmintrin.h>
+#define THEATER_MATCHER_SSE2 1
+#endif
+
+namespace Theater
+{
+	namespace
+	{
+		constexpr uint32_t EMPTY_SLOT = 0xFFFFFFFFu;
+
+		// Code points folding by the same delta, either every one of them or every other one
+		struct FoldRun
+		{
+			uint32_t first;
+			uint16_t count;
+			uint16_t stride;
+			int32_t  delta;
+		};
+
+		// Simple case folding of Unicode 14.0, the C and S entries of CaseFolding.txt outside of ASCII. Entries past
+		// the BMP are never looked up where wchar_t is 16 bits.
+		constexpr FoldRun FOLD_RUNS[] = {
+			{ 0x00B5, 1, 1, 775 }, { 0x00C0, 23, 1, 32 }, { 0x00D8, 7, 1, 32 }, { 0x0100, 24, 2, 1 },
+			{ 0x0132, 3, 2, 1 }, { 0x0139, 8, 2, 1 }, { 0x014A, 23, 2, 1 }, { 0x0178, 1, 1, -121 },
+			{ 0x0179, 3, 2, 1 }, { 0x017F, 1, 1, -268 }, { 0x0181, 1, 1, 210 }, { 0x0182, 2, 2, 1 },
+			{ 0x0186, 1, 1, 206 }, { 0x0187, 1, 1, 1 }, { 0x0189, 2, 1, 205 }, { 0x018B, 1, 1, 1 },
+			{ 0x018E, 1, 1, 79 }, { 0x018F, 1, 1, 202 }, { 0x0190, 1, 1, 203 }, { 0x0191, 1, 1, 1 },
+			{ 0x0193, 1, 1, 205 }, { 0x0194, 1, 1, 207 }, { 0x0196, 1, 1, 211 }, { 0x0197, 1, 1, 209 },
+			{ 0x0198, 1, 1, 1 }, { 0x019C, 1, 1, 211 }, { 0x019D, 1, 1, 213 }, { 0x019F, 1, 1, 214 },
+			{ 0x01A0, 3, 2, 1 }, { 0x01A6, 1, 1, 218 }, { 0x01A7, 1, 1, 1 }, { 0x01A9, 1, 1, 218 },
+			{ 0x01AC, 1, 1, 1 }, { 0x01AE, 1, 1, 218 }, { 0x01AF, 1, 1, 1 }, { 0x01B1, 2, 1, 217 },
+			{ 0x01B3, 2, 2, 1 }, { 0x01B7, 1, 1, 219 }, { 0x01B8, 1, 1, 1 }, { 0x01BC, 1, 1, 1 }, { 0x01C4, 1, 1, 2 },
+			{ 0x01C5, 1, 1, 1 }, { 0x01C7, 1, 1, 2 }, { 0x01C8, 1, 1, 1 }, { 0x01CA, 1, 1, 2 }, { 0x01CB, 9, 2, 1 },
+			{ 0x01DE, 9, 2, 1 }, { 0x01F1, 1, 1, 2 }, { 0x01F2, 2, 2, 1 }, { 0x01F6, 1, 1, -97 },
+			{ 0x01F7, 1, 1, -56 }, { 0x01F8, 20, 2, 1 }, { 0x0220, 1, 1, -130 }, { 0x0222, 9, 2, 1 },
+			{ 0x023A, 1, 1, 10795 }, { 0x023B, 1, 1, 1 }, { 0x023D, 1, 1, -163 }, { 0x023E, 1, 1, 10792 },
+			{ 0x0241, 1, 1, 1 }, { 0x0243, 1, 1, -195 }, { 0x0244, 1, 1, 69 }, { 0x0245, 1, 1, 71 },
+			{ 0x0246, 5, 2, 1 }, { 0x0345, 1, 1, 116 }, { 0x0370, 2, 2, 1 }, { 0x0376, 1, 1, 1 },
+			{ 0x037F, 1, 1, 116 }, { 0x0386, 1, 1, 38 }, { 0x0388, 3, 1, 37 }, { 0x038C, 1, 1, 64 },
+			{ 0x038E, 2, 1, 63 }, { 0x0391, 17, 1, 32 }, { 0x03A3, 9, 1, 32 }, { 0x03C2, 1, 1, 1 },
+			{ 0x03CF, 1, 1, 8 }, { 0x03D0, 1, 1, -30 }, { 0x03D1, 1, 1, -25 }, { 0x03D5, 1, 1, -15 },
+			{ 0x03D6, 1, 1, -22 }, { 0x03D8, 12, 2, 1 }, { 0x03F0, 1, 1, -54 }, { 0x03F1, 1, 1, -48 },
+			{ 0x03F4, 1, 1, -60 }, { 0x03F5, 1, 1, -64 }, { 0x03F7, 1, 1, 1 }, { 0x03F9, 1, 1, -7 },
+			{ 0x03FA, 1, 1, 1 }, { 0x03FD, 3, 1, -130 }, { 0x0400, 16, 1, 80 }, { 0x0410, 32, 1, 32 },
+			{ 0x0460, 17, 2, 1 }, { 0x048A, 27, 2, 1 }, { 0x04C0, 1, 1, 15 }, { 0x04C1, 7, 2, 1 },
+			{ 0x04D0, 48, 2, 1 }, { 0x0531, 38, 1, 48 }, { 0x10A0, 38, 1, 7264 }, { 0x10C7, 1, 1, 7264 },
+			{ 0x10CD, 1, 1, 7264 }, { 0x13F8, 6, 1, -8 }, { 0x1C80, 1, 1, -6222 }, { 0x1C81, 1, 1, -6221 },
+			{ 0x1C82, 1, 1, -6212 }, { 0x1C83, 2, 1, -6210 }, { 0x1C85, 1, 1, -6211 }, { 0x1C86, 1, 1, -6204 },
+			{ 0x1C87, 1, 1, -6180 }, { 0x1C88, 1, 1, 35267 }, { 0x1C90, 43, 1, -3008 }, { 0x1CBD, 3, 1, -3008 },
+			{ 0x1E00, 75, 2, 1 }, { 0x1E9B, 1, 1, -58 }, { 0x1E9E, 1, 1, -7615 }, { 0x1EA0, 48, 2, 1 },
+			{ 0x1F08, 8, 1, -8 }, { 0x1F18, 6, 1, -8 }, { 0x1F28, 8, 1, -8 }, { 0x1F38, 8, 1, -8 },
+			{ 0x1F48, 6, 1, -8 }, { 0x1F59, 4, 2, -8 }, { 0x1F68, 8, 1, -8 }, { 0x1F88, 8, 1, -8 },
+			{ 0x1F98, 8, 1, -8 }, { 0x1FA8, 8, 1, -8 }, { 0x1FB8, 2, 1, -8 }, { 0x1FBA, 2, 1, -74 },
+			{ 0x1FBC, 1, 1, -9 }, { 0x1FBE, 1, 1, -7173 }, { 0x1FC8, 4, 1, -86 }, { 0x1FCC, 1, 1, -9 },
+			{ 0x1FD8, 2, 1, -8 }, { 0x1FDA, 2, 1, -100 }, { 0x1FE8, 2, 1, -8 }, { 0x1FEA, 2, 1, -112 },
+			{ 0x1FEC, 1, 1, -7 }, { 0x1FF8, 2, 1, -128 }, { 0x1FFA, 2, 1, -126 }, { 0x1FFC, 1, 1, -9 },
+			{ 0x2126, 1, 1, -7517 }, { 0x212A, 1, 1, -8383 }, { 0x212B, 1, 1, -8262 }, { 0x2132, 1, 1, 28 },
+			{ 0x2160, 16, 1, 16 }, { 0x2183, 1, 1, 1 }, { 0x24B6, 26, 1, 26 }, { 0x2C00, 48, 1, 48 },
+			{ 0x2C60, 1, 1, 1 }, { 0x2C62, 1, 1, -10743 }, { 0x2C63, 1, 1, -3814 }, { 0x2C64, 1, 1, -10727 },
+			{ 0x2C67, 3, 2, 1 }, { 0x2C6D, 1, 1, -10780 }, { 0x2C6E, 1, 1, -10749 }, { 0x2C6F, 1, 1, -10783 },
+			{ 0x2C70, 1, 1, -10782 }, { 0x2C72, 1, 1, 1 }, { 0x2C75, 1, 1, 1 }, { 0x2C7E, 2, 1, -10815 },
+			{ 0x2C80, 50, 2, 1 }, { 0x2CEB, 2, 2, 1 }, { 0x2CF2, 1, 1, 1 }, { 0xA640, 23, 2, 1 }, { 0xA680, 14, 2, 1 },
+			{ 0xA722, 7, 2, 1 }, { 0xA732, 31, 2, 1 }, { 0xA779, 2, 2, 1 }, { 0xA77D, 1, 1, -35332 },
+			{ 0xA77E, 5, 2, 1 }, { 0xA78B, 1, 1, 1 }, { 0xA78D, 1, 1, -42280 }, { 0xA790, 2, 2, 1 },
+			{ 0xA796, 10, 2, 1 }, { 0xA7AA, 1, 1, -42308 }, { 0xA7AB, 1, 1, -42319 }, { 0xA7AC, 1, 1, -42315 },
+			{ 0xA7AD, 1, 1, -42305 }, { 0xA7AE, 1, 1, -42308 }, { 0xA7B0, 1, 1, -42258 }, { 0xA7B1, 1, 1, -42282 },
+			{ 0xA7B2, 1, 1, -42261 }, { 0xA7B3, 1, 1, 928 }, { 0xA7B4, 8, 2, 1 }, { 0xA7C4, 1, 1, -48 },
+			{ 0xA7C5, 1, 1, -42307 }, { 0xA7C6, 1, 1, -35384 }, { 0xA7C7, 2, 2, 1 }, { 0xA7D0, 1, 1, 1 },
+			{ 0xA7D6, 2, 2, 1 }, { 0xA7F5, 1, 1, 1 }, { 0xAB70, 80, 1, -38864 }, { 0xFF21, 26, 1, 32 },
+			{ 0x10400, 40, 1, 40 }, { 0x104B0, 36, 1, 40 }, { 0x10570, 11, 1, 39 }, { 0x1057C, 15, 1, 39 },
+			{ 0x1058C, 7, 1, 39 }, { 0x10594, 2, 1, 39 }, { 0x10C80, 51, 1, 64 }, { 0x118A0, 32, 1, 32 },
+			{ 0x16E40, 32, 1, 32 }, { 0x1E900, 34, 1, 34 },
+		};
+
+#if THEATER_MATCHER_SSE2
+		// Folds a run of ASCII characters, stops at the first non ASCII block and returns the count processed
+		size_t FoldASCII( const wchar_t* src, wchar_t* dst, size_t length )
+		{
+			constexpr size_t lanes = 16 / sizeof( wchar_t );
+			size_t           i     = 0;
+			for ( ; i + lanes <= length; i += lanes )
+			{
+				const __m128i chars = _mm_loadu_si128( reinterpret_cast<const __m128i*>( src + i ) );
+				__m128i       nonASCII;
+				__m128i       upper;
+				if constexpr ( sizeof( wchar_t ) == 2 )
+				{
+					// signed compares, treat anything outside of [0, 0x7F] as non ASCII
+					nonASCII = _mm_or_si128( _mm_cmpgt_epi16( chars, _mm_set1_epi16( 0x7F ) ),
+					                         _mm_cmplt_epi16( chars, _mm_setzero_si128() ) );
+					upper    = _mm_and_si128( _mm_cmpgt_epi16( chars, _mm_set1_epi16( 'A' - 1 ) ),
+					                          _mm_cmplt_epi16( chars, _mm_set1_epi16( 'Z' + 1 ) ) );
+					upper    = _mm_and_si128( upper, _mm_set1_epi16( 0x20 ) );
+				}
+				else
+				{
+					nonASCII = _mm_or_si128( _mm_cmpgt_epi32( chars, _mm_set1_epi32( 0x7F ) ),
+					                         _mm_cmplt_epi32( chars, _mm_setzero_si128() ) );
+					upper    = _mm_and_si128( _mm_cmpgt_epi32( chars, _mm_set1_epi32( 'A' - 1 ) ),
+					                          _mm_cmplt_epi32( chars, _mm_set1_epi32( 'Z' + 1 ) ) );
+					upper    = _mm_and_si128( upper, _mm_set1_epi32( 0x20 ) );
+				}
+
+				if ( _mm_movemask_epi8( nonASCII ) != 0 )
+					break;
+
+				_mm_storeu_si128( reinterpret_cast<__m128i*>( dst + i ), _mm_or_si128( chars, upper ) );
+			}
+
+			return i;
+		}
+#else
+		size_t FoldASCII( const wchar_t*, wchar_t*, size_t )
+		{
+			return 0;
+		}
+#endif
+	} // namespace
+
+	wchar_t ProcessNameMatcher::FoldChar( wchar_t c )
+	{
+		const uint32_t cp = static_cast<uint32_t>( c );
+		if ( cp < 0x80 )
+			return ( cp >= 'A' && cp <= 'Z' ) ? static_cast<wchar_t>( cp + 0x20 ) : c;
+
+		// last run starting at or before cp
+		const auto iter = std::upper_bound( std::begin( FOLD_RUNS ), std::end( FOLD_RUNS ), cp,
+		                                    []( uint32_t value, const FoldRun& run ) { return value < run.first; } );
+		if ( iter == std::begin( FOLD_RUNS ) )
+			return c;
+
+		const FoldRun& run    = *( iter - 1 );
+		const uint32_t offset = cp - run.first;
+		if ( offset >= run.count * run.stride || offset % run.stride != 0 )
+			return c;
+
+		return static_cast<wchar_t>( static_cast<int32_t>( cp ) + run.delta );
+	}
+
+	void ProcessNameMatcher::Fold( const wchar_t* src, wchar_t* dst, size_t length )
+	{
+		size_t i = 0;
+		while ( i < length )
+		{
+			i += FoldASCII( src + i, dst + i, length - i );
+			if ( i >= length )
+				break;
+
+			// scalar path for the remaining tail or the block that contained non ASCII characters
+			const size_t blockEnd = std::min( length, i + 16 / sizeof( wchar_t ) );
+			for ( ; i < blockEnd; i++ )
+				dst[i] = FoldChar( src[i] );
+		}
+	}
+
+	uint32_t ProcessNameMatcher::Hash( const wchar_t* str, size_t length )
+	{
+		// FNV-1a
+		uint32_t hash = 2166136261u;
+		for ( size_t i = 0; i < length; i++ )
+		{
+			hash ^= static_cast<uint32_t>( str[i] );
+			hash *= 16777619u;
+		}
+
+		// keep EMPTY_SLOT free as a marker
+		return hash == EMPTY_SLOT ? 0u : hash;
+	}
+
+	void ProcessNameMatcher::Clear()
+	{
+		this->names.clear();
+		this->slots.clear();
+		this->count     = 0;
+		this->maxLength = 0;
+	}
+
+	void ProcessNameMatcher::Grow()
+	{
+		const size_t capacity = std::max<size_t>( 16, this->slots.size() * 2 );
+
+		std::vector<Slot> oldSlots = std::move( this->slots );
+		this->slots.assign( capacity, Slot{ EMPTY_SLOT, 0, 0 } );
+
+		const size_t mask = capacity - 1;
+		for ( const auto& slot : oldSlots )
+		{
+			if ( slot.hash == EMPTY_SLOT )
+				continue;
+
+			size_t index = slot.hash & mask;
+			while ( this->slots[index].hash != EMPTY_SLOT )
+				index = ( index + 1 ) & mask;
+			this->slots[index] = slot;
+		}
+	}
+
+	void ProcessNameMatcher::Insert( std::wstring_view name )
+	{
+		if ( name.empty() || name.size() > MAX_NAME_LENGTH )
+			return;
+
+		wchar_t folded[MAX_NAME_LENGTH];
+		Fold( name.data(), folded, name.size() );
+
+		const uint32_t hash = Hash( folded, name.size() );
+
+		// keep load factor under 50%
+		if ( ( this->count + 1 ) * 2 > this->slots.size() )
+			Grow();
+
+		const size_t mask  = this->slots.size() - 1;
+		size_t       index = hash & mask;
+		for ( ;; )
+		{
+			const auto& slot = this->slots[index];
+			if ( slot.hash == EMPTY_SLOT )
+				break;
+
+			// duplicate
+			if ( slot.hash == hash && slot.length == name.size() &&
+			     std::equal( folded, folded + name.size(), this->names.data() + slot.offset ) )
+				return;
+
+			index = ( index + 1 ) & mask;
+		}
+
+		Slot slot;
+		slot.hash   = hash;
+		slot.offset = static_cast<uint32_t>( this->names.size() );
+		slot.length = static_cast<uint32_t>( name.size() );
+		this->names.insert( this->names.end(), folded, folded + name.size() );
+		this->slots[index] = slot;
+
+		this->count++;
+		this->maxLength = std::max( this->maxLength, name.size() );
+	}
+
+	bool ProcessNameMatcher::Contains( std::wstring_view name ) const
+	{
+		if ( this->count == 0 || name.empty() || name.size() > this->maxLength )
+			return false;
+
+		wchar_t folded[MAX_NAME_LENGTH];
+		Fold( name.data(), folded, name.size() );
+
+		const uint32_t hash  = Hash( folded, name.size() );
+		const size_t   mask  = this->slots.size() - 1;
+		size_t         index = hash & mask;
+		for ( ;; )
+		{
+			const auto& slot = this->slots[index];
+			if ( slot.hash == EMPTY_SLOT )
+				return false;
+
+			if ( slot.hash == hash && slot.length == name.size() &&
+			     std::equal( folded, folded + name.size(), this->names.data() + slot.offset ) )
+				return true;
+
+			index = ( index + 1 ) & mask;
+		}
+	}
+
+	size_t ProcessNameMatcher::GetCount() const
+	{
+		return this->count;
+	}
+} // namespace Theater
\ No newline at end of file
@@ -0,0 +1,54 @@
+#pragma once
+
+namespace Theater
+{
+	// Case insensitive set of process names compiled once per settings change.
+	// Names are case folded and stored back to back in a single buffer indexed by an open addressing hash table,
+	// lookups fold the candidate on the stack and never allocate.
+	class ProcessNameMatcher
+	{
+	public:
+		static constexpr size_t MAX_NAME_LENGTH = 260;
+
+		ProcessNameMatcher()  = default;
+		~ProcessNameMatcher() = default;
+
+		template<typename Iter>
+		void Build( Iter first, Iter last );
+		void Clear();
+
+		bool   Contains( std::wstring_view name ) const;
+		size_t GetCount() const;
+
+		// Unicode simple case folding, ASCII is handled with SIMD when available
+		static wchar_t FoldChar( wchar_t c );
+		static void    Fold( const wchar_t* src, wchar_t* dst, size_t length );
+
+	private:
+		struct Slot
+		{
+			uint32_t hash;
+			uint32_t offset;
+			uint32_t length;
+		};
+
+		static uint32_t Hash( const wchar_t* str, size_t length );
+
+		void Insert( std::wstring_view name );
+		void Grow();
+
+	private:
+		std::vector<wchar_t> names;
+		std::vector<Slot>    slots;
+		size_t               count     = 0;
+		size_t               maxLength = 0;
+	};
+
+	template<typename Iter>
+	void ProcessNameMatcher::Build( Iter first, Iter last )
+	{
+		Clear();
+		for ( auto iter = first; iter != last; ++iter )
+			Insert( std::wstring_view( *iter ) );
+	}
+} // namespace Theater
\ No newline at end of file
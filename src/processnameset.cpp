@@ -0,0 +1,269 @@
+#include "theater.h"
+#include "processnameset.h"
+
+namespace Theater
+{
+	namespace
+	{
+		constexpr uint32_t EMPTY_ENTRY = 0xFFFFFFFFu;
+	} // namespace
+
+	std::wstring_view ProcessNameSet::Iterator::operator*() const
+	{
+		return this->set->Get( this->index );
+	}
+
+	ProcessNameSet::Iterator& ProcessNameSet::Iterator::operator++()
+	{
+		this->index++;
+		return *this;
+	}
+
+	bool ProcessNameSet::Iterator::operator==( const Iterator& other ) const
+	{
+		return this->set == other.set && this->index == other.index;
+	}
+
+	bool ProcessNameSet::Iterator::operator!=( const Iterator& other ) const
+	{
+		return !( *this == other );
+	}
+
+	uint32_t ProcessNameSet::Hash( const wchar_t* folded, size_t length )
+	{
+		// FNV-1a
+		uint32_t hash = 2166136261u;
+		for ( size_t i = 0; i < length; i++ )
+		{
+			hash ^= static_cast<uint32_t>( folded[i] );
+			hash *= 16777619u;
+		}
+
+		return hash;
+	}
+
+	bool ProcessNameSet::IsEqual( const Entry& entry, const wchar_t* folded, size_t length ) const
+	{
+		if ( entry.length != length )
+			return false;
+
+		// the arena keeps the names as written, they are folded while comparing
+		const wchar_t* name = this->chars.data() + entry.offset;
+		for ( size_t i = 0; i < length; i++ )
+		{
+			if ( ProcessNameMatcher::FoldChar( name[i] ) != folded[i] )
+				return false;
+		}
+
+		return true;
+	}
+
+	size_t ProcessNameSet::Find( const wchar_t* folded, size_t length, uint32_t hash ) const
+	{
+		if ( this->slots.empty() )
+			return EMPTY_ENTRY;
+
+		const size_t mask = this->slots.size() - 1;
+		for ( size_t index = hash & mask;; index = ( index + 1 ) & mask )
+		{
+			const auto& slot = this->slots[index];
+			if ( slot.entry == EMPTY_ENTRY )
+				return EMPTY_ENTRY;
+
+			if ( slot.hash == hash && IsEqual( this->entries[slot.entry], folded, length ) )
+				return index;
+		}
+	}
+
+	bool ProcessNameSet::Add( std::wstring_view name )
+	{
+		if ( name.empty() || name.size() > ProcessNameMatcher::MAX_NAME_LENGTH )
+			return false;
+
+		wchar_t folded[ProcessNameMatcher::MAX_NAME_LENGTH];
+		ProcessNameMatcher::Fold( name.data(), folded, name.size() );
+
+		const uint32_t hash = Hash( folded, name.size() );
+		if ( Find( folded, name.size(), hash ) != EMPTY_ENTRY )
+			return false;
+
+		// keep load factor under 50%
+		if ( ( this->entries.size() + 1 ) * 2 > this->slots.size() )
+			Grow();
+
+		const uint32_t entry = static_cast<uint32_t>( this->entries.size() );
+		this->entries.emplace_back( Entry{ static_cast<uint32_t>( this->chars.size() ),
+		                                   static_cast<uint32_t>( name.size() ), hash } );
+		this->chars.insert( this->chars.end(), name.begin(), name.end() );
+
+		const size_t mask  = this->slots.size() - 1;
+		size_t       index = hash & mask;
+		while ( this->slots[index].entry != EMPTY_ENTRY )
+			index = ( index + 1 ) & mask;
+		this->slots[index] = Slot{ hash, entry };
+
+		return true;
+	}
+
+	bool ProcessNameSet::Remove( std::wstring_view name )
+	{
+		if ( name.empty() || name.size() > ProcessNameMatcher::MAX_NAME_LENGTH )
+			return false;
+
+		wchar_t folded[ProcessNameMatcher::MAX_NAME_LENGTH];
+		ProcessNameMatcher::Fold( name.data(), folded, name.size() );
+
+		const size_t found = Find( folded, name.size(), Hash( folded, name.size() ) );
+		if ( found == EMPTY_ENTRY )
+			return false;
+
+		const uint32_t entry = this->slots[found].entry;
+		this->garbage += this->entries[entry].length;
+
+		// backward shift deletion, slots after the hole move up unless that would put them before their home
+		const size_t mask = this->slots.size() - 1;
+		size_t       hole = found;
+		for ( size_t next = ( hole + 1 ) & mask; this->slots[next].entry != EMPTY_ENTRY; next = ( next + 1 ) & mask )
+		{
+			const size_t home = this->slots[next].hash & mask;
+			if ( ( ( next - home ) & mask ) >= ( ( next - hole ) & mask ) )
+			{
+				this->slots[hole] = this->slots[next];
+				hole              = next;
+			}
+		}
+		this->slots[hole] = Slot{ 0, EMPTY_ENTRY };
+
+		// keep the entries dense, the last one takes the place of the removed one
+		const uint32_t last = static_cast<uint32_t>( this->entries.size() - 1 );
+		if ( entry != last )
+		{
+			const Entry& moved = this->entries[last];
+			size_t       index = moved.hash & mask;
+			while ( this->slots[index].entry != last )
+				index = ( index + 1 ) & mask;
+
+			this->slots[index].entry = entry;
+			this->entries[entry]     = moved;
+		}
+		this->entries.pop_back();
+
+		if ( this->garbage > this->chars.size() / 2 )
+			Compact();
+
+		return true;
+	}
+
+	bool ProcessNameSet::Contains( std::wstring_view name ) const
+	{
+		if ( name.empty() || name.size() > ProcessNameMatcher::MAX_NAME_LENGTH )
+			return false;
+
+		wchar_t folded[ProcessNameMatcher::MAX_NAME_LENGTH];
+		ProcessNameMatcher::Fold( name.data(), folded, name.size() );
+		return Find( folded, name.size(), Hash( folded, name.size() ) ) != EMPTY_ENTRY;
+	}
+
+	void ProcessNameSet::Clear()
+	{
+		this->chars.clear();
+		this->entries.clear();
+		this->slots.clear();
+		this->garbage = 0;
+	}
+
+	void ProcessNameSet::Reserve( size_t count, size_t averageLength )
+	{
+		this->chars.reserve( count * averageLength );
+		this->entries.reserve( count );
+		while ( count * 2 > this->slots.size() )
+			Grow();
+	}
+
+	size_t ProcessNameSet::GetCount() const
+	{
+		return this->entries.size();
+	}
+
+	bool ProcessNameSet::IsEmpty() const
+	{
+		return this->entries.empty();
+	}
+
+	std::wstring_view ProcessNameSet::Get( size_t index ) const
+	{
+		const Entry& entry = this->entries[index];
+		return std::wstring_view( this->chars.data() + entry.offset, entry.length );
+	}
+
+	ProcessNameSet::Iterator ProcessNameSet::begin() const
+	{
+		return Iterator( this, 0 );
+	}
+
+	ProcessNameSet::Iterator ProcessNameSet::end() const
+	{
+		return Iterator( this, this->entries.size() );
+	}
+
+	size_t ProcessNameSet::GetMemoryUsage() const
+	{
+		return this->chars.capacity() * sizeof( wchar_t ) + this->entries.capacity() * sizeof( Entry ) +
+		       this->slots.capacity() * sizeof( Slot );
+	}
+
+	bool ProcessNameSet::operator==( const ProcessNameSet& other ) const
+	{
+		if ( this->entries.size() != other.entries.size() )
+			return false;
+
+		for ( size_t i = 0; i < this->entries.size(); i++ )
+		{
+			if ( Get( i ) != other.Get( i ) )
+				return false;
+		}
+
+		return true;
+	}
+
+	bool ProcessNameSet::operator!=( const ProcessNameSet& other ) const
+	{
+		return !( *this == other );
+	}
+
+	void ProcessNameSet::Grow()
+	{
+		const size_t capacity = std::max<size_t>( 16, this->slots.size() * 2 );
+
+		std::vector<Slot> oldSlots = std::move( this->slots );
+		this->slots.assign( capacity, Slot{ 0, EMPTY_ENTRY } );
+
+		const size_t mask = capacity - 1;
+		for ( const auto& slot : oldSlots )
+		{
+			if ( slot.entry == EMPTY_ENTRY )
+				continue;
+
+			size_t index = slot.hash & mask;
+			while ( this->slots[index].entry != EMPTY_ENTRY )
+				index = ( index + 1 ) & mask;
+			this->slots[index] = slot;
+		}
+	}
+
+	void ProcessNameSet::Compact()
+	{
+		// only the arena moves, the index refers to entries and stays as is
+		std::vector<wchar_t> compacted;
+		compacted.reserve( this->chars.size() - this->garbage );
+		for ( auto& entry : this->entries )
+		{
+			const wchar_t* name = this->chars.data() + entry.offset;
+			entry.offset        = static_cast<uint32_t>( compacted.size() );
+			compacted.insert( compacted.end(), name, name + entry.length );
+		}
+
+		this->chars   = std::move( compacted );
+		this->garbage = 0;
+	}
+} // namespace Theater
@@ -0,0 +1,86 @@
+#pragma once
+
+namespace Theater
+{
+	// Case insensitive, duplicate free list of process names as edited in the settings.
+	// The names are interned back to back in one arena and found through an open addressing index keyed by their
+	// folded hash, add, remove and contains are O(1) and there is no limit on the count.
+	// Views handed out stay valid until the set is modified. Removing a name moves the last one into its place.
+	class ProcessNameSet
+	{
+	public:
+		class Iterator
+		{
+		public:
+			typedef std::forward_iterator_tag iterator_category;
+			typedef std::wstring_view         value_type;
+			typedef ptrdiff_t                 difference_type;
+			typedef const std::wstring_view*  pointer;
+			typedef std::wstring_view         reference;
+
+			Iterator( const ProcessNameSet* set, size_t index ) : set( set ), index( index )
+			{
+			}
+
+			std::wstring_view operator*() const;
+			Iterator&         operator++();
+			bool              operator==( const Iterator& other ) const;
+			bool              operator!=( const Iterator& other ) const;
+
+		private:
+			const ProcessNameSet* set;
+			size_t                index;
+		};
+
+		ProcessNameSet()  = default;
+		~ProcessNameSet() = default;
+
+		// Returns false for names already in the set in any case, empty names and names longer than
+		// ProcessNameMatcher::MAX_NAME_LENGTH
+		bool Add( std::wstring_view name );
+		bool Remove( std::wstring_view name );
+		bool Contains( std::wstring_view name ) const;
+		void Clear();
+		void Reserve( size_t count, size_t averageLength );
+
+		size_t            GetCount() const;
+		bool              IsEmpty() const;
+		std::wstring_view Get( size_t index ) const;
+		Iterator          begin() const;
+		Iterator          end() const;
+
+		// Bytes held by the arena and the index, including spare capacity
+		size_t GetMemoryUsage() const;
+
+		// Same names with the same case in the same order
+		bool operator==( const ProcessNameSet& other ) const;
+		bool operator!=( const ProcessNameSet& other ) const;
+
+	private:
+		struct Entry
+		{
+			uint32_t offset;
+			uint32_t length;
+			uint32_t hash;
+		};
+
+		struct Slot
+		{
+			uint32_t hash;
+			uint32_t entry;
+		};
+
+		static uint32_t Hash( const wchar_t* folded, size_t length );
+
+		size_t Find( const wchar_t* folded, size_t length, uint32_t hash ) const;
+		bool   IsEqual( const Entry& entry, const wchar_t* folded, size_t length ) const;
+		void   Grow();
+		void   Compact();
+
+	private:
+		std::vector<wchar_t> chars;
+		std::vector<Entry>   entries;
+		std::vector<Slot>    slots;
+		size_t               garbage = 0; // arena characters left behind by removed names
+	};
+} // namespace Theater
\ No newline at end of file
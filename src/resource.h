@@ -34,13 +34,16 @@
 #define ID_CONTEXT_THEATERV0            40030
 #define ID_CONTEXT_THEATER              40031
 #define ID_TRAY_CONTEXT_THEATER         40032
+#define ID_TRAY_CONTEXT_TRACE           40033
+#define ID_TRAY_CONTEXT_TRACE_SAVE      40034
+#define ID_TRAY_CONTEXT_RECORD          40035
 
 // Next default values for new objects
 // 
 #ifdef APSTUDIO_INVOKED
 #ifndef APSTUDIO_READONLY_SYMBOLS
 #define _APS_NEXT_RESOURCE_VALUE        103
-#define _APS_NEXT_COMMAND_VALUE         40033
+#define _APS_NEXT_COMMAND_VALUE         40036
 #define _APS_NEXT_CONTROL_VALUE         1001
 #define _APS_NEXT_SYMED_VALUE           101
 #endif
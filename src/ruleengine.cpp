@@ -0,0 +1,455 @@
+#include "theater.h"
+#include "ruleengine.h"
+
+namespace Theater
+{
+	namespace
+	{
+		constexpr const wchar_t* RULE_FIELD_NAMES[]    = { L"name", L"path", L"class", L"title" };
+		constexpr const wchar_t* RULE_OPERATOR_NAMES[] = { L"equals", L"contains", L"glob" };
+
+		bool IsSeparator( wchar_t c )
+		{
+			return c == L'\\' || c == L'/';
+		}
+	} // namespace
+
+	bool ParseRuleField( std::wstring_view name, RuleField& field )
+	{
+		for ( size_t i = 0; i < std::size( RULE_FIELD_NAMES ); i++ )
+		{
+			if ( name == RULE_FIELD_NAMES[i] )
+			{
+				field = static_cast<RuleField>( i );
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	const wchar_t* GetRuleFieldName( RuleField field )
+	{
+		return RULE_FIELD_NAMES[static_cast<size_t>( field )];
+	}
+
+	bool ParseRuleOperator( std::wstring_view name, RuleOperator& op )
+	{
+		for ( size_t i = 0; i < std::size( RULE_OPERATOR_NAMES ); i++ )
+		{
+			if ( name == RULE_OPERATOR_NAMES[i] )
+			{
+				op = static_cast<RuleOperator>( i );
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	const wchar_t* GetRuleOperatorName( RuleOperator op )
+	{
+		return RULE_OPERATOR_NAMES[static_cast<size_t>( op )];
+	}
+
+	void GlobAutomaton::Clear()
+	{
+		this->classCount = 2;
+		this->tokens.clear();
+		this->startStates.clear();
+		this->classes.clear();
+		std::fill( std::begin( this->asciiClasses ), std::end( this->asciiClasses ), OTHER_CLASS );
+		ResetStates();
+	}
+
+	void GlobAutomaton::SetSeparatorAware( bool state )
+	{
+		this->separatorAware = state;
+	}
+
+	bool GlobAutomaton::IsEmpty() const
+	{
+		return this->startStates.empty();
+	}
+
+	uint16_t GlobAutomaton::GetCharClass( wchar_t c ) const
+	{
+		if ( this->separatorAware && IsSeparator( c ) )
+			return SEPARATOR_CLASS;
+
+		c = ProcessNameMatcher::FoldChar( c );
+		if ( static_cast<uint32_t>( c ) < 128 )
+			return this->asciiClasses[static_cast<uint32_t>( c )];
+
+		const auto iter = this->classes.find( c );
+		return iter != this->classes.cend() ? iter->second : OTHER_CLASS;
+	}
+
+	uint16_t GlobAutomaton::AddCharClass( wchar_t c )
+	{
+		const uint16_t charClass = GetCharClass( c );
+		if ( charClass != OTHER_CLASS )
+			return charClass;
+
+		c = ProcessNameMatcher::FoldChar( c );
+		if ( static_cast<uint32_t>( c ) < 128 )
+			this->asciiClasses[static_cast<uint32_t>( c )] = this->classCount;
+		else
+			this->classes.emplace( c, this->classCount );
+
+		return this->classCount++;
+	}
+
+	void GlobAutomaton::AddToken( TokenKind kind, wchar_t c, bool skipSeparator )
+	{
+		Token token         = {};
+		token.kind          = kind;
+		token.skipSeparator = skipSeparator;
+		token.charClass     = kind == TokenKind::Literal ? AddCharClass( c ) : OTHER_CLASS;
+		this->tokens.emplace_back( token );
+	}
+
+	void GlobAutomaton::Add( RuleOperator op, std::wstring_view pattern )
+	{
+		if ( pattern.empty() )
+			return;
+
+		// can't grow the alphabet without dropping the lazily built states
+		ResetStates();
+
+		const uint32_t start = static_cast<uint32_t>( this->tokens.size() );
+
+		switch ( op )
+		{
+		case RuleOperator::Equals: {
+			for ( const wchar_t c : pattern )
+				AddToken( TokenKind::Literal, c );
+			break;
+		}
+		case RuleOperator::Contains: {
+			// handled by SubstringAutomaton, still supported as an unanchored glob
+			AddToken( TokenKind::AnyPath );
+			for ( const wchar_t c : pattern )
+				AddToken( TokenKind::Literal, c );
+			AddToken( TokenKind::AnyPath );
+			break;
+		}
+		case RuleOperator::Glob: {
+			for ( size_t i = 0; i < pattern.size(); i++ )
+			{
+				const wchar_t c = pattern[i];
+				if ( c == L'?' )
+				{
+					AddToken( TokenKind::AnyChar );
+				}
+				else if ( c == L'*' && i + 1 < pattern.size() && pattern[i + 1] == L'*' )
+				{
+					// "**\" also matches no directory at all
+					i++;
+					const bool skipSeparator =
+					    this->separatorAware && i + 1 < pattern.size() && IsSeparator( pattern[i + 1] );
+					AddToken( TokenKind::AnyPath, 0, skipSeparator );
+				}
+				else if ( c == L'*' )
+				{
+					AddToken( this->separatorAware ? TokenKind::AnyRun : TokenKind::AnyPath );
+				}
+				else
+				{
+					AddToken( TokenKind::Literal, c );
+				}
+			}
+			break;
+		}
+		}
+
+		AddToken( TokenKind::Accept );
+		AddClosure( start, this->startStates );
+		std::sort( this->startStates.begin(), this->startStates.end() );
+		this->startStates.erase( std::unique( this->startStates.begin(), this->startStates.end() ),
+		                         this->startStates.end() );
+	}
+
+	void GlobAutomaton::AddClosure( uint32_t nfaState, std::vector<uint32_t>& states ) const
+	{
+		// tokens of a pattern form a chain, wildcard runs may be skipped over
+		for ( ;; )
+		{
+			states.emplace_back( nfaState );
+
+			const Token& token = this->tokens[nfaState];
+			if ( token.kind != TokenKind::AnyRun && token.kind != TokenKind::AnyPath )
+				return;
+
+			if ( token.skipSeparator )
+				states.emplace_back( nfaState + 1 );
+
+			nfaState += token.skipSeparator ? 2 : 1;
+		}
+	}
+
+	void GlobAutomaton::ResetStates() const
+	{
+		this->stateSets.clear();
+		this->stateIds.clear();
+		this->transitions.clear();
+		this->accepting.clear();
+	}
+
+	int32_t GlobAutomaton::AddState( std::vector<uint32_t>&& states ) const
+	{
+		std::sort( states.begin(), states.end() );
+		states.erase( std::unique( states.begin(), states.end() ), states.end() );
+
+		const auto iter = this->stateIds.find( states );
+		if ( iter != this->stateIds.cend() )
+			return iter->second;
+
+		bool isAccepting = false;
+		for ( const auto nfaState : states )
+			isAccepting |= this->tokens[nfaState].kind == TokenKind::Accept;
+
+		const int32_t id = static_cast<int32_t>( this->stateSets.size() );
+		this->stateIds.emplace( states, id );
+		this->stateSets.emplace_back( std::move( states ) );
+		this->transitions.resize( this->transitions.size() + this->classCount, UNKNOWN_STATE );
+		this->accepting.emplace_back( isAccepting ? 1 : 0 );
+		return id;
+	}
+
+	int32_t GlobAutomaton::Step( int32_t state, uint16_t charClass ) const
+	{
+		const int32_t cached = this->transitions[state * this->classCount + charClass];
+		if ( cached != UNKNOWN_STATE )
+			return cached;
+
+		std::vector<uint32_t> next;
+		for ( const auto nfaState : this->stateSets[state] )
+		{
+			const Token& token = this->tokens[nfaState];
+			switch ( token.kind )
+			{
+			case TokenKind::Literal:
+				if ( token.charClass == charClass )
+					AddClosure( nfaState + 1, next );
+				break;
+			case TokenKind::AnyChar:
+				if ( charClass != SEPARATOR_CLASS )
+					AddClosure( nfaState + 1, next );
+				break;
+			case TokenKind::AnyRun:
+				if ( charClass != SEPARATOR_CLASS )
+				{
+					next.emplace_back( nfaState );
+					AddClosure( nfaState + 1, next );
+				}
+				break;
+			case TokenKind::AnyPath:
+				// once the run isn't empty any more "**\" has to be followed by a separator
+				next.emplace_back( nfaState );
+				AddClosure( nfaState + 1, next );
+				break;
+			case TokenKind::Accept:
+				break;
+			}
+		}
+
+		// bound memory use, restart from a fresh cache holding only the dead, start and current states
+		if ( this->stateSets.size() >= MAX_DFA_STATES )
+		{
+			std::vector<uint32_t> current = this->stateSets[state];
+			ResetStates();
+			AddState( std::vector<uint32_t>() );
+			AddState( std::vector<uint32_t>( this->startStates ) );
+			state = AddState( std::move( current ) );
+		}
+
+		const int32_t nextState = AddState( std::move( next ) );
+		this->transitions[state * this->classCount + charClass] = nextState;
+		return nextState;
+	}
+
+	bool GlobAutomaton::Match( std::wstring_view input ) const
+	{
+		if ( IsEmpty() )
+			return false;
+
+		if ( this->stateSets.empty() )
+		{
+			AddState( std::vector<uint32_t>() );
+			AddState( std::vector<uint32_t>( this->startStates ) );
+		}
+
+		int32_t state = START_STATE;
+		for ( const wchar_t c : input )
+		{
+			state = Step( state, GetCharClass( c ) );
+			if ( state == DEAD_STATE )
+				return false;
+		}
+
+		return this->accepting[state] != 0;
+	}
+
+	void SubstringAutomaton::Clear()
+	{
+		this->nodes.clear();
+	}
+
+	bool SubstringAutomaton::IsEmpty() const
+	{
+		return this->nodes.empty();
+	}
+
+	int32_t SubstringAutomaton::FindEdge( int32_t node, wchar_t c ) const
+	{
+		const auto& edges = this->nodes[node].edges;
+		const auto  iter  = std::lower_bound( edges.cbegin(), edges.cend(), Edge{ c, 0 } );
+		if ( iter == edges.cend() || iter->c != c )
+			return -1;
+
+		return iter->node;
+	}
+
+	void SubstringAutomaton::Add( std::wstring_view pattern )
+	{
+		if ( pattern.empty() )
+			return;
+
+		if ( this->nodes.empty() )
+			this->nodes.emplace_back( Node{ {}, 0, false } );
+
+		int32_t node = 0;
+		for ( const wchar_t c : pattern )
+		{
+			const wchar_t folded = ProcessNameMatcher::FoldChar( c );
+			int32_t       next   = FindEdge( node, folded );
+			if ( next < 0 )
+			{
+				next = static_cast<int32_t>( this->nodes.size() );
+				this->nodes.emplace_back( Node{ {}, 0, false } );
+
+				auto& edges = this->nodes[node].edges;
+				edges.insert( std::upper_bound( edges.begin(), edges.end(), Edge{ folded, 0 } ), Edge{ folded, next } );
+			}
+
+			node = next;
+		}
+
+		this->nodes[node].output = true;
+	}
+
+	void SubstringAutomaton::Build()
+	{
+		if ( this->nodes.empty() )
+			return;
+
+		// breadth first so that failure links always point to already processed nodes
+		std::vector<int32_t> queue;
+		queue.reserve( this->nodes.size() );
+		for ( const auto& edge : this->nodes[0].edges )
+		{
+			this->nodes[edge.node].fail = 0;
+			queue.emplace_back( edge.node );
+		}
+
+		for ( size_t i = 0; i < queue.size(); i++ )
+		{
+			const int32_t node = queue[i];
+			for ( const auto& edge : this->nodes[node].edges )
+			{
+				int32_t fail = this->nodes[node].fail;
+				int32_t next = FindEdge( fail, edge.c );
+				while ( next < 0 && fail != 0 )
+				{
+					fail = this->nodes[fail].fail;
+					next = FindEdge( fail, edge.c );
+				}
+
+				auto& child  = this->nodes[edge.node];
+				child.fail   = next >= 0 ? next : 0;
+				child.output = child.output || this->nodes[child.fail].output;
+				queue.emplace_back( edge.node );
+			}
+		}
+	}
+
+	bool SubstringAutomaton::Match( std::wstring_view input ) const
+	{
+		if ( IsEmpty() )
+			return false;
+
+		int32_t node = 0;
+		for ( const wchar_t c : input )
+		{
+			const wchar_t folded = ProcessNameMatcher::FoldChar( c );
+			int32_t       next   = FindEdge( node, folded );
+			while ( next < 0 && node != 0 )
+			{
+				node = this->nodes[node].fail;
+				next = FindEdge( node, folded );
+			}
+
+			node = next >= 0 ? next : 0;
+			if ( this->nodes[node].output )
+				return true;
+		}
+
+		return false;
+	}
+
+	void RuleEngine::Clear()
+	{
+		for ( auto& automaton : this->globs )
+			automaton.Clear();
+		for ( auto& automaton : this->substrings )
+			automaton.Clear();
+	}
+
+	void RuleEngine::Compile( const std::vector<Rule>& rules )
+	{
+		Clear();
+		this->globs[static_cast<size_t>( RuleField::Path )].SetSeparatorAware( true );
+
+		for ( const auto& rule : rules )
+		{
+			const size_t field = static_cast<size_t>( rule.field );
+			if ( rule.op == RuleOperator::Contains )
+				this->substrings[field].Add( rule.pattern );
+			else
+				this->globs[field].Add( rule.op, rule.pattern );
+		}
+
+		for ( auto& automaton : this->substrings )
+			automaton.Build();
+	}
+
+	bool RuleEngine::IsEmpty() const
+	{
+		for ( size_t i = 0; i < static_cast<size_t>( RuleField::Count ); i++ )
+		{
+			if ( UsesField( static_cast<RuleField>( i ) ) )
+				return false;
+		}
+
+		return true;
+	}
+
+	bool RuleEngine::UsesField( RuleField field ) const
+	{
+		const size_t index = static_cast<size_t>( field );
+		return !this->globs[index].IsEmpty() || !this->substrings[index].IsEmpty();
+	}
+
+	bool RuleEngine::Match( const Input& input ) const
+	{
+		const std::wstring_view values[] = { input.name, input.path, input.windowClass, input.title };
+		for ( size_t i = 0; i < std::size( values ); i++ )
+		{
+			if ( this->globs[i].Match( values[i] ) || this->substrings[i].Match( values[i] ) )
+				return true;
+		}
+
+		return false;
+	}
+} // namespace Theater
\ No newline at end of file
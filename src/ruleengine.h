@@ -0,0 +1,163 @@
+#pragma once
+
+namespace Theater
+{
+	enum class RuleField
+	{
+		Name,
+		Path,
+		Class,
+		Title,
+		Count
+	};
+
+	enum class RuleOperator
+	{
+		Equals,
+		Contains,
+		Glob
+	};
+
+	struct Rule
+	{
+		RuleField    field;
+		RuleOperator op;
+		std::wstring pattern;
+	};
+
+	bool           ParseRuleField( std::wstring_view name, RuleField& field );
+	const wchar_t* GetRuleFieldName( RuleField field );
+	bool           ParseRuleOperator( std::wstring_view name, RuleOperator& op );
+	const wchar_t* GetRuleOperatorName( RuleOperator op );
+
+	// All equals and glob patterns of a field compiled into a single automaton.
+	// Patterns are turned into a glob NFA which is lazily determinized while matching, so once warm
+	// a match costs one table lookup per input character no matter how many patterns were added.
+	// Glob syntax: '?' any character, '*' any run of characters, '**' any run including separators.
+	// Matching is case insensitive, '\' and '/' are separators when the automaton is separator aware.
+	class GlobAutomaton
+	{
+	public:
+		GlobAutomaton()  = default;
+		~GlobAutomaton() = default;
+
+		void Clear();
+		void Add( RuleOperator op, std::wstring_view pattern );
+		void SetSeparatorAware( bool state );
+
+		bool IsEmpty() const;
+		bool Match( std::wstring_view input ) const;
+
+	private:
+		enum class TokenKind : uint8_t
+		{
+			Literal,
+			AnyChar,
+			AnyRun,
+			AnyPath,
+			Accept
+		};
+
+		struct Token
+		{
+			TokenKind kind;
+			bool      skipSeparator;
+			uint16_t  charClass;
+		};
+
+		static constexpr int32_t  DEAD_STATE      = 0;
+		static constexpr int32_t  START_STATE     = 1;
+		static constexpr int32_t  UNKNOWN_STATE   = -1;
+		static constexpr uint16_t OTHER_CLASS     = 0;
+		static constexpr uint16_t SEPARATOR_CLASS = 1;
+		static constexpr size_t   MAX_DFA_STATES  = 4096;
+
+		uint16_t GetCharClass( wchar_t c ) const;
+		uint16_t AddCharClass( wchar_t c );
+		void     AddToken( TokenKind kind, wchar_t c = 0, bool skipSeparator = false );
+		void     AddClosure( uint32_t nfaState, std::vector<uint32_t>& states ) const;
+		int32_t  AddState( std::vector<uint32_t>&& states ) const;
+		int32_t  Step( int32_t state, uint16_t charClass ) const;
+		void     ResetStates() const;
+
+	private:
+		bool                                  separatorAware    = false;
+		uint16_t                              classCount        = 2;
+		uint16_t                              asciiClasses[128] = {};
+		std::unordered_map<wchar_t, uint16_t> classes;
+		std::vector<Token>                    tokens;
+		std::vector<uint32_t>                 startStates;
+
+		// lazily built DFA, state 0 is the dead state and state 1 the start state
+		mutable std::vector<std::vector<uint32_t>>       stateSets;
+		mutable std::map<std::vector<uint32_t>, int32_t> stateIds;
+		mutable std::vector<int32_t>                     transitions;
+		mutable std::vector<uint8_t>                     accepting;
+	};
+
+	// All contains patterns of a field compiled into a single Aho-Corasick automaton, case insensitive.
+	// Unanchored patterns would keep every glob NFA thread alive at once, this keeps them linear in the input.
+	class SubstringAutomaton
+	{
+	public:
+		SubstringAutomaton()  = default;
+		~SubstringAutomaton() = default;
+
+		void Clear();
+		void Add( std::wstring_view pattern );
+		void Build();
+
+		bool IsEmpty() const;
+		bool Match( std::wstring_view input ) const;
+
+	private:
+		struct Edge
+		{
+			wchar_t c;
+			int32_t node;
+
+			bool operator<( const Edge& other ) const
+			{
+				return this->c < other.c;
+			}
+		};
+
+		struct Node
+		{
+			std::vector<Edge> edges;
+			int32_t           fail;
+			bool              output;
+		};
+
+		int32_t FindEdge( int32_t node, wchar_t c ) const;
+
+	private:
+		std::vector<Node> nodes;
+	};
+
+	class RuleEngine
+	{
+	public:
+		struct Input
+		{
+			std::wstring_view name;
+			std::wstring_view path;
+			std::wstring_view windowClass;
+			std::wstring_view title;
+		};
+
+		RuleEngine()  = default;
+		~RuleEngine() = default;
+
+		void Compile( const std::vector<Rule>& rules );
+		void Clear();
+
+		bool IsEmpty() const;
+		bool UsesField( RuleField field ) const;
+		bool Match( const Input& input ) const;
+
+	private:
+		GlobAutomaton      globs[static_cast<size_t>( RuleField::Count )];
+		SubstringAutomaton substrings[static_cast<size_t>( RuleField::Count )];
+	};
+} // namespace Theater
\ No newline at end of file
@@ -2,262 +2,483 @@
 #include "settings.h"
 #include <rapidjson/rapidjson.h>
 #include <rapidjson/document.h>
-#include <rapidjson/filewritestream.h>
-#include <rapidjson/filereadstream.h>
 #include <rapidjson/prettywriter.h>
-#include <rapidjson/reader.h>
+#include <rapidjson/stringbuffer.h>
 
 namespace Theater
 {
 	namespace
 	{
-		static constexpr int SETTINGS_VERSION = 1;
-
 		typedef rapidjson::GenericDocument<rapidjson::UTF16<>> JSONDocument;
 		typedef rapidjson::GenericValue<rapidjson::UTF16<>>    JSONValue;
 
-		wchar_t s_settingsFilename[MAX_PATH]  = L"";
-		wchar_t s_settingsDirectory[MAX_PATH] = L"";
-		char    s_jsonReadWriteBuffer[1024 * 8];
+		// resolved on the UI thread before the persister starts, the worker only reads it
+		SettingsFile s_settingsFile;
 
-		const wchar_t* GetSettingsDirectory()
+		const SettingsFile& GetSettingsFile()
 		{
-			if ( s_settingsDirectory[0] == 0 )
+			if ( s_settingsFile.GetDirectory()[0] == 0 )
 			{
 				PWSTR pLocalAppDataPath = nullptr;
 				if ( ::SHGetKnownFolderPath( FOLDERID_LocalAppData, KF_FLAG_DEFAULT, nullptr, &pLocalAppDataPath ) !=
 				     S_OK )
 				{
 					::CoTaskMemFree( pLocalAppDataPath );
-					return s_settingsDirectory;
+					return s_settingsFile;
 				}
 
-				_snwprintf_s( s_settingsDirectory, MAX_PATH, L"%s\\Theater", pLocalAppDataPath );
+				s_settingsFile.SetDirectory( std::wstring( pLocalAppDataPath ) + L"\\Theater" );
 				::CoTaskMemFree( pLocalAppDataPath );
 			}
 
-			return s_settingsDirectory;
+			return s_settingsFile;
 		}
 
-		const wchar_t* GetSettingsFilename()
+		// Runs on the persister's worker thread, only touches data and the paths resolved before it started
+		bool WriteSettingsFile( const SettingsData& data, uint64_t& contentHash )
 		{
-			if ( s_settingsFilename[0] == 0 )
+			JSONDocument doc;
+			doc.SetObject();
+
+			auto& docAllocator = doc.GetAllocator();
+
+			doc.AddMember( L"version", JSONValue( SettingsData::VERSION ), docAllocator );
+			doc.AddMember( L"enabled", JSONValue( data.enabled ), docAllocator );
+			doc.AddMember( L"alpha", JSONValue( static_cast<int>( data.alpha ) ), docAllocator );
+
+			JSONValue colorVal( rapidjson::kArrayType );
+			colorVal.Reserve( 3, docAllocator );
+			colorVal.PushBack( JSONValue( GetRValue( data.color ) ), docAllocator );
+			colorVal.PushBack( JSONValue( GetGValue( data.color ) ), docAllocator );
+			colorVal.PushBack( JSONValue( GetBValue( data.color ) ), docAllocator );
+			doc.AddMember( L"color", colorVal, docAllocator );
+			doc.AddMember( L"fadeDuration", JSONValue( data.fadeDuration ), docAllocator );
+			doc.AddMember( L"fadeEasing", JSONValue( rapidjson::StringRef( GetEasingName( data.fadeEasing ) ) ),
+			               docAllocator );
+			doc.AddMember( L"spotlight", JSONValue( data.spotlight ), docAllocator );
+			doc.AddMember( L"spotlightFeather", JSONValue( data.spotlightFeather ), docAllocator );
+			doc.AddMember( L"gradient",
+			               JSONValue( rapidjson::StringRef( GetGradientKindName( data.gradient.kind ) ) ),
+			               docAllocator );
+			doc.AddMember( L"gradientRadius", JSONValue( static_cast<double>( data.gradient.radius ) ),
+			               docAllocator );
+			doc.AddMember( L"gradientInner", JSONValue( static_cast<double>( data.gradient.innerCoverage ) ),
+			               docAllocator );
+
+			JSONValue processNamesVal( rapidjson::kArrayType );
+			processNamesVal.Reserve( static_cast<rapidjson::SizeType>( data.processNames.GetCount() ), docAllocator );
+			for ( const auto name : data.processNames )
+				processNamesVal.PushBack(
+				    JSONValue( rapidjson::StringRef( name.data(), static_cast<rapidjson::SizeType>( name.size() ) ) ),
+				    docAllocator );
+			doc.AddMember( L"processes", processNamesVal, docAllocator );
+
+			JSONValue companionNamesVal( rapidjson::kArrayType );
+			companionNamesVal.Reserve( static_cast<rapidjson::SizeType>( data.companionNames.GetCount() ),
+			                           docAllocator );
+			for ( const auto name : data.companionNames )
+				companionNamesVal.PushBack(
+				    JSONValue( rapidjson::StringRef( name.data(), static_cast<rapidjson::SizeType>( name.size() ) ) ),
+				    docAllocator );
+			doc.AddMember( L"companions", companionNamesVal, docAllocator );
+
+			JSONValue rulesVal( rapidjson::kArrayType );
+			rulesVal.Reserve( static_cast<rapidjson::SizeType>( data.rules.size() ), docAllocator );
+			for ( const auto& rule : data.rules )
 			{
-				const auto dir = GetSettingsDirectory();
-				_snwprintf_s( s_settingsFilename, MAX_PATH, L"%s\\settings.json", dir );
+				JSONValue ruleVal( rapidjson::kObjectType );
+				ruleVal.AddMember( L"field", JSONValue( rapidjson::StringRef( GetRuleFieldName( rule.field ) ) ),
+				                   docAllocator );
+				ruleVal.AddMember( JSONValue( rapidjson::StringRef( GetRuleOperatorName( rule.op ) ) ),
+				                   JSONValue( rapidjson::StringRef( rule.pattern.c_str() ) ), docAllocator );
+				rulesVal.PushBack( ruleVal, docAllocator );
 			}
+			doc.AddMember( L"rules", rulesVal, docAllocator );
 
-			return s_settingsFilename;
-		}
-	} // namespace
-
-	bool Settings::Load()
-	{
-		const auto filename = GetSettingsFilename();
-		if ( ::GetFileAttributesW( filename ) == INVALID_FILE_ATTRIBUTES )
-			return false;
+			JSONValue monitorsVal( rapidjson::kArrayType );
+			monitorsVal.Reserve( static_cast<rapidjson::SizeType>( data.monitorLevels.size() ), docAllocator );
+			for ( const auto& level : data.monitorLevels )
+			{
+				JSONValue monitorVal( rapidjson::kObjectType );
+				monitorVal.AddMember( L"device", JSONValue( rapidjson::StringRef( level.device.c_str() ) ),
+				                      docAllocator );
+				if ( level.alpha != MonitorLevel::GLOBAL )
+					monitorVal.AddMember( L"alpha", JSONValue( level.alpha ), docAllocator );
 
-		FILE* fp = nullptr;
-		_wfopen_s( &fp, filename, L"rb" );
-		if ( fp == nullptr )
-			return false;
+				if ( level.color != MonitorLevel::GLOBAL )
+				{
+					const COLORREF levelColor = static_cast<COLORREF>( level.color );
+
+					JSONValue levelColorVal( rapidjson::kArrayType );
+					levelColorVal.Reserve( 3, docAllocator );
+					levelColorVal.PushBack( JSONValue( GetRValue( levelColor ) ), docAllocator );
+					levelColorVal.PushBack( JSONValue( GetGValue( levelColor ) ), docAllocator );
+					levelColorVal.PushBack( JSONValue( GetBValue( levelColor ) ), docAllocator );
+					monitorVal.AddMember( L"color", levelColorVal, docAllocator );
+				}
 
-		rapidjson::FileReadStream inStream( fp, s_jsonReadWriteBuffer, sizeof( s_jsonReadWriteBuffer ) );
+				monitorsVal.PushBack( monitorVal, docAllocator );
+			}
+			doc.AddMember( L"monitors", monitorsVal, docAllocator );
 
-		JSONDocument doc;
-		doc.ParseStream<rapidjson::kParseDefaultFlags, rapidjson::UTF8<>, rapidjson::FileReadStream>( inStream );
-		fclose( fp );
+			rapidjson::StringBuffer json;
+			rapidjson::PrettyWriter<rapidjson::StringBuffer, rapidjson::UTF16<>, rapidjson::UTF8<>> writer( json );
+			if ( !doc.Accept( writer ) )
+				return false;
 
-		if ( doc.HasParseError() )
-			return false;
+			// make sure the directory exists
+			const SettingsFile& file = GetSettingsFile();
+			::SHCreateDirectoryExW( nullptr, file.GetDirectory(), nullptr );
 
-		int         version    = 0;
-		const auto& versionVal = doc[L"version"];
-		if ( versionVal.IsInt() )
-			version = versionVal.GetInt();
+			return file.Write( data, reinterpret_cast<const uint8_t*>( json.GetString() ), json.GetSize(),
+			                   contentHash );
+		}
+	} // namespace
 
-		switch ( version )
+	bool Settings::Load()
+	{
+		const SettingsFile& file = GetSettingsFile();
+		if ( file.Exists() )
 		{
-		case SETTINGS_VERSION: {
-			const auto& enabledVal = doc[L"enabled"];
-			if ( enabledVal.IsBool() )
-				this->enabled = enabledVal.GetBool();
-
-			const auto& alphaVal = doc[L"alpha"];
-			if ( alphaVal.IsInt() )
-				this->alpha = static_cast<BYTE>( std::max( 0, std::min( 255, alphaVal.GetInt() ) ) );
-
-			const auto& colorVal = doc[L"color"];
-			if ( colorVal.IsArray() && colorVal.Size() == 3 )
+			if ( file.ReadSnapshot( this->data, this->fileHash ) )
 			{
-				BYTE r = 0;
-				BYTE g = 0;
-				BYTE b = 0;
-
-				if ( colorVal[0].IsInt() )
-					r = static_cast<BYTE>( std::max( 0, std::min( 255, colorVal[0].GetInt() ) ) );
-				if ( colorVal[1].IsInt() )
-					g = static_cast<BYTE>( std::max( 0, std::min( 255, colorVal[1].GetInt() ) ) );
-				if ( colorVal[2].IsInt() )
-					b = static_cast<BYTE>( std::max( 0, std::min( 255, colorVal[2].GetInt() ) ) );
-
-				this->color = RGB( r, g, b );
+				this->loaded = this->data;
+				this->dirty  = false;
+				return true;
 			}
 
-			const auto& processes = doc[L"processes"];
-			if ( processes.IsArray() )
+			MappedFile json;
+			if ( json.Open( file.GetFilename() ) &&
+			     ReadSettings( reinterpret_cast<const char*>( json.GetData() ), json.GetSize(), this->data ) )
 			{
-				this->processNames.clear();
-
-				for ( const auto& name : processes.GetArray() )
-					this->processNames.emplace_back( std::wstring( name.GetString() ) );
+				this->fileHash = GetContentHash( json.GetData(), json.GetSize() );
+				this->loaded   = this->data;
+				this->dirty    = false;
+				file.UpdateSnapshot( this->data, this->fileHash );
+				return true;
 			}
-
-			break;
-		}
-		default: {
-			// unsupported version, bail out
-			return false;
-		}
 		}
 
-		this->dirty = false;
+		// settings.json is gone or broken, the backup holds the generation written before it
+		MappedFile backup;
+		if ( !backup.Open( file.GetBackupFilename() ) ||
+		     !ReadSettings( reinterpret_cast<const char*>( backup.GetData() ), backup.GetSize(), this->data ) )
+			return false;
 
+		this->loaded = this->data;
+		this->dirty  = false;
 		return true;
 	}
 
-	bool Settings::Save() const
+	bool Settings::Reload()
 	{
-		const auto filename = GetSettingsFilename();
-		if ( ::GetFileAttributesW( filename ) != INVALID_FILE_ATTRIBUTES && !this->dirty )
-			return true;
+		// our own write most likely triggered this, what it wrote has to be known before the file can be told apart
+		// from an external edit
+		this->persister.WaitForWrite();
+		TakeWritten();
 
-		JSONDocument doc;
-		doc.SetObject();
+		const SettingsFile& file = GetSettingsFile();
+		SettingsData        next;
+		{
+			MappedFile json;
+			if ( !json.Open( file.GetFilename() ) )
+				return false;
 
-		auto& docAllocator = doc.GetAllocator();
+			// editors touch the file without changing it, and our own saves come back through here too
+			const uint64_t hash = GetContentHash( json.GetData(), json.GetSize() );
+			if ( hash == this->fileHash )
+				return false;
 
-		doc.AddMember( L"version", JSONValue( SETTINGS_VERSION ), docAllocator );
-		doc.AddMember( L"enabled", JSONValue( this->enabled ), docAllocator );
-		doc.AddMember( L"alpha", JSONValue( static_cast<int>( this->alpha ) ), docAllocator );
+			// most likely caught halfway through a write, the next change notification will get it
+			if ( !ReadSettings( reinterpret_cast<const char*>( json.GetData() ), json.GetSize(), next ) )
+				return false;
 
-		JSONValue colorVal( rapidjson::kArrayType );
-		colorVal.Reserve( 3, docAllocator );
-		colorVal.PushBack( JSONValue( GetRValue( this->color ) ), docAllocator );
-		colorVal.PushBack( JSONValue( GetGValue( this->color ) ), docAllocator );
-		colorVal.PushBack( JSONValue( GetBValue( this->color ) ), docAllocator );
-		doc.AddMember( L"color", colorVal, docAllocator );
+			this->fileHash = hash;
+		}
 
-		JSONValue processNamesVal( rapidjson::kArrayType );
-		processNamesVal.Reserve( static_cast<rapidjson::SizeType>( this->processNames.size() ), docAllocator );
-		for ( const auto& name : this->processNames )
-			processNamesVal.PushBack( JSONValue( rapidjson::StringRef( name.c_str() ) ), docAllocator );
-		doc.AddMember( L"processes", processNamesVal, docAllocator );
+		// only what changed in the file is taken over, anything changed here and not saved yet stays,
+		// every group the edit touched is delivered in one notification
+		BeginChanges();
+		const uint32_t changes = DiffSettings( this->loaded, next );
+		MergeSettings( next, changes, this->data );
+		this->loaded = std::move( next );
+		file.UpdateSnapshot( this->loaded, this->fileHash );
+
+		// a write still waiting would put the edited values back, it has to carry them as well
+		if ( changes != 0 && this->persister.IsPending() )
+			SchedulePersist();
+
+		NotifyChanges( changes );
+		CommitChanges();
+		return changes != 0;
+	}
 
-		// make sure the directory exists
-		::SHCreateDirectoryExW( nullptr, GetSettingsDirectory(), nullptr );
+	bool Settings::OpenWatcher( FileWatcher& watcher ) const
+	{
+		// settings.json might not be written yet, its directory has to exist to be watched
+		const SettingsFile& file = GetSettingsFile();
+		::SHCreateDirectoryExW( nullptr, file.GetDirectory(), nullptr );
+		return watcher.Open( file.GetDirectory(), SettingsFile::FILENAME );
+	}
 
-		FILE* fp = nullptr;
-		_wfopen_s( &fp, filename, L"wb" );
-		if ( fp == nullptr )
-			return false;
+	const wchar_t* Settings::GetDirectory() const
+	{
+		return GetSettingsFile().GetDirectory();
+	}
 
-		rapidjson::FileWriteStream outStream( fp, s_jsonReadWriteBuffer, sizeof( s_jsonReadWriteBuffer ) );
-		rapidjson::PrettyWriter<rapidjson::FileWriteStream, rapidjson::UTF16<>, rapidjson::UTF8<>> writer( outStream );
-		const bool success = doc.Accept( writer );
-		fclose( fp );
+	bool Settings::Save()
+	{
+		TakeWritten();
+		if ( GetSettingsFile().Exists() && !this->dirty && !this->persister.IsPending() )
+			return true;
 
-		this->dirty = false;
+		if ( !this->persister.IsRunning() )
+		{
+			if ( !WriteSettingsFile( this->data, this->fileHash ) )
+				return false;
 
+			this->loaded = this->data;
+			this->dirty  = false;
+			return true;
+		}
+
+		SchedulePersist();
+		const bool success = this->persister.Flush();
+		TakeWritten();
 		return success;
 	}
 
-	bool Settings::IsTheaterEnabled() const
+	bool Settings::StartAutoSave( uint32_t delayMs )
 	{
-		return this->enabled;
+		// resolved here, the worker only reads them
+		GetSettingsFile();
+
+		return this->persister.Start( WriteSettingsFile, delayMs );
 	}
 
-	void Settings::EnableTheater( bool state )
+	void Settings::StopAutoSave()
 	{
-		this->enabled = state;
-		this->dirty   = true;
+		this->persister.Stop();
 	}
 
-	size_t Settings::GetProcessNamesCount() const
+	bool Settings::IsTheaterEnabled() const
 	{
-		return this->processNames.size();
+		return this->data.enabled;
 	}
 
-	size_t Settings::GetProcessNames( const wchar_t* processes[], size_t processNamesCount ) const
+	void Settings::EnableTheater( bool state )
 	{
-		if ( processes == nullptr )
-			return 0u;
+		if ( this->data.enabled == state )
+			return;
 
-		const size_t maxElements = std::min( processNamesCount, this->processNames.size() );
-		for ( size_t i = 0; i < maxElements; i++ )
-			processes[i] = this->processNames[i].c_str();
+		this->data.enabled = state;
+		MarkChanged( SETTINGS_CHANGE_ENABLED );
+	}
 
-		return maxElements;
+	const ProcessNameSet& Settings::GetProcessNames() const
+	{
+		return this->data.processNames;
 	}
 
 	void Settings::AddProcessName( const wchar_t* processName )
 	{
-		this->processNames.emplace_back( std::wstring( processName ) );
-		this->dirty = true;
+		if ( !this->data.processNames.Add( processName ) )
+			return;
+
+		MarkChanged( SETTINGS_CHANGE_PROCESSES );
 	}
 
 	void Settings::RemoveProcessName( const wchar_t* processName )
 	{
-		auto iter = std::find_if(
-		    this->processNames.begin(), this->processNames.end(),
-		    [processName]( const std::wstring& name ) { return _wcsicmp( name.c_str(), processName ) == 0; } );
-		if ( iter == this->processNames.end() )
+		if ( !this->data.processNames.Remove( processName ) )
 			return;
 
-		this->processNames.erase( iter );
-		this->dirty = true;
+		MarkChanged( SETTINGS_CHANGE_PROCESSES );
+	}
+
+	const ProcessNameSet& Settings::GetCompanionNames() const
+	{
+		return this->data.companionNames;
+	}
+
+	const std::vector<Rule>& Settings::GetRules() const
+	{
+		return this->data.rules;
+	}
+
+	void Settings::AddRule( const Rule& rule )
+	{
+		this->data.rules.emplace_back( rule );
+		MarkChanged( SETTINGS_CHANGE_RULES );
+	}
+
+	void Settings::ClearRules()
+	{
+		if ( this->data.rules.empty() )
+			return;
+
+		this->data.rules.clear();
+		MarkChanged( SETTINGS_CHANGE_RULES );
 	}
 
 	BYTE Settings::GetAlpha() const
 	{
-		return this->alpha;
+		return this->data.alpha;
 	}
 
 	void Settings::SetAlpha( BYTE value )
 	{
-		this->alpha      = value;
-		this->dirty = true;
+		if ( this->data.alpha == value )
+			return;
+
+		this->data.alpha = value;
+		MarkChanged( SETTINGS_CHANGE_ALPHA );
 	}
 
 	COLORREF Settings::GetColor() const
 	{
-		return this->color;
+		return this->data.color;
 	}
 
 	void Settings::SetColor( COLORREF value )
 	{
-		this->color      = value;
-		this->dirty = true;
+		if ( this->data.color == value )
+			return;
+
+		this->data.color = value;
+		MarkChanged( SETTINGS_CHANGE_COLOR );
 	}
 
-	void Settings::RegisterChangedCallback( SETTINGSCHANGEDCALLBACK callback )
+	uint32_t Settings::GetFadeDuration() const
 	{
-		this->notifyCallbacks.emplace_back( callback );
+		return this->data.fadeDuration;
 	}
 
-	void Settings::UnregisterChangedCallback( SETTINGSCHANGEDCALLBACK callback )
+	void Settings::SetFadeDuration( uint32_t value )
+	{
+		if ( this->data.fadeDuration == value )
+			return;
+
+		this->data.fadeDuration = value;
+		MarkChanged( SETTINGS_CHANGE_FADE );
+	}
+
+	Easing Settings::GetFadeEasing() const
+	{
+		return this->data.fadeEasing;
+	}
+
+	void Settings::SetFadeEasing( Easing value )
+	{
+		if ( this->data.fadeEasing == value )
+			return;
+
+		this->data.fadeEasing = value;
+		MarkChanged( SETTINGS_CHANGE_FADE );
+	}
+
+	bool Settings::IsSpotlightEnabled() const
 	{
-		auto iter = std::find_if( this->notifyCallbacks.begin(), this->notifyCallbacks.end(),
-		                          [callback]( SETTINGSCHANGEDCALLBACK clb ) { return clb == callback; } );
-		if ( iter == this->notifyCallbacks.end() )
+		return this->data.spotlight;
+	}
+
+	void Settings::EnableSpotlight( bool state )
+	{
+		if ( this->data.spotlight == state )
 			return;
 
-		this->notifyCallbacks.erase( iter );
+		this->data.spotlight = state;
+		MarkChanged( SETTINGS_CHANGE_SPOTLIGHT );
 	}
 
-	void Settings::NotifyChanges() const
+	uint32_t Settings::GetSpotlightFeather() const
 	{
-		for ( auto callback : this->notifyCallbacks )
-			callback();
+		return this->data.spotlightFeather;
+	}
+
+	void Settings::SetSpotlightFeather( uint32_t value )
+	{
+		if ( this->data.spotlightFeather == value )
+			return;
+
+		this->data.spotlightFeather = value;
+		MarkChanged( SETTINGS_CHANGE_SPOTLIGHT );
+	}
+
+	const GradientParams& Settings::GetGradient() const
+	{
+		return this->data.gradient;
+	}
+
+	void Settings::SetGradient( const GradientParams& value )
+	{
+		this->data.gradient = value;
+		MarkChanged( SETTINGS_CHANGE_GRADIENT );
+	}
+
+	const std::vector<MonitorLevel>& Settings::GetMonitorLevels() const
+	{
+		return this->data.monitorLevels;
+	}
+
+	void Settings::SetMonitorLevels( const std::vector<MonitorLevel>& value )
+	{
+		this->data.monitorLevels = value;
+		MarkChanged( SETTINGS_CHANGE_MONITORS );
+	}
+
+	void Settings::RegisterChangedCallback( SETTINGSCHANGEDCALLBACK callback, uint32_t changes )
+	{
+		this->changeBus.Subscribe( callback, changes );
+	}
+
+	void Settings::UnregisterChangedCallback( SETTINGSCHANGEDCALLBACK callback )
+	{
+		this->changeBus.Unsubscribe( callback );
+	}
+
+	void Settings::NotifyChanges( uint32_t changes )
+	{
+		this->changeBus.Publish( changes );
+	}
+
+	void Settings::BeginChanges()
+	{
+		this->changeBus.Begin();
+	}
+
+	void Settings::CommitChanges()
+	{
+		this->changeBus.Commit();
+	}
+
+	void Settings::MarkChanged( uint32_t changes )
+	{
+		this->dirty = true;
+		if ( this->persister.IsRunning() )
+			SchedulePersist();
+
+		this->changeBus.Publish( changes );
+	}
+
+	void Settings::SchedulePersist()
+	{
+		// loaded and dirty stay as they are, the write can still fail
+		this->persistGeneration = this->persister.Schedule( this->data );
+	}
+
+	void Settings::TakeWritten()
+	{
+		SettingsData written;
+		uint64_t     generation  = 0;
+		uint64_t     contentHash = 0;
+		if ( !this->persister.TakeWritten( written, generation, contentHash ) )
+			return;
+
+		// an older generation leaves later changes still to be written
+		this->loaded   = std::move( written );
+		this->fileHash = contentHash;
+		if ( generation == this->persistGeneration )
+			this->dirty = false;
 	}
 } // namespace Theater
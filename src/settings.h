@@ -9,35 +9,86 @@ namespace Theater
 		~Settings() = default;
 
 		bool Load();
-		bool Save() const;
+
+		// Writes pending changes right away and waits for them, with auto save running they go through its worker
+		bool Save();
+
+		// Changes are written on a worker thread once they stayed quiet for delayMs, StopAutoSave writes what
+		// is still pending before returning.
+		bool StartAutoSave( uint32_t delayMs );
+		void StopAutoSave();
+
+		// Re-reads settings.json after an external edit, only the groups that changed in the file are applied
+		// over the current values and notified. Returns false when nothing changed or the file doesn't parse yet.
+		bool Reload();
+		bool OpenWatcher( FileWatcher& watcher ) const;
+
+		// Folder of settings.json, whatever else the app writes goes there too
+		const wchar_t* GetDirectory() const;
 
 		bool IsTheaterEnabled() const;
 		void EnableTheater( bool state );
 
-		size_t GetProcessNamesCount() const;
-		size_t GetProcessNames( const wchar_t* processNames[], size_t processNamesCount ) const;
-		void   AddProcessName( const wchar_t* processName );
-		void   RemoveProcessName( const wchar_t* processName );
+		const ProcessNameSet& GetProcessNames() const;
+		void                  AddProcessName( const wchar_t* processName );
+		void                  RemoveProcessName( const wchar_t* processName );
+
+		// Processes whose windows stay above the dimmer while a target is shown, only edited in settings.json
+		const ProcessNameSet& GetCompanionNames() const;
+
+		const std::vector<Rule>& GetRules() const;
+		void                     AddRule( const Rule& rule );
+		void                     ClearRules();
 
 		BYTE     GetAlpha() const;
 		void     SetAlpha( BYTE alpha );
 		COLORREF GetColor() const;
 		void     SetColor( COLORREF color );
+		uint32_t GetFadeDuration() const;
+		void     SetFadeDuration( uint32_t duration );
+		Easing   GetFadeEasing() const;
+		void     SetFadeEasing( Easing easing );
 
-		typedef void ( *SETTINGSCHANGEDCALLBACK )();
-		void RegisterChangedCallback( SETTINGSCHANGEDCALLBACK callback );
+		bool     IsSpotlightEnabled() const;
+		void     EnableSpotlight( bool state );
+		uint32_t GetSpotlightFeather() const;
+		void     SetSpotlightFeather( uint32_t feather );
+
+		const GradientParams& GetGradient() const;
+		void                  SetGradient( const GradientParams& gradient );
+
+		const std::vector<MonitorLevel>& GetMonitorLevels() const;
+		void                             SetMonitorLevels( const std::vector<MonitorLevel>& levels );
+
+		// Setters notify right away unless called between BeginChanges and CommitChanges,
+		// the changes are then delivered together when the outermost transaction commits.
+		// changes is a combination of SettingsChange, a callback is only called for the changes it registered for.
+		typedef ChangeBus::CHANGECALLBACK SETTINGSCHANGEDCALLBACK;
+		void RegisterChangedCallback( SETTINGSCHANGEDCALLBACK callback, uint32_t changes );
 		void UnregisterChangedCallback( SETTINGSCHANGEDCALLBACK callback );
-		void NotifyChanges() const;
+		void NotifyChanges( uint32_t changes );
+		void BeginChanges();
+		void CommitChanges();
 
 	private:
-		mutable bool dirty   = false;
-		bool         enabled = true;
-		BYTE         alpha   = 200;
-		COLORREF     color   = RGB( 0, 0, 0 );
+		void MarkChanged( uint32_t changes );
+		void SchedulePersist();
+		void TakeWritten();
+
+	private:
+		// data holds changes settings.json doesn't have yet, until the write carrying the latest of them is confirmed
+		mutable bool dirty = false;
+		SettingsData data;
+
+		// settings.json as last read or written, reloads are diffed against it
+		mutable SettingsData loaded;
+		uint64_t             fileHash = 0;
 
-		std::vector<std::wstring> processNames;
+		// generation of the last persister write carrying data
+		uint64_t persistGeneration = 0;
 
-		std::vector<SETTINGSCHANGEDCALLBACK> notifyCallbacks;
+		ChangeBus         changeBus;
+		SettingsPersister persister;
 	};
 
 } // namespace Theater
\ No newline at end of file
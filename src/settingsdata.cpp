@@ -0,0 +1,91 @@
+#include "theater.h"
+#include "settingsdata.h"
+
+namespace Theater
+{
+	namespace
+	{
+		bool IsSameRule( const Rule& a, const Rule& b )
+		{
+			return a.field == b.field && a.op == b.op && a.pattern == b.pattern;
+		}
+
+		bool IsSameLevel( const MonitorLevel& a, const MonitorLevel& b )
+		{
+			return a.device == b.device && a.alpha == b.alpha && a.color == b.color;
+		}
+
+		template<typename T, typename Equal>
+		bool IsSameList( const std::vector<T>& a, const std::vector<T>& b, Equal equal )
+		{
+			return a.size() == b.size() && std::equal( a.begin(), a.end(), b.begin(), equal );
+		}
+	} // namespace
+
+	uint32_t DiffSettings( const SettingsData& former, const SettingsData& next )
+	{
+		uint32_t changes = 0;
+		if ( former.enabled != next.enabled )
+			changes |= SETTINGS_CHANGE_ENABLED;
+		if ( former.alpha != next.alpha )
+			changes |= SETTINGS_CHANGE_ALPHA;
+		if ( former.color != next.color )
+			changes |= SETTINGS_CHANGE_COLOR;
+		if ( former.fadeDuration != next.fadeDuration || former.fadeEasing != next.fadeEasing )
+			changes |= SETTINGS_CHANGE_FADE;
+		if ( former.spotlight != next.spotlight || former.spotlightFeather != next.spotlightFeather )
+			changes |= SETTINGS_CHANGE_SPOTLIGHT;
+		if ( former.gradient.kind != next.gradient.kind || former.gradient.radius != next.gradient.radius ||
+		     former.gradient.innerCoverage != next.gradient.innerCoverage )
+			changes |= SETTINGS_CHANGE_GRADIENT;
+		if ( former.processNames != next.processNames )
+			changes |= SETTINGS_CHANGE_PROCESSES;
+		if ( former.companionNames != next.companionNames )
+			changes |= SETTINGS_CHANGE_COMPANIONS;
+		if ( !IsSameList( former.rules, next.rules, IsSameRule ) )
+			changes |= SETTINGS_CHANGE_RULES;
+		if ( !IsSameList( former.monitorLevels, next.monitorLevels, IsSameLevel ) )
+			changes |= SETTINGS_CHANGE_MONITORS;
+
+		return changes;
+	}
+
+	void MergeSettings( const SettingsData& source, uint32_t changes, SettingsData& data )
+	{
+		if ( changes & SETTINGS_CHANGE_ENABLED )
+			data.enabled = source.enabled;
+
+		if ( changes & SETTINGS_CHANGE_ALPHA )
+			data.alpha = source.alpha;
+
+		if ( changes & SETTINGS_CHANGE_COLOR )
+			data.color = source.color;
+
+		if ( changes & SETTINGS_CHANGE_FADE )
+		{
+			data.fadeDuration = source.fadeDuration;
+			data.fadeEasing   = source.fadeEasing;
+		}
+
+		if ( changes & SETTINGS_CHANGE_SPOTLIGHT )
+		{
+			data.spotlight        = source.spotlight;
+			data.spotlightFeather = source.spotlightFeather;
+		}
+
+		if ( changes & SETTINGS_CHANGE_GRADIENT )
+			data.gradient = source.gradient;
+
+		if ( changes & SETTINGS_CHANGE_PROCESSES )
+			data.processNames = source.processNames;
+
+		if ( changes & SETTINGS_CHANGE_COMPANIONS )
+			data.companionNames = source.companionNames;
+
+		if ( changes & SETTINGS_CHANGE_RULES )
+			data.rules = source.rules;
+
+		if ( changes & SETTINGS_CHANGE_MONITORS )
+			data.monitorLevels = source.monitorLevels;
+	}
+} // namespace Theater
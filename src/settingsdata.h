@@ -0,0 +1,49 @@
+#pragma once
+
+namespace Theater
+{
+	// Plain values behind Settings, kept free of Win32 types so the readers can be used anywhere
+	struct SettingsData
+	{
+		static constexpr int32_t VERSION = 1;
+
+		bool           enabled          = true;
+		uint8_t        alpha            = 200;
+		uint32_t       color            = 0; // 0x00BBGGRR like a COLORREF
+		uint32_t       fadeDuration     = 500;
+		Easing         fadeEasing       = Easing::Linear;
+		bool           spotlight        = false;
+		uint32_t       spotlightFeather = 32;
+		GradientParams gradient         = { GradientKind::None, 1500.0f, 0.25f };
+
+		ProcessNameSet            processNames;
+		ProcessNameSet            companionNames; // kept above the dimmer along with a target, never a target alone
+		std::vector<Rule>         rules;
+		std::vector<MonitorLevel> monitorLevels;
+	};
+
+	// Groups of settings a change can touch, combined as a bitmask
+	enum SettingsChange : uint32_t
+	{
+		SETTINGS_CHANGE_ENABLED    = 1 << 0,
+		SETTINGS_CHANGE_ALPHA      = 1 << 1,
+		SETTINGS_CHANGE_COLOR      = 1 << 2,
+		SETTINGS_CHANGE_FADE       = 1 << 3,
+		SETTINGS_CHANGE_SPOTLIGHT  = 1 << 4,
+		SETTINGS_CHANGE_GRADIENT   = 1 << 5,
+		SETTINGS_CHANGE_PROCESSES  = 1 << 6,
+		SETTINGS_CHANGE_RULES      = 1 << 7,
+		SETTINGS_CHANGE_MONITORS   = 1 << 8,
+		SETTINGS_CHANGE_COMPANIONS = 1 << 9,
+		SETTINGS_CHANGE_ALL        = ( 1 << 10 ) - 1,
+
+		// what the target resolver's matchers are built from
+		SETTINGS_CHANGE_TARGET = SETTINGS_CHANGE_PROCESSES | SETTINGS_CHANGE_RULES | SETTINGS_CHANGE_COMPANIONS
+	};
+
+	// Groups whose values differ between former and next
+	uint32_t DiffSettings( const SettingsData& former, const SettingsData& next );
+
+	// Copies the groups in changes from source over data, everything else in data is left as is
+	void MergeSettings( const SettingsData& source, uint32_t changes, SettingsData& data );
+} // namespace Theater
\ No newline at end of file
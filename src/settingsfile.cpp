@@ -0,0 +1,235 @@
+#include "theater.h"
+#include "settingsfile.h"
+
+#if !defined( _WIN32 )
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Theater
+{
+	namespace
+	{
+#if defined( _WIN32 )
+		constexpr wchar_t PATH_SEPARATOR = L'\\';
+#else
+		constexpr wchar_t PATH_SEPARATOR = L'/';
+
+		bool GetNativePath( const std::wstring& path, std::string& nativePath )
+		{
+			nativePath.assign( path.size() * MB_CUR_MAX + 1, '\0' );
+			const size_t length = wcstombs( &nativePath[0], path.c_str(), nativePath.size() );
+			if ( length == static_cast<size_t>( -1 ) )
+				return false;
+
+			nativePath.resize( length );
+			return true;
+		}
+#endif
+	} // namespace
+
+	uint64_t GetContentHash( const uint8_t* bytes, size_t size )
+	{
+		uint64_t hash = 14695981039346656037ull;
+		for ( size_t i = 0; i < size; i++ )
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+
+		return hash;
+	}
+
+	MappedFile::~MappedFile()
+	{
+		Close();
+	}
+
+#if defined( _WIN32 )
+	bool MappedFile::Open( const wchar_t* filename )
+	{
+		Close();
+
+		HANDLE file = ::CreateFileW( filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		                             FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr );
+		if ( file == INVALID_HANDLE_VALUE )
+			return false;
+
+		// empty files can't be mapped, the view keeps the mapping and the file open by itself
+		LARGE_INTEGER fileSize = {};
+		HANDLE        mapping  = nullptr;
+		if ( ::GetFileSizeEx( file, &fileSize ) && fileSize.QuadPart != 0 )
+			mapping = ::CreateFileMappingW( file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+
+		if ( mapping != nullptr )
+		{
+			this->view = static_cast<const uint8_t*>( ::MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 ) );
+			::CloseHandle( mapping );
+		}
+
+		::CloseHandle( file );
+		if ( this->view == nullptr )
+			return false;
+
+		this->size = static_cast<size_t>( fileSize.QuadPart );
+		return true;
+	}
+
+	void MappedFile::Close()
+	{
+		if ( this->view != nullptr )
+			::UnmapViewOfFile( this->view );
+
+		this->view = nullptr;
+		this->size = 0;
+	}
+#else
+	bool MappedFile::Open( const wchar_t* filename )
+	{
+		Close();
+
+		std::string path;
+		if ( !GetNativePath( filename, path ) )
+			return false;
+
+		const int file = open( path.c_str(), O_RDONLY | O_CLOEXEC );
+		if ( file < 0 )
+			return false;
+
+		// empty files can't be mapped, the mapping keeps the file open by itself
+		struct stat attributes = {};
+		void*       mapping    = MAP_FAILED;
+		if ( fstat( file, &attributes ) == 0 && attributes.st_size > 0 )
+			mapping = mmap( nullptr, static_cast<size_t>( attributes.st_size ), PROT_READ, MAP_PRIVATE, file, 0 );
+
+		close( file );
+		if ( mapping == MAP_FAILED )
+			return false;
+
+		this->view = static_cast<const uint8_t*>( mapping );
+		this->size = static_cast<size_t>( attributes.st_size );
+		return true;
+	}
+
+	void MappedFile::Close()
+	{
+		if ( this->view != nullptr )
+			munmap( const_cast<uint8_t*>( this->view ), this->size );
+
+		this->view = nullptr;
+		this->size = 0;
+	}
+#endif
+
+	const uint8_t* MappedFile::GetData() const
+	{
+		return this->view;
+	}
+
+	size_t MappedFile::GetSize() const
+	{
+		return this->size;
+	}
+
+	void SettingsFile::SetDirectory( const std::wstring& path )
+	{
+		this->directory        = path;
+		this->filename         = path + PATH_SEPARATOR + FILENAME;
+		this->backupFilename   = this->filename + L".bak";
+		this->snapshotFilename = path + PATH_SEPARATOR + L"settings.bin";
+	}
+
+	const wchar_t* SettingsFile::GetDirectory() const
+	{
+		return this->directory.c_str();
+	}
+
+	const wchar_t* SettingsFile::GetFilename() const
+	{
+		return this->filename.c_str();
+	}
+
+	const wchar_t* SettingsFile::GetBackupFilename() const
+	{
+		return this->backupFilename.c_str();
+	}
+
+	const wchar_t* SettingsFile::GetSnapshotFilename() const
+	{
+		return this->snapshotFilename.c_str();
+	}
+
+	bool SettingsFile::Exists() const
+	{
+		SettingsSource source = {};
+		return GetSource( source );
+	}
+
+	bool SettingsFile::ReadSnapshot( SettingsData& data, uint64_t& contentHash ) const
+	{
+		SettingsSource source = {};
+		MappedFile     snapshot;
+		return GetSource( source ) && snapshot.Open( GetSnapshotFilename() ) &&
+		       ReadSettingsSnapshot( snapshot.GetData(), snapshot.GetSize(), source, data, contentHash );
+	}
+
+	void SettingsFile::UpdateSnapshot( const SettingsData& data, uint64_t contentHash ) const
+	{
+		SettingsSource       source = {};
+		std::vector<uint8_t> bytes;
+		if ( !GetSource( source ) || !WriteSettingsSnapshot( data, source, contentHash, bytes ) )
+		{
+#if defined( _WIN32 )
+			::DeleteFileW( GetSnapshotFilename() );
+#else
+			std::string path;
+			if ( GetNativePath( this->snapshotFilename, path ) )
+				unlink( path.c_str() );
+#endif
+			return;
+		}
+
+		// a snapshot that can't be replaced is stale and gets ignored, the JSON is parsed instead
+		WriteFileAtomic( GetSnapshotFilename(), bytes.data(), bytes.size(), nullptr );
+	}
+
+	bool SettingsFile::Write( const SettingsData& data, const uint8_t* json, size_t size, uint64_t& contentHash ) const
+	{
+		// the former settings.json stays around as the backup a load falls back to
+		if ( !WriteFileAtomic( GetFilename(), json, size, GetBackupFilename() ) )
+			return false;
+
+		contentHash = GetContentHash( json, size );
+		UpdateSnapshot( data, contentHash );
+		return true;
+	}
+
+#if defined( _WIN32 )
+	bool SettingsFile::GetSource( SettingsSource& source ) const
+	{
+		WIN32_FILE_ATTRIBUTE_DATA attributes = {};
+		if ( !::GetFileAttributesExW( GetFilename(), GetFileExInfoStandard, &attributes ) )
+			return false;
+
+		source.size      = ( static_cast<uint64_t>( attributes.nFileSizeHigh ) << 32 ) | attributes.nFileSizeLow;
+		source.writeTime = ( static_cast<uint64_t>( attributes.ftLastWriteTime.dwHighDateTime ) << 32 ) |
+		                   attributes.ftLastWriteTime.dwLowDateTime;
+		return true;
+	}
+#else
+	bool SettingsFile::GetSource( SettingsSource& source ) const
+	{
+		std::string path;
+		struct stat attributes = {};
+		if ( !GetNativePath( this->filename, path ) || stat( path.c_str(), &attributes ) != 0 )
+			return false;
+
+		source.size      = static_cast<uint64_t>( attributes.st_size );
+		source.writeTime = static_cast<uint64_t>( attributes.st_mtim.tv_sec ) * 1000000000ull +
+		                   static_cast<uint64_t>( attributes.st_mtim.tv_nsec );
+		return true;
+	}
+#endif
+} // namespace Theater
@@ -0,0 +1,67 @@
+#pragma once
+
+namespace Theater
+{
+	// FNV-1a over a whole file, tells settings.json contents apart
+	uint64_t GetContentHash( const uint8_t* bytes, size_t size );
+
+	// Read only view of a whole file, an empty file fails to open
+	class MappedFile
+	{
+	public:
+		MappedFile() = default;
+		~MappedFile();
+
+		bool Open( const wchar_t* filename );
+		void Close();
+
+		const uint8_t* GetData() const;
+		size_t         GetSize() const;
+
+	private:
+		MappedFile( const MappedFile& ) = delete;
+		MappedFile& operator=( const MappedFile& ) = delete;
+
+	private:
+		const uint8_t* view = nullptr;
+		size_t         size = 0;
+	};
+
+	// settings.json along with its backup and its snapshot, all in one directory.
+	// Whatever is written or read back reports the content hash of settings.json, a change notification for a
+	// hash already known is our own write. The snapshot keeps the hash so the next start knows it too.
+	class SettingsFile
+	{
+	public:
+		static constexpr wchar_t FILENAME[] = L"settings.json";
+
+		SettingsFile()  = default;
+		~SettingsFile() = default;
+
+		void           SetDirectory( const std::wstring& directory );
+		const wchar_t* GetDirectory() const;
+		const wchar_t* GetFilename() const;
+		const wchar_t* GetBackupFilename() const;
+		const wchar_t* GetSnapshotFilename() const;
+
+		bool Exists() const;
+
+		// Only while settings.json is still the file the snapshot was taken from
+		bool ReadSnapshot( SettingsData& data, uint64_t& contentHash ) const;
+
+		// Takes a snapshot of data matching the settings.json currently on disk, the stale one is deleted on failure
+		void UpdateSnapshot( const SettingsData& data, uint64_t contentHash ) const;
+
+		// Replaces settings.json with json, the serialized data, and keeps the former content as the backup
+		bool Write( const SettingsData& data, const uint8_t* json, size_t size, uint64_t& contentHash ) const;
+
+	private:
+		bool GetSource( SettingsSource& source ) const;
+
+	private:
+		std::wstring directory;
+		std::wstring filename;
+		std::wstring backupFilename;
+		std::wstring snapshotFilename;
+	};
+} // namespace Theater
\ No newline at end of file
@@ -0,0 +1,156 @@
+#include "theater.h"
+#include "settingspersister.h"
+
+namespace Theater
+{
+	SettingsPersister::~SettingsPersister()
+	{
+		Stop();
+	}
+
+	bool SettingsPersister::Start( WRITECALLBACK writeCallback, uint32_t delayMs )
+	{
+		if ( writeCallback == nullptr || this->worker.joinable() )
+			return false;
+
+		this->callback = writeCallback;
+		this->delay    = delayMs;
+		this->stopping = false;
+		this->worker   = std::thread( &SettingsPersister::Run, this );
+		return true;
+	}
+
+	void SettingsPersister::Stop()
+	{
+		if ( !this->worker.joinable() )
+			return;
+
+		{
+			std::lock_guard<std::mutex> guard( this->lock );
+			this->stopping = true;
+		}
+
+		this->wakeup.notify_one();
+		this->worker.join();
+	}
+
+	bool SettingsPersister::IsRunning() const
+	{
+		return this->worker.joinable();
+	}
+
+	uint64_t SettingsPersister::Schedule( const SettingsData& data )
+	{
+		uint64_t generation = 0;
+		{
+			std::lock_guard<std::mutex> guard( this->lock );
+			this->pending    = data;
+			this->hasPending = true;
+			this->deadline   = Clock::now() + std::chrono::milliseconds( this->delay );
+			this->failures   = 0;
+			generation       = ++this->scheduledGeneration;
+		}
+
+		this->wakeup.notify_one();
+		return generation;
+	}
+
+	bool SettingsPersister::IsPending() const
+	{
+		std::lock_guard<std::mutex> guard( this->lock );
+		return this->hasPending;
+	}
+
+	bool SettingsPersister::Flush()
+	{
+		std::unique_lock<std::mutex> guard( this->lock );
+		if ( !this->worker.joinable() )
+			return !this->hasPending;
+
+		const uint64_t generation = this->scheduledGeneration;
+		if ( this->writtenGeneration >= generation )
+			return this->lastWriteSucceeded;
+
+		this->flushRequested = true;
+		this->wakeup.notify_one();
+		this->written.wait( guard, [this, generation]() { return this->writtenGeneration >= generation; } );
+		return this->lastWriteSucceeded;
+	}
+
+	void SettingsPersister::WaitForWrite()
+	{
+		std::unique_lock<std::mutex> guard( this->lock );
+		this->written.wait( guard, [this]() { return !this->writing; } );
+	}
+
+	bool SettingsPersister::TakeWritten( SettingsData& data, uint64_t& generation, uint64_t& contentHash )
+	{
+		std::lock_guard<std::mutex> guard( this->lock );
+		if ( !this->hasConfirmed )
+			return false;
+
+		data               = std::move( this->confirmed );
+		generation         = this->confirmedGeneration;
+		contentHash        = this->confirmedHash;
+		this->hasConfirmed = false;
+		return true;
+	}
+
+	void SettingsPersister::Run()
+	{
+		std::unique_lock<std::mutex> guard( this->lock );
+		for ( ;; )
+		{
+			if ( !this->hasPending )
+			{
+				if ( this->stopping )
+					break;
+
+				this->wakeup.wait( guard );
+				continue;
+			}
+
+			if ( !this->stopping && !this->flushRequested && Clock::now() < this->deadline )
+			{
+				this->wakeup.wait_until( guard, this->deadline );
+				continue;
+			}
+
+			SettingsData   data        = std::move( this->pending );
+			const uint64_t generation  = this->scheduledGeneration;
+			uint64_t       contentHash = 0;
+			this->hasPending           = false;
+			this->flushRequested       = false;
+			this->writing              = true;
+
+			// serializing and writing happen unlocked, Schedule never waits for the disk
+			guard.unlock();
+			const bool success = this->callback( data, contentHash );
+			guard.lock();
+
+			this->writing = false;
+
+			// data scheduled meanwhile is newer, otherwise the failed data is retried unless shutting down
+			if ( !success && !this->hasPending && !this->stopping )
+			{
+				this->failures       = std::min( this->failures + 1, 16u );
+				const uint64_t retry = static_cast<uint64_t>( this->delay ) << this->failures;
+
+				this->pending    = std::move( data );
+				this->hasPending = true;
+				this->deadline   = Clock::now() + std::chrono::milliseconds( std::min<uint64_t>( retry, MAX_DELAY ) );
+			}
+			else if ( success )
+			{
+				this->confirmed           = std::move( data );
+				this->confirmedGeneration = generation;
+				this->confirmedHash       = contentHash;
+				this->hasConfirmed        = true;
+			}
+
+			this->writtenGeneration  = generation;
+			this->lastWriteSucceeded = success;
+			this->written.notify_all();
+		}
+	}
+} // namespace Theater
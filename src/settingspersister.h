@@ -0,0 +1,78 @@
+#pragma once
+
+namespace Theater
+{
+	// Writes settings on a worker thread once they stayed unchanged for the delay, so a burst of changes,
+	// like dragging through the opacity values, is written once and the UI thread never waits on the disk.
+	// Only the latest scheduled data is kept, a failed write is retried with a growing delay.
+	// The owner learns what reached the disk through TakeWritten, a scheduled write may still fail.
+	class SettingsPersister
+	{
+	public:
+		static constexpr uint32_t DEFAULT_DELAY = 1000;
+		static constexpr uint32_t MAX_DELAY     = 60000;
+
+		// Called on the worker thread with a copy of the data, returns whether it was written along with the content
+		// hash of what it wrote
+		typedef bool ( *WRITECALLBACK )( const SettingsData& data, uint64_t& contentHash );
+
+		SettingsPersister() = default;
+		~SettingsPersister();
+
+		bool Start( WRITECALLBACK callback, uint32_t delayMs );
+
+		// Writes whatever is still pending before the worker exits
+		void Stop();
+		bool IsRunning() const;
+
+		// Replaces whatever is pending and restarts the delay, returns the generation TakeWritten reports back
+		uint64_t Schedule( const SettingsData& data );
+		bool     IsPending() const;
+
+		// Writes what is pending right away and waits for it, returns false when that write failed
+		bool Flush();
+
+		// Waits for a write in progress to finish, data still waiting for its delay is left alone
+		void WaitForWrite();
+
+		// The latest data written successfully since the last call along with its generation and content hash,
+		// false when nothing was written meanwhile
+		bool TakeWritten( SettingsData& data, uint64_t& generation, uint64_t& contentHash );
+
+	private:
+		SettingsPersister( const SettingsPersister& ) = delete;
+		SettingsPersister& operator=( const SettingsPersister& ) = delete;
+
+		void Run();
+
+	private:
+		typedef std::chrono::steady_clock Clock;
+
+		std::thread             worker;
+		mutable std::mutex      lock;
+		std::condition_variable wakeup;
+		std::condition_variable written;
+
+		WRITECALLBACK callback = nullptr;
+		uint32_t      delay    = DEFAULT_DELAY;
+
+		SettingsData      pending;
+		bool              hasPending = false;
+		bool              writing    = false;
+		Clock::time_point deadline;
+		uint32_t          failures = 0;
+
+		// every Schedule starts a generation, Flush waits for the one current when it was called
+		uint64_t scheduledGeneration = 0;
+		uint64_t writtenGeneration   = 0;
+		bool     lastWriteSucceeded  = true;
+		bool     flushRequested      = false;
+		bool     stopping            = false;
+
+		// the last successful write not taken yet
+		SettingsData confirmed;
+		uint64_t     confirmedGeneration = 0;
+		uint64_t     confirmedHash       = 0;
+		bool         hasConfirmed        = false;
+	};
+} // namespace Theater
\ No newline at end of file
@@ -0,0 +1,460 @@
+#include "theater.h"
+#include "settingsreader.h"
+#include <rapidjson/rapidjson.h>
+#include <rapidjson/memorystream.h>
+#include <rapidjson/reader.h>
+
+namespace Theater
+{
+	namespace
+	{
+		// whatever wchar_t holds, UTF-16 code units would split characters past the BMP where it's 32 bits
+		typedef std::conditional_t<sizeof( wchar_t ) == 2, rapidjson::UTF16<wchar_t>, rapidjson::UTF32<wchar_t>>
+		    WideEncoding;
+
+		int32_t Clamp( int32_t value, int32_t low, int32_t high )
+		{
+			return std::max( low, std::min( high, value ) );
+		}
+
+		uint32_t PackColor( const uint8_t rgb[3] )
+		{
+			return static_cast<uint32_t>( rgb[0] ) | ( static_cast<uint32_t>( rgb[1] ) << 8 ) |
+			       ( static_cast<uint32_t>( rgb[2] ) << 16 );
+		}
+
+		// Only the shapes settings.json uses are tracked, anything else is skipped as a whole
+		enum class Scope : uint8_t
+		{
+			Root,
+			Color,
+			Processes,
+			Companions,
+			Rules,
+			Rule,
+			Monitors,
+			Monitor,
+			MonitorColor
+		};
+
+		struct Value
+		{
+			enum class Type : uint8_t
+			{
+				Null,
+				Bool,
+				Int,
+				Number,
+				String
+			};
+
+			Type              type    = Type::Null;
+			bool              boolean = false;
+			int32_t           integer = 0;   // Int only
+			double            number  = 0.0; // Int and Number
+			std::wstring_view string;
+
+			bool IsNumber() const
+			{
+				return this->type == Type::Int || this->type == Type::Number;
+			}
+		};
+
+		class SettingsHandler
+		{
+		public:
+			explicit SettingsHandler( SettingsData& data ) : data( data )
+			{
+			}
+
+			int32_t GetVersion() const
+			{
+				return this->version;
+			}
+
+			bool Null()
+			{
+				return OnValue( Value() );
+			}
+
+			bool Bool( bool b )
+			{
+				Value value   = {};
+				value.type    = Value::Type::Bool;
+				value.boolean = b;
+				return OnValue( value );
+			}
+
+			bool Int( int i )
+			{
+				Value value   = {};
+				value.type    = Value::Type::Int;
+				value.integer = i;
+				value.number  = i;
+				return OnValue( value );
+			}
+
+			bool Uint( unsigned u )
+			{
+				// non negative integers always come through here, they are only ints while they fit
+				if ( u <= static_cast<unsigned>( INT32_MAX ) )
+					return Int( static_cast<int>( u ) );
+
+				return Double( static_cast<double>( u ) );
+			}
+
+			bool Int64( int64_t i )
+			{
+				return Double( static_cast<double>( i ) );
+			}
+
+			bool Uint64( uint64_t u )
+			{
+				return Double( static_cast<double>( u ) );
+			}
+
+			bool Double( double d )
+			{
+				Value value  = {};
+				value.type   = Value::Type::Number;
+				value.number = d;
+				return OnValue( value );
+			}
+
+			// only called with kParseNumbersAsStringsFlag
+			bool RawNumber( const wchar_t*, rapidjson::SizeType, bool )
+			{
+				return OnValue( Value() );
+			}
+
+			bool String( const wchar_t* str, rapidjson::SizeType length, bool )
+			{
+				Value value  = {};
+				value.type   = Value::Type::String;
+				value.string = std::wstring_view( str, length );
+				return OnValue( value );
+			}
+
+			bool Key( const wchar_t* str, rapidjson::SizeType length, bool )
+			{
+				if ( this->skipDepth == 0 )
+					this->key.assign( str, length );
+
+				return true;
+			}
+
+			bool StartObject()
+			{
+				return Enter( false );
+			}
+
+			bool EndObject( rapidjson::SizeType memberCount )
+			{
+				return Leave( memberCount );
+			}
+
+			bool StartArray()
+			{
+				return Enter( true );
+			}
+
+			bool EndArray( rapidjson::SizeType elementCount )
+			{
+				return Leave( elementCount );
+			}
+
+		private:
+			bool Enter( bool array )
+			{
+				if ( this->skipDepth > 0 )
+				{
+					this->skipDepth++;
+					return true;
+				}
+
+				bool  known = false;
+				Scope next  = Scope::Root;
+				if ( this->scopes.empty() )
+				{
+					known = !array;
+				}
+				else
+				{
+					switch ( this->scopes.back() )
+					{
+					case Scope::Root: {
+						if ( !array )
+							break;
+
+						known = true;
+						if ( this->key == L"color" )
+						{
+							next          = Scope::Color;
+							this->rgbSize = 0;
+						}
+						else if ( this->key == L"processes" )
+						{
+							next = Scope::Processes;
+							this->data.processNames.Clear();
+						}
+						else if ( this->key == L"companions" )
+						{
+							next = Scope::Companions;
+							this->data.companionNames.Clear();
+						}
+						else if ( this->key == L"rules" )
+						{
+							next = Scope::Rules;
+							this->data.rules.clear();
+						}
+						else if ( this->key == L"monitors" )
+						{
+							next = Scope::Monitors;
+							this->data.monitorLevels.clear();
+						}
+						else
+						{
+							known = false;
+						}
+						break;
+					}
+					case Scope::Color:
+					case Scope::MonitorColor: {
+						// still an element, it just isn't a channel
+						if ( this->rgbSize < 3 )
+							this->rgb[this->rgbSize] = 0;
+						this->rgbSize++;
+						break;
+					}
+					case Scope::Rules: {
+						if ( array )
+							break;
+
+						known             = true;
+						next              = Scope::Rule;
+						this->rule        = {};
+						this->ruleField   = false;
+						this->ruleValid   = false;
+						this->rulePattern = false;
+						break;
+					}
+					case Scope::Monitors: {
+						if ( array )
+							break;
+
+						known               = true;
+						next                = Scope::Monitor;
+						this->monitor       = {};
+						this->monitorDevice = false;
+						break;
+					}
+					case Scope::Monitor: {
+						if ( array && this->key == L"color" )
+						{
+							known         = true;
+							next          = Scope::MonitorColor;
+							this->rgbSize = 0;
+						}
+						break;
+					}
+					default:
+						break;
+					}
+				}
+
+				if ( !known )
+				{
+					this->skipDepth = 1;
+					return true;
+				}
+
+				this->scopes.emplace_back( next );
+				return true;
+			}
+
+			bool Leave( rapidjson::SizeType count )
+			{
+				if ( this->skipDepth > 0 )
+				{
+					this->skipDepth--;
+					return true;
+				}
+
+				const Scope scope = this->scopes.back();
+				this->scopes.pop_back();
+
+				switch ( scope )
+				{
+				case Scope::Color: {
+					if ( count == 3 )
+						this->data.color = PackColor( this->rgb );
+					break;
+				}
+				case Scope::Rule: {
+					if ( this->ruleValid && this->rulePattern )
+						this->data.rules.emplace_back( std::move( this->rule ) );
+					break;
+				}
+				case Scope::Monitor: {
+					if ( this->monitorDevice )
+						this->data.monitorLevels.emplace_back( std::move( this->monitor ) );
+					break;
+				}
+				case Scope::MonitorColor: {
+					if ( count == 3 )
+						this->monitor.color = PackColor( this->rgb );
+					break;
+				}
+				default:
+					break;
+				}
+
+				return true;
+			}
+
+			bool OnValue( const Value& value )
+			{
+				if ( this->skipDepth > 0 || this->scopes.empty() )
+					return true;
+
+				switch ( this->scopes.back() )
+				{
+				case Scope::Root:
+					OnRootValue( value );
+					break;
+				case Scope::Color:
+				case Scope::MonitorColor: {
+					if ( this->rgbSize < 3 )
+					{
+						this->rgb[this->rgbSize] =
+						    value.type == Value::Type::Int ? static_cast<uint8_t>( Clamp( value.integer, 0, 255 ) ) : 0;
+					}
+					this->rgbSize++;
+					break;
+				}
+				case Scope::Processes: {
+					if ( value.type == Value::Type::String )
+						this->data.processNames.Add( value.string );
+					break;
+				}
+				case Scope::Companions: {
+					if ( value.type == Value::Type::String )
+						this->data.companionNames.Add( value.string );
+					break;
+				}
+				case Scope::Rule: {
+					// the first field wins, the pattern is the first member named after an operator
+					if ( this->key == L"field" )
+					{
+						if ( !this->ruleField )
+						{
+							this->ruleField = true;
+							this->ruleValid =
+							    value.type == Value::Type::String && ParseRuleField( value.string, this->rule.field );
+						}
+					}
+					else if ( !this->rulePattern && value.type == Value::Type::String &&
+					          ParseRuleOperator( this->key, this->rule.op ) )
+					{
+						this->rule.pattern = value.string;
+						this->rulePattern  = true;
+					}
+					break;
+				}
+				case Scope::Monitor: {
+					if ( this->key == L"device" && value.type == Value::Type::String )
+					{
+						this->monitor.device = value.string;
+						this->monitorDevice  = true;
+					}
+					else if ( this->key == L"alpha" && value.type == Value::Type::Int )
+					{
+						this->monitor.alpha = Clamp( value.integer, 0, 255 );
+					}
+					break;
+				}
+				default:
+					break;
+				}
+
+				return true;
+			}
+
+			void OnRootValue( const Value& value )
+			{
+				auto& settings = this->data;
+				if ( value.type == Value::Type::Int )
+				{
+					if ( this->key == L"version" )
+						this->version = value.integer;
+					else if ( this->key == L"alpha" )
+						settings.alpha = static_cast<uint8_t>( Clamp( value.integer, 0, 255 ) );
+					else if ( this->key == L"fadeDuration" )
+						settings.fadeDuration = static_cast<uint32_t>( Clamp( value.integer, 0, 10000 ) );
+					else if ( this->key == L"spotlightFeather" )
+						settings.spotlightFeather = static_cast<uint32_t>( Clamp( value.integer, 0, 1024 ) );
+				}
+
+				if ( value.IsNumber() )
+				{
+					if ( this->key == L"gradientRadius" )
+						settings.gradient.radius = std::max( 1.0f, static_cast<float>( value.number ) );
+					else if ( this->key == L"gradientInner" )
+						settings.gradient.innerCoverage =
+						    std::max( 0.0f, std::min( 1.0f, static_cast<float>( value.number ) ) );
+				}
+				else if ( value.type == Value::Type::Bool )
+				{
+					if ( this->key == L"enabled" )
+						settings.enabled = value.boolean;
+					else if ( this->key == L"spotlight" )
+						settings.spotlight = value.boolean;
+				}
+				else if ( value.type == Value::Type::String )
+				{
+					if ( this->key == L"fadeEasing" )
+						ParseEasing( value.string, settings.fadeEasing );
+					else if ( this->key == L"gradient" )
+						ParseGradientKind( value.string, settings.gradient.kind );
+				}
+			}
+
+		private:
+			SettingsData&      data;
+			int32_t            version   = 0;
+			std::vector<Scope> scopes;
+			uint32_t           skipDepth = 0;
+			std::wstring       key;
+
+			// the color array being read, either the global one or a monitor's
+			uint8_t rgb[3]  = {};
+			size_t  rgbSize = 0;
+
+			Rule rule        = {};
+			bool ruleField   = false;
+			bool ruleValid   = false;
+			bool rulePattern = false;
+
+			MonitorLevel monitor       = {};
+			bool         monitorDevice = false;
+		};
+	} // namespace
+
+	bool ReadSettings( const char* json, size_t length, SettingsData& data )
+	{
+		// work on a copy so a truncated or unsupported file changes nothing
+		SettingsData    result = data;
+		SettingsHandler handler( result );
+
+		rapidjson::MemoryStream                                  stream( json, length );
+		rapidjson::GenericReader<rapidjson::UTF8<>, WideEncoding> reader;
+		if ( reader.Parse<rapidjson::kParseDefaultFlags>( stream, handler ).IsError() )
+			return false;
+
+		if ( handler.GetVersion() != SettingsData::VERSION )
+			return false;
+
+		data = std::move( result );
+		return true;
+	}
+} // namespace Theater
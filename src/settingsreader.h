@@ -0,0 +1,9 @@
+#pragma once
+
+namespace Theater
+{
+	// Streams settings.json (UTF-8) straight into data, no DOM is built.
+	// Keys missing from the file or holding a value of the wrong type leave data untouched, unknown keys are skipped.
+	// data is only written when the whole file parsed and its version is supported.
+	bool ReadSettings( const char* json, size_t length, SettingsData& data );
+} // namespace Theater
\ No newline at end of file
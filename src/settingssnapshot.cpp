@@ -0,0 +1,335 @@
+#include "theater.h"
+#include "settingssnapshot.h"
+
+namespace Theater
+{
+	namespace
+	{
+		constexpr uint32_t SNAPSHOT_MAGIC   = 0x504E5354; // "TSNP"
+		constexpr uint16_t SNAPSHOT_FORMAT  = 3;
+		constexpr size_t   SNAPSHOT_HEADER  = 40;
+		constexpr size_t   SNAPSHOT_CHECKED = 32; // header bytes before the payload size and checksum
+
+		uint32_t Checksum( const uint8_t* bytes, size_t size )
+		{
+			// FNV-1a
+			uint32_t hash = 2166136261u;
+			for ( size_t i = 0; i < size; i++ )
+			{
+				hash ^= bytes[i];
+				hash *= 16777619u;
+			}
+
+			return hash;
+		}
+
+		class SnapshotWriter
+		{
+		public:
+			explicit SnapshotWriter( std::vector<uint8_t>& bytes ) : bytes( bytes )
+			{
+			}
+
+			void U8( uint8_t value )
+			{
+				this->bytes.emplace_back( value );
+			}
+
+			void U16( uint16_t value )
+			{
+				U8( static_cast<uint8_t>( value ) );
+				U8( static_cast<uint8_t>( value >> 8 ) );
+			}
+
+			void U32( uint32_t value )
+			{
+				U16( static_cast<uint16_t>( value ) );
+				U16( static_cast<uint16_t>( value >> 16 ) );
+			}
+
+			void U64( uint64_t value )
+			{
+				U32( static_cast<uint32_t>( value ) );
+				U32( static_cast<uint32_t>( value >> 32 ) );
+			}
+
+			void F32( float value )
+			{
+				uint32_t bits = 0;
+				memcpy( &bits, &value, sizeof( bits ) );
+				U32( bits );
+			}
+
+			bool String( std::wstring_view value )
+			{
+				U32( static_cast<uint32_t>( value.size() ) );
+				for ( const wchar_t ch : value )
+				{
+					if ( static_cast<uint32_t>( ch ) > 0xFFFF )
+						return false;
+
+					U16( static_cast<uint16_t>( ch ) );
+				}
+
+				return true;
+			}
+
+		private:
+			std::vector<uint8_t>& bytes;
+		};
+
+		// Every read is bounds checked, the first failure sticks and turns all further reads into zeros
+		class SnapshotReader
+		{
+		public:
+			SnapshotReader( const uint8_t* bytes, size_t size ) : bytes( bytes ), size( size )
+			{
+			}
+
+			bool IsValid() const
+			{
+				return this->valid;
+			}
+
+			bool IsAtEnd() const
+			{
+				return this->offset == this->size;
+			}
+
+			uint8_t U8()
+			{
+				if ( !Require( 1 ) )
+					return 0;
+
+				return this->bytes[this->offset++];
+			}
+
+			uint16_t U16()
+			{
+				const uint16_t low = U8();
+				return static_cast<uint16_t>( low | ( U8() << 8 ) );
+			}
+
+			uint32_t U32()
+			{
+				const uint32_t low = U16();
+				return low | ( static_cast<uint32_t>( U16() ) << 16 );
+			}
+
+			uint64_t U64()
+			{
+				const uint64_t low = U32();
+				return low | ( static_cast<uint64_t>( U32() ) << 32 );
+			}
+
+			float F32()
+			{
+				const uint32_t bits  = U32();
+				float          value = 0.0f;
+				memcpy( &value, &bits, sizeof( value ) );
+				return value;
+			}
+
+			bool Bool()
+			{
+				const uint8_t value = U8();
+				if ( value > 1 )
+					this->valid = false;
+
+				return value != 0;
+			}
+
+			// Element count of an array whose elements take at least minSize bytes each
+			uint32_t Count( size_t minSize )
+			{
+				const uint32_t count = U32();
+				if ( !this->valid || count > ( this->size - this->offset ) / minSize )
+				{
+					this->valid = false;
+					return 0;
+				}
+
+				return count;
+			}
+
+			void String( std::wstring& value )
+			{
+				const uint32_t length = Count( 2 );
+				value.resize( length );
+				for ( uint32_t i = 0; i < length; i++ )
+					value[i] = static_cast<wchar_t>( U16() );
+			}
+
+			void Fail()
+			{
+				this->valid = false;
+			}
+
+		private:
+			bool Require( size_t count )
+			{
+				if ( this->valid && count <= this->size - this->offset )
+					return true;
+
+				this->valid = false;
+				return false;
+			}
+
+		private:
+			const uint8_t* bytes;
+			size_t         size;
+			size_t         offset = 0;
+			bool           valid  = true;
+		};
+	} // namespace
+
+	bool WriteSettingsSnapshot( const SettingsData& data, const SettingsSource& source, uint64_t contentHash,
+	                            std::vector<uint8_t>& bytes )
+	{
+		bytes.clear();
+
+		SnapshotWriter writer( bytes );
+		writer.U32( SNAPSHOT_MAGIC );
+		writer.U16( SNAPSHOT_FORMAT );
+		writer.U16( static_cast<uint16_t>( SettingsData::VERSION ) );
+		writer.U64( source.size );
+		writer.U64( source.writeTime );
+		writer.U64( contentHash );
+		writer.U32( 0 ); // payload size, patched below
+		writer.U32( 0 ); // checksum, patched below
+
+		writer.U8( data.enabled ? 1 : 0 );
+		writer.U8( data.alpha );
+		writer.U32( data.color );
+		writer.U32( data.fadeDuration );
+		writer.U8( static_cast<uint8_t>( data.fadeEasing ) );
+		writer.U8( data.spotlight ? 1 : 0 );
+		writer.U32( data.spotlightFeather );
+		writer.U8( static_cast<uint8_t>( data.gradient.kind ) );
+		writer.F32( data.gradient.radius );
+		writer.F32( data.gradient.innerCoverage );
+
+		bool success = true;
+
+		writer.U32( static_cast<uint32_t>( data.processNames.GetCount() ) );
+		for ( const auto name : data.processNames )
+			success = writer.String( name ) && success;
+
+		writer.U32( static_cast<uint32_t>( data.companionNames.GetCount() ) );
+		for ( const auto name : data.companionNames )
+			success = writer.String( name ) && success;
+
+		writer.U32( static_cast<uint32_t>( data.rules.size() ) );
+		for ( const auto& rule : data.rules )
+		{
+			writer.U8( static_cast<uint8_t>( rule.field ) );
+			writer.U8( static_cast<uint8_t>( rule.op ) );
+			success = writer.String( rule.pattern ) && success;
+		}
+
+		writer.U32( static_cast<uint32_t>( data.monitorLevels.size() ) );
+		for ( const auto& level : data.monitorLevels )
+		{
+			success = writer.String( level.device ) && success;
+			writer.U32( static_cast<uint32_t>( level.alpha ) );
+			writer.U64( static_cast<uint64_t>( level.color ) );
+		}
+
+		const size_t   payloadSize = bytes.size() - SNAPSHOT_HEADER;
+		const uint32_t checksum    = Checksum( bytes.data() + SNAPSHOT_HEADER, payloadSize );
+		for ( size_t i = 0; i < 4; i++ )
+		{
+			bytes[SNAPSHOT_CHECKED + i]     = static_cast<uint8_t>( payloadSize >> ( i * 8 ) );
+			bytes[SNAPSHOT_CHECKED + 4 + i] = static_cast<uint8_t>( checksum >> ( i * 8 ) );
+		}
+
+		return success;
+	}
+
+	bool ReadSettingsSnapshot( const uint8_t* bytes, size_t size, const SettingsSource& source, SettingsData& data,
+	                           uint64_t& contentHash )
+	{
+		if ( bytes == nullptr || size < SNAPSHOT_HEADER )
+			return false;
+
+		SnapshotReader header( bytes, SNAPSHOT_HEADER );
+		if ( header.U32() != SNAPSHOT_MAGIC || header.U16() != SNAPSHOT_FORMAT ||
+		     header.U16() != static_cast<uint16_t>( SettingsData::VERSION ) )
+			return false;
+
+		if ( header.U64() != source.size || header.U64() != source.writeTime )
+			return false;
+
+		const uint64_t sourceHash  = header.U64();
+		const uint32_t payloadSize = header.U32();
+		const uint32_t checksum    = header.U32();
+		if ( payloadSize != size - SNAPSHOT_HEADER || Checksum( bytes + SNAPSHOT_HEADER, payloadSize ) != checksum )
+			return false;
+
+		// a valid checksum doesn't make the content sane, every value is range checked anyway
+		SettingsData   result = {};
+		SnapshotReader reader( bytes + SNAPSHOT_HEADER, payloadSize );
+
+		result.enabled                = reader.Bool();
+		result.alpha                  = reader.U8();
+		result.color                  = reader.U32();
+		result.fadeDuration           = std::min( reader.U32(), 10000u );
+		result.fadeEasing             = static_cast<Easing>( reader.U8() );
+		result.spotlight              = reader.Bool();
+		result.spotlightFeather       = std::min( reader.U32(), 1024u );
+		result.gradient.kind          = static_cast<GradientKind>( reader.U8() );
+		result.gradient.radius        = std::max( 1.0f, reader.F32() );
+		result.gradient.innerCoverage = std::max( 0.0f, std::min( 1.0f, reader.F32() ) );
+		if ( result.fadeEasing > Easing::EaseInOut || result.gradient.kind > GradientKind::Linear )
+			reader.Fail();
+
+		// a duplicate can only come from a corrupt snapshot
+		const uint32_t processNameCount = reader.Count( 4 );
+		result.processNames.Reserve( processNameCount, 16 );
+		for ( uint32_t i = 0; i < processNameCount; i++ )
+		{
+			std::wstring name;
+			reader.String( name );
+			if ( !result.processNames.Add( name ) )
+				reader.Fail();
+		}
+
+		const uint32_t companionNameCount = reader.Count( 4 );
+		result.companionNames.Reserve( companionNameCount, 16 );
+		for ( uint32_t i = 0; i < companionNameCount; i++ )
+		{
+			std::wstring name;
+			reader.String( name );
+			if ( !result.companionNames.Add( name ) )
+				reader.Fail();
+		}
+
+		result.rules.resize( reader.Count( 6 ) );
+		for ( auto& rule : result.rules )
+		{
+			rule.field = static_cast<RuleField>( reader.U8() );
+			rule.op    = static_cast<RuleOperator>( reader.U8() );
+			reader.String( rule.pattern );
+			if ( rule.field >= RuleField::Count || rule.op > RuleOperator::Glob )
+				reader.Fail();
+		}
+
+		result.monitorLevels.resize( reader.Count( 16 ) );
+		for ( auto& level : result.monitorLevels )
+		{
+			reader.String( level.device );
+			level.alpha = static_cast<int32_t>( reader.U32() );
+			level.color = static_cast<int64_t>( reader.U64() );
+			if ( level.alpha < MonitorLevel::GLOBAL || level.alpha > 255 || level.color < MonitorLevel::GLOBAL ||
+			     level.color > 0xFFFFFF )
+				reader.Fail();
+		}
+
+		if ( !reader.IsValid() || !reader.IsAtEnd() )
+			return false;
+
+		data        = std::move( result );
+		contentHash = sourceHash;
+		return true;
+	}
+} // namespace Theater
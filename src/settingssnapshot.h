@@ -0,0 +1,22 @@
+#pragma once
+
+namespace Theater
+{
+	// Identifies the settings.json a snapshot was taken from, any difference makes the snapshot stale
+	struct SettingsSource
+	{
+		uint64_t size;
+		uint64_t writeTime;
+	};
+
+	// Compact binary image of SettingsData kept next to settings.json, so startup can skip parsing the JSON.
+	// A fixed header (magic, format and settings version, source, content hash of the source, payload size, FNV-1a
+	// checksum of the payload) is followed by the fields in declaration order, little endian, strings as a length and
+	// UTF-16 code units. Fails when a string holds a code unit wider than 16 bits.
+	bool WriteSettingsSnapshot( const SettingsData& data, const SettingsSource& source, uint64_t contentHash,
+	                            std::vector<uint8_t>& bytes );
+
+	// Fails on a foreign, truncated, corrupt or stale snapshot, data and contentHash are only written on success
+	bool ReadSettingsSnapshot( const uint8_t* bytes, size_t size, const SettingsSource& source, SettingsData& data,
+	                           uint64_t& contentHash );
+} // namespace Theater
\ No newline at end of file
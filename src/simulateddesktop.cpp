@@ -0,0 +1,463 @@
+#include "theater.h"
+#include "simulateddesktop.h"
+
+namespace Theater
+{
+	namespace
+	{
+		size_t CopyString( const std::wstring& source, wchar_t* buffer, size_t size )
+		{
+			if ( buffer == nullptr || size == 0 )
+				return 0;
+
+			// truncated and terminated like GetWindowTextW
+			const size_t length = std::min( source.size(), size - 1 );
+			std::copy( source.begin(), source.begin() + length, buffer );
+			buffer[length] = 0;
+			return length;
+		}
+
+		std::wstring GetProcessName( const std::wstring& path )
+		{
+			const size_t separator = path.find_last_of( L"\\/" );
+			const size_t start     = separator == std::wstring::npos ? 0 : separator + 1;
+			const size_t extension = path.find_last_of( L'.' );
+			const size_t end       = extension == std::wstring::npos || extension < start ? path.size() : extension;
+			return path.substr( start, end - start );
+		}
+	} // namespace
+
+	void SimulatedDesktop::AddMonitor( const std::wstring& device, const PlatformRect& rect )
+	{
+		this->monitors.emplace_back( PlatformMonitor{ device, rect } );
+	}
+
+	void SimulatedDesktop::ClearMonitors()
+	{
+		this->monitors.clear();
+	}
+
+	uint32_t SimulatedDesktop::StartProcess( const std::wstring& path )
+	{
+		// pids are reused on Windows, the creation time tells instances apart
+		const uint32_t pid = this->nextPid;
+		this->nextPid += 4;
+
+		this->processes[pid] = Process{ static_cast<uint64_t>( this->time ) + 1, path, GetProcessName( path ) };
+		return pid;
+	}
+
+	void SimulatedDesktop::EndProcess( uint32_t pid )
+	{
+		std::vector<WindowId> owned;
+		for ( const auto& entry : this->windows )
+		{
+			if ( entry.second.pid == pid )
+				owned.emplace_back( entry.first );
+		}
+
+		// unordered_map order isn't deterministic, the events have to be
+		std::sort( owned.begin(), owned.end() );
+		for ( const auto window : owned )
+			DestroyWindow( window );
+
+		this->processes.erase( pid );
+	}
+
+	void SimulatedDesktop::SetCurrentProcess( uint32_t pid )
+	{
+		this->currentPid = pid;
+	}
+
+	Platform::WindowId SimulatedDesktop::AddWindow( const WindowParams& params )
+	{
+		Window window    = {};
+		window.id        = this->nextWindow;
+		window.pid       = params.pid;
+		window.owner     = params.owner;
+		window.className = params.className;
+		window.title     = params.title;
+		window.rect      = params.rect;
+		window.visible   = params.visible;
+		window.topmost   = params.topmost;
+		window.child     = params.child;
+		window.alpha     = 255;
+		this->nextWindow += 0x10;
+
+		const auto& added = this->windows.emplace( window.id, std::move( window ) ).first->second;
+		if ( !added.child )
+			Raise( added );
+
+		Queue( WindowEventType::Created, added );
+		if ( added.visible )
+			Queue( WindowEventType::Shown, added );
+
+		return added.id;
+	}
+
+	void SimulatedDesktop::DestroyWindow( WindowId window )
+	{
+		const Window* destroyed = Find( window );
+		if ( destroyed == nullptr )
+			return;
+
+		if ( destroyed->visible )
+			Queue( WindowEventType::Hidden, *destroyed );
+		Queue( WindowEventType::Destroyed, *destroyed );
+
+		const size_t index = GetZOrderIndex( window );
+		if ( index != this->zOrder.size() )
+			this->zOrder.erase( this->zOrder.begin() + index );
+
+		if ( this->foreground == window )
+			this->foreground = NO_WINDOW;
+
+		this->windows.erase( window );
+	}
+
+	void SimulatedDesktop::SetForegroundWindow( WindowId window )
+	{
+		const Window* activated = Find( window );
+		if ( activated == nullptr || activated->child )
+			return;
+
+		Raise( *activated );
+		this->foreground = window;
+		Queue( WindowEventType::Foreground, *activated );
+	}
+
+	void SimulatedDesktop::SetWindowCloaked( WindowId window, bool state )
+	{
+		Window* cloaked = Find( window );
+		if ( cloaked == nullptr || cloaked->cloaked == state )
+			return;
+
+		cloaked->cloaked = state;
+		Queue( state ? WindowEventType::Cloaked : WindowEventType::Uncloaked, *cloaked );
+	}
+
+	void SimulatedDesktop::SetWindowTitle( WindowId window, const std::wstring& title )
+	{
+		Window* renamed = Find( window );
+		if ( renamed != nullptr )
+			renamed->title = title;
+	}
+
+	void SimulatedDesktop::SetWindowRect( WindowId window, const PlatformRect& rect )
+	{
+		Window* moved = Find( window );
+		if ( moved == nullptr )
+			return;
+
+		moved->rect = rect;
+		if ( this->locationPid != 0 && moved->pid == this->locationPid )
+			Queue( WindowEventType::LocationChanged, *moved );
+	}
+
+	void SimulatedDesktop::Advance( uint32_t ms )
+	{
+		this->time += ms;
+	}
+
+	uint32_t SimulatedDesktop::GetTime() const
+	{
+		return this->time;
+	}
+
+	size_t SimulatedDesktop::DispatchEvents()
+	{
+		// the callback may change the desktop, whatever it queues waits for the next dispatch
+		std::vector<WindowEvent> dispatched;
+		dispatched.swap( this->events );
+
+		if ( this->hookCallback != nullptr )
+		{
+			for ( const auto& event : dispatched )
+				this->hookCallback( event );
+		}
+
+		return dispatched.size();
+	}
+
+	Platform::WindowId SimulatedDesktop::GetForegroundWindow() const
+	{
+		return this->foreground;
+	}
+
+	const std::vector<Platform::WindowId>& SimulatedDesktop::GetZOrder() const
+	{
+		return this->zOrder;
+	}
+
+	uint8_t SimulatedDesktop::GetWindowAlpha( WindowId window ) const
+	{
+		const Window* layered = Find( window );
+		return layered != nullptr ? layered->alpha : 0;
+	}
+
+	size_t SimulatedDesktop::GetZOrderMoveCount() const
+	{
+		return this->zOrderMoveCount;
+	}
+
+	size_t SimulatedDesktop::GetProcessQueryCount() const
+	{
+		return this->processQueryCount;
+	}
+
+	size_t SimulatedDesktop::GetWindowAlphaCount() const
+	{
+		return this->windowAlphaCount;
+	}
+
+	void SimulatedDesktop::EnumTopLevelWindows( std::vector<WindowId>& result ) const
+	{
+		result.insert( result.end(), this->zOrder.begin(), this->zOrder.end() );
+	}
+
+	bool SimulatedDesktop::IsWindow( WindowId window ) const
+	{
+		return Find( window ) != nullptr;
+	}
+
+	bool SimulatedDesktop::IsTopLevelWindow( WindowId window ) const
+	{
+		const Window* found = Find( window );
+		return found != nullptr && !found->child;
+	}
+
+	bool SimulatedDesktop::IsWindowVisible( WindowId window ) const
+	{
+		const Window* found = Find( window );
+		return found != nullptr && found->visible;
+	}
+
+	bool SimulatedDesktop::IsWindowCloaked( WindowId window ) const
+	{
+		const Window* found = Find( window );
+		return found != nullptr && found->cloaked;
+	}
+
+	bool SimulatedDesktop::IsWindowTopmost( WindowId window ) const
+	{
+		const Window* found = Find( window );
+		return found != nullptr && found->topmost;
+	}
+
+	Platform::WindowId SimulatedDesktop::GetWindowOwner( WindowId window ) const
+	{
+		const Window* found = Find( window );
+		return found != nullptr ? found->owner : NO_WINDOW;
+	}
+
+	bool SimulatedDesktop::GetWindowRect( WindowId window, PlatformRect& rect ) const
+	{
+		const Window* found = Find( window );
+		if ( found == nullptr )
+			return false;
+
+		rect = found->rect;
+		return true;
+	}
+
+	size_t SimulatedDesktop::GetWindowClassName( WindowId window, wchar_t* buffer, size_t size ) const
+	{
+		const Window* found = Find( window );
+		return found != nullptr ? CopyString( found->className, buffer, size ) : 0;
+	}
+
+	size_t SimulatedDesktop::GetWindowTitle( WindowId window, wchar_t* buffer, size_t size ) const
+	{
+		const Window* found = Find( window );
+		return found != nullptr ? CopyString( found->title, buffer, size ) : 0;
+	}
+
+	uint32_t SimulatedDesktop::GetWindowProcessId( WindowId window ) const
+	{
+		const Window* found = Find( window );
+		return found != nullptr ? found->pid : 0;
+	}
+
+	Platform::WindowId SimulatedDesktop::GetTopWindow() const
+	{
+		return this->zOrder.empty() ? NO_WINDOW : this->zOrder.front();
+	}
+
+	Platform::WindowId SimulatedDesktop::GetWindowAbove( WindowId window ) const
+	{
+		const size_t index = GetZOrderIndex( window );
+		return index == 0 || index == this->zOrder.size() ? NO_WINDOW : this->zOrder[index - 1];
+	}
+
+	Platform::WindowId SimulatedDesktop::GetWindowBelow( WindowId window ) const
+	{
+		const size_t index = GetZOrderIndex( window );
+		return index + 1 >= this->zOrder.size() ? NO_WINDOW : this->zOrder[index + 1];
+	}
+
+	bool SimulatedDesktop::MoveWindowsBelow( WindowId insertAfter, const WindowId* moved, size_t count )
+	{
+		// like DeferWindowPos, nothing moves if any window of the batch is gone
+		if ( GetZOrderIndex( insertAfter ) == this->zOrder.size() )
+			return false;
+
+		for ( size_t i = 0; i < count; i++ )
+		{
+			if ( GetZOrderIndex( moved[i] ) == this->zOrder.size() )
+				return false;
+		}
+
+		WindowId previous = insertAfter;
+		for ( size_t i = 0; i < count; i++ )
+		{
+			if ( moved[i] == previous )
+				continue;
+
+			this->zOrder.erase( this->zOrder.begin() + GetZOrderIndex( moved[i] ) );
+			this->zOrder.insert( this->zOrder.begin() + GetZOrderIndex( previous ) + 1, moved[i] );
+			previous = moved[i];
+		}
+
+		this->zOrderMoveCount += count;
+		return true;
+	}
+
+	bool SimulatedDesktop::MoveWindowsToBottom( const WindowId* moved, size_t count )
+	{
+		for ( size_t i = 0; i < count; i++ )
+		{
+			if ( GetZOrderIndex( moved[i] ) == this->zOrder.size() )
+				return false;
+		}
+
+		// a window sent to the bottom loses its topmost state
+		for ( size_t i = 0; i < count; i++ )
+		{
+			this->zOrder.erase( this->zOrder.begin() + GetZOrderIndex( moved[i] ) );
+			this->zOrder.emplace_back( moved[i] );
+			Find( moved[i] )->topmost = false;
+		}
+
+		this->zOrderMoveCount += count;
+		return true;
+	}
+
+	void SimulatedDesktop::ShowWindow( WindowId window, bool state )
+	{
+		Window* shown = Find( window );
+		if ( shown == nullptr || shown->visible == state )
+			return;
+
+		shown->visible = state;
+		Queue( state ? WindowEventType::Shown : WindowEventType::Hidden, *shown );
+	}
+
+	void SimulatedDesktop::SetWindowAlpha( WindowId window, uint8_t alpha )
+	{
+		this->windowAlphaCount++;
+
+		Window* layered = Find( window );
+		if ( layered != nullptr )
+			layered->alpha = alpha;
+	}
+
+	void SimulatedDesktop::EnumMonitors( std::vector<PlatformMonitor>& result ) const
+	{
+		result.insert( result.end(), this->monitors.begin(), this->monitors.end() );
+	}
+
+	bool SimulatedDesktop::QueryProcessId( uint32_t pid, ProcessCache::ProcessId& id ) const
+	{
+		const auto iter = this->processes.find( pid );
+		if ( iter == this->processes.end() )
+			return false;
+
+		id.pid          = pid;
+		id.creationTime = iter->second.creationTime;
+		return true;
+	}
+
+	bool SimulatedDesktop::QueryProcessPath( uint32_t pid, std::wstring& path, std::wstring& name ) const
+	{
+		this->processQueryCount++;
+
+		const auto iter = this->processes.find( pid );
+		if ( iter == this->processes.end() )
+			return false;
+
+		path = iter->second.path;
+		name = iter->second.name;
+		return true;
+	}
+
+	bool SimulatedDesktop::StartEventHooks( WINDOWEVENTCALLBACK callback )
+	{
+		this->hookCallback = callback;
+		return callback != nullptr;
+	}
+
+	void SimulatedDesktop::StopEventHooks()
+	{
+		this->hookCallback = nullptr;
+		this->locationPid  = 0;
+		this->events.clear();
+	}
+
+	bool SimulatedDesktop::StartLocationHook( uint32_t pid )
+	{
+		if ( this->hookCallback == nullptr || pid == 0 )
+			return false;
+
+		this->locationPid = pid;
+		return true;
+	}
+
+	void SimulatedDesktop::StopLocationHook()
+	{
+		this->locationPid = 0;
+	}
+
+	const SimulatedDesktop::Window* SimulatedDesktop::Find( WindowId window ) const
+	{
+		const auto iter = this->windows.find( window );
+		return iter != this->windows.end() ? &iter->second : nullptr;
+	}
+
+	SimulatedDesktop::Window* SimulatedDesktop::Find( WindowId window )
+	{
+		const auto iter = this->windows.find( window );
+		return iter != this->windows.end() ? &iter->second : nullptr;
+	}
+
+	size_t SimulatedDesktop::GetZOrderIndex( WindowId window ) const
+	{
+		return static_cast<size_t>( std::find( this->zOrder.begin(), this->zOrder.end(), window ) -
+		                            this->zOrder.begin() );
+	}
+
+	void SimulatedDesktop::Raise( const Window& window )
+	{
+		const size_t index = GetZOrderIndex( window.id );
+		if ( index != this->zOrder.size() )
+			this->zOrder.erase( this->zOrder.begin() + index );
+
+		// the top of the band, right below the last topmost window for the others
+		auto position = this->zOrder.begin();
+		if ( !window.topmost )
+		{
+			position = std::find_if( this->zOrder.begin(), this->zOrder.end(),
+			                         [this]( WindowId other ) { return !Find( other )->topmost; } );
+		}
+
+		this->zOrder.insert( position, window.id );
+	}
+
+	void SimulatedDesktop::Queue( WindowEventType type, const Window& window )
+	{
+		// hooks only see what happens while they are installed, and skip our own process
+		if ( this->hookCallback == nullptr || window.pid == this->currentPid )
+			return;
+
+		this->events.emplace_back( WindowEvent{ type, this->time, window.id } );
+	}
+} // namespace Theater
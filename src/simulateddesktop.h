@@ -0,0 +1,142 @@
+#pragma once
+
+namespace Theater
+{
+	// Deterministic in-memory desktop to run the theater logic headless, in tests, profiles and benchmarks.
+	// Nothing happens on its own: time only moves through Advance, and hook events are queued as changes are made
+	// and delivered in that order by DispatchEvents. Events of the current process are skipped like the Win32 hooks
+	// do. Single threaded, queries and changes have to come from the same thread.
+	class SimulatedDesktop final : public Platform
+	{
+	public:
+		struct WindowParams
+		{
+			uint32_t     pid   = 0;
+			WindowId     owner = NO_WINDOW;
+			std::wstring className;
+			std::wstring title;
+			PlatformRect rect    = {};
+			bool         visible = true;
+			bool         topmost = false;
+			bool         child   = false;
+		};
+
+		SimulatedDesktop()  = default;
+		~SimulatedDesktop() = default;
+
+		void AddMonitor( const std::wstring& device, const PlatformRect& rect );
+		void ClearMonitors();
+
+		// Returns the pid of the new process, its name is the file name of path without the extension
+		uint32_t StartProcess( const std::wstring& path );
+		void     EndProcess( uint32_t pid );
+		void     SetCurrentProcess( uint32_t pid );
+
+		// New windows go on top of their band, topmost windows stay above the others
+		WindowId AddWindow( const WindowParams& params );
+		void     DestroyWindow( WindowId window );
+		void     SetForegroundWindow( WindowId window );
+		void     SetWindowCloaked( WindowId window, bool state );
+		void     SetWindowTitle( WindowId window, const std::wstring& title );
+		void     SetWindowRect( WindowId window, const PlatformRect& rect );
+
+		void     Advance( uint32_t ms );
+		uint32_t GetTime() const;
+
+		// Delivers the queued events to the hook callback, returns how many were delivered
+		size_t DispatchEvents();
+
+		WindowId                     GetForegroundWindow() const;
+		const std::vector<WindowId>& GetZOrder() const;
+		uint8_t                      GetWindowAlpha( WindowId window ) const;
+
+		// Windows moved through MoveWindowsBelow and MoveWindowsToBottom since the start
+		size_t GetZOrderMoveCount() const;
+
+		// Processes whose path was asked for through QueryProcessPath since the start
+		size_t GetProcessQueryCount() const;
+
+		// SetWindowAlpha calls since the start, whether they changed anything or not
+		size_t GetWindowAlphaCount() const;
+
+		void     EnumTopLevelWindows( std::vector<WindowId>& windows ) const override;
+		bool     IsWindow( WindowId window ) const override;
+		bool     IsTopLevelWindow( WindowId window ) const override;
+		bool     IsWindowVisible( WindowId window ) const override;
+		bool     IsWindowCloaked( WindowId window ) const override;
+		bool     IsWindowTopmost( WindowId window ) const override;
+		WindowId GetWindowOwner( WindowId window ) const override;
+		bool     GetWindowRect( WindowId window, PlatformRect& rect ) const override;
+		size_t   GetWindowClassName( WindowId window, wchar_t* buffer, size_t size ) const override;
+		size_t   GetWindowTitle( WindowId window, wchar_t* buffer, size_t size ) const override;
+		uint32_t GetWindowProcessId( WindowId window ) const override;
+
+		WindowId GetTopWindow() const override;
+		WindowId GetWindowAbove( WindowId window ) const override;
+		WindowId GetWindowBelow( WindowId window ) const override;
+		bool     MoveWindowsBelow( WindowId insertAfter, const WindowId* windows, size_t count ) override;
+		bool     MoveWindowsToBottom( const WindowId* windows, size_t count ) override;
+
+		void ShowWindow( WindowId window, bool state ) override;
+		void SetWindowAlpha( WindowId window, uint8_t alpha ) override;
+
+		void EnumMonitors( std::vector<PlatformMonitor>& monitors ) const override;
+
+		bool QueryProcessId( uint32_t pid, ProcessCache::ProcessId& id ) const override;
+		bool QueryProcessPath( uint32_t pid, std::wstring& path, std::wstring& name ) const override;
+
+		bool StartEventHooks( WINDOWEVENTCALLBACK callback ) override;
+		void StopEventHooks() override;
+		bool StartLocationHook( uint32_t pid ) override;
+		void StopLocationHook() override;
+
+	private:
+		struct Window
+		{
+			WindowId     id;
+			uint32_t     pid;
+			WindowId     owner;
+			std::wstring className;
+			std::wstring title;
+			PlatformRect rect;
+			bool         visible;
+			bool         cloaked;
+			bool         topmost;
+			bool         child;
+			uint8_t      alpha;
+		};
+
+		struct Process
+		{
+			uint64_t     creationTime;
+			std::wstring path;
+			std::wstring name;
+		};
+
+		SimulatedDesktop( const SimulatedDesktop& ) = delete;
+		SimulatedDesktop& operator=( const SimulatedDesktop& ) = delete;
+
+		const Window* Find( WindowId window ) const;
+		Window*       Find( WindowId window );
+		size_t        GetZOrderIndex( WindowId window ) const;
+		void          Raise( const Window& window );
+		void          Queue( WindowEventType type, const Window& window );
+
+	private:
+		std::unordered_map<WindowId, Window>  windows;
+		std::vector<WindowId>                 zOrder;
+		std::vector<PlatformMonitor>          monitors;
+		std::unordered_map<uint32_t, Process> processes;
+		std::vector<WindowEvent>              events;
+		WINDOWEVENTCALLBACK                   hookCallback      = nullptr;
+		uint32_t                              time              = 0;
+		uint32_t                              nextPid           = 1000;
+		WindowId                              nextWindow        = 0x10010;
+		uint32_t                              currentPid        = 0;
+		uint32_t                              locationPid       = 0;
+		WindowId                              foreground        = NO_WINDOW;
+		size_t                                zOrderMoveCount   = 0;
+		mutable size_t                        processQueryCount = 0;
+		size_t                                windowAlphaCount  = 0;
+	};
+} // namespace Theater
\ No newline at end of file
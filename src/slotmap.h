@@ -0,0 +1,164 @@
+#pragma once
+
+namespace Theater
+{
+	// Dense storage addressed through generational handles.
+	// Values are kept contiguous for fast iteration, a removed slot bumps its generation so stale handles never resolve.
+	template<typename T>
+	class SlotMap
+	{
+	public:
+		struct Handle
+		{
+			uint32_t index;
+			uint32_t generation;
+		};
+
+		SlotMap()  = default;
+		~SlotMap() = default;
+
+		Handle   Insert( T value );
+		bool     Remove( Handle handle );
+		T*       Get( Handle handle );
+		const T* Get( Handle handle ) const;
+		void     Clear();
+		void     Reserve( size_t count );
+
+		size_t   GetCount() const;
+		const T* begin() const;
+		const T* end() const;
+
+	private:
+		static constexpr uint32_t INVALID_INDEX = 0xFFFFFFFFu;
+
+		struct Slot
+		{
+			uint32_t generation;
+			uint32_t valueIndex; // next free slot when unused
+		};
+
+	private:
+		std::vector<Slot>     slots;
+		std::vector<T>        values;
+		std::vector<uint32_t> valueSlots;
+		uint32_t              freeHead = INVALID_INDEX;
+	};
+
+	template<typename T>
+	typename SlotMap<T>::Handle SlotMap<T>::Insert( T value )
+	{
+		uint32_t index = this->freeHead;
+		if ( index != INVALID_INDEX )
+		{
+			this->freeHead = this->slots[index].valueIndex;
+		}
+		else
+		{
+			index = static_cast<uint32_t>( this->slots.size() );
+			this->slots.emplace_back( Slot{ 0, INVALID_INDEX } );
+		}
+
+		auto& slot      = this->slots[index];
+		slot.valueIndex = static_cast<uint32_t>( this->values.size() );
+		this->values.emplace_back( std::move( value ) );
+		this->valueSlots.emplace_back( index );
+
+		return Handle{ index, slot.generation };
+	}
+
+	template<typename T>
+	bool SlotMap<T>::Remove( Handle handle )
+	{
+		if ( Get( handle ) == nullptr )
+			return false;
+
+		auto&          slot       = this->slots[handle.index];
+		const uint32_t valueIndex = slot.valueIndex;
+		const uint32_t lastIndex  = static_cast<uint32_t>( this->values.size() - 1 );
+
+		// keep values dense by moving the last one in the hole
+		if ( valueIndex != lastIndex )
+		{
+			this->values[valueIndex]                             = std::move( this->values[lastIndex] );
+			this->valueSlots[valueIndex]                         = this->valueSlots[lastIndex];
+			this->slots[this->valueSlots[valueIndex]].valueIndex = valueIndex;
+		}
+
+		this->values.pop_back();
+		this->valueSlots.pop_back();
+
+		slot.generation++;
+		slot.valueIndex = this->freeHead;
+		this->freeHead  = handle.index;
+		return true;
+	}
+
+	template<typename T>
+	T* SlotMap<T>::Get( Handle handle )
+	{
+		return const_cast<T*>( static_cast<const SlotMap<T>*>( this )->Get( handle ) );
+	}
+
+	template<typename T>
+	const T* SlotMap<T>::Get( Handle handle ) const
+	{
+		if ( handle.index >= this->slots.size() )
+			return nullptr;
+
+		const auto& slot = this->slots[handle.index];
+		if ( slot.generation != handle.generation || slot.valueIndex >= this->values.size() ||
+		     this->valueSlots[slot.valueIndex] != handle.index )
+			return nullptr;
+
+		return &this->values[slot.valueIndex];
+	}
+
+	template<typename T>
+	void SlotMap<T>::Clear()
+	{
+		// keep generations so handles given out before stay invalid
+		this->freeHead = INVALID_INDEX;
+		for ( uint32_t i = 0; i < this->slots.size(); i++ )
+		{
+			auto& slot = this->slots[i];
+			if ( slot.valueIndex != INVALID_INDEX && slot.valueIndex < this->values.size() &&
+			     this->valueSlots[slot.valueIndex] == i )
+				slot.generation++;
+		}
+
+		for ( uint32_t i = static_cast<uint32_t>( this->slots.size() ); i > 0; i-- )
+		{
+			this->slots[i - 1].valueIndex = this->freeHead;
+			this->freeHead                = i - 1;
+		}
+
+		this->values.clear();
+		this->valueSlots.clear();
+	}
+
+	template<typename T>
+	void SlotMap<T>::Reserve( size_t count )
+	{
+		this->slots.reserve( count );
+		this->values.reserve( count );
+		this->valueSlots.reserve( count );
+	}
+
+	template<typename T>
+	size_t SlotMap<T>::GetCount() const
+	{
+		return this->values.size();
+	}
+
+	template<typename T>
+	const T* SlotMap<T>::begin() const
+	{
+		return this->values.data();
+	}
+
+	template<typename T>
+	const T* SlotMap<T>::end() const
+	{
+		return this->values.data() + this->values.size();
+	}
+} // namespace Theater
\ No newline at end of file
@@ -0,0 +1,455 @@
+#include "theater.h"
+#include "soakrun.h"
+#include <rapidjson/rapidjson.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+#include <random>
+
+#if defined( _WIN32 )
+#include <psapi.h>
+#else
+#include <cstdio>
+#include <dirent.h>
+#include <unistd.h>
+#endif
+
+namespace Theater
+{
+	namespace
+	{
+		constexpr uint32_t SOAK_JSON_VERSION = 1;
+		constexpr size_t   MIN_SAMPLES       = 8;
+		constexpr uint32_t MAX_MONITORS      = 4;
+		constexpr int32_t  MONITOR_WIDTH     = 1920;
+		constexpr int32_t  MONITOR_HEIGHT    = 1080;
+
+		// process names repeat so target names toggled by the settings keep matching live processes
+		constexpr uint32_t PROCESS_NAME_COUNT = 64;
+
+		const char* const SOAK_RESOURCE_NAMES[SOAK_RESOURCE_COUNT] = { "windows",        "registryWindows",
+		                                                               "cachedWindows",  "cachedProcesses",
+		                                                               "sessionWindows", "nameSetBytes",
+		                                                               "monitorLevels",  "handles",
+		                                                               "memoryBytes" };
+
+		// below this an increase is noise: allocator pages, a few windows more at the end of the churn
+		const uint64_t SOAK_RESOURCE_SLACK[SOAK_RESOURCE_COUNT] = { 32, 32, 32, 16, 16, 4096, 1, 8, 4 << 20 };
+
+		uint64_t GetHandleCount()
+		{
+#if defined( _WIN32 )
+			DWORD count = 0;
+			::GetProcessHandleCount( ::GetCurrentProcess(), &count );
+			return count;
+#else
+			// open descriptors are the closest there is, the directory's own one is counted in every sample
+			DIR* directory = opendir( "/proc/self/fd" );
+			if ( directory == nullptr )
+				return 0;
+
+			uint64_t count = 0;
+			while ( readdir( directory ) != nullptr )
+				count++;
+
+			closedir( directory );
+			return count;
+#endif
+		}
+
+		uint64_t GetMemoryBytes()
+		{
+#if defined( _WIN32 )
+			PROCESS_MEMORY_COUNTERS_EX counters = {};
+			counters.cb                         = sizeof( counters );
+			auto* basic = reinterpret_cast<PROCESS_MEMORY_COUNTERS*>( &counters );
+			if ( !::GetProcessMemoryInfo( ::GetCurrentProcess(), basic, sizeof( counters ) ) )
+				return 0;
+
+			return counters.PrivateUsage;
+#else
+			// the data segment, heap and anonymous mappings
+			FILE* file = fopen( "/proc/self/statm", "r" );
+			if ( file == nullptr )
+				return 0;
+
+			// size resident shared text library data, in pages
+			unsigned long fields[6] = {};
+			const int     read      = fscanf( file, "%lu %lu %lu %lu %lu %lu", &fields[0], &fields[1], &fields[2],
+			                                  &fields[3], &fields[4], &fields[5] );
+			fclose( file );
+			if ( read != 6 )
+				return 0;
+
+			const unsigned long data = fields[5];
+
+			return static_cast<uint64_t>( data ) * static_cast<uint64_t>( sysconf( _SC_PAGESIZE ) );
+#endif
+		}
+
+		class Soak
+		{
+		public:
+			Soak( const SoakOptions& options, SoakReport& report )
+			    : options( options ), report( report ), random( options.seed )
+			{
+			}
+
+			void Run()
+			{
+				this->self = this->desktop.StartProcess( L"theater" );
+				this->desktop.SetCurrentProcess( this->self );
+				Reconcile( 2 );
+
+				while ( this->windows.size() < this->options.windowCount )
+					AddWindow();
+
+				this->pipeline.Start( &this->desktop );
+				this->pipeline.Configure( this->targetNames, this->companionNames );
+
+				for ( uint64_t i = 0; i < this->options.events; i++ )
+				{
+					Advance( Pick( 1, 40 ) );
+
+					const uint32_t action = Pick( 0, 99 );
+					if ( action < 50 )
+						SwitchForeground();
+					else if ( action < 55 )
+						DragTarget();
+					else if ( action < 80 )
+						Churn();
+					else if ( action < 88 )
+						ToggleVisible();
+					else if ( action < 95 )
+						ToggleCloaked();
+					else if ( action < 98 )
+						ToggleTargetName();
+					else
+						Reconcile( Pick( 1, MAX_MONITORS ) );
+
+					this->pipeline.Dispatch( this->nowMs );
+
+					if ( ( i + 1 ) % this->options.sampleEvery == 0 )
+						Sample( i + 1 );
+				}
+
+				this->pipeline.Stop();
+			}
+
+		private:
+			uint32_t Pick( uint32_t min, uint32_t max )
+			{
+				return std::uniform_int_distribution<uint32_t>( min, max )( this->random );
+			}
+
+			Platform::WindowId PickWindow()
+			{
+				return this->windows[Pick( 0, static_cast<uint32_t>( this->windows.size() - 1 ) )];
+			}
+
+			void Advance( uint32_t ms )
+			{
+				this->desktop.Advance( ms );
+				this->nowMs += ms;
+
+				HeadlessPipeline::Decision decision = {};
+				if ( this->pipeline.Decide( this->nowMs, decision ) )
+					this->pipeline.Arrange( decision );
+
+				uint32_t changes = 0;
+				this->pipeline.Track( this->nowMs, changes );
+			}
+
+			void SwitchForeground()
+			{
+				if ( !this->windows.empty() )
+					this->desktop.SetForegroundWindow( PickWindow() );
+			}
+
+			// the target dragged around at the mouse rate, now and then across a monitor or resized to fill one
+			void DragTarget()
+			{
+				const auto target = this->pipeline.GetTracker().GetWindow();
+				if ( target == Platform::NO_WINDOW )
+					return;
+
+				PlatformRect   rect  = this->pipeline.GetTracker().GetRect();
+				const uint32_t moves = Pick( 1, 64 );
+				for ( uint32_t i = 0; i < moves; i++ )
+				{
+					const int32_t dx = static_cast<int32_t>( Pick( 0, 40 ) ) - 20;
+					const int32_t dy = static_cast<int32_t>( Pick( 0, 40 ) ) - 20;
+					rect             = { rect.left + dx, rect.top + dy, rect.right + dx, rect.bottom + dy };
+					if ( Pick( 0, 99 ) == 0 )
+						rect = { 0, 0, MONITOR_WIDTH, MONITOR_HEIGHT };
+
+					this->desktop.SetWindowRect( target, rect );
+					this->pipeline.Dispatch( this->nowMs );
+					Advance( 1 );
+				}
+			}
+
+			// creating is likelier below the window count and destroying above it, the desktop hovers around it
+			void Churn()
+			{
+				const uint32_t target = this->options.windowCount;
+				if ( this->windows.empty() || Pick( 0, 2 * target ) >= this->windows.size() )
+					AddWindow();
+				else
+					RemoveWindow( Pick( 0, static_cast<uint32_t>( this->windows.size() - 1 ) ) );
+			}
+
+			void AddWindow()
+			{
+				// a third of the windows come with a new process, the others join a running one
+				uint32_t pid = 0;
+				if ( this->processes.empty() || Pick( 0, 2 ) == 0 )
+				{
+					wchar_t path[64];
+					swprintf( path, 64, L"C:\\Apps\\app%u.exe", this->nextProcess++ % PROCESS_NAME_COUNT );
+					pid                  = this->desktop.StartProcess( path );
+					this->processes[pid] = 0;
+					this->processPids.emplace_back( pid );
+				}
+				else
+				{
+					pid = this->processPids[Pick( 0, static_cast<uint32_t>( this->processPids.size() - 1 ) )];
+				}
+
+				const int32_t x = static_cast<int32_t>( Pick( 0, MONITOR_WIDTH ) );
+				const int32_t y = static_cast<int32_t>( Pick( 0, MONITOR_HEIGHT ) );
+
+				SimulatedDesktop::WindowParams params = {};
+				params.pid                            = pid;
+				params.className                      = L"AppWindow";
+				params.rect                           = { x, y, x + 800, y + 600 };
+				params.topmost                        = Pick( 0, 99 ) == 0;
+
+				this->windows.emplace_back( this->desktop.AddWindow( params ) );
+				this->windowPids.emplace_back( pid );
+				this->processes[pid]++;
+			}
+
+			void RemoveWindow( uint32_t index )
+			{
+				this->desktop.DestroyWindow( this->windows[index] );
+
+				// a process goes away with its last window
+				const uint32_t pid = this->windowPids[index];
+				if ( --this->processes[pid] == 0 )
+				{
+					this->desktop.EndProcess( pid );
+					this->processes.erase( pid );
+
+					auto position = std::find( this->processPids.begin(), this->processPids.end(), pid );
+					*position     = this->processPids.back();
+					this->processPids.pop_back();
+				}
+
+				this->windows[index]    = this->windows.back();
+				this->windowPids[index] = this->windowPids.back();
+				this->windows.pop_back();
+				this->windowPids.pop_back();
+			}
+
+			void ToggleVisible()
+			{
+				if ( this->windows.empty() )
+					return;
+
+				const auto window = PickWindow();
+				this->desktop.ShowWindow( window, !this->desktop.IsWindowVisible( window ) );
+			}
+
+			void ToggleCloaked()
+			{
+				if ( this->windows.empty() )
+					return;
+
+				const auto window = PickWindow();
+				this->desktop.SetWindowCloaked( window, !this->desktop.IsWindowCloaked( window ) );
+			}
+
+			// what a settings change does to the logic, a new name set, all decisions invalidated and the session over
+			void ToggleTargetName()
+			{
+				wchar_t name[32];
+				swprintf( name, 32, L"app%u", Pick( 0, PROCESS_NAME_COUNT - 1 ) );
+
+				auto& names = Pick( 0, 3 ) == 0 ? this->companionNames : this->targetNames;
+				if ( !names.Remove( name ) )
+					names.Add( name );
+
+				this->pipeline.Configure( this->targetNames, this->companionNames );
+			}
+
+			// a monitor plugged in or out, the dimmer windows follow like the dimmer's own reconcile
+			void Reconcile( uint32_t monitorCount )
+			{
+				std::vector<MonitorLayout> next;
+				for ( uint32_t i = 0; i < monitorCount; i++ )
+				{
+					wchar_t device[32];
+					swprintf( device, 32, L"\\\\.\\DISPLAY%u", i + 1 );
+
+					const int32_t left = static_cast<int32_t>( i ) * MONITOR_WIDTH;
+					next.emplace_back( MonitorLayout{ device, left, 0, left + MONITOR_WIDTH, MONITOR_HEIGHT } );
+				}
+
+				MonitorTopologyDiff diff;
+				DiffMonitorTopology( this->layouts, next, diff );
+
+				for ( const size_t index : diff.retired )
+					this->desktop.DestroyWindow( this->dimmers[index].window );
+
+				std::vector<ZOrderDimmer> dimmers;
+				std::vector<std::wstring> devices;
+				this->desktop.ClearMonitors();
+				for ( size_t i = 0; i < next.size(); i++ )
+				{
+					const auto&        layout = next[i];
+					const PlatformRect rect   = { layout.left, layout.top, layout.right, layout.bottom };
+					this->desktop.AddMonitor( layout.device, rect );
+					devices.emplace_back( layout.device );
+
+					if ( diff.entries[i].action != MonitorAction::Create )
+					{
+						dimmers.emplace_back( ZOrderDimmer{ this->dimmers[diff.entries[i].source].window, rect } );
+						continue;
+					}
+
+					SimulatedDesktop::WindowParams params = {};
+					params.pid                            = this->self;
+					params.className                      = L"TheaterDimmerWindow";
+					params.rect                           = rect;
+					dimmers.emplace_back( ZOrderDimmer{ this->desktop.AddWindow( params ), rect } );
+				}
+
+				this->layouts = std::move( next );
+				this->dimmers = std::move( dimmers );
+				this->pipeline.SetDimmers( this->dimmers );
+
+				this->levels.Assign( devices.data(), devices.size() );
+				this->levels.Update( this->levelChanges );
+			}
+
+			void Sample( uint64_t events )
+			{
+				std::vector<Platform::WindowId> topLevelWindows;
+				this->desktop.EnumTopLevelWindows( topLevelWindows );
+
+				const size_t nameSetBytes = this->targetNames.GetMemoryUsage() + this->companionNames.GetMemoryUsage();
+
+				SoakSample sample                    = {};
+				sample.events                        = events;
+				sample.values[SOAK_WINDOWS]          = topLevelWindows.size();
+				sample.values[SOAK_REGISTRY_WINDOWS] = this->pipeline.GetRegistry().GetCount();
+				sample.values[SOAK_CACHED_WINDOWS]   = this->pipeline.GetProcessCache().GetWindowCount();
+				sample.values[SOAK_CACHED_PROCESSES] = this->pipeline.GetProcessCache().GetProcessCount();
+				sample.values[SOAK_SESSION_WINDOWS]  = this->pipeline.GetSession().GetWindowCount();
+				sample.values[SOAK_NAME_SET_BYTES]   = nameSetBytes;
+				sample.values[SOAK_MONITOR_LEVELS]   = this->levels.GetCount();
+				sample.values[SOAK_HANDLES]          = GetHandleCount();
+				sample.values[SOAK_MEMORY_BYTES]     = GetMemoryBytes();
+				this->report.samples.emplace_back( sample );
+			}
+
+		private:
+			const SoakOptions& options;
+			SoakReport&        report;
+			std::mt19937       random;
+
+			SimulatedDesktop                   desktop;
+			HeadlessPipeline                   pipeline;
+			ProcessNameSet                     targetNames;
+			ProcessNameSet                     companionNames;
+			MonitorLevels                      levels;
+			std::vector<MonitorLevels::Change> levelChanges;
+			std::vector<MonitorLayout>         layouts;
+			std::vector<ZOrderDimmer>          dimmers;
+			uint64_t                           nowMs       = 0;
+			uint32_t                           self        = 0;
+			uint32_t                           nextProcess = 0;
+
+			// live windows and their process, destroyed ones are swapped with the last
+			std::vector<Platform::WindowId>        windows;
+			std::vector<uint32_t>                  windowPids;
+			std::unordered_map<uint32_t, uint32_t> processes; // pid to its window count
+			std::vector<uint32_t>                  processPids;
+		};
+
+		bool IsGrowing( const std::vector<SoakSample>& samples, SoakResource resource )
+		{
+			const size_t count  = samples.size();
+			uint64_t     second = 0;
+			uint64_t     last   = 0;
+			for ( size_t i = count / 4; i < count / 2; i++ )
+				second = std::max( second, samples[i].values[resource] );
+			for ( size_t i = count - count / 4; i < count; i++ )
+				last = std::max( last, samples[i].values[resource] );
+
+			return last > second + std::max( second / 10, SOAK_RESOURCE_SLACK[resource] );
+		}
+	} // namespace
+
+	const char* GetSoakResourceName( SoakResource resource )
+	{
+		return resource < SOAK_RESOURCE_COUNT ? SOAK_RESOURCE_NAMES[resource] : "";
+	}
+
+	bool RunSoak( const SoakOptions& options, SoakReport& report )
+	{
+		report = SoakReport();
+
+		Soak soak( options, report );
+		soak.Run();
+
+		// too short a run tells nothing about growth
+		if ( report.samples.size() < MIN_SAMPLES )
+			return true;
+
+		for ( size_t resource = 0; resource < SOAK_RESOURCE_COUNT; resource++ )
+		{
+			if ( IsGrowing( report.samples, static_cast<SoakResource>( resource ) ) )
+				report.growing.emplace_back( static_cast<SoakResource>( resource ) );
+		}
+
+		return report.growing.empty();
+	}
+
+	void WriteSoakJson( const SoakReport& report, std::string& json )
+	{
+		rapidjson::StringBuffer                    buffer;
+		rapidjson::Writer<rapidjson::StringBuffer> writer( buffer );
+
+		writer.StartObject();
+		writer.Key( "version" );
+		writer.Uint( SOAK_JSON_VERSION );
+		writer.Key( "passed" );
+		writer.Bool( report.growing.empty() );
+		writer.Key( "growing" );
+		writer.StartArray();
+		for ( const auto resource : report.growing )
+			writer.String( GetSoakResourceName( resource ) );
+		writer.EndArray();
+		writer.Key( "resources" );
+		writer.StartArray();
+		writer.String( "events" );
+		for ( const auto name : SOAK_RESOURCE_NAMES )
+			writer.String( name );
+		writer.EndArray();
+		writer.Key( "samples" );
+		writer.StartArray();
+		for ( const auto& sample : report.samples )
+		{
+			writer.StartArray();
+			writer.Uint64( sample.events );
+			for ( const auto value : sample.values )
+				writer.Uint64( value );
+			writer.EndArray();
+		}
+		writer.EndArray();
+		writer.EndObject();
+
+		json.assign( buffer.GetString(), buffer.GetSize() );
+	}
+} // namespace Theater
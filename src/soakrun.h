@@ -0,0 +1,52 @@
+#pragma once
+
+namespace Theater
+{
+	enum SoakResource : size_t
+	{
+		SOAK_WINDOWS,
+		SOAK_REGISTRY_WINDOWS,
+		SOAK_CACHED_WINDOWS,
+		SOAK_CACHED_PROCESSES,
+		SOAK_SESSION_WINDOWS,
+		SOAK_NAME_SET_BYTES,
+		SOAK_MONITOR_LEVELS,
+		SOAK_HANDLES,
+		SOAK_MEMORY_BYTES,
+		SOAK_RESOURCE_COUNT
+	};
+
+	// Runs the theater logic for a long time against a churning simulated desktop: foreground switches, windows
+	// and processes coming and going, target name changes and monitors being plugged in and out.
+	// Resources are sampled along the way, everything the logic holds should level off once the desktop does.
+	struct SoakOptions
+	{
+		uint64_t events      = 2000000;
+		uint32_t sampleEvery = 20000; // events between two samples
+		uint32_t windowCount = 200;   // the churn keeps the desktop around this many windows
+		uint32_t seed        = 1;
+	};
+
+	struct SoakSample
+	{
+		uint64_t events;
+		uint64_t values[SOAK_RESOURCE_COUNT];
+	};
+
+	struct SoakReport
+	{
+		std::vector<SoakSample> samples;
+
+		// A resource grows when its peak over the last quarter of the run is above its peak over the second
+		// quarter by more than noise, the first quarter is left to warm up
+		std::vector<SoakResource> growing;
+	};
+
+	const char* GetSoakResourceName( SoakResource resource );
+
+	// Returns false when a resource grew
+	bool RunSoak( const SoakOptions& options, SoakReport& report );
+
+	// {"version":1,"passed":true,"growing":[],"resources":["windows",...],"samples":[[events,value,...],...]}
+	void WriteSoakJson( const SoakReport& report, std::string& json );
+} // namespace Theater
\ No newline at end of file
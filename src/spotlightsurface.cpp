@@ -0,0 +1,376 @@
+#include "theater.h"
+#include "spotlightsurface.h"
+
+#if defined( _M_X64 ) || defined( _M_IX86 ) || defined( __SSE2__ )
+#include <emmintrin.h>
+#define THEATER_SPOTLIGHT_SSE2 1
+#endif
+
+namespace Theater
+{
+	namespace
+	{
+		constexpr uint32_t MAX_FEATHER = 1024;
+
+		// stands in for an infinitely sharp edge, anything outside of the hole is at least half a pixel away
+		constexpr float SHARP_EDGE = 1.0e6f;
+
+		// scales a premultiplied pixel, rounds like the gradient kernels so solid pixels match them
+		uint32_t ScalePixel( uint32_t pixel, float coverage )
+		{
+			const uint32_t a = static_cast<uint32_t>( ( pixel >> 24 ) * coverage + 0.5f );
+			const uint32_t r = static_cast<uint32_t>( ( ( pixel >> 16 ) & 0xFF ) * coverage + 0.5f );
+			const uint32_t g = static_cast<uint32_t>( ( ( pixel >> 8 ) & 0xFF ) * coverage + 0.5f );
+			const uint32_t b = static_cast<uint32_t>( ( pixel & 0xFF ) * coverage + 0.5f );
+			return ( a << 24 ) | ( r << 16 ) | ( g << 8 ) | b;
+		}
+
+		float DistanceToSpan( float c, float low, float high )
+		{
+			return std::max( std::max( low - c, 0.0f ), c - high );
+		}
+	} // namespace
+
+	void SpotlightSurface::Resize( uint32_t newWidth, uint32_t newHeight )
+	{
+		if ( this->width == newWidth && this->height == newHeight )
+			return;
+
+		this->width  = newWidth;
+		this->height = newHeight;
+		MarkAllDirty();
+	}
+
+	void SpotlightSurface::SetColor( uint8_t r, uint8_t g, uint8_t b )
+	{
+		const uint32_t newColor = 0xFF000000u | ( static_cast<uint32_t>( r ) << 16 ) |
+		                          ( static_cast<uint32_t>( g ) << 8 ) | static_cast<uint32_t>( b );
+		if ( this->color == newColor )
+			return;
+
+		this->color = newColor;
+		MarkAllDirty();
+	}
+
+	void SpotlightSurface::SetGradient( const GradientParams& params )
+	{
+		if ( params.kind == this->gradient.kind && params.radius == this->gradient.radius &&
+		     params.innerCoverage == this->gradient.innerCoverage )
+			return;
+
+		this->gradient = params;
+		MarkAllDirty();
+	}
+
+	void SpotlightSurface::SetTarget( const Rect& newTarget )
+	{
+		const Rect validTarget = newTarget.IsEmpty() ? Rect{} : newTarget;
+		if ( validTarget == this->target )
+			return;
+
+		if ( HasGradient() )
+		{
+			// the whole image is relative to the target, if it only moved so does the image
+			const bool translated = !validTarget.IsEmpty() && !this->target.IsEmpty() &&
+			                        validTarget.right - validTarget.left == this->target.right - this->target.left &&
+			                        validTarget.bottom - validTarget.top == this->target.bottom - this->target.top;
+			const bool upToDate = this->shiftPending || this->dirtyTop == this->dirtyBottom;
+
+			const int32_t dx = validTarget.left - this->target.left;
+			const int32_t dy = validTarget.top - this->target.top;
+			this->target     = validTarget;
+
+			if ( !translated || !upToDate )
+			{
+				MarkAllDirty();
+				return;
+			}
+
+			this->shiftPending = true;
+			this->shiftX += dx;
+			this->shiftY += dy;
+			if ( std::abs( this->shiftX ) >= static_cast<int32_t>( this->width ) ||
+			     std::abs( this->shiftY ) >= static_cast<int32_t>( this->height ) )
+			{
+				MarkAllDirty();
+				return;
+			}
+
+			MarkDirty( 0, static_cast<int32_t>( this->height ) );
+			return;
+		}
+
+		// flat color, only the rows around where the hole was and where it goes change
+		MarkHoleDirty();
+		this->target = validTarget;
+		MarkHoleDirty();
+	}
+
+	void SpotlightSurface::SetHole( bool state, uint32_t newFeather )
+	{
+		newFeather = std::min( newFeather, MAX_FEATHER );
+		if ( state == this->holeEnabled && newFeather == this->feather )
+			return;
+
+		MarkHoleDirty();
+		this->holeEnabled = state;
+		this->feather     = newFeather;
+		MarkHoleDirty();
+	}
+
+	void SpotlightSurface::SetSimdLevel( SimdLevel level )
+	{
+		if ( level == this->simdLevel )
+			return;
+
+		this->simdLevel = level;
+		MarkAllDirty();
+	}
+
+	uint32_t SpotlightSurface::GetWidth() const
+	{
+		return this->width;
+	}
+
+	uint32_t SpotlightSurface::GetHeight() const
+	{
+		return this->height;
+	}
+
+	bool SpotlightSurface::GetDirtyRows( uint32_t& firstRow, uint32_t& rowCount ) const
+	{
+		firstRow = this->dirtyTop;
+		rowCount = this->dirtyBottom - this->dirtyTop;
+		return rowCount > 0;
+	}
+
+	bool SpotlightSurface::HasHole() const
+	{
+		return this->holeEnabled && !this->target.IsEmpty();
+	}
+
+	bool SpotlightSurface::HasGradient() const
+	{
+		return this->gradient.kind != GradientKind::None;
+	}
+
+	void SpotlightSurface::MarkDirty( int32_t top, int32_t bottom )
+	{
+		const uint32_t clampedTop    = static_cast<uint32_t>( std::max( top, 0 ) );
+		const uint32_t clampedBottom = std::min( static_cast<uint32_t>( std::max( bottom, 0 ) ), this->height );
+		if ( clampedTop >= clampedBottom )
+			return;
+
+		if ( this->dirtyTop == this->dirtyBottom )
+		{
+			this->dirtyTop    = clampedTop;
+			this->dirtyBottom = clampedBottom;
+			return;
+		}
+
+		this->dirtyTop    = std::min( this->dirtyTop, clampedTop );
+		this->dirtyBottom = std::max( this->dirtyBottom, clampedBottom );
+	}
+
+	void SpotlightSurface::MarkAllDirty()
+	{
+		this->shiftPending = false;
+		this->shiftX       = 0;
+		this->shiftY       = 0;
+		MarkDirty( 0, static_cast<int32_t>( this->height ) );
+	}
+
+	void SpotlightSurface::MarkHoleDirty()
+	{
+		if ( !HasHole() )
+			return;
+
+		// the buffer doesn't match the target position yet, partial updates can't be placed
+		if ( this->shiftPending )
+		{
+			MarkAllDirty();
+			return;
+		}
+
+		const int32_t feather32 = static_cast<int32_t>( this->feather );
+		MarkDirty( this->target.top - feather32, this->target.bottom + feather32 );
+	}
+
+	void SpotlightSurface::Shift( uint32_t* pixels, size_t stride ) const
+	{
+		const int32_t width32  = static_cast<int32_t>( this->width );
+		const int32_t height32 = static_cast<int32_t>( this->height );
+		const size_t  count    = static_cast<size_t>( width32 - std::abs( this->shiftX ) );
+		const int32_t dstX     = std::max( this->shiftX, 0 );
+		const int32_t srcX     = std::max( -this->shiftX, 0 );
+
+		// walk against the shift so rows are read before being overwritten
+		const int32_t first = this->shiftY > 0 ? height32 - 1 : 0;
+		const int32_t last  = this->shiftY > 0 ? this->shiftY - 1 : height32 + this->shiftY;
+		const int32_t step  = this->shiftY > 0 ? -1 : 1;
+		for ( int32_t y = first; y != last; y += step )
+		{
+			const uint32_t* src = pixels + ( y - this->shiftY ) * stride + srcX;
+			uint32_t*       dst = pixels + y * stride + dstX;
+			std::memmove( dst, src, count * sizeof( uint32_t ) );
+		}
+	}
+
+	void SpotlightSurface::Render( uint32_t* pixels, size_t stride )
+	{
+		if ( this->dirtyTop == this->dirtyBottom )
+			return;
+
+		if ( this->shiftPending )
+		{
+			Shift( pixels, stride );
+
+			// only what scrolled in needs rendering
+			const int32_t width32     = static_cast<int32_t>( this->width );
+			const int32_t height32    = static_cast<int32_t>( this->height );
+			const int32_t rowsBegin   = this->shiftY > 0 ? 0 : height32 + this->shiftY;
+			const int32_t rowsEnd     = this->shiftY > 0 ? this->shiftY : height32;
+			const int32_t columnBegin = this->shiftX > 0 ? 0 : width32 + this->shiftX;
+			const int32_t columnEnd   = this->shiftX > 0 ? this->shiftX : width32;
+			for ( int32_t y = 0; y < height32; y++ )
+			{
+				if ( y >= rowsBegin && y < rowsEnd )
+					RenderSpan( pixels, stride, y, 0, width32 );
+				else if ( this->shiftX != 0 )
+					RenderSpan( pixels, stride, y, columnBegin, columnEnd );
+			}
+		}
+		else
+		{
+			for ( uint32_t y = this->dirtyTop; y < this->dirtyBottom; y++ )
+				RenderSpan( pixels, stride, y, 0, static_cast<int32_t>( this->width ) );
+		}
+
+		this->dirtyTop     = 0;
+		this->dirtyBottom  = 0;
+		this->shiftPending = false;
+		this->shiftX       = 0;
+		this->shiftY       = 0;
+	}
+
+	void SpotlightSurface::RenderSpan( uint32_t* pixels, size_t stride, uint32_t y, int32_t left, int32_t right ) const
+	{
+		uint32_t* row = pixels + y * stride;
+
+		const Rect& hole = this->target;
+		if ( HasGradient() )
+		{
+			const float centerX = hole.IsEmpty() ? this->width * 0.5f : ( hole.left + hole.right ) * 0.5f;
+			const float centerY = hole.IsEmpty() ? this->height * 0.5f : ( hole.top + hole.bottom ) * 0.5f;
+			RenderGradientSpan( this->simdLevel, row + left, right - left, left + 0.5f - centerX, y + 0.5f - centerY,
+			                    this->gradient, this->color );
+		}
+		else
+		{
+			FillRow( this->simdLevel, row + left, right - left, this->color );
+		}
+
+		if ( !HasHole() )
+			return;
+
+		const float invFeather = this->feather > 0 ? 1.0f / this->feather : SHARP_EDGE;
+		const float dy = DistanceToSpan( y + 0.5f, static_cast<float>( hole.top ), static_cast<float>( hole.bottom ) );
+		if ( dy * invFeather >= 1.0f )
+			return;
+
+		// the soft edge only spans part of the row
+		const int32_t feather32 = static_cast<int32_t>( this->feather );
+		const int32_t bandLeft  = std::min( std::max( hole.left - feather32, left ), right );
+		const int32_t bandRight = std::min( std::max( hole.right + feather32, bandLeft ), right );
+		if ( dy > 0.0f )
+		{
+			CutRow( this->simdLevel, row + bandLeft, bandRight - bandLeft, static_cast<float>( bandLeft ), dy, hole,
+			        invFeather );
+			return;
+		}
+
+		// rows across the hole are fully transparent in between the two edges
+		const int32_t holeLeft  = std::min( std::max( hole.left, bandLeft ), bandRight );
+		const int32_t holeRight = std::min( std::max( hole.right, holeLeft ), bandRight );
+		CutRow( this->simdLevel, row + bandLeft, holeLeft - bandLeft, static_cast<float>( bandLeft ), dy, hole,
+		        invFeather );
+		FillRow( this->simdLevel, row + holeLeft, holeRight - holeLeft, 0 );
+		CutRow( this->simdLevel, row + holeRight, bandRight - holeRight, static_cast<float>( holeRight ), dy, hole,
+		        invFeather );
+	}
+
+	void SpotlightSurface::FillRow( SimdLevel level, uint32_t* row, size_t count, uint32_t pixel )
+	{
+		size_t i = 0;
+#if THEATER_SPOTLIGHT_SSE2
+		const __m128i pixels = _mm_set1_epi32( static_cast<int>( pixel ) );
+		for ( ; level != SimdLevel::Scalar && i + 16 <= count; i += 16 )
+		{
+			_mm_storeu_si128( reinterpret_cast<__m128i*>( row + i ), pixels );
+			_mm_storeu_si128( reinterpret_cast<__m128i*>( row + i + 4 ), pixels );
+			_mm_storeu_si128( reinterpret_cast<__m128i*>( row + i + 8 ), pixels );
+			_mm_storeu_si128( reinterpret_cast<__m128i*>( row + i + 12 ), pixels );
+		}
+		for ( ; level != SimdLevel::Scalar && i + 4 <= count; i += 4 )
+			_mm_storeu_si128( reinterpret_cast<__m128i*>( row + i ), pixels );
+#else
+		static_cast<void>( level );
+#endif
+		for ( ; i < count; i++ )
+			row[i] = pixel;
+	}
+
+	void SpotlightSurface::CutRow( SimdLevel level, uint32_t* row, size_t count, float x, float dy, const Rect& hole,
+	                               float invFeather )
+	{
+		const float left  = static_cast<float>( hole.left );
+		const float right = static_cast<float>( hole.right );
+
+		size_t i = 0;
+#if THEATER_SPOTLIGHT_SSE2
+		const __m128  leftV  = _mm_set1_ps( left );
+		const __m128  rightV = _mm_set1_ps( right );
+		const __m128  dy2    = _mm_set1_ps( dy * dy );
+		const __m128  invV   = _mm_set1_ps( invFeather );
+		const __m128  zero   = _mm_setzero_ps();
+		const __m128  one    = _mm_set1_ps( 1.0f );
+		const __m128  half   = _mm_set1_ps( 0.5f );
+		const __m128  step   = _mm_set1_ps( 4.0f );
+		const __m128i mask   = _mm_set1_epi32( 0xFF );
+
+		__m128 xs = _mm_setr_ps( x + 0.5f, x + 1.5f, x + 2.5f, x + 3.5f );
+		for ( ; level != SimdLevel::Scalar && i + 4 <= count; i += 4 )
+		{
+			const __m128 dx = _mm_max_ps( _mm_max_ps( _mm_sub_ps( leftV, xs ), zero ), _mm_sub_ps( xs, rightV ) );
+			const __m128 d  = _mm_sqrt_ps( _mm_add_ps( _mm_mul_ps( dx, dx ), dy2 ) );
+			const __m128 c  = _mm_min_ps( _mm_mul_ps( d, invV ), one );
+
+			// same rounding as ScalePixel
+			const __m128i pixels = _mm_loadu_si128( reinterpret_cast<const __m128i*>( row + i ) );
+			const __m128  a      = _mm_cvtepi32_ps( _mm_srli_epi32( pixels, 24 ) );
+			const __m128  r      = _mm_cvtepi32_ps( _mm_and_si128( _mm_srli_epi32( pixels, 16 ), mask ) );
+			const __m128  g      = _mm_cvtepi32_ps( _mm_and_si128( _mm_srli_epi32( pixels, 8 ), mask ) );
+			const __m128  b      = _mm_cvtepi32_ps( _mm_and_si128( pixels, mask ) );
+
+			const __m128i ai = _mm_cvttps_epi32( _mm_add_ps( _mm_mul_ps( a, c ), half ) );
+			const __m128i ri = _mm_cvttps_epi32( _mm_add_ps( _mm_mul_ps( r, c ), half ) );
+			const __m128i gi = _mm_cvttps_epi32( _mm_add_ps( _mm_mul_ps( g, c ), half ) );
+			const __m128i bi = _mm_cvttps_epi32( _mm_add_ps( _mm_mul_ps( b, c ), half ) );
+
+			const __m128i scaled = _mm_or_si128( _mm_or_si128( _mm_slli_epi32( ai, 24 ), _mm_slli_epi32( ri, 16 ) ),
+			                                     _mm_or_si128( _mm_slli_epi32( gi, 8 ), bi ) );
+			_mm_storeu_si128( reinterpret_cast<__m128i*>( row + i ), scaled );
+
+			xs = _mm_add_ps( xs, step );
+		}
+#else
+		static_cast<void>( level );
+#endif
+		for ( ; i < count; i++ )
+		{
+			const float dx = DistanceToSpan( x + i + 0.5f, left, right );
+			const float d  = std::sqrt( dx * dx + dy * dy );
+			row[i]         = ScalePixel( row[i], std::min( d * invFeather, 1.0f ) );
+		}
+	}
+} // namespace Theater
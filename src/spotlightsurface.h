@@ -0,0 +1,86 @@
+#pragma once
+
+namespace Theater
+{
+	// Premultiplied 32 bit BGRA image covering one monitor: the dimmer color, flat or as a gradient centered on the
+	// target, optionally with a transparent hole over the target and a soft edge of feather pixels around it.
+	// The pixels live in memory owned by the caller (a DIB section) and are only re-rendered where a change touched
+	// them, the global fade alpha is applied at composition time and never causes a re-render.
+	class SpotlightSurface
+	{
+	public:
+		struct Rect
+		{
+			int32_t left;
+			int32_t top;
+			int32_t right;
+			int32_t bottom;
+
+			bool IsEmpty() const
+			{
+				return this->right <= this->left || this->bottom <= this->top;
+			}
+
+			bool operator==( const Rect& other ) const
+			{
+				return this->left == other.left && this->top == other.top && this->right == other.right &&
+				       this->bottom == other.bottom;
+			}
+		};
+
+		SpotlightSurface()  = default;
+		~SpotlightSurface() = default;
+
+		void Resize( uint32_t width, uint32_t height );
+		void SetColor( uint8_t r, uint8_t g, uint8_t b );
+		void SetGradient( const GradientParams& params );
+
+		// Target in surface coordinates, it can lie outside of the surface. An empty rect means no target,
+		// the gradient is then centered on the surface.
+		void SetTarget( const Rect& target );
+		void SetHole( bool state, uint32_t feather );
+
+		// Kernels Render uses, GetSimdLevel by default. Lower levels give identical results and are only slower.
+		void SetSimdLevel( SimdLevel level );
+
+		uint32_t GetWidth() const;
+		uint32_t GetHeight() const;
+
+		// Rows re-rendered by the next Render call, false when the surface is up to date
+		bool GetDirtyRows( uint32_t& firstRow, uint32_t& rowCount ) const;
+
+		// Renders the dirty rows into pixels, stride is in pixels.
+		// pixels must hold the previous render, when only the target moved its content is shifted instead.
+		void Render( uint32_t* pixels, size_t stride );
+
+		static void FillRow( SimdLevel level, uint32_t* row, size_t count, uint32_t pixel );
+		static void CutRow( SimdLevel level, uint32_t* row, size_t count, float x, float dy, const Rect& hole,
+		                    float invFeather );
+
+	private:
+		bool HasHole() const;
+		bool HasGradient() const;
+		void MarkDirty( int32_t top, int32_t bottom );
+		void MarkAllDirty();
+		void MarkHoleDirty();
+		void Shift( uint32_t* pixels, size_t stride ) const;
+		void RenderSpan( uint32_t* pixels, size_t stride, uint32_t y, int32_t left, int32_t right ) const;
+
+	private:
+		uint32_t       width       = 0;
+		uint32_t       height      = 0;
+		uint32_t       color       = 0xFF000000u;
+		GradientParams gradient    = { GradientKind::None, 0.0f, 0.0f };
+		Rect           target      = {};
+		bool           holeEnabled = false;
+		uint32_t       feather     = 0;
+		uint32_t       dirtyTop    = 0;
+		uint32_t       dirtyBottom = 0;
+		SimdLevel      simdLevel   = GetSimdLevel();
+
+		// pending translation of the whole image, only valid while everything else is up to date
+		bool    shiftPending = false;
+		int32_t shiftX       = 0;
+		int32_t shiftY       = 0;
+	};
+} // namespace Theater
\ No newline at end of file
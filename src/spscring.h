@@ -0,0 +1,86 @@
+#pragma once
+
+namespace Theater
+{
+	// Bounded lock-free ring for exactly one producer thread and one consumer thread.
+	// Indices run freely and are masked on access, each side caches the other side's index so the shared
+	// cache lines are only touched when the ring looks full or empty.
+	template<typename T, size_t Capacity>
+	class SpscRing
+	{
+		static_assert( Capacity >= 2 && ( Capacity & ( Capacity - 1 ) ) == 0, "Capacity must be a power of two" );
+
+	public:
+		SpscRing()  = default;
+		~SpscRing() = default;
+
+		// producer only, fails when the ring is full
+		bool Push( const T& value );
+
+		// consumer only, fails when the ring is empty
+		bool Pop( T& value );
+
+		bool   IsEmpty() const;
+		size_t GetCapacity() const;
+
+	private:
+		SpscRing( const SpscRing& ) = delete;
+		SpscRing& operator=( const SpscRing& ) = delete;
+
+	private:
+		static constexpr size_t CACHE_LINE_SIZE = 64;
+		static constexpr size_t MASK            = Capacity - 1;
+
+		alignas( CACHE_LINE_SIZE ) std::atomic<size_t> head{ 0 };
+		size_t cachedTail = 0;
+
+		alignas( CACHE_LINE_SIZE ) std::atomic<size_t> tail{ 0 };
+		size_t cachedHead = 0;
+
+		alignas( CACHE_LINE_SIZE ) T values[Capacity] = {};
+	};
+
+	template<typename T, size_t Capacity>
+	bool SpscRing<T, Capacity>::Push( const T& value )
+	{
+		const size_t currentTail = this->tail.load( std::memory_order_relaxed );
+		if ( currentTail - this->cachedHead == Capacity )
+		{
+			this->cachedHead = this->head.load( std::memory_order_acquire );
+			if ( currentTail - this->cachedHead == Capacity )
+				return false;
+		}
+
+		this->values[currentTail & MASK] = value;
+		this->tail.store( currentTail + 1, std::memory_order_release );
+		return true;
+	}
+
+	template<typename T, size_t Capacity>
+	bool SpscRing<T, Capacity>::Pop( T& value )
+	{
+		const size_t currentHead = this->head.load( std::memory_order_relaxed );
+		if ( currentHead == this->cachedTail )
+		{
+			this->cachedTail = this->tail.load( std::memory_order_acquire );
+			if ( currentHead == this->cachedTail )
+				return false;
+		}
+
+		value = this->values[currentHead & MASK];
+		this->head.store( currentHead + 1, std::memory_order_release );
+		return true;
+	}
+
+	template<typename T, size_t Capacity>
+	bool SpscRing<T, Capacity>::IsEmpty() const
+	{
+		return this->head.load( std::memory_order_acquire ) == this->tail.load( std::memory_order_acquire );
+	}
+
+	template<typename T, size_t Capacity>
+	size_t SpscRing<T, Capacity>::GetCapacity() const
+	{
+		return Capacity;
+	}
+} // namespace Theater
\ No newline at end of file
@@ -0,0 +1,194 @@
+#include "theater.h"
+#include "targetresolver.h"
+
+namespace Theater
+{
+	void TargetResolver::SetPlatform( const Platform* targetPlatform )
+	{
+		this->platform = targetPlatform;
+		this->processCache.Clear();
+		this->companionProcesses.clear();
+	}
+
+	void TargetResolver::Configure( const ProcessNameSet& processNames, const std::vector<Rule>& rules )
+	{
+		this->processNameMatcher.Build( processNames.begin(), processNames.end() );
+		this->ruleEngine.Compile( rules );
+		this->processCache.InvalidateDecisions();
+	}
+
+	void TargetResolver::ConfigureCompanions( const ProcessNameSet& companionNames )
+	{
+		this->companionNameMatcher.Build( companionNames.begin(), companionNames.end() );
+
+		this->companionProcesses.clear();
+		this->processCache.ForEachProcess(
+		    [this]( const ProcessCache::ProcessId& processId, const ProcessCache::Process& process ) {
+			    if ( this->companionNameMatcher.Contains( process.name ) )
+				    this->companionProcesses.emplace_back( processId );
+		    } );
+	}
+
+	bool TargetResolver::IsTargetWindow( WindowId window, const ProcessCache::Process& process ) const
+	{
+		TraceScope trace( "match", window );
+
+		if ( this->processNameMatcher.Contains( process.name ) )
+			return true;
+
+		if ( this->ruleEngine.IsEmpty() )
+			return false;
+
+		RuleEngine::Input input = {};
+		input.name              = process.name;
+		input.path              = process.path;
+
+		wchar_t windowClass[256];
+		if ( this->ruleEngine.UsesField( RuleField::Class ) )
+		{
+			const size_t length = this->platform->GetWindowClassName( window, windowClass, 256 );
+			input.windowClass   = std::wstring_view( windowClass, length );
+		}
+
+		wchar_t title[256];
+		if ( this->ruleEngine.UsesField( RuleField::Title ) )
+		{
+			const size_t length = this->platform->GetWindowTitle( window, title, 256 );
+			input.title         = std::wstring_view( title, length );
+		}
+
+		return this->ruleEngine.Match( input );
+	}
+
+	bool TargetResolver::IsCompanionProcess( const ProcessCache::ProcessId& processId ) const
+	{
+		if ( this->companionNameMatcher.GetCount() == 0 )
+			return false;
+
+		const auto process = this->processCache.LookupProcess( processId );
+		return process != nullptr && this->companionNameMatcher.Contains( process->name );
+	}
+
+	void TargetResolver::AddCompanionProcess( const ProcessCache::ProcessId& process )
+	{
+		// a process evicted with its last window and cached again might still be listed
+		const auto iter = std::find( this->companionProcesses.cbegin(), this->companionProcesses.cend(), process );
+		if ( iter == this->companionProcesses.cend() )
+			this->companionProcesses.emplace_back( process );
+	}
+
+	bool TargetResolver::Resolve( WindowId window, bool& isTarget )
+	{
+		Resolution resolution = {};
+		if ( !Resolve( window, resolution ) )
+			return false;
+
+		isTarget = resolution.isTarget;
+		return true;
+	}
+
+	bool TargetResolver::Resolve( WindowId window, Resolution& resolution )
+	{
+		if ( this->platform == nullptr )
+			return false;
+
+		TraceScope trace( "resolve", window );
+
+		const uint32_t pid = this->platform->GetWindowProcessId( window );
+		if ( pid == 0 )
+			return false;
+
+		// fast path, a live window can't outlive its process so its pid can't have been recycled
+		// titles change over time though, decisions involving them can't be cached
+		const auto cachedWindow = this->processCache.LookupWindow( window, pid );
+		if ( cachedWindow != nullptr )
+		{
+			const bool cacheable = !this->ruleEngine.UsesField( RuleField::Title );
+			if ( cacheable && this->processCache.IsDecisionValid( *cachedWindow ) )
+			{
+				resolution.process     = cachedWindow->process;
+				resolution.isTarget    = cachedWindow->isTarget;
+				resolution.isCompanion = IsCompanionProcess( cachedWindow->process );
+				return true;
+			}
+
+			const auto cachedProcess = this->processCache.LookupProcess( cachedWindow->process );
+			if ( cachedProcess != nullptr )
+			{
+				resolution.process     = cachedWindow->process;
+				resolution.isTarget    = IsTargetWindow( window, *cachedProcess );
+				resolution.isCompanion = IsCompanionProcess( cachedWindow->process );
+				this->processCache.UpdateDecision( window, resolution.isTarget );
+				return true;
+			}
+		}
+
+		ProcessCache::ProcessId processId = {};
+		if ( !this->platform->QueryProcessId( pid, processId ) )
+			return false;
+
+		// another window of the same process instance might already be known
+		const ProcessCache::Process* process = this->processCache.LookupProcess( processId );
+		if ( process == nullptr )
+		{
+			TraceScope queryTrace( "query-process", pid );
+
+			std::wstring path;
+			std::wstring name;
+			if ( !this->platform->QueryProcessPath( pid, path, name ) )
+				return false;
+
+			this->processCache.InsertProcess( processId, std::move( path ), std::move( name ) );
+			process = this->processCache.LookupProcess( processId );
+			if ( this->companionNameMatcher.Contains( process->name ) )
+				AddCompanionProcess( processId );
+		}
+
+		resolution.process     = processId;
+		resolution.isTarget    = IsTargetWindow( window, *process );
+		resolution.isCompanion = IsCompanionProcess( processId );
+		this->processCache.InsertWindow( window, processId, resolution.isTarget );
+		return true;
+	}
+
+	void TargetResolver::RemoveWindow( WindowId window )
+	{
+		this->processCache.RemoveWindow( window );
+	}
+
+	void TargetResolver::Clear()
+	{
+		this->processCache.Clear();
+		this->companionProcesses.clear();
+	}
+
+	void TargetResolver::GetWindowsWithCompanions( const ProcessCache::ProcessId& process,
+	                                               std::vector<WindowId>& windows )
+	{
+		windows.clear();
+
+		const auto entry = this->processCache.LookupProcess( process );
+		if ( entry != nullptr )
+			windows.insert( windows.end(), entry->windows.cbegin(), entry->windows.cend() );
+
+		// evicted companions are dropped on the way
+		for ( auto iter = this->companionProcesses.begin(); iter != this->companionProcesses.end(); )
+		{
+			const auto companion = this->processCache.LookupProcess( *iter );
+			if ( companion == nullptr )
+			{
+				iter = this->companionProcesses.erase( iter );
+				continue;
+			}
+
+			if ( !( *iter == process ) )
+				windows.insert( windows.end(), companion->windows.cbegin(), companion->windows.cend() );
+			++iter;
+		}
+	}
+
+	const ProcessCache& TargetResolver::GetProcessCache() const
+	{
+		return this->processCache;
+	}
+} // namespace Theater
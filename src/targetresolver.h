@@ -0,0 +1,54 @@
+#pragma once
+
+namespace Theater
+{
+	// Decides whether a window belongs to the theater target, from its process name, path, class and title.
+	// Process instances and decisions are cached per window, the platform is only asked for what isn't known yet.
+	// Not thread safe, the caller serializes Configure and Resolve.
+	class TargetResolver
+	{
+	public:
+		typedef Platform::WindowId WindowId;
+
+		struct Resolution
+		{
+			ProcessCache::ProcessId process;
+			bool                    isTarget;
+			bool                    isCompanion; // the process is a companion, whether the window is a target or not
+		};
+
+		TargetResolver()  = default;
+		~TargetResolver() = default;
+
+		void SetPlatform( const Platform* platform );
+
+		// Rebuilds the matchers, cached decisions are dropped but the processes stay known
+		void Configure( const ProcessNameSet& processNames, const std::vector<Rule>& rules );
+		void ConfigureCompanions( const ProcessNameSet& companionNames );
+
+		// Fails when the window or its process can't be queried
+		bool Resolve( WindowId window, bool& isTarget );
+		bool Resolve( WindowId window, Resolution& resolution );
+
+		void RemoveWindow( WindowId window );
+		void Clear();
+
+		// The cached windows of process and of every companion process, only windows resolved so far are known
+		void GetWindowsWithCompanions( const ProcessCache::ProcessId& process, std::vector<WindowId>& windows );
+
+		const ProcessCache& GetProcessCache() const;
+
+	private:
+		bool IsTargetWindow( WindowId window, const ProcessCache::Process& process ) const;
+		bool IsCompanionProcess( const ProcessCache::ProcessId& process ) const;
+		void AddCompanionProcess( const ProcessCache::ProcessId& process );
+
+	private:
+		const Platform*                      platform = nullptr;
+		ProcessNameMatcher                   processNameMatcher;
+		ProcessNameMatcher                   companionNameMatcher;
+		RuleEngine                           ruleEngine;
+		ProcessCache                         processCache;
+		std::vector<ProcessCache::ProcessId> companionProcesses; // cached ones, those evicted since included
+	};
+} // namespace Theater
\ No newline at end of file
@@ -0,0 +1,132 @@
+#include "theater.h"
+#include "targettracker.h"
+
+namespace Theater
+{
+	void TargetTracker::SetFramePeriod( uint32_t periodMs )
+	{
+		this->framePeriod = periodMs;
+	}
+
+	void TargetTracker::SetMonitors( const std::vector<PlatformRect>& monitorRects )
+	{
+		this->monitors    = monitorRects;
+		this->monitorMask = GetMonitorMask( this->rect );
+	}
+
+	bool TargetTracker::Track( const Platform& platform, WindowId target )
+	{
+		Clear();
+
+		PlatformRect targetRect = {};
+		if ( !platform.GetWindowRect( target, targetRect ) )
+			return false;
+
+		this->window      = target;
+		this->rect        = targetRect;
+		this->monitorMask = GetMonitorMask( targetRect );
+		return true;
+	}
+
+	void TargetTracker::Clear()
+	{
+		this->window      = Platform::NO_WINDOW;
+		this->rect        = {};
+		this->monitorMask = 0;
+		this->hasPending  = false;
+		this->nextUpdate  = 0;
+	}
+
+	bool TargetTracker::Push( const WindowEvent& event, uint64_t nowMs )
+	{
+		if ( event.type != WindowEventType::LocationChanged || event.window != this->window ||
+		     this->window == Platform::NO_WINDOW )
+			return false;
+
+		if ( this->hasPending )
+			this->coalescedCount++;
+
+		// a quiet target is updated on the spot, a moving one once per frame
+		this->hasPending = true;
+		this->nextUpdate = std::max( this->nextUpdate, nowMs );
+		return true;
+	}
+
+	bool TargetTracker::Pop( const Platform& platform, uint64_t nowMs, uint32_t& changes )
+	{
+		if ( !this->hasPending || nowMs < this->nextUpdate )
+			return false;
+
+		this->hasPending = false;
+		this->nextUpdate = nowMs + this->framePeriod;
+
+		// the window is gone, its destruction stops the theater anyway
+		PlatformRect targetRect = {};
+		if ( !platform.GetWindowRect( this->window, targetRect ) )
+			return false;
+
+		changes = 0;
+		if ( targetRect.left != this->rect.left || targetRect.top != this->rect.top )
+			changes |= TARGET_MOVED;
+		if ( targetRect.right - targetRect.left != this->rect.right - this->rect.left ||
+		     targetRect.bottom - targetRect.top != this->rect.bottom - this->rect.top )
+			changes |= TARGET_RESIZED;
+
+		// an unchanged rect can't have crossed into another monitor
+		if ( changes != 0 )
+		{
+			const uint64_t mask = GetMonitorMask( targetRect );
+			if ( mask != this->monitorMask )
+				changes |= TARGET_MONITORS_CHANGED;
+
+			this->rect        = targetRect;
+			this->monitorMask = mask;
+		}
+
+		return changes != 0;
+	}
+
+	uint32_t TargetTracker::GetTimeout( uint64_t nowMs ) const
+	{
+		if ( !this->hasPending )
+			return NO_TIMEOUT;
+
+		if ( nowMs >= this->nextUpdate )
+			return 0;
+
+		return static_cast<uint32_t>( this->nextUpdate - nowMs );
+	}
+
+	TargetTracker::WindowId TargetTracker::GetWindow() const
+	{
+		return this->window;
+	}
+
+	const PlatformRect& TargetTracker::GetRect() const
+	{
+		return this->rect;
+	}
+
+	uint64_t TargetTracker::GetMonitorMask() const
+	{
+		return this->monitorMask;
+	}
+
+	size_t TargetTracker::GetCoalescedCount() const
+	{
+		return this->coalescedCount;
+	}
+
+	uint64_t TargetTracker::GetMonitorMask( const PlatformRect& targetRect ) const
+	{
+		uint64_t     mask         = 0;
+		const size_t monitorCount = std::min<size_t>( this->monitors.size(), 64 );
+		for ( size_t i = 0; i < monitorCount; i++ )
+		{
+			if ( IntersectPlatformRects( targetRect, this->monitors[i] ) )
+				mask |= 1ull << i;
+		}
+
+		return mask;
+	}
+} // namespace Theater
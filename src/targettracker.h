@@ -0,0 +1,64 @@
+#pragma once
+
+namespace Theater
+{
+	// Follows the rect of the target window through its location change events. A move or resize sends those at the
+	// mouse rate, they are coalesced so the rect is queried at most once per frame: the first one after a quiet frame
+	// goes through right away, the following ones wait for the next frame and only the latest state is read.
+	// What changed is reported so callers only redo the dimmer geometry when the target changed size or monitors.
+	class TargetTracker
+	{
+	public:
+		typedef Platform::WindowId WindowId;
+
+		static constexpr uint32_t NO_TIMEOUT           = 0xFFFFFFFFu;
+		static constexpr uint32_t DEFAULT_FRAME_PERIOD = 16;
+
+		enum : uint32_t
+		{
+			TARGET_MOVED            = 1 << 0,
+			TARGET_RESIZED          = 1 << 1,
+			TARGET_MONITORS_CHANGED = 1 << 2 // the set of monitors the target intersects
+		};
+
+		TargetTracker()  = default;
+		~TargetTracker() = default;
+
+		void SetFramePeriod( uint32_t periodMs );
+
+		// Monitor order is the one of the dimmers, only the first 64 are told apart
+		void SetMonitors( const std::vector<PlatformRect>& monitorRects );
+
+		// Starts over with window at its current rect, fails when the window is gone
+		bool Track( const Platform& platform, WindowId window );
+		void Clear();
+
+		// Returns true when event is a location change of the tracked window, the update is left for Pop
+		bool Push( const WindowEvent& event, uint64_t nowMs );
+
+		// Reads the rect once a frame elapsed since the last update, changes is a combination of TARGET_ flags.
+		// False when nothing is due or nothing changed.
+		bool Pop( const Platform& platform, uint64_t nowMs, uint32_t& changes );
+
+		// Milliseconds until Pop can succeed, NO_TIMEOUT when nothing is pending
+		uint32_t GetTimeout( uint64_t nowMs ) const;
+
+		WindowId            GetWindow() const;
+		const PlatformRect& GetRect() const;
+		uint64_t            GetMonitorMask() const; // one bit per monitor the target intersects
+		size_t              GetCoalescedCount() const;
+
+	private:
+		uint64_t GetMonitorMask( const PlatformRect& targetRect ) const;
+
+	private:
+		std::vector<PlatformRect> monitors;
+		WindowId                  window         = Platform::NO_WINDOW;
+		PlatformRect              rect           = {};
+		uint64_t                  monitorMask    = 0;
+		bool                      hasPending     = false;
+		uint64_t                  nextUpdate     = 0;
+		uint32_t                  framePeriod    = DEFAULT_FRAME_PERIOD;
+		size_t                    coalescedCount = 0;
+	};
+} // namespace Theater
\ No newline at end of file
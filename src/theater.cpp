@@ -1,13 +1,87 @@
 #include "theater.h"
+#include <fstream>
 
+namespace
+{
+	std::string RunBenchmark()
+	{
+		std::vector<Theater::BenchmarkRun> runs;
+		Theater::RunPipelineBenchmark( Theater::BenchmarkOptions(), runs );
+
+		std::string json;
+		Theater::WriteBenchmarkJson( runs, json );
+		return json;
+	}
+
+	bool RunSoak( std::string& json )
+	{
+		Theater::SoakReport report;
+		const bool          passed = Theater::RunSoak( Theater::SoakOptions(), report );
+		Theater::WriteSoakJson( report, json );
+		return passed;
+	}
+
+	template<typename Char>
+	bool RunReplay( const Char* filename, bool realTime, std::string& json )
+	{
+		std::ifstream file( filename, std::ios::binary );
+		if ( !file )
+			return false;
+
+		const std::istreambuf_iterator<char> begin( file );
+		const std::vector<uint8_t>           bytes( begin, std::istreambuf_iterator<char>() );
+
+		Theater::EventLog log;
+		if ( !Theater::ReadEventLog( bytes.data(), bytes.size(), log ) )
+			return false;
+
+		Theater::ReplayOptions options = {};
+		options.realTime               = realTime;
+
+		Theater::ReplayReport report = {};
+		if ( !Theater::ReplayEventLog( log, options, report ) )
+			return false;
+
+		Theater::WriteReplayJson( report, json );
+		return true;
+	}
+} // namespace
+
+#if defined( _WIN32 )
 int APIENTRY wWinMain( _In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPWSTR lpCmdLine,
                        _In_ int nCmdShow )
 {
 	UNREFERENCED_PARAMETER( hInstance );
 	UNREFERENCED_PARAMETER( hPrevInstance );
-	UNREFERENCED_PARAMETER( lpCmdLine );
 	UNREFERENCED_PARAMETER( nCmdShow );
 
+	// theater.exe --benchmark results.json runs the headless pipeline benchmark instead of the app,
+	// theater.exe --soak report.json a soak run and theater.exe --replay events.thlog report.json a recorded log
+	int        argc      = 0;
+	LPWSTR*    argv      = lpCmdLine[0] != L'\0' ? CommandLineToArgvW( lpCmdLine, &argc ) : nullptr;
+	const bool benchmark = argc == 2 && wcscmp( argv[0], L"--benchmark" ) == 0;
+	const bool soak      = argc == 2 && wcscmp( argv[0], L"--soak" ) == 0;
+	const bool replay    = argc == 3 && wcscmp( argv[0], L"--replay" ) == 0;
+	if ( benchmark || soak || replay )
+	{
+		std::string json;
+		bool        ran = true;
+		if ( benchmark )
+			json = RunBenchmark();
+		else if ( soak )
+			ran = RunSoak( json );
+		else
+			ran = RunReplay( argv[1], false, json );
+
+		const auto bytes   = reinterpret_cast<const uint8_t*>( json.data() );
+		const bool written = Theater::WriteFileAtomic( argv[argc - 1], bytes, json.size(), nullptr );
+		LocalFree( argv );
+		return ran && written ? 0 : -1;
+	}
+
+	if ( argv != nullptr )
+		LocalFree( argv );
+
 	auto& app = Theater::App::Current();
 
 	if ( !app.Init() )
@@ -19,4 +93,133 @@ int APIENTRY wWinMain( _In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstanc
 	const auto result = app.Run();
 	app.Close();
 	return result;
-}
\ No newline at end of file
+}
+#else
+#include <cstdio>
+
+#if defined( THEATER_HAS_X11 )
+namespace
+{
+	// $XDG_CONFIG_HOME/theater, ~/.config/theater without it
+	bool GetSettingsDirectory( std::wstring& directory )
+	{
+		const char* configHome = getenv( "XDG_CONFIG_HOME" );
+		const char* home       = getenv( "HOME" );
+		std::string path;
+		if ( configHome != nullptr && configHome[0] == '/' )
+			path = std::string( configHome ) + "/theater";
+		else if ( home != nullptr && home[0] == '/' )
+			path = std::string( home ) + "/.config/theater";
+		else
+			return false;
+
+		directory.assign( path.size() + 1, L'\0' );
+		const size_t length = mbstowcs( &directory[0], path.c_str(), directory.size() );
+		if ( length == static_cast<size_t>( -1 ) )
+			return false;
+
+		directory.resize( length );
+		return true;
+	}
+
+	// The same order as Settings::Load, the snapshot while it matches settings.json, the file, then its backup
+	Theater::SettingsData LoadSettings()
+	{
+		Theater::SettingsData data;
+		std::wstring          directory;
+		if ( !GetSettingsDirectory( directory ) )
+			return data;
+
+		Theater::SettingsFile file;
+		file.SetDirectory( directory );
+
+		uint64_t contentHash = 0;
+		if ( file.Exists() && file.ReadSnapshot( data, contentHash ) )
+			return data;
+
+		Theater::MappedFile json;
+		if ( json.Open( file.GetFilename() ) &&
+		     Theater::ReadSettings( reinterpret_cast<const char*>( json.GetData() ), json.GetSize(), data ) )
+		{
+			file.UpdateSnapshot( data, Theater::GetContentHash( json.GetData(), json.GetSize() ) );
+			return data;
+		}
+
+		Theater::MappedFile backup;
+		if ( backup.Open( file.GetBackupFilename() ) )
+			Theater::ReadSettings( reinterpret_cast<const char*>( backup.GetData() ), backup.GetSize(), data );
+
+		return data;
+	}
+
+	int RunX11App( const char* argv0 )
+	{
+		Theater::X11App app;
+		if ( !app.Init( nullptr, LoadSettings() ) )
+		{
+			const char* display = getenv( "DISPLAY" );
+			fprintf( stderr, "%s: can't open display %s\n", argv0, display != nullptr ? display : "" );
+			app.Close();
+			return 1;
+		}
+
+		const int result = app.Run();
+		app.Close();
+		return result;
+	}
+} // namespace
+#endif
+
+int main( int argc, char** argv )
+{
+#if defined( THEATER_HAS_X11 )
+	// without arguments the app runs on $DISPLAY
+	if ( argc == 1 )
+		return RunX11App( argv[0] );
+#endif
+
+	// the benchmark, soak runs and replays need no display
+	const bool benchmark = argc >= 2 && argc <= 3 && strcmp( argv[1], "--benchmark" ) == 0;
+	const bool soak      = argc >= 2 && argc <= 3 && strcmp( argv[1], "--soak" ) == 0;
+	const bool replay    = argc >= 3 && argc <= 4 && strcmp( argv[1], "--replay" ) == 0;
+	if ( !benchmark && !soak && !replay )
+	{
+#if defined( THEATER_HAS_X11 )
+		fprintf( stderr, "usage: %s\n", argv[0] );
+		fprintf( stderr, "       %s --benchmark [results.json]\n", argv[0] );
+#else
+		fprintf( stderr, "usage: %s --benchmark [results.json]\n", argv[0] );
+#endif
+		fprintf( stderr, "       %s --soak [report.json]\n", argv[0] );
+		fprintf( stderr, "       %s --replay events.thlog [--realtime]\n", argv[0] );
+		return 1;
+	}
+
+	// a soak run that saw growth still writes its report, the exit code tells
+	std::string json;
+	bool        passed = true;
+	if ( benchmark )
+	{
+		json = RunBenchmark();
+	}
+	else if ( soak )
+	{
+		passed = RunSoak( json );
+	}
+	else if ( !RunReplay( argv[2], argc == 4 && strcmp( argv[3], "--realtime" ) == 0, json ) )
+	{
+		fprintf( stderr, "%s: can't replay %s\n", argv[0], argv[2] );
+		return 1;
+	}
+
+	FILE* file = !replay && argc == 3 ? fopen( argv[2], "wb" ) : stdout;
+	if ( file == nullptr )
+		return 1;
+
+	const bool written = fwrite( json.data(), 1, json.size(), file ) == json.size();
+	if ( file != stdout )
+		fclose( file );
+
+	return passed && written ? 0 : 1;
+}
+#endif
@@ -1,5 +1,6 @@
 #pragma once
 
+#if defined( _WIN32 )
 // Win32 API
 #include <SDKDDKVer.h>
 #define WIN32_LEAN_AND_MEAN
@@ -10,16 +11,72 @@
 #include <shellapi.h>
 #include <shlobj.h>
 #include <commdlg.h>
+#include <dwmapi.h>
+#endif
 
 // STL
 #include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
 // App
+#include "slotmap.h"
+#include "spscring.h"
+#include "tracerecorder.h"
+#include "changebus.h"
+#include "eventcoalescer.h"
+#include "filewatcher.h"
+#include "atomicfile.h"
+#include "fadeanimation.h"
+#include "gradientkernel.h"
+#include "monitortopology.h"
+#include "processcache.h"
+#include "processnamematcher.h"
+#include "processnameset.h"
+#include "ruleengine.h"
+#include "platform.h"
+#include "monitorlevels.h"
+#include "simulateddesktop.h"
+#include "targetresolver.h"
+#include "spotlightsurface.h"
+#include "settingsdata.h"
+#include "settingsreader.h"
+#include "settingssnapshot.h"
+#include "settingsfile.h"
+#include "settingspersister.h"
+#include "windowregistry.h"
+#include "theatersession.h"
+#include "targettracker.h"
+#include "zorderplanner.h"
+#include "zorderstack.h"
+#include "zorderarranger.h"
+#include "pipelinebenchmark.h"
+#include "headlesspipeline.h"
+#include "eventlog.h"
+#include "eventreplay.h"
+#include "soakrun.h"
+#if defined( _WIN32 )
 #include "settings.h"
+#include "win32platform.h"
 #include "tray.h"
 #include "dimmer.h"
 #include "app.h"
+#else
+#include "x11platform.h"
+#include "x11dimmer.h"
+#include "x11app.h"
+#endif
\ No newline at end of file
@@ -0,0 +1,181 @@
+#include "theater.h"
+#include "theatersession.h"
+
+namespace Theater
+{
+	namespace
+	{
+		std::unique_lock<std::mutex> LockRegistry( std::mutex* registryLock )
+		{
+			if ( registryLock == nullptr )
+				return std::unique_lock<std::mutex>();
+
+			return std::unique_lock<std::mutex>( *registryLock );
+		}
+	} // namespace
+
+	bool TheaterSession::OnForeground( WindowId window, TargetResolver& resolver, const WindowRegistry& registry,
+	                                   std::mutex* registryLock, Transition& transition )
+	{
+		TargetResolver::Resolution resolution = {};
+		if ( !resolver.Resolve( window, resolution ) )
+			return false;
+
+		// a window the session didn't see yet still belongs to it when its process does
+		if ( IsActive() && ( Contains( window ) || IsMember( resolution ) ) )
+		{
+			Insert( window );
+			this->focus = window;
+			transition  = Transition::Switch;
+			return true;
+		}
+
+		if ( !resolution.isTarget )
+		{
+			Clear();
+			transition = Transition::Stop;
+			return true;
+		}
+
+		Start( window, resolution.process, resolver, registry, registryLock );
+		transition = Transition::Start;
+		return true;
+	}
+
+	void TheaterSession::OnWindowEvent( const WindowEvent& event, TargetResolver& resolver,
+	                                    const WindowRegistry& registry, std::mutex* registryLock )
+	{
+		if ( !this->scanned || event.type == WindowEventType::Foreground )
+			return;
+
+		// nothing to add a window to, resolving it would query the process of everything shown system wide
+		if ( !IsActive() )
+		{
+			this->scanned = false;
+			return;
+		}
+
+		bool visible = false;
+		{
+			const auto lock = LockRegistry( registryLock );
+			visible         = registry.IsWindowVisible( event.window );
+		}
+
+		if ( !visible )
+		{
+			Remove( event.window );
+			return;
+		}
+
+		TargetResolver::Resolution resolution = {};
+		if ( Contains( event.window ) || !resolver.Resolve( event.window, resolution ) )
+			return;
+
+		if ( IsMember( resolution ) )
+			Insert( event.window );
+	}
+
+	void TheaterSession::Clear()
+	{
+		this->process = {};
+		this->focus   = Platform::NO_WINDOW;
+		this->windows.clear();
+	}
+
+	void TheaterSession::Reset()
+	{
+		Clear();
+		this->scanned = false;
+	}
+
+	bool TheaterSession::IsActive() const
+	{
+		return this->focus != Platform::NO_WINDOW;
+	}
+
+	TheaterSession::WindowId TheaterSession::GetFocus() const
+	{
+		return this->focus;
+	}
+
+	bool TheaterSession::Contains( WindowId window ) const
+	{
+		return std::binary_search( this->windows.cbegin(), this->windows.cend(), window );
+	}
+
+	size_t TheaterSession::GetWindowCount() const
+	{
+		return this->windows.size();
+	}
+
+	void TheaterSession::GetCompanions( WindowId window, std::vector<WindowId>& companions ) const
+	{
+		companions.clear();
+		if ( !Contains( window ) )
+			return;
+
+		for ( const auto member : this->windows )
+		{
+			if ( member != window )
+				companions.emplace_back( member );
+		}
+	}
+
+	bool TheaterSession::IsMember( const TargetResolver::Resolution& resolution ) const
+	{
+		// the target's own process instance, a restarted one is another session
+		return resolution.isCompanion || resolution.process == this->process;
+	}
+
+	void TheaterSession::Start( WindowId window, const ProcessCache::ProcessId& targetProcess,
+	                            TargetResolver& resolver, const WindowRegistry& registry, std::mutex* registryLock )
+	{
+		// windows were shown since the last session without being resolved, those the resolver knows only cost a pid
+		// lookup on the way
+		if ( !this->scanned )
+		{
+			std::vector<WindowId> visibleWindows;
+			{
+				const auto lock = LockRegistry( registryLock );
+				visibleWindows  = registry.GetVisibleWindows();
+			}
+
+			for ( const auto visible : visibleWindows )
+			{
+				TargetResolver::Resolution resolution = {};
+				resolver.Resolve( visible, resolution );
+			}
+			this->scanned = true;
+		}
+
+		this->process = targetProcess;
+		this->focus   = window;
+
+		// the cache also holds hidden windows and ones whose destruction it wasn't told about
+		resolver.GetWindowsWithCompanions( targetProcess, this->windows );
+		const auto lock = LockRegistry( registryLock );
+		this->windows.erase( std::remove_if( this->windows.begin(), this->windows.end(),
+		                                     [&registry]( WindowId member ) {
+			                                     return !registry.IsWindowVisible( member );
+		                                     } ),
+		                     this->windows.end() );
+		this->windows.emplace_back( window );
+
+		std::sort( this->windows.begin(), this->windows.end() );
+		this->windows.erase( std::unique( this->windows.begin(), this->windows.end() ), this->windows.end() );
+	}
+
+	void TheaterSession::Insert( WindowId window )
+	{
+		const auto iter = std::lower_bound( this->windows.begin(), this->windows.end(), window );
+		if ( iter == this->windows.end() || *iter != window )
+			this->windows.insert( iter, window );
+	}
+
+	void TheaterSession::Remove( WindowId window )
+	{
+		const auto iter = std::lower_bound( this->windows.begin(), this->windows.end(), window );
+		if ( iter != this->windows.end() && *iter == window )
+			this->windows.erase( iter );
+	}
+} // namespace Theater
@@ -0,0 +1,65 @@
+#pragma once
+
+namespace Theater
+{
+	// The windows kept above the dimmers while the theater is shown. A session starts on a target window and takes
+	// in every visible top level window of that process instance and of the companion processes, windows shown
+	// later included. Focus moving between them switches the focused window without starting anything over.
+	// Windows shown during a session are resolved as they show up, those shown without one are left until the next
+	// session starts and walks the registry again, so a session starts off the windows the resolver lists per process.
+	// Not thread safe, the caller serializes it along with the resolver. A registry shared with another thread comes
+	// with its lock, which is only held while reading the registry and never while the resolver queries the platform.
+	class TheaterSession
+	{
+	public:
+		typedef Platform::WindowId WindowId;
+
+		enum class Transition
+		{
+			// a new session, its windows have to be ordered above the dimmers
+			Start,
+			// focus moved to another window of the session, nothing to reorder
+			Switch,
+			// focus left the session, which is over
+			Stop
+		};
+
+		TheaterSession()  = default;
+		~TheaterSession() = default;
+
+		// Fails when the window can't be resolved, the session is left as is then
+		bool OnForeground( WindowId window, TargetResolver& resolver, const WindowRegistry& registry,
+		                   std::mutex* registryLock, Transition& transition );
+
+		// Follows windows being shown, hidden or destroyed, once the registry took the event in.
+		// Has to see every event once a session started, without a session they only have the next start walk the
+		// registry again.
+		void OnWindowEvent( const WindowEvent& event, TargetResolver& resolver, const WindowRegistry& registry,
+		                    std::mutex* registryLock );
+
+		void Clear();
+		// Clears and walks the registry again on the next start, for when events might have been missed
+		void Reset();
+
+		bool     IsActive() const;
+		WindowId GetFocus() const;
+		bool     Contains( WindowId window ) const;
+		size_t   GetWindowCount() const;
+
+		// The windows of the session other than window, sorted. None when window isn't part of the session.
+		void GetCompanions( WindowId window, std::vector<WindowId>& companions ) const;
+
+	private:
+		bool IsMember( const TargetResolver::Resolution& resolution ) const;
+		void Start( WindowId window, const ProcessCache::ProcessId& process, TargetResolver& resolver,
+		            const WindowRegistry& registry, std::mutex* registryLock );
+		void Insert( WindowId window );
+		void Remove( WindowId window );
+
+	private:
+		ProcessCache::ProcessId process = {};
+		WindowId                focus   = Platform::NO_WINDOW;
+		bool                    scanned = false;
+		std::vector<WindowId>   windows; // sorted, a handful at most
+	};
+} // namespace Theater
\ No newline at end of file
@@ -0,0 +1,127 @@
+#include "theater.h"
+#include "tracerecorder.h"
+#include <memory>
+
+namespace Theater
+{
+	namespace
+	{
+		std::atomic<bool> s_tracingEnabled{ false };
+
+		// rings are only added, a thread's ring stays readable after the thread exits
+		std::mutex                              s_traceRingsLock;
+		std::vector<std::unique_ptr<TraceRing>> s_traceRings;
+		thread_local TraceRing*                 t_traceRing = nullptr;
+
+		TraceRing& GetThreadRing()
+		{
+			if ( t_traceRing == nullptr )
+			{
+				std::lock_guard<std::mutex> lock( s_traceRingsLock );
+				const auto threadId = static_cast<uint32_t>( s_traceRings.size() + 1 );
+				s_traceRings.emplace_back( std::make_unique<TraceRing>( threadId ) );
+				t_traceRing = s_traceRings.back().get();
+			}
+
+			return *t_traceRing;
+		}
+	} // namespace
+
+	TraceRing::TraceRing( uint32_t threadId ) : threadId( threadId )
+	{
+	}
+
+	void TraceRing::Write( const TraceSpan& span )
+	{
+		const uint64_t index = this->written.load( std::memory_order_relaxed );
+		Slot&          slot  = this->slots[index & MASK];
+
+		// a reader that sees any of the new fields through their release sees the odd sequence before them too,
+		// plain stores on x86 and no fence ThreadSanitizer can't follow
+		slot.sequence.store( 2 * index + 1, std::memory_order_relaxed );
+		slot.name.store( span.name, std::memory_order_release );
+		slot.start.store( span.start, std::memory_order_release );
+		slot.end.store( span.end, std::memory_order_release );
+		slot.arg.store( span.arg, std::memory_order_release );
+		slot.sequence.store( 2 * index + 2, std::memory_order_release );
+
+		this->written.store( index + 1, std::memory_order_release );
+	}
+
+	void TraceRing::SetThreadName( const char* name )
+	{
+		this->threadName.store( name, std::memory_order_release );
+	}
+
+	void TraceRing::Read( std::vector<TraceSpan>& spans ) const
+	{
+		const uint64_t written = this->written.load( std::memory_order_acquire );
+		const uint64_t first   = written > CAPACITY ? written - CAPACITY : 0;
+		for ( uint64_t index = first; index < written; index++ )
+		{
+			const Slot&    slot     = this->slots[index & MASK];
+			const uint64_t sequence = slot.sequence.load( std::memory_order_acquire );
+			if ( sequence != 2 * index + 2 )
+				continue;
+
+			TraceSpan span = {};
+			span.name      = slot.name.load( std::memory_order_acquire );
+			span.start     = slot.start.load( std::memory_order_acquire );
+			span.end       = slot.end.load( std::memory_order_acquire );
+			span.arg       = slot.arg.load( std::memory_order_acquire );
+
+			// the writer lapped us while copying, the span is torn
+			if ( slot.sequence.load( std::memory_order_relaxed ) != sequence )
+				continue;
+
+			spans.emplace_back( span );
+		}
+	}
+
+	uint32_t TraceRing::GetThreadId() const
+	{
+		return this->threadId;
+	}
+
+	const char* TraceRing::GetThreadName() const
+	{
+		return this->threadName.load( std::memory_order_acquire );
+	}
+
+	void EnableTracing( bool state )
+	{
+		s_tracingEnabled.store( state, std::memory_order_relaxed );
+	}
+
+	bool IsTracingEnabled()
+	{
+		return s_tracingEnabled.load( std::memory_order_relaxed );
+	}
+
+	uint64_t GetTraceTime()
+	{
+		const auto now = std::chrono::steady_clock::now().time_since_epoch();
+		return static_cast<uint64_t>( std::chrono::duration_cast<std::chrono::nanoseconds>( now ).count() );
+	}
+
+	void SetTraceThreadName( const char* name )
+	{
+		GetThreadRing().SetThreadName( name );
+	}
+
+	void RecordTraceSpan( const char* name, uint64_t start, uint64_t end, uint64_t arg )
+	{
+		GetThreadRing().Write( TraceSpan{ name, start, end, arg } );
+	}
+
+	void ReadTraceThreads( std::vector<TraceThread>& threads )
+	{
+		std::lock_guard<std::mutex> lock( s_traceRingsLock );
+		threads.reserve( threads.size() + s_traceRings.size() );
+		for ( const auto& ring : s_traceRings )
+		{
+			threads.emplace_back( TraceThread{ ring->GetThreadId(), ring->GetThreadName(), {} } );
+			ring->Read( threads.back().spans );
+		}
+	}
+} // namespace Theater
@@ -0,0 +1,106 @@
+#pragma once
+
+namespace Theater
+{
+	// A finished span, times are nanoseconds of the steady clock
+	struct TraceSpan
+	{
+		const char* name; // a string literal, only the pointer is kept
+		uint64_t    start;
+		uint64_t    end;
+		uint64_t    arg;
+	};
+
+	// The latest spans of one thread, older ones are overwritten. The owning thread is the only writer and never
+	// waits, readers copy the slots under a per-slot sequence and skip the ones overwritten while they read.
+	class TraceRing
+	{
+	public:
+		static constexpr size_t CAPACITY = 4096;
+
+		explicit TraceRing( uint32_t threadId );
+		~TraceRing() = default;
+
+		// owner only
+		void Write( const TraceSpan& span );
+		void SetThreadName( const char* name );
+
+		// Appends the spans still in the ring, oldest first
+		void Read( std::vector<TraceSpan>& spans ) const;
+
+		uint32_t    GetThreadId() const;
+		const char* GetThreadName() const;
+
+	private:
+		TraceRing( const TraceRing& ) = delete;
+		TraceRing& operator=( const TraceRing& ) = delete;
+
+		// sequence is 2 * index + 1 while the span of that index is written and 2 * index + 2 once it is complete
+		struct Slot
+		{
+			std::atomic<uint64_t>    sequence{ 0 };
+			std::atomic<const char*> name{ nullptr };
+			std::atomic<uint64_t>    start{ 0 };
+			std::atomic<uint64_t>    end{ 0 };
+			std::atomic<uint64_t>    arg{ 0 };
+		};
+
+	private:
+		static constexpr size_t MASK = CAPACITY - 1;
+		static_assert( ( CAPACITY & MASK ) == 0, "CAPACITY must be a power of two" );
+
+		const uint32_t           threadId;
+		std::atomic<const char*> threadName{ nullptr };
+		std::atomic<uint64_t>    written{ 0 };
+		Slot                     slots[CAPACITY];
+	};
+
+	// Tracing is off by default, a disabled TraceScope costs a relaxed load and a branch
+	void     EnableTracing( bool state );
+	bool     IsTracingEnabled();
+	uint64_t GetTraceTime();
+
+	// Spans go to a ring of the calling thread, created on its first span and kept after the thread exits
+	void SetTraceThreadName( const char* name );
+	void RecordTraceSpan( const char* name, uint64_t start, uint64_t end, uint64_t arg );
+
+	// The spans still in the ring of one thread, oldest first
+	struct TraceThread
+	{
+		uint32_t               threadId;
+		const char*            threadName; // nullptr until the thread named itself
+		std::vector<TraceSpan> spans;
+	};
+
+	// Appends one entry per thread that recorded a span
+	void ReadTraceThreads( std::vector<TraceThread>& threads );
+
+	// Spans of all threads in the Chrome trace event format, loads in chrome://tracing and Perfetto.
+	// Lives in tracewriter.cpp, the only part of tracing that needs rapidjson.
+	void WriteTraceJson( std::string& json );
+
+	// Records its lifetime as a span when tracing was enabled on construction
+	class TraceScope
+	{
+	public:
+		explicit TraceScope( const char* name, uint64_t arg = 0 )
+		    : name( name ), arg( arg ), start( IsTracingEnabled() ? GetTraceTime() : 0 )
+		{
+		}
+
+		~TraceScope()
+		{
+			if ( this->start != 0 )
+				RecordTraceSpan( this->name, this->start, GetTraceTime(), this->arg );
+		}
+
+	private:
+		TraceScope( const TraceScope& ) = delete;
+		TraceScope& operator=( const TraceScope& ) = delete;
+
+	private:
+		const char*    name;
+		const uint64_t arg;
+		const uint64_t start;
+	};
+} // namespace Theater
\ No newline at end of file
@@ -0,0 +1,87 @@
+#include "theater.h"
+#include "tracerecorder.h"
+#include <rapidjson/rapidjson.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+
+namespace Theater
+{
+	namespace
+	{
+		constexpr char TRACE_CATEGORY[] = "theater";
+		constexpr int  TRACE_PROCESS_ID = 1;
+	} // namespace
+
+	void WriteTraceJson( std::string& json )
+	{
+		std::vector<TraceThread> threads;
+		ReadTraceThreads( threads );
+
+		// timestamps are microseconds from the earliest span, the absolute clock value means nothing to a reader
+		uint64_t origin = UINT64_MAX;
+		for ( const auto& thread : threads )
+		{
+			for ( const auto& span : thread.spans )
+				origin = std::min( origin, span.start );
+		}
+
+		rapidjson::StringBuffer                    buffer;
+		rapidjson::Writer<rapidjson::StringBuffer> writer( buffer );
+
+		writer.StartObject();
+		writer.Key( "displayTimeUnit" );
+		writer.String( "ms" );
+		writer.Key( "traceEvents" );
+		writer.StartArray();
+		for ( const auto& thread : threads )
+		{
+			if ( thread.threadName != nullptr )
+			{
+				writer.StartObject();
+				writer.Key( "name" );
+				writer.String( "thread_name" );
+				writer.Key( "ph" );
+				writer.String( "M" );
+				writer.Key( "pid" );
+				writer.Int( TRACE_PROCESS_ID );
+				writer.Key( "tid" );
+				writer.Uint( thread.threadId );
+				writer.Key( "args" );
+				writer.StartObject();
+				writer.Key( "name" );
+				writer.String( thread.threadName );
+				writer.EndObject();
+				writer.EndObject();
+			}
+
+			for ( const auto& span : thread.spans )
+			{
+				writer.StartObject();
+				writer.Key( "name" );
+				writer.String( span.name );
+				writer.Key( "cat" );
+				writer.String( TRACE_CATEGORY );
+				writer.Key( "ph" );
+				writer.String( "X" );
+				writer.Key( "ts" );
+				writer.Double( ( span.start - origin ) / 1000.0 );
+				writer.Key( "dur" );
+				writer.Double( ( span.end - span.start ) / 1000.0 );
+				writer.Key( "pid" );
+				writer.Int( TRACE_PROCESS_ID );
+				writer.Key( "tid" );
+				writer.Uint( thread.threadId );
+				writer.Key( "args" );
+				writer.StartObject();
+				writer.Key( "arg" );
+				writer.Uint64( span.arg );
+				writer.EndObject();
+				writer.EndObject();
+			}
+		}
+		writer.EndArray();
+		writer.EndObject();
+
+		json.assign( buffer.GetString(), buffer.GetSize() );
+	}
+} // namespace Theater
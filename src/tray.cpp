@@ -180,7 +180,6 @@ namespace Theater
 				}
 
 				App::Current().GetSettings().SetAlpha( alpha );
-				App::Current().GetSettings().NotifyChanges();
 				return 0;
 			}
 
@@ -196,7 +195,6 @@ namespace Theater
 				if ( ::ChooseColorW( &cc ) == TRUE )
 					App::Current().GetSettings().SetColor( cc.rgbResult );
 
-				App::Current().GetSettings().NotifyChanges();
 				return 0;
 			}
 			case ID_TRAY_CONTEXT_EXIT: {
@@ -207,6 +205,18 @@ namespace Theater
 				App::Current().GetSettings().EnableTheater( !App::Current().GetSettings().IsTheaterEnabled() );
 				return 0;
 			}
+			case ID_TRAY_CONTEXT_TRACE: {
+				EnableTracing( !IsTracingEnabled() );
+				return 0;
+			}
+			case ID_TRAY_CONTEXT_TRACE_SAVE: {
+				App::Current().SaveTrace();
+				return 0;
+			}
+			case ID_TRAY_CONTEXT_RECORD: {
+				App::Current().RecordEvents( !App::Current().IsRecordingEvents() );
+				return 0;
+			}
 			}
 			break;
 		}
@@ -226,6 +236,12 @@ namespace Theater
 				mii.fState        = MFS_ENABLED | ( App::Current().GetSettings().IsTheaterEnabled() ? MFS_CHECKED : MFS_UNCHECKED );
 				::SetMenuItemInfoW( this->contextMenu, ID_TRAY_CONTEXT_ENABLED, FALSE, &mii );
 
+				mii.fState = MFS_ENABLED | ( IsTracingEnabled() ? MFS_CHECKED : MFS_UNCHECKED );
+				::SetMenuItemInfoW( this->contextMenu, ID_TRAY_CONTEXT_TRACE, FALSE, &mii );
+
+				mii.fState = MFS_ENABLED | ( App::Current().IsRecordingEvents() ? MFS_CHECKED : MFS_UNCHECKED );
+				::SetMenuItemInfoW( this->contextMenu, ID_TRAY_CONTEXT_RECORD, FALSE, &mii );
+
 				// needed to ensure context menu gets closed if a use clicks elsewhere when it is open
 				::SetForegroundWindow( this->messageWindow );
 
@@ -0,0 +1,377 @@
+#include "theater.h"
+#include "win32platform.h"
+
+namespace Theater
+{
+	namespace
+	{
+		Platform::WINDOWEVENTCALLBACK s_eventCallback = nullptr;
+
+		HWND ToHandle( Platform::WindowId window )
+		{
+			return reinterpret_cast<HWND>( window );
+		}
+
+		Platform::WindowId ToWindowId( HWND hwnd )
+		{
+			return reinterpret_cast<Platform::WindowId>( hwnd );
+		}
+
+		BOOL CALLBACK EnumWindowsProc( _In_ HWND hwnd, _In_ LPARAM lParam )
+		{
+			auto topLevelWindows = reinterpret_cast<std::vector<Platform::WindowId>*>( lParam );
+			topLevelWindows->emplace_back( ToWindowId( hwnd ) );
+			return TRUE;
+		}
+
+		BOOL CALLBACK EnumMonitorsProc( HMONITOR handle, HDC, LPRECT rc, LPARAM lParam )
+		{
+			auto monitors = reinterpret_cast<std::vector<PlatformMonitor>*>( lParam );
+
+			MONITORINFOEXW info = {};
+			info.cbSize         = sizeof( info );
+			::GetMonitorInfoW( handle, &info );
+
+			monitors->emplace_back( PlatformMonitor{ info.szDevice, { rc->left, rc->top, rc->right, rc->bottom } } );
+			return TRUE;
+		}
+
+		// Closes the process handle on every path out
+		class ProcessHandle
+		{
+		public:
+			explicit ProcessHandle( uint32_t pid )
+			    : handle( ::OpenProcess( PROCESS_QUERY_LIMITED_INFORMATION, FALSE, static_cast<DWORD>( pid ) ) )
+			{
+			}
+
+			~ProcessHandle()
+			{
+				if ( this->handle != nullptr )
+					::CloseHandle( this->handle );
+			}
+
+			HANDLE Get() const
+			{
+				return this->handle;
+			}
+
+		private:
+			ProcessHandle( const ProcessHandle& ) = delete;
+			ProcessHandle& operator=( const ProcessHandle& ) = delete;
+
+		private:
+			HANDLE handle;
+		};
+	} // namespace
+
+	void Win32Platform::EnumTopLevelWindows( std::vector<WindowId>& windows ) const
+	{
+		::EnumWindows( EnumWindowsProc, reinterpret_cast<LPARAM>( &windows ) );
+	}
+
+	bool Win32Platform::IsWindow( WindowId window ) const
+	{
+		return ::IsWindow( ToHandle( window ) ) != FALSE;
+	}
+
+	bool Win32Platform::IsTopLevelWindow( WindowId window ) const
+	{
+		const HWND hwnd = ToHandle( window );
+		return ( ::GetWindowLongPtrW( hwnd, GWL_STYLE ) & WS_CHILD ) == 0 && ::IsWindow( hwnd );
+	}
+
+	bool Win32Platform::IsWindowVisible( WindowId window ) const
+	{
+		return ::IsWindowVisible( ToHandle( window ) ) != FALSE;
+	}
+
+	bool Win32Platform::IsWindowCloaked( WindowId window ) const
+	{
+		DWORD cloaked = 0;
+		if ( ::DwmGetWindowAttribute( ToHandle( window ), DWMWA_CLOAKED, &cloaked, sizeof( cloaked ) ) != S_OK )
+			return false;
+
+		return cloaked != 0;
+	}
+
+	bool Win32Platform::IsWindowTopmost( WindowId window ) const
+	{
+		return ( ::GetWindowLongPtrW( ToHandle( window ), GWL_EXSTYLE ) & WS_EX_TOPMOST ) != 0;
+	}
+
+	Platform::WindowId Win32Platform::GetWindowOwner( WindowId window ) const
+	{
+		return ToWindowId( ::GetWindow( ToHandle( window ), GW_OWNER ) );
+	}
+
+	bool Win32Platform::GetWindowRect( WindowId window, PlatformRect& rect ) const
+	{
+		RECT rc = {};
+		if ( !::GetWindowRect( ToHandle( window ), &rc ) )
+			return false;
+
+		rect = { rc.left, rc.top, rc.right, rc.bottom };
+		return true;
+	}
+
+	size_t Win32Platform::GetWindowClassName( WindowId window, wchar_t* buffer, size_t size ) const
+	{
+		const int length = ::GetClassNameW( ToHandle( window ), buffer, static_cast<int>( size ) );
+		return static_cast<size_t>( std::max( 0, length ) );
+	}
+
+	size_t Win32Platform::GetWindowTitle( WindowId window, wchar_t* buffer, size_t size ) const
+	{
+		const int length = ::GetWindowTextW( ToHandle( window ), buffer, static_cast<int>( size ) );
+		return static_cast<size_t>( std::max( 0, length ) );
+	}
+
+	uint32_t Win32Platform::GetWindowProcessId( WindowId window ) const
+	{
+		DWORD pid = 0;
+		::GetWindowThreadProcessId( ToHandle( window ), &pid );
+		return static_cast<uint32_t>( pid );
+	}
+
+	Platform::WindowId Win32Platform::GetTopWindow() const
+	{
+		return ToWindowId( ::GetTopWindow( nullptr ) );
+	}
+
+	Platform::WindowId Win32Platform::GetWindowAbove( WindowId window ) const
+	{
+		return ToWindowId( ::GetWindow( ToHandle( window ), GW_HWNDPREV ) );
+	}
+
+	Platform::WindowId Win32Platform::GetWindowBelow( WindowId window ) const
+	{
+		return ToWindowId( ::GetWindow( ToHandle( window ), GW_HWNDNEXT ) );
+	}
+
+	bool Win32Platform::MoveWindowsBelow( WindowId insertAfter, const WindowId* windows, size_t count )
+	{
+		TraceScope trace( "move-windows-below", count );
+
+		HDWP dwp = ::BeginDeferWindowPos( static_cast<int>( count ) );
+		if ( dwp == nullptr )
+			return false;
+
+		HWND previous = ToHandle( insertAfter );
+		for ( size_t i = 0; i < count; i++ )
+		{
+			const HWND hwnd = ToHandle( windows[i] );
+			dwp      = ::DeferWindowPos( dwp, hwnd, previous, 0, 0, 0, 0, SWP_NOMOVE | SWP_NOSIZE | SWP_NOACTIVATE );
+			previous = hwnd;
+			if ( dwp == nullptr )
+				return false;
+		}
+
+		return ::EndDeferWindowPos( dwp ) != FALSE;
+	}
+
+	bool Win32Platform::MoveWindowsToBottom( const WindowId* windows, size_t count )
+	{
+		TraceScope trace( "move-windows-to-bottom", count );
+
+		HDWP dwp = ::BeginDeferWindowPos( static_cast<int>( count ) );
+		if ( dwp == nullptr )
+			return false;
+
+		for ( size_t i = 0; i < count; i++ )
+		{
+			dwp = ::DeferWindowPos( dwp, ToHandle( windows[i] ), HWND_BOTTOM, 0, 0, 0, 0,
+			                        SWP_NOMOVE | SWP_NOSIZE | SWP_NOACTIVATE );
+			if ( dwp == nullptr )
+				return false;
+		}
+
+		return ::EndDeferWindowPos( dwp ) != FALSE;
+	}
+
+	void Win32Platform::ShowWindow( WindowId window, bool state )
+	{
+		::ShowWindow( ToHandle( window ), state ? SW_SHOWNOACTIVATE : SW_HIDE );
+	}
+
+	void Win32Platform::SetWindowAlpha( WindowId window, uint8_t alpha )
+	{
+		::SetLayeredWindowAttributes( ToHandle( window ), 0, alpha, LWA_ALPHA );
+	}
+
+	void Win32Platform::EnumMonitors( std::vector<PlatformMonitor>& monitors ) const
+	{
+		::EnumDisplayMonitors( nullptr, nullptr, EnumMonitorsProc, reinterpret_cast<LPARAM>( &monitors ) );
+	}
+
+	bool Win32Platform::QueryProcessId( uint32_t pid, ProcessCache::ProcessId& id ) const
+	{
+		ProcessHandle process( pid );
+		if ( process.Get() == nullptr )
+			return false;
+
+		FILETIME creationTime = {};
+		FILETIME exitTime     = {};
+		FILETIME kernelTime   = {};
+		FILETIME userTime     = {};
+		if ( !::GetProcessTimes( process.Get(), &creationTime, &exitTime, &kernelTime, &userTime ) )
+			return false;
+
+		id.pid = pid;
+		id.creationTime =
+		    ( static_cast<uint64_t>( creationTime.dwHighDateTime ) << 32 ) | creationTime.dwLowDateTime;
+		return true;
+	}
+
+	bool Win32Platform::QueryProcessPath( uint32_t pid, std::wstring& path, std::wstring& name ) const
+	{
+		ProcessHandle process( pid );
+		if ( process.Get() == nullptr )
+			return false;
+
+		wchar_t processPath[_MAX_PATH];
+		DWORD   processPathLen = _MAX_PATH;
+		if ( ::QueryFullProcessImageNameW( process.Get(), 0, processPath, &processPathLen ) == 0 )
+			return false;
+		processPath[_MAX_PATH - 1] = 0;
+
+		wchar_t filename[_MAX_FNAME];
+		_wsplitpath_s( processPath, nullptr, 0, nullptr, 0, filename, _MAX_FNAME, nullptr, 0 );
+		filename[_MAX_FNAME - 1] = 0;
+
+		path.assign( processPath );
+		name.assign( filename );
+		return true;
+	}
+
+	void Win32Platform::WinEventHookProc( HWINEVENTHOOK, DWORD event, HWND hwnd, LONG idObject, LONG idChild, DWORD,
+	                                      DWORD dwmsEventTime )
+	{
+		if ( s_eventCallback == nullptr || hwnd == nullptr || idObject != OBJID_WINDOW || idChild != CHILDID_SELF )
+			return;
+
+		WindowEvent windowEvent = {};
+		windowEvent.time        = dwmsEventTime;
+		windowEvent.window      = ToWindowId( hwnd );
+
+		// how long the switch waited in the system before reaching us, dwmsEventTime is on the tick count clock
+		if ( event == EVENT_SYSTEM_FOREGROUND && IsTracingEnabled() )
+		{
+			const uint64_t now = GetTraceTime();
+			const uint64_t age = static_cast<uint64_t>( ::GetTickCount() - dwmsEventTime ) * 1000000;
+			RecordTraceSpan( "system-dispatch", now > age ? now - age : 0, now, windowEvent.window );
+		}
+
+		switch ( event )
+		{
+		case EVENT_SYSTEM_FOREGROUND:
+			windowEvent.type = WindowEventType::Foreground;
+			break;
+		case EVENT_OBJECT_CREATE:
+			windowEvent.type = WindowEventType::Created;
+			break;
+		case EVENT_OBJECT_DESTROY:
+			windowEvent.type = WindowEventType::Destroyed;
+			break;
+		case EVENT_OBJECT_SHOW:
+			windowEvent.type = WindowEventType::Shown;
+			break;
+		case EVENT_OBJECT_HIDE:
+			windowEvent.type = WindowEventType::Hidden;
+			break;
+		case EVENT_OBJECT_CLOAKED:
+			windowEvent.type = WindowEventType::Cloaked;
+			break;
+		case EVENT_OBJECT_UNCLOAKED:
+			windowEvent.type = WindowEventType::Uncloaked;
+			break;
+		case EVENT_OBJECT_LOCATIONCHANGE:
+			windowEvent.type = WindowEventType::LocationChanged;
+			break;
+		default:
+			return;
+		}
+
+		s_eventCallback( windowEvent );
+	}
+
+	bool Win32Platform::StartEventHooks( WINDOWEVENTCALLBACK callback )
+	{
+		if ( this->winEventHook != nullptr )
+			return true;
+
+		s_eventCallback = callback;
+
+		this->winEventHook =
+		    ::SetWinEventHook( EVENT_SYSTEM_FOREGROUND, EVENT_SYSTEM_FOREGROUND, nullptr, WinEventHookProc, 0, 0,
+		                       WINEVENT_OUTOFCONTEXT | WINEVENT_SKIPOWNPROCESS );
+
+		// create, destroy, show and hide are contiguous
+		this->winEventObjectHook = ::SetWinEventHook( EVENT_OBJECT_CREATE, EVENT_OBJECT_HIDE, nullptr, WinEventHookProc,
+		                                              0, 0, WINEVENT_OUTOFCONTEXT | WINEVENT_SKIPOWNPROCESS );
+
+		this->winEventCloakHook =
+		    ::SetWinEventHook( EVENT_OBJECT_CLOAKED, EVENT_OBJECT_UNCLOAKED, nullptr, WinEventHookProc, 0, 0,
+		                       WINEVENT_OUTOFCONTEXT | WINEVENT_SKIPOWNPROCESS );
+
+		return this->winEventHook != nullptr && this->winEventObjectHook != nullptr &&
+		       this->winEventCloakHook != nullptr;
+	}
+
+	void Win32Platform::StopEventHooks()
+	{
+		StopLocationHook();
+
+		if ( this->winEventHook != nullptr )
+		{
+			::UnhookWinEvent( this->winEventHook );
+			this->winEventHook = nullptr;
+		}
+
+		if ( this->winEventObjectHook != nullptr )
+		{
+			::UnhookWinEvent( this->winEventObjectHook );
+			this->winEventObjectHook = nullptr;
+		}
+
+		if ( this->winEventCloakHook != nullptr )
+		{
+			::UnhookWinEvent( this->winEventCloakHook );
+			this->winEventCloakHook = nullptr;
+		}
+
+		s_eventCallback = nullptr;
+	}
+
+	bool Win32Platform::StartLocationHook( uint32_t pid )
+	{
+		if ( s_eventCallback == nullptr || pid == 0 )
+			return false;
+
+		if ( this->winEventLocationHook != nullptr && this->locationHookPid == pid )
+			return true;
+
+		StopLocationHook();
+
+		// scoped to the process, a global hook would be called for every caret, cursor and window move of the desktop
+		this->winEventLocationHook =
+		    ::SetWinEventHook( EVENT_OBJECT_LOCATIONCHANGE, EVENT_OBJECT_LOCATIONCHANGE, nullptr, WinEventHookProc, pid,
+		                       0, WINEVENT_OUTOFCONTEXT | WINEVENT_SKIPOWNPROCESS );
+		if ( this->winEventLocationHook == nullptr )
+			return false;
+
+		this->locationHookPid = pid;
+		return true;
+	}
+
+	void Win32Platform::StopLocationHook()
+	{
+		if ( this->winEventLocationHook != nullptr )
+		{
+			::UnhookWinEvent( this->winEventLocationHook );
+			this->winEventLocationHook = nullptr;
+		}
+
+		this->locationHookPid = 0;
+	}
+} // namespace Theater
@@ -0,0 +1,57 @@
+#pragma once
+
+namespace Theater
+{
+	class Win32Platform final : public Platform
+	{
+	public:
+		Win32Platform()  = default;
+		~Win32Platform() = default;
+
+		void     EnumTopLevelWindows( std::vector<WindowId>& windows ) const override;
+		bool     IsWindow( WindowId window ) const override;
+		bool     IsTopLevelWindow( WindowId window ) const override;
+		bool     IsWindowVisible( WindowId window ) const override;
+		bool     IsWindowCloaked( WindowId window ) const override;
+		bool     IsWindowTopmost( WindowId window ) const override;
+		WindowId GetWindowOwner( WindowId window ) const override;
+		bool     GetWindowRect( WindowId window, PlatformRect& rect ) const override;
+		size_t   GetWindowClassName( WindowId window, wchar_t* buffer, size_t size ) const override;
+		size_t   GetWindowTitle( WindowId window, wchar_t* buffer, size_t size ) const override;
+		uint32_t GetWindowProcessId( WindowId window ) const override;
+
+		WindowId GetTopWindow() const override;
+		WindowId GetWindowAbove( WindowId window ) const override;
+		WindowId GetWindowBelow( WindowId window ) const override;
+		bool     MoveWindowsBelow( WindowId insertAfter, const WindowId* windows, size_t count ) override;
+		bool     MoveWindowsToBottom( const WindowId* windows, size_t count ) override;
+
+		void ShowWindow( WindowId window, bool state ) override;
+		void SetWindowAlpha( WindowId window, uint8_t alpha ) override;
+
+		void EnumMonitors( std::vector<PlatformMonitor>& monitors ) const override;
+
+		bool QueryProcessId( uint32_t pid, ProcessCache::ProcessId& id ) const override;
+		bool QueryProcessPath( uint32_t pid, std::wstring& path, std::wstring& name ) const override;
+
+		// WinEvent hooks can't carry a context, only one platform can have them installed at a time
+		bool StartEventHooks( WINDOWEVENTCALLBACK callback ) override;
+		void StopEventHooks() override;
+		bool StartLocationHook( uint32_t pid ) override;
+		void StopLocationHook() override;
+
+	private:
+		Win32Platform( const Win32Platform& ) = delete;
+		Win32Platform& operator=( const Win32Platform& ) = delete;
+
+		static void CALLBACK WinEventHookProc( HWINEVENTHOOK hWinEventHook, DWORD event, HWND hwnd, LONG idObject,
+		                                       LONG idChild, DWORD idEventThread, DWORD dwmsEventTime );
+
+	private:
+		HWINEVENTHOOK winEventHook         = nullptr;
+		HWINEVENTHOOK winEventObjectHook   = nullptr;
+		HWINEVENTHOOK winEventCloakHook    = nullptr;
+		HWINEVENTHOOK winEventLocationHook = nullptr;
+		uint32_t      locationHookPid      = 0;
+	};
+} // namespace Theater
\ No newline at end of file
@@ -0,0 +1,184 @@
+#include "theater.h"
+#include "windowregistry.h"
+
+namespace Theater
+{
+	void WindowRegistry::Init( const Platform* platform )
+	{
+		Close();
+		this->platform = platform;
+		if ( this->platform == nullptr )
+			return;
+
+		TraceScope trace( "enumerate-windows" );
+
+		std::vector<WindowId> windows;
+		windows.reserve( 512 );
+		this->platform->EnumTopLevelWindows( windows );
+
+		this->entries.Reserve( windows.size() );
+		this->handles.reserve( windows.size() );
+		for ( const auto window : windows )
+			Add( window );
+	}
+
+	void WindowRegistry::Close()
+	{
+		this->entries.Clear();
+		this->handles.clear();
+		this->visibleWindows.clear();
+		this->visibleWindowsDirty = true;
+		this->platform            = nullptr;
+	}
+
+	WindowRegistry::Entry* WindowRegistry::Find( WindowId window )
+	{
+		const auto iter = this->handles.find( window );
+		if ( iter == this->handles.cend() )
+			return nullptr;
+
+		return this->entries.Get( iter->second );
+	}
+
+	WindowRegistry::Entry* WindowRegistry::Add( WindowId window )
+	{
+		auto entry = Find( window );
+		if ( entry != nullptr )
+			return entry;
+
+		// most enumerated windows are hidden, their cloak state is only asked for once they are shown
+		Entry newEntry   = {};
+		newEntry.id      = window;
+		newEntry.visible = this->platform->IsWindowVisible( window );
+		newEntry.cloaked = newEntry.visible && this->platform->IsWindowCloaked( window );
+
+		const auto handle = this->entries.Insert( newEntry );
+		this->handles.emplace( window, handle );
+		this->visibleWindowsDirty |= newEntry.visible && !newEntry.cloaked;
+		return this->entries.Get( handle );
+	}
+
+	void WindowRegistry::OnWindowCreated( WindowId window )
+	{
+		if ( this->platform == nullptr || !this->platform->IsTopLevelWindow( window ) )
+			return;
+
+		Add( window );
+	}
+
+	void WindowRegistry::OnWindowDestroyed( WindowId window )
+	{
+		const auto iter = this->handles.find( window );
+		if ( iter == this->handles.cend() )
+			return;
+
+		const auto entry = this->entries.Get( iter->second );
+		if ( entry != nullptr )
+			this->visibleWindowsDirty |= entry->visible && !entry->cloaked;
+
+		this->entries.Remove( iter->second );
+		this->handles.erase( iter );
+	}
+
+	void WindowRegistry::OnWindowShown( WindowId window, bool state )
+	{
+		if ( this->platform == nullptr )
+			return;
+
+		// windows created before we started listening are picked up on their first show
+		auto entry = Find( window );
+		if ( entry == nullptr )
+		{
+			if ( !state || !this->platform->IsTopLevelWindow( window ) )
+				return;
+
+			entry = Add( window );
+		}
+
+		if ( entry->visible == state )
+			return;
+
+		// a window added while hidden may have been cloaked all along, no cloak event would tell
+		if ( state )
+			entry->cloaked = this->platform->IsWindowCloaked( window );
+
+		entry->visible = state;
+		this->visibleWindowsDirty |= !entry->cloaked;
+	}
+
+	void WindowRegistry::OnWindowCloaked( WindowId window, bool state )
+	{
+		auto entry = Find( window );
+		if ( entry == nullptr || entry->cloaked == state )
+			return;
+
+		entry->cloaked = state;
+		this->visibleWindowsDirty |= entry->visible;
+	}
+
+	void WindowRegistry::OnWindowEvent( const WindowEvent& event )
+	{
+		switch ( event.type )
+		{
+		case WindowEventType::Foreground:
+		case WindowEventType::LocationChanged:
+			break;
+		case WindowEventType::Created:
+			OnWindowCreated( event.window );
+			break;
+		case WindowEventType::Destroyed:
+			OnWindowDestroyed( event.window );
+			break;
+		case WindowEventType::Shown:
+		case WindowEventType::Hidden:
+			OnWindowShown( event.window, event.type == WindowEventType::Shown );
+			break;
+		case WindowEventType::Cloaked:
+		case WindowEventType::Uncloaked:
+			OnWindowCloaked( event.window, event.type == WindowEventType::Cloaked );
+			break;
+		}
+	}
+
+	bool WindowRegistry::IsInitialized() const
+	{
+		return this->platform != nullptr;
+	}
+
+	bool WindowRegistry::Contains( WindowId window ) const
+	{
+		return this->handles.find( window ) != this->handles.cend();
+	}
+
+	bool WindowRegistry::IsWindowVisible( WindowId window ) const
+	{
+		const auto iter = this->handles.find( window );
+		if ( iter == this->handles.cend() )
+			return false;
+
+		const auto entry = this->entries.Get( iter->second );
+		return entry != nullptr && entry->visible && !entry->cloaked;
+	}
+
+	const std::vector<WindowRegistry::WindowId>& WindowRegistry::GetVisibleWindows() const
+	{
+		if ( this->visibleWindowsDirty )
+		{
+			this->visibleWindows.clear();
+			for ( const auto& entry : this->entries )
+			{
+				if ( entry.visible && !entry.cloaked )
+					this->visibleWindows.emplace_back( entry.id );
+			}
+
+			this->visibleWindowsDirty = false;
+		}
+
+		return this->visibleWindows;
+	}
+
+	size_t WindowRegistry::GetCount() const
+	{
+		return this->entries.GetCount();
+	}
+} // namespace Theater
\ No newline at end of file
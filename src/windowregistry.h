@@ -0,0 +1,54 @@
+#pragma once
+
+namespace Theater
+{
+	// Live set of top-level windows kept up to date from window events instead of enumerating on every activation.
+	// The OS is only reached through the Platform interface, for the initial enumeration and state queries.
+	class WindowRegistry
+	{
+	public:
+		typedef uintptr_t WindowId;
+
+		WindowRegistry()  = default;
+		~WindowRegistry() = default;
+
+		void Init( const Platform* platform );
+		void Close();
+
+		void OnWindowCreated( WindowId window );
+		void OnWindowDestroyed( WindowId window );
+		void OnWindowShown( WindowId window, bool state );
+		void OnWindowCloaked( WindowId window, bool state );
+
+		// Hands a hook event to the handler above matching its type
+		void OnWindowEvent( const WindowEvent& event );
+
+		bool   IsInitialized() const;
+		bool   Contains( WindowId window ) const;
+		bool   IsWindowVisible( WindowId window ) const;
+		size_t GetCount() const;
+
+		// Visible, uncloaked windows, only rebuilt after a change
+		const std::vector<WindowId>& GetVisibleWindows() const;
+
+	private:
+		struct Entry
+		{
+			WindowId id;
+			bool     visible;
+			bool     cloaked;
+		};
+
+		typedef SlotMap<Entry>::Handle Handle;
+
+		Entry* Find( WindowId window );
+		Entry* Add( WindowId window );
+
+	private:
+		const Platform*                      platform = nullptr;
+		SlotMap<Entry>                       entries;
+		std::unordered_map<WindowId, Handle> handles;
+		mutable std::vector<WindowId>        visibleWindows;
+		mutable bool                         visibleWindowsDirty = true;
+	};
+} // namespace Theater
\ No newline at end of file
@@ -0,0 +1,373 @@
+#include "theater.h"
+#include "x11app.h"
+
+#if !defined( _WIN32 )
+#include <X11/Xlib.h>
+#include <cerrno>
+#include <csignal>
+#include <poll.h>
+#include <time.h>
+
+namespace Theater
+{
+	namespace
+	{
+		// hook and display callbacks carry no context
+		X11App*               s_app  = nullptr;
+		volatile sig_atomic_t s_quit = 0;
+
+		// the clock of the platform's event times
+		uint64_t GetTimeMs()
+		{
+			timespec now = {};
+			clock_gettime( CLOCK_MONOTONIC, &now );
+			return static_cast<uint64_t>( now.tv_sec ) * 1000 + now.tv_nsec / 1000000;
+		}
+
+		void OnQuitSignal( int )
+		{
+			X11App::Quit();
+		}
+	} // namespace
+
+	bool X11App::Init( const char* displayName, const SettingsData& settings )
+	{
+		if ( !this->platform.Open( displayName ) )
+			return false;
+
+		s_app = this;
+		if ( !this->dimmer.Init( &this->platform ) )
+			return false;
+
+		this->alpha = settings.alpha / 255.0f;
+		this->dimmer.SetColor( settings.color );
+		this->dimmer.SetLevels( settings.alpha, settings.monitorLevels );
+		this->dimmer.SetTopologyChangedCallback( X11App::TopologyChangedCallback );
+		this->platform.SetDisplayChangedCallback( X11App::DisplayChangedCallback );
+		UpdateZOrderDimmers();
+
+		this->fade.SetDuration( settings.fadeDuration );
+		this->fade.SetEasing( settings.fadeEasing );
+		this->fade.Reset( 0.0f );
+
+		this->registry.Init( &this->platform );
+		this->resolver.SetPlatform( &this->platform );
+		this->resolver.Configure( settings.processNames, settings.rules );
+		this->resolver.ConfigureCompanions( settings.companionNames );
+		this->coalescer.Clear();
+
+		// disabled, the dimmers are created but nothing ever shows them
+		if ( settings.enabled )
+			this->platform.StartEventHooks( X11App::EventCallback );
+
+		return true;
+	}
+
+	void X11App::Close()
+	{
+		TrackStop();
+		this->platform.StopEventHooks();
+		this->dimmer.Close();
+		this->registry.Close();
+		this->resolver.Clear();
+		this->session.Reset();
+		this->platform.Close();
+
+		this->theaterShown = false;
+		this->dimmerShown  = false;
+		this->target       = Platform::NO_WINDOW;
+		if ( s_app == this )
+			s_app = nullptr;
+	}
+
+	int X11App::Run()
+	{
+		// no SA_RESTART, the signal has to break the poll
+		struct sigaction action = {};
+		action.sa_handler       = OnQuitSignal;
+		sigemptyset( &action.sa_mask );
+		sigaction( SIGINT, &action, nullptr );
+		sigaction( SIGTERM, &action, nullptr );
+
+		s_quit = 0;
+		while ( s_quit == 0 )
+		{
+			if ( !Step( GetTimeout() ) )
+				return 1;
+		}
+
+		return 0;
+	}
+
+	void X11App::Quit()
+	{
+		s_quit = 1;
+	}
+
+	bool X11App::Step( uint32_t timeoutMs )
+	{
+		// Xlib may have queued events while reading a reply, the connection won't be readable for those
+		if ( XPending( this->platform.GetDisplay() ) == 0 )
+		{
+			pollfd connection = {};
+			connection.fd     = this->platform.GetConnectionNumber();
+			connection.events = POLLIN;
+			const int timeout = timeoutMs == NO_TIMEOUT ? -1 : static_cast<int>( timeoutMs );
+			const int ready   = poll( &connection, 1, timeout );
+			if ( ready < 0 && errno != EINTR )
+				return false;
+			if ( ready > 0 && ( connection.revents & ( POLLERR | POLLHUP ) ) != 0 )
+				return false;
+		}
+
+		const uint64_t now = GetTimeMs();
+		Dispatch( now );
+		Decide( now );
+		Track( now );
+		FadeTick();
+		return true;
+	}
+
+	uint32_t X11App::GetTimeout() const
+	{
+		// all of them use NO_TIMEOUT as the largest value
+		const uint64_t now     = GetTimeMs();
+		uint32_t       timeout = std::min( this->coalescer.GetTimeout( now ), this->tracker.GetTimeout( now ) );
+		if ( this->fade.IsRunning() )
+			timeout = std::min( timeout, TargetTracker::DEFAULT_FRAME_PERIOD );
+
+		return timeout;
+	}
+
+	void X11App::Dispatch( uint64_t nowMs )
+	{
+		TraceScope trace( "dispatch" );
+
+		this->events.clear();
+		this->platform.DispatchEvents();
+
+		for ( const auto& event : this->events )
+		{
+			// the target's moves only matter to the tracker
+			if ( event.type == WindowEventType::LocationChanged )
+			{
+				this->tracker.Push( event, nowMs );
+				continue;
+			}
+
+			if ( !this->coalescer.Push( event, nowMs ) )
+				continue;
+
+			this->registry.OnWindowEvent( event );
+			if ( event.type == WindowEventType::Destroyed )
+				this->resolver.RemoveWindow( event.window );
+
+			this->session.OnWindowEvent( event, this->resolver, this->registry, nullptr );
+		}
+	}
+
+	void X11App::Decide( uint64_t nowMs )
+	{
+		WindowEvent foreground = {};
+		if ( !this->coalescer.PopForeground( nowMs, foreground ) )
+			return;
+
+		TheaterSession::Transition transition = TheaterSession::Transition::Stop;
+		if ( !this->session.OnForeground( foreground.window, this->resolver, this->registry, nullptr, transition ) )
+			return;
+
+		// the window may be gone already, the session is over then
+		if ( transition == TheaterSession::Transition::Stop || !this->platform.IsWindow( foreground.window ) )
+			TheaterStop();
+		else if ( transition == TheaterSession::Transition::Switch && this->theaterShown )
+			TheaterSwitch( foreground.window );
+		else
+			TheaterStart( foreground.window );
+	}
+
+	void X11App::Track( uint64_t nowMs )
+	{
+		uint32_t changes = 0;
+		if ( !this->tracker.Pop( this->platform, nowMs, changes ) )
+			return;
+
+		TraceScope trace( "target-track", this->tracker.GetWindow() );
+		if ( ( changes & TargetTracker::TARGET_MONITORS_CHANGED ) != 0 )
+			Arrange();
+	}
+
+	void X11App::TheaterStart( Platform::WindowId window )
+	{
+		TraceScope trace( "theater-start", window );
+
+		const bool wasTheaterShown = this->theaterShown;
+		this->theaterShown         = true;
+		this->target               = window;
+
+		if ( !wasTheaterShown )
+		{
+			// a fade out might still be running, in which case we fade back in from where it is
+			if ( !this->dimmerShown )
+			{
+				this->fade.Reset( 0.0f );
+				this->dimmer.SetAlpha( 0.0f );
+				this->dimmer.Show( true );
+				this->dimmerShown = true;
+			}
+
+			FadeStart( this->alpha );
+		}
+
+		TrackStart( window );
+		Arrange();
+	}
+
+	void X11App::TheaterSwitch( Platform::WindowId window )
+	{
+		TraceScope trace( "theater-switch", window );
+
+		// focus moved within the session, all of its windows are above the dimmers already
+		this->target = window;
+		TrackStart( window );
+	}
+
+	void X11App::TheaterStop()
+	{
+		if ( !this->theaterShown )
+			return;
+
+		// the dimmer gets hidden once faded out
+		this->theaterShown = false;
+		this->target       = Platform::NO_WINDOW;
+		TrackStop();
+		FadeStart( 0.0f );
+	}
+
+	void X11App::Arrange()
+	{
+		if ( !this->theaterShown )
+			return;
+
+		this->session.GetCompanions( this->target, this->companions );
+		this->arranger.Arrange( this->platform, this->target, this->companions, this->registry, nullptr );
+	}
+
+	void X11App::UpdateZOrderDimmers()
+	{
+		const size_t dimmerCount = this->dimmer.GetWindowCount();
+		this->zOrderDimmers.resize( dimmerCount );
+		for ( size_t i = 0; i < dimmerCount; i++ )
+		{
+			this->zOrderDimmers[i].window  = this->dimmer.GetWindow( i );
+			this->zOrderDimmers[i].monitor = this->dimmer.GetMonitorRect( i );
+		}
+
+		this->arranger.SetDimmers( this->zOrderDimmers );
+
+		std::vector<PlatformRect> monitors;
+		for ( const auto& zOrderDimmer : this->zOrderDimmers )
+			monitors.emplace_back( zOrderDimmer.monitor );
+
+		this->tracker.SetMonitors( monitors );
+	}
+
+	void X11App::FadeStart( float value )
+	{
+		this->fade.Start( value );
+		FadeTick();
+	}
+
+	void X11App::FadeTick()
+	{
+		if ( !this->fade.IsRunning() )
+			return;
+
+		uint8_t value = 0;
+		if ( this->fade.Tick( value ) )
+			this->dimmer.SetAlpha( value / 255.0f );
+
+		if ( this->fade.IsRunning() )
+			return;
+
+		if ( !this->theaterShown && this->dimmerShown )
+		{
+			this->dimmer.Show( false );
+			this->dimmerShown = false;
+		}
+	}
+
+	void X11App::TrackStart( Platform::WindowId window )
+	{
+		if ( !this->tracker.Track( this->platform, window ) )
+		{
+			TrackStop();
+			return;
+		}
+
+		// a switch within the session may stay on the same process, the hook is kept then
+		this->platform.StartLocationHook( this->platform.GetWindowProcessId( window ) );
+	}
+
+	void X11App::TrackStop()
+	{
+		this->tracker.Clear();
+		this->platform.StopLocationHook();
+	}
+
+	bool X11App::IsTheaterShown() const
+	{
+		return this->theaterShown;
+	}
+
+	bool X11App::IsDimmerShown() const
+	{
+		return this->dimmerShown;
+	}
+
+	Platform::WindowId X11App::GetTarget() const
+	{
+		return this->target;
+	}
+
+	const X11Platform& X11App::GetPlatform() const
+	{
+		return this->platform;
+	}
+
+	const X11Dimmer& X11App::GetDimmer() const
+	{
+		return this->dimmer;
+	}
+
+	const TheaterSession& X11App::GetSession() const
+	{
+		return this->session;
+	}
+
+	const TargetTracker& X11App::GetTracker() const
+	{
+		return this->tracker;
+	}
+
+	const FadeAnimation& X11App::GetFade() const
+	{
+		return this->fade;
+	}
+
+	void X11App::EventCallback( const WindowEvent& event )
+	{
+		s_app->events.emplace_back( event );
+	}
+
+	void X11App::DisplayChangedCallback()
+	{
+		s_app->dimmer.Reconcile();
+	}
+
+	void X11App::TopologyChangedCallback()
+	{
+		s_app->UpdateZOrderDimmers();
+		s_app->Arrange();
+	}
+} // namespace Theater
+#endif
@@ -0,0 +1,85 @@
+#pragma once
+
+namespace Theater
+{
+	// The app on the X11 backend, everything runs on the thread calling Run. Hook events go through the coalescer
+	// into the registry, the resolver and the theater session the way HeadlessPipeline::Dispatch takes them, a
+	// session start fades the dimmers in and arranges them below the target, a stop fades them out.
+	// The target is tracked through the location hook while a session is on, every dimmer only covers its own
+	// monitor so a target moved onto other monitors is arranged again.
+	// The loop sleeps in poll() on the connection until the coalescer, the tracker or the fade is due.
+	class X11App
+	{
+	public:
+		X11App()  = default;
+		~X11App() = default;
+
+		// nullptr opens $DISPLAY. Only one app can be initialized at a time, the callbacks carry no context.
+		bool Init( const char* displayName, const SettingsData& settings );
+		void Close();
+
+		// Steps until Quit, which is safe to call from a signal handler. Returns the exit code.
+		int         Run();
+		static void Quit();
+
+		// One pass of the loop, waiting at most timeoutMs for the server. False once the connection is gone.
+		bool Step( uint32_t timeoutMs );
+
+		// Milliseconds until the coalescer, the tracker or the fade is due, NO_TIMEOUT when nothing is pending
+		uint32_t GetTimeout() const;
+
+		static constexpr uint32_t NO_TIMEOUT = WindowEventCoalescer::NO_TIMEOUT;
+
+		bool                  IsTheaterShown() const;
+		bool                  IsDimmerShown() const;
+		Platform::WindowId    GetTarget() const;
+		const X11Platform&    GetPlatform() const;
+		const X11Dimmer&      GetDimmer() const;
+		const TheaterSession& GetSession() const;
+		const TargetTracker&  GetTracker() const;
+		const FadeAnimation&  GetFade() const;
+
+	private:
+		X11App( const X11App& ) = delete;
+		X11App& operator=( const X11App& ) = delete;
+
+		static void EventCallback( const WindowEvent& event );
+		static void DisplayChangedCallback();
+		static void TopologyChangedCallback();
+
+		void Dispatch( uint64_t nowMs );
+		void Decide( uint64_t nowMs );
+		void Track( uint64_t nowMs );
+
+		void TheaterStart( Platform::WindowId window );
+		void TheaterSwitch( Platform::WindowId window );
+		void TheaterStop();
+		void Arrange();
+		void UpdateZOrderDimmers();
+
+		void FadeStart( float alpha );
+		void FadeTick();
+
+		void TrackStart( Platform::WindowId window );
+		void TrackStop();
+
+	private:
+		X11Platform                     platform;
+		X11Dimmer                       dimmer;
+		WindowRegistry                  registry;
+		TargetResolver                  resolver;
+		TheaterSession                  session;
+		TargetTracker                   tracker;
+		WindowEventCoalescer            coalescer;
+		ZOrderArranger                  arranger;
+		FadeAnimation                   fade;
+		std::vector<WindowEvent>        events;
+		std::vector<ZOrderDimmer>       zOrderDimmers;
+		std::vector<Platform::WindowId> companions;
+
+		float              alpha        = 0.0f; // where a fade in ends, the settings' alpha
+		bool               theaterShown = false;
+		bool               dimmerShown  = false;
+		Platform::WindowId target       = Platform::NO_WINDOW;
+	};
+} // namespace Theater
\ No newline at end of file
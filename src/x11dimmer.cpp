@@ -0,0 +1,352 @@
+#include "theater.h"
+#include "x11dimmer.h"
+
+#if !defined( _WIN32 )
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/shape.h>
+
+namespace Theater
+{
+	namespace
+	{
+		constexpr char DIMMER_WINDOW_NAME[]  = "TheaterDimmerWindow";
+		constexpr char DIMMER_WINDOW_CLASS[] = "Theater";
+
+		Window ToWindow( Platform::WindowId window )
+		{
+			return static_cast<Window>( window );
+		}
+
+		// pixel of an opaque 0x00BBGGRR color in a TrueColor visual, the opacity is up to the compositor
+		unsigned long ToPixel( uint32_t color )
+		{
+			const unsigned long r = color & 0xFF;
+			const unsigned long g = ( color >> 8 ) & 0xFF;
+			const unsigned long b = ( color >> 16 ) & 0xFF;
+			return 0xFF000000ul | ( r << 16 ) | ( g << 8 ) | b;
+		}
+	} // namespace
+
+	bool X11Dimmer::WindowsCreate()
+	{
+		Display* display = this->platform->GetDisplay();
+		const int screen = DefaultScreen( display );
+
+		// without a compositing manager an ARGB window is drawn opaque, the default visual is as good then
+		XVisualInfo visualInfo = {};
+		if ( XMatchVisualInfo( display, screen, 32, TrueColor, &visualInfo ) )
+		{
+			this->visualId = XVisualIDFromVisual( visualInfo.visual );
+			this->depth    = visualInfo.depth;
+			this->colormap = XCreateColormap( display, RootWindow( display, screen ), visualInfo.visual, AllocNone );
+		}
+		else
+		{
+			this->visualId = XVisualIDFromVisual( DefaultVisual( display, screen ) );
+			this->depth    = DefaultDepth( display, screen );
+			this->colormap = DefaultColormap( display, screen );
+		}
+
+		std::vector<PlatformMonitor> platformMonitors;
+		this->platform->EnumMonitors( platformMonitors );
+		for ( auto& platformMonitor : platformMonitors )
+		{
+			MonitorInstance monitor = {};
+			monitor.device          = std::move( platformMonitor.device );
+			monitor.rect            = platformMonitor.rect;
+			monitor.window          = Platform::NO_WINDOW;
+			this->monitors.emplace_back( std::move( monitor ) );
+		}
+
+		// for each monitor, create a window overlapping the entire region
+		for ( auto& monitor : this->monitors )
+			WindowCreate( monitor );
+
+		LevelsAssign();
+		LevelsApply();
+		return true;
+	}
+
+	void X11Dimmer::WindowsDestroy()
+	{
+		if ( this->platform == nullptr || !this->platform->IsOpen() )
+			return;
+
+		Display* display = this->platform->GetDisplay();
+		for ( const auto& monitor : this->monitors )
+		{
+			if ( monitor.window != Platform::NO_WINDOW )
+				XDestroyWindow( display, ToWindow( monitor.window ) );
+		}
+
+		for ( const auto window : this->windowPool )
+			XDestroyWindow( display, ToWindow( window ) );
+
+		const int screen = DefaultScreen( display );
+		if ( this->colormap != 0 && this->colormap != DefaultColormap( display, screen ) )
+			XFreeColormap( display, this->colormap );
+
+		XFlush( display );
+
+		this->monitors.clear();
+		this->windowPool.clear();
+		this->colormap = 0;
+	}
+
+	bool X11Dimmer::WindowCreate( MonitorInstance& monitor )
+	{
+		Display*           display = this->platform->GetDisplay();
+		const unsigned int width   = static_cast<unsigned int>( monitor.rect.right - monitor.rect.left );
+		const unsigned int height  = static_cast<unsigned int>( monitor.rect.bottom - monitor.rect.top );
+
+		// retired windows are kept around, reusing one is cheaper than creating a new one
+		if ( !this->windowPool.empty() )
+		{
+			monitor.window = this->windowPool.back();
+			this->windowPool.pop_back();
+			XMoveResizeWindow( display, ToWindow( monitor.window ), monitor.rect.left, monitor.rect.top, width,
+			                   height );
+		}
+		else
+		{
+			XVisualInfo visualTemplate = {};
+			visualTemplate.visualid    = this->visualId;
+			int          visualCount   = 0;
+			XVisualInfo* visualInfo    = XGetVisualInfo( display, VisualIDMask, &visualTemplate, &visualCount );
+			if ( visualInfo == nullptr )
+				return false;
+
+			// override-redirect, the window manager neither decorates nor restacks it
+			XSetWindowAttributes attributes = {};
+			attributes.override_redirect    = True;
+			attributes.colormap             = this->colormap;
+			attributes.background_pixel     = ToPixel( 0 );
+			attributes.border_pixel         = 0;
+
+			const unsigned long mask   = CWOverrideRedirect | CWColormap | CWBackPixel | CWBorderPixel;
+			const Window        window =
+			    XCreateWindow( display, DefaultRootWindow( display ), monitor.rect.left, monitor.rect.top, width,
+			                   height, 0, this->depth, InputOutput, visualInfo->visual, mask, &attributes );
+			XFree( visualInfo );
+			if ( window == None )
+				return false;
+
+			XStoreName( display, window, DIMMER_WINDOW_NAME );
+
+			XClassHint classHint = {};
+			classHint.res_name   = const_cast<char*>( DIMMER_WINDOW_NAME );
+			classHint.res_class  = const_cast<char*>( DIMMER_WINDOW_CLASS );
+			XSetClassHint( display, window, &classHint );
+
+			// an empty input region lets clicks through to whatever is below
+			XShapeCombineRectangles( display, window, ShapeInput, 0, 0, nullptr, 0, ShapeSet, Unsorted );
+
+			monitor.window = window;
+		}
+
+		// alpha and color are applied once the monitor levels are bound
+		this->platform->SetWindowAlpha( monitor.window, 0 );
+
+		if ( this->shown )
+			this->platform->ShowWindow( monitor.window, true );
+
+		return true;
+	}
+
+	void X11Dimmer::WindowMove( MonitorInstance& monitor )
+	{
+		const unsigned int width  = static_cast<unsigned int>( monitor.rect.right - monitor.rect.left );
+		const unsigned int height = static_cast<unsigned int>( monitor.rect.bottom - monitor.rect.top );
+		XMoveResizeWindow( this->platform->GetDisplay(), ToWindow( monitor.window ), monitor.rect.left,
+		                   monitor.rect.top, width, height );
+		XFlush( this->platform->GetDisplay() );
+	}
+
+	void X11Dimmer::WindowRetire( MonitorInstance& monitor )
+	{
+		this->platform->ShowWindow( monitor.window, false );
+		this->windowPool.emplace_back( monitor.window );
+		monitor.window = Platform::NO_WINDOW;
+	}
+
+	void X11Dimmer::WindowSetColor( Platform::WindowId window, uint32_t color )
+	{
+		// the server fills the background itself, nothing to draw
+		Display* display = this->platform->GetDisplay();
+		XSetWindowBackground( display, ToWindow( window ), ToPixel( color ) );
+		XClearWindow( display, ToWindow( window ) );
+		XFlush( display );
+	}
+
+	void X11Dimmer::Reconcile()
+	{
+		std::vector<PlatformMonitor> platformMonitors;
+		this->platform->EnumMonitors( platformMonitors );
+
+		std::vector<MonitorInstance> next;
+		next.reserve( platformMonitors.size() );
+		for ( auto& platformMonitor : platformMonitors )
+		{
+			MonitorInstance monitor = {};
+			monitor.device          = std::move( platformMonitor.device );
+			monitor.rect            = platformMonitor.rect;
+			monitor.window          = Platform::NO_WINDOW;
+			next.emplace_back( std::move( monitor ) );
+		}
+
+		std::vector<MonitorLayout> formerLayouts;
+		std::vector<MonitorLayout> nextLayouts;
+		formerLayouts.reserve( this->monitors.size() );
+		nextLayouts.reserve( next.size() );
+		for ( const auto& monitor : this->monitors )
+			formerLayouts.emplace_back( MonitorLayout{ monitor.device, monitor.rect.left, monitor.rect.top,
+			                                           monitor.rect.right, monitor.rect.bottom } );
+		for ( const auto& monitor : next )
+			nextLayouts.emplace_back( MonitorLayout{ monitor.device, monitor.rect.left, monitor.rect.top,
+			                                         monitor.rect.right, monitor.rect.bottom } );
+
+		MonitorTopologyDiff diff;
+		DiffMonitorTopology( formerLayouts, nextLayouts, diff );
+
+		// retire first so created monitors can reuse those windows right away
+		for ( const size_t index : diff.retired )
+			WindowRetire( this->monitors[index] );
+
+		bool changed = !diff.retired.empty();
+		for ( size_t i = 0; i < next.size(); i++ )
+		{
+			const auto& entry = diff.entries[i];
+			if ( entry.action == MonitorAction::Create )
+			{
+				WindowCreate( next[i] );
+				changed = true;
+				continue;
+			}
+
+			// take the former window over, only the monitor identity comes from the new set
+			next[i].window = this->monitors[entry.source].window;
+			if ( entry.action == MonitorAction::Move )
+			{
+				WindowMove( next[i] );
+				changed = true;
+			}
+		}
+
+		this->monitors = std::move( next );
+
+		// monitors taken over keep their levels, the others are presented once bound
+		LevelsAssign();
+		for ( size_t i = 0; i < diff.entries.size(); i++ )
+		{
+			if ( diff.entries[i].action != MonitorAction::Keep )
+				this->levels.Invalidate( i );
+		}
+		LevelsApply();
+
+		if ( changed && this->topologyCallback != nullptr )
+			this->topologyCallback();
+	}
+
+	void X11Dimmer::SetTopologyChangedCallback( TOPOLOGYCHANGEDCALLBACK callback )
+	{
+		this->topologyCallback = callback;
+	}
+
+	bool X11Dimmer::Init( X11Platform* platform )
+	{
+		this->platform = platform;
+		if ( this->platform == nullptr || !this->platform->IsOpen() )
+			return false;
+
+		return WindowsCreate();
+	}
+
+	void X11Dimmer::Close()
+	{
+		WindowsDestroy();
+		this->platform = nullptr;
+	}
+
+	void X11Dimmer::Show( bool state )
+	{
+		this->shown = state;
+		for ( const auto& monitor : this->monitors )
+			this->platform->ShowWindow( monitor.window, state );
+	}
+
+	bool X11Dimmer::IsDimmerWindow( Platform::WindowId window ) const
+	{
+		for ( const auto& monitor : this->monitors )
+		{
+			if ( window == monitor.window )
+				return true;
+		}
+
+		return false;
+	}
+
+	size_t X11Dimmer::GetWindowCount() const
+	{
+		return this->monitors.size();
+	}
+
+	Platform::WindowId X11Dimmer::GetWindow( size_t index ) const
+	{
+		return this->monitors[index].window;
+	}
+
+	PlatformRect X11Dimmer::GetMonitorRect( size_t index ) const
+	{
+		return this->monitors[index].rect;
+	}
+
+	void X11Dimmer::SetAlpha( float alpha )
+	{
+		this->levels.SetFade( alpha );
+		LevelsApply();
+	}
+
+	void X11Dimmer::SetColor( uint32_t color )
+	{
+		this->levels.SetBaseColor( color );
+		LevelsApply();
+	}
+
+	void X11Dimmer::SetLevels( uint8_t alpha, const std::vector<MonitorLevel>& overrides )
+	{
+		this->levels.SetBaseAlpha( alpha );
+		this->levels.SetOverrides( overrides );
+		LevelsApply();
+	}
+
+	void X11Dimmer::LevelsAssign()
+	{
+		std::vector<std::wstring> devices;
+		devices.reserve( this->monitors.size() );
+		for ( const auto& monitor : this->monitors )
+			devices.emplace_back( monitor.device );
+
+		this->levels.Assign( devices.data(), devices.size() );
+	}
+
+	void X11Dimmer::LevelsApply()
+	{
+		// called on every fade tick, only monitors whose quantized alpha or color changed are touched
+		if ( !this->levels.Update( this->levelChanges ) )
+			return;
+
+		for ( const auto& change : this->levelChanges )
+		{
+			const auto& monitor = this->monitors[change.index];
+			if ( monitor.window == Platform::NO_WINDOW )
+				continue;
+
+			if ( change.flags & MonitorLevels::ALPHA_CHANGED )
+				this->platform->SetWindowAlpha( monitor.window, this->levels.GetAlpha( change.index ) );
+			if ( change.flags & MonitorLevels::COLOR_CHANGED )
+				WindowSetColor( monitor.window, this->levels.GetColor( change.index ) );
+		}
+	}
+} // namespace Theater
+#endif
@@ -0,0 +1,70 @@
+#pragma once
+
+namespace Theater
+{
+	// Dimmer of the X11 backend, one override-redirect window per XRandR monitor.
+	// The windows use an ARGB visual when there is one and take no input. Alpha goes through the platform's
+	// _NET_WM_WINDOW_OPACITY so fades never repaint, only a color change refills the window background.
+	// Spotlight and gradients are not supported, they need the compositor to blend a per-pixel surface.
+	class X11Dimmer
+	{
+	public:
+		X11Dimmer()  = default;
+		~X11Dimmer() = default;
+
+		bool Init( X11Platform* platform );
+		void Close();
+
+		void               Show( bool state );
+		bool               IsDimmerWindow( Platform::WindowId window ) const;
+		size_t             GetWindowCount() const;
+		Platform::WindowId GetWindow( size_t index ) const;
+		PlatformRect       GetMonitorRect( size_t index ) const;
+
+		void SetAlpha( float alpha );
+		void SetColor( uint32_t color ); // 0x00BBGGRR like MonitorLevel::color
+
+		// Per monitor overrides, alpha is where each monitor lands when the fade reaches the global alpha
+		void SetLevels( uint8_t alpha, const std::vector<MonitorLevel>& overrides );
+
+		// Matches the windows to the monitors again, to be called from the platform's display changed callback
+		void Reconcile();
+
+		// Called after display changes added, moved or retired dimmer windows
+		typedef void ( *TOPOLOGYCHANGEDCALLBACK )();
+		void SetTopologyChangedCallback( TOPOLOGYCHANGEDCALLBACK callback );
+
+	private:
+		struct MonitorInstance
+		{
+			std::wstring       device;
+			PlatformRect       rect;
+			Platform::WindowId window;
+		};
+
+		bool WindowsCreate();
+		void WindowsDestroy();
+		bool WindowCreate( MonitorInstance& monitor );
+		void WindowMove( MonitorInstance& monitor );
+		void WindowRetire( MonitorInstance& monitor );
+		void WindowSetColor( Platform::WindowId window, uint32_t color );
+		void LevelsAssign();
+		void LevelsApply();
+
+	private:
+		X11Platform*                    platform = nullptr;
+		std::vector<MonitorInstance>    monitors;
+		std::vector<Platform::WindowId> windowPool;
+		bool                            shown            = false;
+		TOPOLOGYCHANGEDCALLBACK         topologyCallback = nullptr;
+
+		// ARGB visual of the windows, the default one without a compositing manager
+		unsigned long visualId = 0;
+		int           depth    = 0;
+		unsigned long colormap = 0;
+
+		// alpha and color of each monitor, indexed like monitors
+		MonitorLevels                      levels;
+		std::vector<MonitorLevels::Change> levelChanges;
+	};
+} // namespace Theater
\ No newline at end of file
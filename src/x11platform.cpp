@@ -0,0 +1,943 @@
+#include "theater.h"
+#include "x11platform.h"
+
+#if !defined( _WIN32 )
+#include <X11/Xatom.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/Xrandr.h>
+#include <climits>
+#include <cstdio>
+#include <time.h>
+#include <unistd.h>
+
+namespace Theater
+{
+	namespace
+	{
+		// in the order of X11Platform::AtomIndex
+		const char* const ATOM_NAMES[] = {
+			"_NET_ACTIVE_WINDOW",
+			"_NET_CLIENT_LIST",
+			"_NET_CURRENT_DESKTOP",
+			"_NET_WM_DESKTOP",
+			"_NET_WM_STATE",
+			"_NET_WM_STATE_ABOVE",
+			"_NET_WM_STATE_HIDDEN",
+			"_NET_WM_PID",
+			"_NET_WM_NAME",
+			"_NET_WM_WINDOW_OPACITY",
+			"_NET_RESTACK_WINDOW",
+			"WM_STATE",
+			"UTF8_STRING",
+		};
+
+		// _NET_WM_DESKTOP of windows shown on every desktop
+		constexpr unsigned long ALL_DESKTOPS = 0xFFFFFFFFul;
+
+		// _NET_RESTACK_WINDOW source indication, pagers are obeyed where applications might be ignored
+		constexpr long RESTACK_SOURCE_PAGER = 2;
+
+		constexpr int MAX_CLIENT_DEPTH = 3;
+
+		Window ToWindow( Platform::WindowId window )
+		{
+			return static_cast<Window>( window );
+		}
+
+		// windows can go away between any two requests, failed requests are reported by their return value instead
+		int IgnoreErrors( Display*, XErrorEvent* )
+		{
+			return 0;
+		}
+
+		uint32_t GetTimeMs()
+		{
+			timespec now = {};
+			clock_gettime( CLOCK_MONOTONIC, &now );
+			return static_cast<uint32_t>( static_cast<uint64_t>( now.tv_sec ) * 1000 + now.tv_nsec / 1000000 );
+		}
+
+		// Property data of format 32, which Xlib hands out as longs whatever their size on the wire
+		unsigned long* GetLongProperty( Display* display, Window window, Atom property, Atom type, long maxLength,
+		                                unsigned long& count )
+		{
+			Atom           actualType   = None;
+			int            actualFormat = 0;
+			unsigned long  bytesAfter   = 0;
+			unsigned char* data         = nullptr;
+			count                       = 0;
+			if ( XGetWindowProperty( display, window, property, 0, maxLength, False, type, &actualType, &actualFormat,
+			                         &count, &bytesAfter, &data ) != Success )
+				return nullptr;
+
+			if ( data != nullptr && ( actualType != type || actualFormat != 32 ) )
+			{
+				XFree( data );
+				return nullptr;
+			}
+
+			return reinterpret_cast<unsigned long*>( data );
+		}
+
+		// Lenient decoder, malformed sequences become U+FFFD. Always terminates buffer, returns the characters written.
+		size_t DecodeUtf8( const char* text, size_t length, wchar_t* buffer, size_t size )
+		{
+			if ( size == 0 )
+				return 0;
+
+			const auto bytes   = reinterpret_cast<const unsigned char*>( text );
+			size_t     written = 0;
+			size_t     i       = 0;
+			while ( i < length && written + 1 < size )
+			{
+				const unsigned char lead = bytes[i++];
+
+				uint32_t codepoint = 0xFFFD;
+				size_t   trailing  = 0;
+				if ( lead < 0x80 )
+				{
+					codepoint = lead;
+				}
+				else if ( ( lead & 0xE0 ) == 0xC0 )
+				{
+					codepoint = lead & 0x1F;
+					trailing  = 1;
+				}
+				else if ( ( lead & 0xF0 ) == 0xE0 )
+				{
+					codepoint = lead & 0x0F;
+					trailing  = 2;
+				}
+				else if ( ( lead & 0xF8 ) == 0xF0 )
+				{
+					codepoint = lead & 0x07;
+					trailing  = 3;
+				}
+
+				for ( ; trailing > 0; trailing-- )
+				{
+					if ( i >= length || ( bytes[i] & 0xC0 ) != 0x80 )
+					{
+						codepoint = 0xFFFD;
+						break;
+					}
+
+					codepoint = ( codepoint << 6 ) | ( bytes[i++] & 0x3F );
+				}
+
+				buffer[written++] = static_cast<wchar_t>( codepoint );
+			}
+
+			buffer[written] = 0;
+			return written;
+		}
+
+		void DecodeUtf8( const char* text, std::wstring& result )
+		{
+			const size_t length = strlen( text );
+			result.resize( length + 1 );
+			result.resize( DecodeUtf8( text, length, &result[0], result.size() ) );
+		}
+	} // namespace
+
+	X11Platform::~X11Platform()
+	{
+		Close();
+	}
+
+	bool X11Platform::Open( const char* displayName )
+	{
+		Close();
+
+		// the resolver queries windows from the event worker
+		XInitThreads();
+
+		this->display = XOpenDisplay( displayName );
+		if ( this->display == nullptr )
+			return false;
+
+		XSetErrorHandler( IgnoreErrors );
+		XInternAtoms( this->display, const_cast<char**>( ATOM_NAMES ), ATOM_COUNT, False, this->atoms );
+
+		int errorBase = 0;
+		if ( !XRRQueryExtension( this->display, &this->randrEventBase, &errorBase ) )
+			this->randrEventBase = -1;
+
+		if ( this->randrEventBase >= 0 )
+			XRRSelectInput( this->display, ToWindow( GetRootWindow() ), RRScreenChangeNotifyMask );
+
+		this->currentPid    = static_cast<uint32_t>( getpid() );
+		this->stackingDirty = true;
+		SelectRootInput();
+		return true;
+	}
+
+	void X11Platform::Close()
+	{
+		if ( this->display == nullptr )
+			return;
+
+		StopEventHooks();
+		XCloseDisplay( this->display );
+
+		this->display        = nullptr;
+		this->randrEventBase = -1;
+		this->stacking.clear();
+		this->stackingIndex.clear();
+		this->frameClients.clear();
+		this->clientFrames.clear();
+		this->stackingDirty = true;
+	}
+
+	bool X11Platform::IsOpen() const
+	{
+		return this->display != nullptr;
+	}
+
+	_XDisplay* X11Platform::GetDisplay() const
+	{
+		return this->display;
+	}
+
+	int X11Platform::GetConnectionNumber() const
+	{
+		return this->display != nullptr ? ConnectionNumber( this->display ) : -1;
+	}
+
+	void X11Platform::SetDisplayChangedCallback( DISPLAYCHANGEDCALLBACK callback )
+	{
+		this->displayCallback = callback;
+	}
+
+	size_t X11Platform::DispatchEvents()
+	{
+		if ( this->display == nullptr )
+			return 0;
+
+		size_t count = 0;
+		while ( XPending( this->display ) > 0 )
+		{
+			XEvent event;
+			XNextEvent( this->display, &event );
+			OnEvent( event );
+			count++;
+		}
+
+		return count;
+	}
+
+	bool X11Platform::ReadCardinal( WindowId window, AtomIndex property, unsigned long& value ) const
+	{
+		unsigned long  count = 0;
+		unsigned long* data  = GetLongProperty( this->display, ToWindow( window ), this->atoms[property], XA_CARDINAL,
+		                                        1, count );
+		if ( data == nullptr )
+			return false;
+
+		const bool result = count > 0;
+		if ( result )
+			value = data[0];
+
+		XFree( data );
+		return result;
+	}
+
+	bool X11Platform::ReadWindows( WindowId window, AtomIndex property, std::vector<WindowId>& windows ) const
+	{
+		windows.clear();
+
+		unsigned long  count = 0;
+		unsigned long* data  = GetLongProperty( this->display, ToWindow( window ), this->atoms[property], XA_WINDOW,
+		                                        LONG_MAX, count );
+		if ( data == nullptr )
+			return false;
+
+		windows.assign( data, data + count );
+		XFree( data );
+		return true;
+	}
+
+	bool X11Platform::HasState( WindowId window, AtomIndex state ) const
+	{
+		unsigned long  count = 0;
+		unsigned long* data  = GetLongProperty( this->display, ToWindow( window ), this->atoms[ATOM_NET_WM_STATE],
+		                                        XA_ATOM, 64, count );
+		if ( data == nullptr )
+			return false;
+
+		const bool result = std::find( data, data + count, this->atoms[state] ) != data + count;
+		XFree( data );
+		return result;
+	}
+
+	Platform::WindowId X11Platform::GetRootWindow() const
+	{
+		return DefaultRootWindow( this->display );
+	}
+
+	unsigned long X11Platform::GetCurrentDesktop() const
+	{
+		unsigned long desktop = ALL_DESKTOPS;
+		ReadCardinal( GetRootWindow(), ATOM_NET_CURRENT_DESKTOP, desktop );
+		return desktop;
+	}
+
+	bool X11Platform::IsCloaked( WindowId window, unsigned long currentDesktop ) const
+	{
+		// the closest thing to a cloaked window is one sitting on another virtual desktop
+		unsigned long desktop = ALL_DESKTOPS;
+		if ( currentDesktop == ALL_DESKTOPS || !ReadCardinal( window, ATOM_NET_WM_DESKTOP, desktop ) )
+			return false;
+
+		return desktop != ALL_DESKTOPS && desktop != currentDesktop;
+	}
+
+	void X11Platform::EnumTopLevelWindows( std::vector<WindowId>& windows ) const
+	{
+		std::vector<WindowId> clientList;
+		ReadWindows( GetRootWindow(), ATOM_NET_CLIENT_LIST, clientList );
+		windows.insert( windows.end(), clientList.begin(), clientList.end() );
+	}
+
+	bool X11Platform::IsWindow( WindowId window ) const
+	{
+		XWindowAttributes attributes = {};
+		return XGetWindowAttributes( this->display, ToWindow( window ), &attributes ) != 0;
+	}
+
+	bool X11Platform::IsTopLevelWindow( WindowId window ) const
+	{
+		// the window manager tags the clients it manages with WM_STATE
+		Atom           actualType   = None;
+		int            actualFormat = 0;
+		unsigned long  count        = 0;
+		unsigned long  bytesAfter   = 0;
+		unsigned char* data         = nullptr;
+		if ( XGetWindowProperty( this->display, ToWindow( window ), this->atoms[ATOM_WM_STATE], 0, 0, False,
+		                         AnyPropertyType, &actualType, &actualFormat, &count, &bytesAfter, &data ) != Success )
+			return false;
+
+		if ( data != nullptr )
+			XFree( data );
+
+		return actualType != None;
+	}
+
+	bool X11Platform::IsWindowVisible( WindowId window ) const
+	{
+		// viewable means the window and all its ancestors, the frame included, are mapped
+		XWindowAttributes attributes = {};
+		if ( XGetWindowAttributes( this->display, ToWindow( window ), &attributes ) == 0 )
+			return false;
+
+		return attributes.map_state == IsViewable;
+	}
+
+	bool X11Platform::IsWindowCloaked( WindowId window ) const
+	{
+		return IsCloaked( window, GetCurrentDesktop() );
+	}
+
+	bool X11Platform::IsWindowTopmost( WindowId window ) const
+	{
+		return HasState( window, ATOM_NET_WM_STATE_ABOVE );
+	}
+
+	Platform::WindowId X11Platform::GetWindowOwner( WindowId window ) const
+	{
+		Window owner = None;
+		if ( !XGetTransientForHint( this->display, ToWindow( window ), &owner ) )
+			return NO_WINDOW;
+
+		return owner;
+	}
+
+	bool X11Platform::GetWindowRect( WindowId window, PlatformRect& rect ) const
+	{
+		XWindowAttributes attributes = {};
+		if ( XGetWindowAttributes( this->display, ToWindow( window ), &attributes ) == 0 )
+			return false;
+
+		int    x     = 0;
+		int    y     = 0;
+		Window child = None;
+		if ( !XTranslateCoordinates( this->display, ToWindow( window ), attributes.root, 0, 0, &x, &y, &child ) )
+			return false;
+
+		rect = { x, y, x + attributes.width, y + attributes.height };
+		return true;
+	}
+
+	size_t X11Platform::GetWindowClassName( WindowId window, wchar_t* buffer, size_t size ) const
+	{
+		XClassHint hint = {};
+		if ( XGetClassHint( this->display, ToWindow( window ), &hint ) == 0 )
+			return DecodeUtf8( "", 0, buffer, size );
+
+		const char*  className = hint.res_class != nullptr ? hint.res_class : "";
+		const size_t length    = DecodeUtf8( className, strlen( className ), buffer, size );
+		if ( hint.res_name != nullptr )
+			XFree( hint.res_name );
+		if ( hint.res_class != nullptr )
+			XFree( hint.res_class );
+		return length;
+	}
+
+	size_t X11Platform::GetWindowTitle( WindowId window, wchar_t* buffer, size_t size ) const
+	{
+		Atom           actualType   = None;
+		int            actualFormat = 0;
+		unsigned long  count        = 0;
+		unsigned long  bytesAfter   = 0;
+		unsigned char* data         = nullptr;
+		const long     maxLength    = static_cast<long>( size ) * 4; // in longs, plenty for size characters
+		if ( XGetWindowProperty( this->display, ToWindow( window ), this->atoms[ATOM_NET_WM_NAME], 0, maxLength, False,
+		                         this->atoms[ATOM_UTF8_STRING], &actualType, &actualFormat, &count, &bytesAfter,
+		                         &data ) == Success &&
+		     data != nullptr )
+		{
+			size_t length = 0;
+			if ( actualType == this->atoms[ATOM_UTF8_STRING] && actualFormat == 8 )
+				length = DecodeUtf8( reinterpret_cast<const char*>( data ), count, buffer, size );
+
+			XFree( data );
+			if ( length > 0 )
+				return length;
+		}
+
+		// older clients only set the ICCCM name
+		char* name = nullptr;
+		if ( XFetchName( this->display, ToWindow( window ), &name ) == 0 || name == nullptr )
+			return DecodeUtf8( "", 0, buffer, size );
+
+		const size_t length = DecodeUtf8( name, strlen( name ), buffer, size );
+		XFree( name );
+		return length;
+	}
+
+	uint32_t X11Platform::GetWindowProcessId( WindowId window ) const
+	{
+		unsigned long pid = 0;
+		ReadCardinal( window, ATOM_NET_WM_PID, pid );
+		return static_cast<uint32_t>( pid );
+	}
+
+	Platform::WindowId X11Platform::FindClient( WindowId frame ) const
+	{
+		// depth first like XmuClientWindow, reparenting window managers keep the client a level or two down
+		std::vector<std::pair<WindowId, int>> pending = { { frame, 0 } };
+		while ( !pending.empty() )
+		{
+			const auto current = pending.back();
+			pending.pop_back();
+			if ( IsTopLevelWindow( current.first ) )
+				return current.first;
+
+			if ( current.second == MAX_CLIENT_DEPTH )
+				continue;
+
+			Window       root     = None;
+			Window       parent   = None;
+			Window*      children = nullptr;
+			unsigned int count    = 0;
+			if ( !XQueryTree( this->display, ToWindow( current.first ), &root, &parent, &children, &count ) )
+				continue;
+
+			for ( unsigned int i = 0; i < count; i++ )
+				pending.emplace_back( children[i], current.second + 1 );
+
+			if ( children != nullptr )
+				XFree( children );
+		}
+
+		return frame;
+	}
+
+	Platform::WindowId X11Platform::GetFrame( WindowId window ) const
+	{
+		UpdateStacking();
+
+		const auto iter = this->clientFrames.find( window );
+		return iter != this->clientFrames.cend() ? iter->second : window;
+	}
+
+	void X11Platform::UpdateStacking() const
+	{
+		if ( !this->stackingDirty )
+			return;
+
+		this->stackingDirty = false;
+		this->stacking.clear();
+		this->stackingIndex.clear();
+		this->clientFrames.clear();
+
+		Window       root     = None;
+		Window       parent   = None;
+		Window*      children = nullptr;
+		unsigned int count    = 0;
+		if ( !XQueryTree( this->display, ToWindow( GetRootWindow() ), &root, &parent, &children, &count ) )
+			return;
+
+		// children come bottom to top, frames are only searched for their client the first time they are seen
+		this->stacking.reserve( count );
+		for ( unsigned int i = count; i-- > 0; )
+		{
+			const WindowId child = children[i];
+
+			auto iter = this->frameClients.find( child );
+			if ( iter == this->frameClients.end() )
+				iter = this->frameClients.emplace( child, FindClient( child ) ).first;
+
+			const WindowId window = iter->second;
+			if ( window != child )
+				this->clientFrames[window] = child;
+
+			this->stackingIndex[window] = this->stacking.size();
+			this->stacking.emplace_back( window );
+		}
+
+		if ( children != nullptr )
+			XFree( children );
+	}
+
+	Platform::WindowId X11Platform::GetTopWindow() const
+	{
+		UpdateStacking();
+		return this->stacking.empty() ? NO_WINDOW : this->stacking.front();
+	}
+
+	Platform::WindowId X11Platform::GetWindowAbove( WindowId window ) const
+	{
+		UpdateStacking();
+
+		const auto iter = this->stackingIndex.find( window );
+		if ( iter == this->stackingIndex.cend() || iter->second == 0 )
+			return NO_WINDOW;
+
+		return this->stacking[iter->second - 1];
+	}
+
+	Platform::WindowId X11Platform::GetWindowBelow( WindowId window ) const
+	{
+		UpdateStacking();
+
+		const auto iter = this->stackingIndex.find( window );
+		if ( iter == this->stackingIndex.cend() || iter->second + 1 >= this->stacking.size() )
+			return NO_WINDOW;
+
+		return this->stacking[iter->second + 1];
+	}
+
+	bool X11Platform::Restack( WindowId window, WindowId sibling )
+	{
+		// clients are restacked by their window manager, our own override-redirect windows directly
+		if ( IsTopLevelWindow( window ) )
+		{
+			XEvent event               = {};
+			event.xclient.type         = ClientMessage;
+			event.xclient.window       = ToWindow( window );
+			event.xclient.message_type = this->atoms[ATOM_NET_RESTACK_WINDOW];
+			event.xclient.format       = 32;
+			event.xclient.data.l[0]    = RESTACK_SOURCE_PAGER;
+			event.xclient.data.l[1]    = static_cast<long>( sibling );
+			event.xclient.data.l[2]    = Below;
+			return XSendEvent( this->display, ToWindow( GetRootWindow() ), False,
+			                   SubstructureRedirectMask | SubstructureNotifyMask, &event ) != 0;
+		}
+
+		if ( sibling == NO_WINDOW )
+			return XLowerWindow( this->display, ToWindow( window ) ) != 0;
+
+		XWindowChanges changes = {};
+		changes.sibling        = ToWindow( GetFrame( sibling ) );
+		changes.stack_mode     = Below;
+		return XConfigureWindow( this->display, ToWindow( window ), CWSibling | CWStackMode, &changes ) != 0;
+	}
+
+	bool X11Platform::MoveWindowsBelow( WindowId insertAfter, const WindowId* windows, size_t count )
+	{
+		bool     result  = true;
+		WindowId sibling = insertAfter;
+		for ( size_t i = 0; i < count && result; i++ )
+		{
+			result  = Restack( windows[i], sibling );
+			sibling = windows[i];
+		}
+
+		XFlush( this->display );
+		this->stackingDirty = true;
+		return result;
+	}
+
+	bool X11Platform::MoveWindowsToBottom( const WindowId* windows, size_t count )
+	{
+		bool result = true;
+		for ( size_t i = 0; i < count && result; i++ )
+			result = Restack( windows[i], NO_WINDOW );
+
+		XFlush( this->display );
+		this->stackingDirty = true;
+		return result;
+	}
+
+	void X11Platform::ShowWindow( WindowId window, bool state )
+	{
+		if ( state )
+		{
+			XMapWindow( this->display, ToWindow( window ) );
+		}
+		else
+		{
+			XUnmapWindow( this->display, ToWindow( window ) );
+		}
+
+		XFlush( this->display );
+	}
+
+	void X11Platform::SetWindowAlpha( WindowId window, uint8_t alpha )
+	{
+		const unsigned long opacity = alpha * 0x01010101ul;
+		XChangeProperty( this->display, ToWindow( window ), this->atoms[ATOM_NET_WM_WINDOW_OPACITY], XA_CARDINAL, 32,
+		                 PropModeReplace, reinterpret_cast<const unsigned char*>( &opacity ), 1 );
+		XFlush( this->display );
+	}
+
+	void X11Platform::EnumMonitors( std::vector<PlatformMonitor>& monitors ) const
+	{
+		int             count = 0;
+		XRRMonitorInfo* infos = this->randrEventBase >= 0
+		                            ? XRRGetMonitors( this->display, ToWindow( GetRootWindow() ), True, &count )
+		                            : nullptr;
+		if ( infos == nullptr || count == 0 )
+		{
+			// no XRandR, the whole screen is a single monitor named after the display
+			const int       screen  = DefaultScreen( this->display );
+			PlatformMonitor monitor = {};
+			DecodeUtf8( DisplayString( this->display ), monitor.device );
+			monitor.rect = { 0, 0, DisplayWidth( this->display, screen ), DisplayHeight( this->display, screen ) };
+			monitors.emplace_back( std::move( monitor ) );
+
+			if ( infos != nullptr )
+				XRRFreeMonitors( infos );
+			return;
+		}
+
+		for ( int i = 0; i < count; i++ )
+		{
+			const XRRMonitorInfo& info    = infos[i];
+			PlatformMonitor       monitor = {};
+			monitor.rect                  = { info.x, info.y, info.x + info.width, info.y + info.height };
+
+			// the output name, e.g. DP-1, is what stays stable across layout changes
+			char* name = XGetAtomName( this->display, info.name );
+			if ( name != nullptr )
+			{
+				DecodeUtf8( name, monitor.device );
+				XFree( name );
+			}
+
+			monitors.emplace_back( std::move( monitor ) );
+		}
+
+		XRRFreeMonitors( infos );
+	}
+
+	bool X11Platform::QueryProcessId( uint32_t pid, ProcessCache::ProcessId& id ) const
+	{
+		char filename[64];
+		snprintf( filename, sizeof( filename ), "/proc/%u/stat", pid );
+
+		FILE* file = fopen( filename, "r" );
+		if ( file == nullptr )
+			return false;
+
+		char         stat[1024];
+		const size_t length = fread( stat, 1, sizeof( stat ) - 1, file );
+		fclose( file );
+		stat[length] = 0;
+
+		// the command name can hold anything, fields are counted from its closing parenthesis
+		const char* iter = strrchr( stat, ')' );
+		if ( iter == nullptr )
+			return false;
+
+		// starttime is the 22nd field, the 20th after the command name
+		for ( int field = 0; field < 20; field++ )
+		{
+			iter = strchr( iter + 1, ' ' );
+			if ( iter == nullptr )
+				return false;
+		}
+
+		char*                    end       = nullptr;
+		const unsigned long long startTime = strtoull( iter + 1, &end, 10 );
+		if ( end == iter + 1 )
+			return false;
+
+		id.pid          = pid;
+		id.creationTime = startTime;
+		return true;
+	}
+
+	bool X11Platform::QueryProcessPath( uint32_t pid, std::wstring& path, std::wstring& name ) const
+	{
+		char link[64];
+		snprintf( link, sizeof( link ), "/proc/%u/exe", pid );
+
+		char          target[PATH_MAX];
+		const ssize_t length = readlink( link, target, sizeof( target ) - 1 );
+		if ( length <= 0 )
+			return false;
+		target[length] = 0;
+
+		const char* filename = strrchr( target, '/' );
+		DecodeUtf8( target, path );
+		DecodeUtf8( filename != nullptr ? filename + 1 : target, name );
+		return true;
+	}
+
+	void X11Platform::SelectRootInput()
+	{
+		// restacks are followed whether hooks are installed or not, the z-order snapshot depends on them
+		long mask = SubstructureNotifyMask;
+		if ( this->hookCallback != nullptr )
+			mask |= PropertyChangeMask;
+
+		XSelectInput( this->display, ToWindow( GetRootWindow() ), mask );
+		XFlush( this->display );
+	}
+
+	bool X11Platform::StartEventHooks( WINDOWEVENTCALLBACK callback )
+	{
+		if ( this->display == nullptr )
+			return false;
+
+		if ( this->hookCallback != nullptr )
+			return true;
+
+		// the clients present now are the starting point, they are not reported as created
+		this->hookCallback = callback;
+		this->clients.clear();
+		UpdateClients( false );
+		SelectRootInput();
+		return true;
+	}
+
+	void X11Platform::StopEventHooks()
+	{
+		if ( this->hookCallback == nullptr )
+			return;
+
+		for ( const auto& client : this->clients )
+			XSelectInput( this->display, ToWindow( client.id ), NoEventMask );
+
+		this->hookCallback = nullptr;
+		this->locationPid  = 0;
+		this->clients.clear();
+		SelectRootInput();
+	}
+
+	bool X11Platform::StartLocationHook( uint32_t pid )
+	{
+		if ( this->hookCallback == nullptr || pid == 0 )
+			return false;
+
+		this->locationPid = pid;
+		return true;
+	}
+
+	void X11Platform::StopLocationHook()
+	{
+		this->locationPid = 0;
+	}
+
+	void X11Platform::UpdateClients( bool notify )
+	{
+		std::vector<WindowId> windows;
+		ReadWindows( GetRootWindow(), ATOM_NET_CLIENT_LIST, windows );
+		std::sort( windows.begin(), windows.end() );
+
+		const unsigned long desktop = GetCurrentDesktop();
+
+		// both lists are sorted, walk them side by side
+		std::vector<Client> next;
+		next.reserve( windows.size() );
+		size_t former = 0;
+		for ( const auto window : windows )
+		{
+			for ( ; former < this->clients.size() && this->clients[former].id < window; former++ )
+			{
+				if ( notify )
+					Notify( WindowEventType::Destroyed, this->clients[former] );
+			}
+
+			if ( former < this->clients.size() && this->clients[former].id == window )
+			{
+				next.emplace_back( this->clients[former++] );
+				continue;
+			}
+
+			// visibility and desktop changes of the client come from the client itself
+			XSelectInput( this->display, ToWindow( window ), StructureNotifyMask | PropertyChangeMask );
+
+			const Client client = { window, GetWindowProcessId( window ), IsCloaked( window, desktop ) };
+			next.emplace_back( client );
+			if ( notify )
+			{
+				Notify( WindowEventType::Created, client );
+				if ( IsWindowVisible( window ) )
+					Notify( WindowEventType::Shown, client );
+			}
+		}
+
+		for ( ; former < this->clients.size(); former++ )
+		{
+			if ( notify )
+				Notify( WindowEventType::Destroyed, this->clients[former] );
+		}
+
+		this->clients.swap( next );
+	}
+
+	X11Platform::Client* X11Platform::FindTrackedClient( WindowId window )
+	{
+		const auto iter = std::lower_bound( this->clients.begin(), this->clients.end(), window,
+		                                    []( const Client& client, WindowId id ) { return client.id < id; } );
+		if ( iter == this->clients.end() || iter->id != window )
+			return nullptr;
+
+		return &*iter;
+	}
+
+	void X11Platform::OnEvent( const _XEvent& event )
+	{
+		if ( this->randrEventBase >= 0 && event.type == this->randrEventBase + RRScreenChangeNotify )
+		{
+			XRRUpdateConfiguration( const_cast<XEvent*>( &event ) );
+			if ( this->displayCallback != nullptr )
+				this->displayCallback();
+			return;
+		}
+
+		const WindowId root = GetRootWindow();
+		switch ( event.type )
+		{
+		case CreateNotify:
+		case ConfigureNotify:
+		case CirculateNotify:
+		case MapNotify:
+		case UnmapNotify:
+		case DestroyNotify:
+		case ReparentNotify: {
+			if ( event.xany.window == root )
+			{
+				// a root child was restacked, a frame gone or a client reparented into its frame
+				this->stackingDirty = true;
+				if ( event.type == DestroyNotify )
+					this->frameClients.erase( event.xdestroywindow.window );
+				if ( event.type == ReparentNotify )
+				{
+					this->frameClients.erase( event.xreparent.window );
+					this->frameClients.erase( event.xreparent.parent );
+				}
+				break;
+			}
+
+			if ( event.type == ConfigureNotify )
+			{
+				const Client* client = FindTrackedClient( event.xconfigure.window );
+				if ( client != nullptr && this->locationPid != 0 && client->pid == this->locationPid )
+					Notify( WindowEventType::LocationChanged, *client );
+				break;
+			}
+
+			if ( event.type != MapNotify && event.type != UnmapNotify )
+				break;
+
+			// the client's own structure events
+			const Client* client = FindTrackedClient( event.xany.window );
+			if ( client != nullptr )
+				Notify( event.type == MapNotify ? WindowEventType::Shown : WindowEventType::Hidden, *client );
+			break;
+		}
+		case PropertyNotify: {
+			const Atom atom = event.xproperty.atom;
+			if ( event.xproperty.window == root )
+			{
+				if ( atom == this->atoms[ATOM_NET_ACTIVE_WINDOW] )
+					OnForegroundChanged();
+				else if ( atom == this->atoms[ATOM_NET_CLIENT_LIST] )
+					UpdateClients( true );
+				else if ( atom == this->atoms[ATOM_NET_CURRENT_DESKTOP] )
+					OnDesktopChanged();
+				break;
+			}
+
+			if ( atom != this->atoms[ATOM_NET_WM_DESKTOP] )
+				break;
+
+			Client* client = FindTrackedClient( event.xproperty.window );
+			if ( client == nullptr )
+				break;
+
+			const bool cloaked = IsCloaked( client->id, GetCurrentDesktop() );
+			if ( cloaked != client->cloaked )
+			{
+				client->cloaked = cloaked;
+				Notify( cloaked ? WindowEventType::Cloaked : WindowEventType::Uncloaked, *client );
+			}
+			break;
+		}
+		default:
+			break;
+		}
+	}
+
+	void X11Platform::OnForegroundChanged()
+	{
+		std::vector<WindowId> active;
+		if ( !ReadWindows( GetRootWindow(), ATOM_NET_ACTIVE_WINDOW, active ) || active.empty() ||
+		     active[0] == NO_WINDOW )
+			return;
+
+		const Client* client = FindTrackedClient( active[0] );
+		if ( client != nullptr )
+		{
+			Notify( WindowEventType::Foreground, *client );
+			return;
+		}
+
+		// the window manager may activate a window before listing it
+		const Client untracked = { active[0], GetWindowProcessId( active[0] ), false };
+		Notify( WindowEventType::Foreground, untracked );
+	}
+
+	void X11Platform::OnDesktopChanged()
+	{
+		const unsigned long desktop = GetCurrentDesktop();
+		for ( auto& client : this->clients )
+		{
+			const bool cloaked = IsCloaked( client.id, desktop );
+			if ( cloaked == client.cloaked )
+				continue;
+
+			client.cloaked = cloaked;
+			Notify( cloaked ? WindowEventType::Cloaked : WindowEventType::Uncloaked, client );
+		}
+	}
+
+	void X11Platform::Notify( WindowEventType type, const Client& client ) const
+	{
+		// like the Win32 hooks, our own windows are left out
+		if ( this->hookCallback == nullptr || client.pid == this->currentPid )
+			return;
+
+		WindowEvent windowEvent = {};
+		windowEvent.type        = type;
+		windowEvent.time        = GetTimeMs();
+		windowEvent.window      = client.id;
+		this->hookCallback( windowEvent );
+	}
+} // namespace Theater
+#endif
@@ -0,0 +1,140 @@
+#pragma once
+
+// Xlib's macros (None, Bool, Status...) would clash with the rest of the tree, only its handles are declared here
+struct _XDisplay;
+union _XEvent;
+
+namespace Theater
+{
+	// Platform over an X11 connection and an EWMH window manager.
+	// Top level windows are the WM clients, the foreground is followed through _NET_ACTIVE_WINDOW property changes
+	// and windows on another desktop count as cloaked. Hook events are read by DispatchEvents, the UI loop polls
+	// the connection number and calls it whenever the connection is readable.
+	// Z-order is read from the children of the root window, frames stand for their client, override-redirect
+	// windows such as the dimmers for themselves. The snapshot is refreshed once a restack was seen.
+	class X11Platform final : public Platform
+	{
+	public:
+		typedef void ( *DISPLAYCHANGEDCALLBACK )();
+
+		X11Platform() = default;
+		~X11Platform();
+
+		// nullptr opens $DISPLAY
+		bool       Open( const char* displayName );
+		void       Close();
+		bool       IsOpen() const;
+		_XDisplay* GetDisplay() const;
+		int        GetConnectionNumber() const;
+
+		// Reads whatever the server sent, hook and display callbacks are called from here. Returns the events read.
+		size_t DispatchEvents();
+
+		// Called after XRandR reported a change of the monitor layout
+		void SetDisplayChangedCallback( DISPLAYCHANGEDCALLBACK callback );
+
+		void     EnumTopLevelWindows( std::vector<WindowId>& windows ) const override;
+		bool     IsWindow( WindowId window ) const override;
+		bool     IsTopLevelWindow( WindowId window ) const override;
+		bool     IsWindowVisible( WindowId window ) const override;
+		bool     IsWindowCloaked( WindowId window ) const override;
+		bool     IsWindowTopmost( WindowId window ) const override;
+		WindowId GetWindowOwner( WindowId window ) const override;
+		bool     GetWindowRect( WindowId window, PlatformRect& rect ) const override;
+		size_t   GetWindowClassName( WindowId window, wchar_t* buffer, size_t size ) const override;
+		size_t   GetWindowTitle( WindowId window, wchar_t* buffer, size_t size ) const override;
+		uint32_t GetWindowProcessId( WindowId window ) const override;
+
+		WindowId GetTopWindow() const override;
+		WindowId GetWindowAbove( WindowId window ) const override;
+		WindowId GetWindowBelow( WindowId window ) const override;
+		bool     MoveWindowsBelow( WindowId insertAfter, const WindowId* windows, size_t count ) override;
+		bool     MoveWindowsToBottom( const WindowId* windows, size_t count ) override;
+
+		// Alpha goes through _NET_WM_WINDOW_OPACITY, the compositor applies it without the window repainting
+		void ShowWindow( WindowId window, bool state ) override;
+		void SetWindowAlpha( WindowId window, uint8_t alpha ) override;
+
+		void EnumMonitors( std::vector<PlatformMonitor>& monitors ) const override;
+
+		// Read from /proc, the process start time tells apart instances reusing a pid
+		bool QueryProcessId( uint32_t pid, ProcessCache::ProcessId& id ) const override;
+		bool QueryProcessPath( uint32_t pid, std::wstring& path, std::wstring& name ) const override;
+
+		bool StartEventHooks( WINDOWEVENTCALLBACK callback ) override;
+		void StopEventHooks() override;
+
+		// From the ConfigureNotify events of the clients, which the hooks already select. A reparenting window
+		// manager sends a synthetic one to the client when only its frame moves.
+		bool StartLocationHook( uint32_t pid ) override;
+		void StopLocationHook() override;
+
+	private:
+		enum AtomIndex : size_t
+		{
+			ATOM_NET_ACTIVE_WINDOW,
+			ATOM_NET_CLIENT_LIST,
+			ATOM_NET_CURRENT_DESKTOP,
+			ATOM_NET_WM_DESKTOP,
+			ATOM_NET_WM_STATE,
+			ATOM_NET_WM_STATE_ABOVE,
+			ATOM_NET_WM_STATE_HIDDEN,
+			ATOM_NET_WM_PID,
+			ATOM_NET_WM_NAME,
+			ATOM_NET_WM_WINDOW_OPACITY,
+			ATOM_NET_RESTACK_WINDOW,
+			ATOM_WM_STATE,
+			ATOM_UTF8_STRING,
+			ATOM_COUNT
+		};
+
+		// Clients known to the hooks, to report what changed when the client list or the desktop does
+		struct Client
+		{
+			WindowId id;
+			uint32_t pid;
+			bool     cloaked;
+		};
+
+		X11Platform( const X11Platform& ) = delete;
+		X11Platform& operator=( const X11Platform& ) = delete;
+
+		bool ReadCardinal( WindowId window, AtomIndex property, unsigned long& value ) const;
+		bool ReadWindows( WindowId window, AtomIndex property, std::vector<WindowId>& windows ) const;
+		bool HasState( WindowId window, AtomIndex state ) const;
+
+		WindowId      GetRootWindow() const;
+		unsigned long GetCurrentDesktop() const;
+		bool          IsCloaked( WindowId window, unsigned long currentDesktop ) const;
+		bool          Restack( WindowId window, WindowId sibling );
+
+		WindowId FindClient( WindowId frame ) const;
+		WindowId GetFrame( WindowId window ) const;
+		void     UpdateStacking() const;
+
+		void    SelectRootInput();
+		void    UpdateClients( bool notify );
+		Client* FindTrackedClient( WindowId window );
+		void    OnEvent( const _XEvent& event );
+		void    OnForegroundChanged();
+		void    OnDesktopChanged();
+		void    Notify( WindowEventType type, const Client& client ) const;
+
+	private:
+		_XDisplay*             display           = nullptr;
+		unsigned long          atoms[ATOM_COUNT] = {};
+		int                    randrEventBase    = -1;
+		WINDOWEVENTCALLBACK    hookCallback      = nullptr;
+		DISPLAYCHANGEDCALLBACK displayCallback   = nullptr;
+		uint32_t               currentPid        = 0;
+		uint32_t               locationPid       = 0;
+		std::vector<Client>    clients;
+
+		// root children top to bottom, frames replaced by their client
+		mutable std::vector<WindowId>                  stacking;
+		mutable std::unordered_map<WindowId, size_t>   stackingIndex;
+		mutable std::unordered_map<WindowId, WindowId> frameClients; // root child to the window standing for it
+		mutable std::unordered_map<WindowId, WindowId> clientFrames;
+		mutable bool                                   stackingDirty = true;
+	};
+} // namespace Theater
\ No newline at end of file
@@ -0,0 +1,80 @@
+#include "theater.h"
+#include "zorderarranger.h"
+
+namespace Theater
+{
+	void ZOrderArranger::SetDimmers( const std::vector<ZOrderDimmer>& newDimmers )
+	{
+		this->dimmers = newDimmers;
+		this->dimmerWindows.clear();
+		for ( const auto& dimmer : newDimmers )
+			this->dimmerWindows.emplace_back( dimmer.window );
+	}
+
+	const std::vector<ZOrderDimmer>& ZOrderArranger::GetDimmers() const
+	{
+		return this->dimmers;
+	}
+
+	ZOrderStrategy ZOrderArranger::Arrange( Platform& platform, WindowId target,
+	                                        const std::vector<WindowId>& targetCompanions,
+	                                        const WindowRegistry& registry, std::mutex* registryLock )
+	{
+		this->companions.clear();
+		for ( const auto companion : targetCompanions )
+		{
+			if ( platform.IsWindowVisible( companion ) )
+				this->companions.emplace_back( companion );
+		}
+
+		BuildZOrderStack( platform, target, this->companions, this->dimmers, this->stack );
+
+		const auto strategy = PlanZOrder( this->stack, target, this->companions.size(), this->dimmers.size() );
+		switch ( strategy )
+		{
+		case ZOrderStrategy::None:
+			break;
+		case ZOrderStrategy::InsertBelowTarget:
+			// chain the companions and the dimmers right below the target
+			PlanZOrderChain( this->stack, target, this->companions, this->dimmerWindows, this->chain );
+			platform.MoveWindowsBelow( target, this->chain.data(), this->chain.size() );
+			break;
+		case ZOrderStrategy::PushToBottom:
+			PushToBottom( platform, target, registry, registryLock );
+			break;
+		}
+
+		return strategy;
+	}
+
+	size_t ZOrderArranger::GetSavedMoves() const
+	{
+		return this->savedMoves;
+	}
+
+	void ZOrderArranger::PushToBottom( Platform& platform, WindowId target, const WindowRegistry& registry,
+	                                   std::mutex* registryLock )
+	{
+		{
+			std::unique_lock<std::mutex> lock;
+			if ( registryLock != nullptr )
+				lock = std::unique_lock<std::mutex>( *registryLock );
+
+			BuildFullZOrderStack( platform, target, this->companions, this->dimmers, registry, this->stack );
+		}
+
+		PlanZOrderMoves( this->stack, target, this->moves );
+		this->savedMoves += this->moves.savedMoves;
+
+		if ( !this->moves.windows.empty() )
+			platform.MoveWindowsToBottom( this->moves.windows.data(), this->moves.windows.size() );
+
+		// nothing pushes the dimmers down, those above the target are chained right below it along with the
+		// companions a dimmer covers
+		if ( this->moves.chainBelowTarget )
+		{
+			PlanZOrderChain( this->stack, target, this->companions, this->dimmerWindows, this->chain );
+			platform.MoveWindowsBelow( target, this->chain.data(), this->chain.size() );
+		}
+	}
+} // namespace Theater
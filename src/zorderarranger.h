@@ -0,0 +1,44 @@
+#pragma once
+
+namespace Theater
+{
+	// Gets a new target and its companions above the dimmers, and the dimmers above the windows they overlap, in as
+	// few z-order moves as it can. The app and the headless pipeline, so the benchmark, soak runs and replays too,
+	// all order windows through this one.
+	class ZOrderArranger
+	{
+	public:
+		typedef Platform::WindowId WindowId;
+
+		ZOrderArranger()  = default;
+		~ZOrderArranger() = default;
+
+		// Monitor bits of the stack follow the order of the dimmers
+		void                             SetDimmers( const std::vector<ZOrderDimmer>& dimmers );
+		const std::vector<ZOrderDimmer>& GetDimmers() const;
+
+		// Companions that are not visible are left out, a window gone would fail the whole batch of moves.
+		// The registry is only read when windows have to be pushed to the bottom, under registryLock when given.
+		ZOrderStrategy Arrange( Platform& platform, WindowId target, const std::vector<WindowId>& targetCompanions,
+		                        const WindowRegistry& registry, std::mutex* registryLock );
+
+		// Windows PushToBottom left where they were since the start, out of those it considered
+		size_t GetSavedMoves() const;
+
+	private:
+		ZOrderArranger( const ZOrderArranger& ) = delete;
+		ZOrderArranger& operator=( const ZOrderArranger& ) = delete;
+
+		void PushToBottom( Platform& platform, WindowId target, const WindowRegistry& registry,
+		                   std::mutex* registryLock );
+
+	private:
+		std::vector<ZOrderDimmer> dimmers;
+		std::vector<WindowId>     dimmerWindows;
+		std::vector<WindowId>     companions;
+		std::vector<ZOrderWindow> stack;
+		std::vector<WindowId>     chain;
+		ZOrderMoves               moves      = {};
+		size_t                    savedMoves = 0;
+	};
+} // namespace Theater
\ No newline at end of file
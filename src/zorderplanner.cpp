@@ -0,0 +1,153 @@
+#include "theater.h"
+#include "zorderplanner.h"
+
+namespace Theater
+{
+	ZOrderStrategy PlanZOrder( const std::vector<ZOrderWindow>& stack, uintptr_t target, size_t companionCount,
+	                           size_t dimmerCount )
+	{
+		const auto targetIter = std::find_if( stack.cbegin(), stack.cend(),
+		                                      [target]( const ZOrderWindow& window ) { return window.id == target; } );
+		if ( targetIter == stack.cend() )
+			return ZOrderStrategy::PushToBottom;
+
+		// dimmers are not topmost, they can't be slotted below a topmost target
+		if ( targetIter->topmost )
+			return ZOrderStrategy::PushToBottom;
+
+		bool   dimmersAbove    = false;
+		size_t companionsAbove = 0;
+		for ( auto iter = stack.cbegin(); iter != targetIter; ++iter )
+		{
+			if ( iter->dimmer )
+			{
+				dimmersAbove = true;
+				continue;
+			}
+
+			if ( iter->companion )
+			{
+				companionsAbove++;
+				continue;
+			}
+
+			// topmost windows live in their own band and owned windows always stay above their owner,
+			// anything else above the target means it isn't at the top of its band yet
+			if ( !iter->topmost && !iter->ownedByTarget )
+				return ZOrderStrategy::PushToBottom;
+		}
+
+		if ( dimmerCount == 0 )
+			return ZOrderStrategy::None;
+
+		// in place when the companions the target doesn't cover come right below it, then all the dimmers
+		auto   iter            = targetIter + 1;
+		size_t companionsBelow = 0;
+		for ( ; iter != stack.cend() && iter->companion; ++iter )
+			companionsBelow++;
+
+		size_t dimmersBelow = 0;
+		for ( ; iter != stack.cend() && iter->dimmer; ++iter )
+			dimmersBelow++;
+
+		if ( !dimmersAbove && companionsAbove + companionsBelow == companionCount && dimmersBelow == dimmerCount )
+			return ZOrderStrategy::None;
+
+		return ZOrderStrategy::InsertBelowTarget;
+	}
+
+	void PlanZOrderChain( const std::vector<ZOrderWindow>& stack, uintptr_t target,
+	                      const std::vector<uintptr_t>& companions, const std::vector<uintptr_t>& dimmers,
+	                      std::vector<uintptr_t>& chain )
+	{
+		chain.clear();
+
+		// a companion above the target only stays put when no dimmer is above it
+		const auto targetIter = std::find_if( stack.cbegin(), stack.cend(),
+		                                      [target]( const ZOrderWindow& window ) { return window.id == target; } );
+		const auto dimmerIter = std::find_if( stack.cbegin(), targetIter,
+		                                      []( const ZOrderWindow& window ) { return window.dimmer; } );
+		for ( const auto companion : companions )
+		{
+			const bool above = std::any_of( stack.cbegin(), dimmerIter, [companion]( const ZOrderWindow& window ) {
+				return window.id == companion;
+			} );
+			if ( !above )
+				chain.emplace_back( companion );
+		}
+
+		chain.insert( chain.end(), dimmers.begin(), dimmers.end() );
+	}
+
+	void PlanZOrderMoves( const std::vector<ZOrderWindow>& stack, uintptr_t target, ZOrderMoves& moves )
+	{
+		moves.windows.clear();
+		moves.savedMoves       = 0;
+		moves.chainBelowTarget = false;
+
+		// a dimmer above the target or a companion gets the dimmers chained right below the target after the moves
+		bool     targetSeen     = false;
+		uint64_t targetMonitors = 0;
+		uint64_t dimmerMonitors = 0;
+		for ( const auto& window : stack )
+		{
+			if ( window.id == target )
+			{
+				targetSeen     = true;
+				targetMonitors = window.monitors;
+			}
+			else if ( window.dimmer )
+			{
+				dimmerMonitors |= window.monitors;
+				moves.chainBelowTarget |= !targetSeen;
+			}
+			else if ( window.companion )
+			{
+				moves.chainBelowTarget = true;
+			}
+		}
+
+		// single top to bottom pass, tracking what has been seen so far
+		targetSeen              = false;
+		uint64_t dimmedMonitors = 0;
+		size_t   candidates     = 0;
+		for ( const auto& window : stack )
+		{
+			if ( window.id == target )
+			{
+				targetSeen = true;
+				continue;
+			}
+
+			if ( window.dimmer )
+			{
+				dimmedMonitors |= window.monitors;
+				continue;
+			}
+
+			if ( window.ownedByTarget || window.companion )
+				continue;
+
+			candidates++;
+
+			// chained dimmers end up above everything below the target, only what's above it and overlaps one of
+			// them has to go. Otherwise the dimmers stay where they are, anything above one of them goes too.
+			bool move = false;
+			if ( moves.chainBelowTarget )
+			{
+				move = !targetSeen && ( window.monitors & ( targetMonitors | dimmerMonitors ) ) != 0;
+			}
+			else
+			{
+				const bool aboveTarget = !targetSeen && ( window.monitors & targetMonitors ) != 0;
+				const bool aboveDimmer = ( window.monitors & ~dimmedMonitors ) != 0;
+				move                   = aboveTarget || aboveDimmer;
+			}
+
+			if ( move )
+				moves.windows.emplace_back( window.id );
+		}
+
+		moves.savedMoves = candidates - moves.windows.size();
+	}
+} // namespace Theater
\ No newline at end of file
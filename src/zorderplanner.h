@@ -0,0 +1,53 @@
+#pragma once
+
+namespace Theater
+{
+	enum class ZOrderStrategy
+	{
+		// dimmers already sit right below the target
+		None,
+		// slot the companions and the dimmers right below the target, one move per window
+		InsertBelowTarget,
+		// push every other window to the bottom, one move per window
+		PushToBottom
+	};
+
+	struct ZOrderWindow
+	{
+		uintptr_t id;
+		uint64_t  monitors; // one bit per monitor the window intersects, dimmers only have their own monitor set
+		bool      topmost;
+		bool      dimmer;
+		bool      ownedByTarget;
+		bool      companion; // another window of the theater session, kept above the dimmers with the target
+	};
+
+	struct ZOrderMoves
+	{
+		// windows to push to the bottom, top to bottom so their relative order is kept
+		std::vector<uintptr_t> windows;
+		size_t                 savedMoves;
+		// the dimmers, and the companions a dimmer covers, still have to be chained right below the target after
+		// the push, see PlanZOrderChain
+		bool                   chainBelowTarget;
+	};
+
+	// Picks how to get the target and its companions above the dimmers.
+	// The stack is ordered top to bottom and only needs to cover the windows above the target, the target itself
+	// and at least companionCount + dimmerCount windows below it.
+	ZOrderStrategy PlanZOrder( const std::vector<ZOrderWindow>& stack, uintptr_t target, size_t companionCount,
+	                           size_t dimmerCount );
+
+	// Windows to slot right below the target for InsertBelowTarget, top to bottom. Companions already above the
+	// target and the dimmers stay where they are, the others come first and the dimmers last.
+	void PlanZOrderChain( const std::vector<ZOrderWindow>& stack, uintptr_t target,
+	                      const std::vector<uintptr_t>& companions, const std::vector<uintptr_t>& dimmers,
+	                      std::vector<uintptr_t>& chain );
+
+	// Smallest set of windows to push to the bottom so the target and the dimmers end up above everything they overlap.
+	// A window only moves when it is above the target on a monitor the target touches, or above the dimmer of one of
+	// its monitors. When a dimmer is above the target or there are companions, the dimmers get chained right below
+	// the target afterwards and only the windows above the target overlapping the target or a dimmer move.
+	// Companions never move, the stack must be complete and ordered top to bottom.
+	void PlanZOrderMoves( const std::vector<ZOrderWindow>& stack, uintptr_t target, ZOrderMoves& moves );
+} // namespace Theater
\ No newline at end of file
@@ -0,0 +1,98 @@
+#include "theater.h"
+#include "zorderstack.h"
+
+namespace Theater
+{
+	namespace
+	{
+		void MarkCompanions( const std::vector<Platform::WindowId>& companions, std::vector<ZOrderWindow>& stack )
+		{
+			if ( companions.empty() )
+				return;
+
+			for ( auto& window : stack )
+				window.companion = std::binary_search( companions.begin(), companions.end(), window.id );
+		}
+	} // namespace
+
+	ZOrderWindow MakeZOrderWindow( const Platform& platform, Platform::WindowId window, Platform::WindowId target,
+	                               const std::vector<ZOrderDimmer>& dimmers )
+	{
+		ZOrderWindow result  = {};
+		result.id            = window;
+		result.topmost       = platform.IsWindowTopmost( window );
+		result.ownedByTarget = platform.GetWindowOwner( window ) == target;
+
+		PlatformRect windowRect = {};
+		platform.GetWindowRect( window, windowRect );
+
+		const size_t monitorCount = std::min<size_t>( dimmers.size(), 64 );
+		for ( size_t i = 0; i < monitorCount; i++ )
+		{
+			if ( dimmers[i].window == window )
+			{
+				result.dimmer   = true;
+				result.monitors = 1ull << i;
+				break;
+			}
+
+			if ( IntersectPlatformRects( windowRect, dimmers[i].monitor ) )
+				result.monitors |= 1ull << i;
+		}
+
+		return result;
+	}
+
+	void BuildZOrderStack( const Platform& platform, Platform::WindowId target,
+	                       const std::vector<Platform::WindowId>& companions, const std::vector<ZOrderDimmer>& dimmers,
+	                       std::vector<ZOrderWindow>& stack )
+	{
+		stack.clear();
+
+		// only walk what's above the target, usually a handful of topmost windows
+		for ( auto window = platform.GetWindowAbove( target ); window != Platform::NO_WINDOW;
+		      window = platform.GetWindowAbove( window ) )
+		{
+			if ( platform.IsWindowVisible( window ) )
+				stack.emplace_back( MakeZOrderWindow( platform, window, target, dimmers ) );
+		}
+		std::reverse( stack.begin(), stack.end() );
+
+		stack.emplace_back( MakeZOrderWindow( platform, target, target, dimmers ) );
+
+		const size_t depth = companions.size() + dimmers.size();
+		size_t       below = 0;
+		for ( auto window = platform.GetWindowBelow( target ); window != Platform::NO_WINDOW && below < depth;
+		      window = platform.GetWindowBelow( window ) )
+		{
+			if ( !platform.IsWindowVisible( window ) )
+				continue;
+
+			stack.emplace_back( MakeZOrderWindow( platform, window, target, dimmers ) );
+			below++;
+		}
+
+		MarkCompanions( companions, stack );
+	}
+
+	void BuildFullZOrderStack( const Platform& platform, Platform::WindowId target,
+	                           const std::vector<Platform::WindowId>& companions,
+	                           const std::vector<ZOrderDimmer>& dimmers, const WindowRegistry& registry,
+	                           std::vector<ZOrderWindow>& stack )
+	{
+		stack.clear();
+
+		for ( auto window = platform.GetTopWindow(); window != Platform::NO_WINDOW;
+		      window = platform.GetWindowBelow( window ) )
+		{
+			// our own windows are not tracked by the registry
+			const bool isDimmer =
+			    std::any_of( dimmers.begin(), dimmers.end(),
+			                 [window]( const ZOrderDimmer& dimmer ) { return dimmer.window == window; } );
+			if ( window == target || isDimmer || registry.IsWindowVisible( window ) )
+				stack.emplace_back( MakeZOrderWindow( platform, window, target, dimmers ) );
+		}
+
+		MarkCompanions( companions, stack );
+	}
+} // namespace Theater
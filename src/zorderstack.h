@@ -0,0 +1,27 @@
+#pragma once
+
+namespace Theater
+{
+	// A dimmer window and the monitor it covers, monitor bits in the stack follow the order of these
+	struct ZOrderDimmer
+	{
+		Platform::WindowId window;
+		PlatformRect       monitor;
+	};
+
+	ZOrderWindow MakeZOrderWindow( const Platform& platform, Platform::WindowId window, Platform::WindowId target,
+	                               const std::vector<ZOrderDimmer>& dimmers );
+
+	// The visible windows above the target, the target and as many visible windows below it as there are companions
+	// and dimmers, enough for PlanZOrder to tell whether they are in place. Companions are sorted.
+	void BuildZOrderStack( const Platform& platform, Platform::WindowId target,
+	                       const std::vector<Platform::WindowId>& companions, const std::vector<ZOrderDimmer>& dimmers,
+	                       std::vector<ZOrderWindow>& stack );
+
+	// Every window PlanZOrderMoves has to consider, the target, the dimmers and the visible windows in the registry.
+	// The registry is read throughout, the caller holds whatever lock guards it.
+	void BuildFullZOrderStack( const Platform& platform, Platform::WindowId target,
+	                           const std::vector<Platform::WindowId>& companions,
+	                           const std::vector<ZOrderDimmer>& dimmers, const WindowRegistry& registry,
+	                           std::vector<ZOrderWindow>& stack );
+} // namespace Theater
\ No newline at end of file
@@ -0,0 +1,166 @@
+#include "theater.h"
+#include "testing.h"
+
+namespace Theater
+{
+	namespace
+	{
+		// Listeners are plain functions, like App's, so what they see goes through globals
+		struct Received
+		{
+			uint32_t calls   = 0;
+			uint32_t changes = 0;
+		};
+
+		ChangeBus*     s_bus = nullptr;
+		Received       s_target;
+		Received       s_other;
+		TargetResolver s_resolver;
+		SettingsData   s_settings;
+		uint32_t       s_rebuilds = 0;
+
+		void Reset( ChangeBus& bus )
+		{
+			s_bus      = &bus;
+			s_target   = {};
+			s_other    = {};
+			s_rebuilds = 0;
+		}
+
+		// What App::OnTargetSettingsChanged leads to on the worker
+		void OnTargetChanged( uint32_t changes )
+		{
+			s_target.calls++;
+			s_target.changes |= changes;
+
+			s_resolver.Configure( s_settings.processNames, s_settings.rules );
+			s_rebuilds++;
+		}
+
+		void OnOtherChanged( uint32_t changes )
+		{
+			s_other.calls++;
+			s_other.changes |= changes;
+		}
+
+		// Turning theater on applies the alpha and color it was left with
+		void OnEnabled( uint32_t )
+		{
+			s_bus->Publish( SETTINGS_CHANGE_ALPHA );
+			s_bus->Publish( SETTINGS_CHANGE_COLOR );
+			s_bus->Unsubscribe( OnEnabled );
+		}
+	} // namespace
+} // namespace Theater
+
+using namespace Theater;
+
+THEATER_TEST( changebus, ListenersOnlySeeTheChangesTheySubscribedTo )
+{
+	ChangeBus bus;
+	Reset( bus );
+	bus.Subscribe( OnTargetChanged, SETTINGS_CHANGE_TARGET );
+	bus.Subscribe( OnOtherChanged, SETTINGS_CHANGE_ALPHA | SETTINGS_CHANGE_COLOR );
+
+	bus.Publish( SETTINGS_CHANGE_ALPHA | SETTINGS_CHANGE_RULES | SETTINGS_CHANGE_FADE );
+	CHECK( s_target.calls == 1 );
+	CHECK( s_target.changes == SETTINGS_CHANGE_RULES );
+	CHECK( s_other.calls == 1 );
+	CHECK( s_other.changes == SETTINGS_CHANGE_ALPHA );
+
+	// nobody asked for these
+	bus.Publish( SETTINGS_CHANGE_FADE | SETTINGS_CHANGE_MONITORS );
+	bus.Publish( 0 );
+	CHECK( s_target.calls == 1 );
+	CHECK( s_other.calls == 1 );
+
+	bus.Unsubscribe( OnOtherChanged );
+	bus.Publish( SETTINGS_CHANGE_ALL );
+	CHECK( s_target.calls == 2 );
+	CHECK( s_target.changes == SETTINGS_CHANGE_TARGET );
+	CHECK( s_other.calls == 1 );
+}
+
+THEATER_TEST( changebus, AlphaChangeDoesNotRebuildTheMatcher )
+{
+	ChangeBus bus;
+	Reset( bus );
+	bus.Subscribe( OnTargetChanged, SETTINGS_CHANGE_TARGET );
+	bus.Subscribe( OnOtherChanged, SETTINGS_CHANGE_ALL & ~SETTINGS_CHANGE_TARGET );
+
+	s_settings = SettingsData();
+	s_settings.processNames.Add( L"game.exe" );
+	s_settings.rules.emplace_back( Rule{ RuleField::Path, RuleOperator::Glob, L"D:\\Games\\**\\*.exe" } );
+
+	// the way Settings::Reload notifies an edit of settings.json that only touched the alpha
+	SettingsData edited = s_settings;
+	edited.alpha        = static_cast<uint8_t>( s_settings.alpha / 2 );
+	bus.Publish( DiffSettings( s_settings, edited ) );
+	CHECK( s_rebuilds == 0 );
+	CHECK( s_other.changes == SETTINGS_CHANGE_ALPHA );
+
+	for ( uint32_t alpha = 0; alpha < 256; alpha++ )
+		bus.Publish( SETTINGS_CHANGE_ALPHA );
+	CHECK( s_rebuilds == 0 );
+
+	edited.processNames.Add( L"other.exe" );
+	bus.Publish( DiffSettings( s_settings, edited ) );
+	CHECK( s_rebuilds == 1 );
+	CHECK( s_target.changes == SETTINGS_CHANGE_PROCESSES );
+}
+
+THEATER_TEST( changebus, ChangesPublishedByAListenerAreDeliveredTogether )
+{
+	ChangeBus bus;
+	Reset( bus );
+	bus.Subscribe( OnEnabled, SETTINGS_CHANGE_ENABLED );
+	bus.Subscribe( OnOtherChanged, SETTINGS_CHANGE_ALPHA | SETTINGS_CHANGE_COLOR );
+
+	bus.Publish( SETTINGS_CHANGE_ENABLED );
+	CHECK( s_other.calls == 1 );
+	CHECK( s_other.changes == ( SETTINGS_CHANGE_ALPHA | SETTINGS_CHANGE_COLOR ) );
+
+	// OnEnabled unsubscribed itself while being called
+	bus.Publish( SETTINGS_CHANGE_ENABLED );
+	CHECK( s_other.calls == 1 );
+}
+
+THEATER_TEST( changebus, NestedTransactionsDeliverOneMergedMask )
+{
+	ChangeBus bus;
+	Reset( bus );
+	bus.Subscribe( OnTargetChanged, SETTINGS_CHANGE_TARGET );
+	bus.Subscribe( OnOtherChanged, SETTINGS_CHANGE_ALL & ~SETTINGS_CHANGE_TARGET );
+
+	// an import that sets several groups, part of it through a helper with its own transaction
+	bus.Begin();
+	bus.Publish( SETTINGS_CHANGE_ALPHA );
+	bus.Begin();
+	bus.Publish( SETTINGS_CHANGE_COLOR );
+	bus.Publish( SETTINGS_CHANGE_PROCESSES );
+	bus.Commit();
+	CHECK( s_other.calls == 0 );
+	CHECK( s_target.calls == 0 );
+	CHECK( bus.GetPending() == ( SETTINGS_CHANGE_ALPHA | SETTINGS_CHANGE_COLOR | SETTINGS_CHANGE_PROCESSES ) );
+
+	bus.Publish( SETTINGS_CHANGE_ALPHA | SETTINGS_CHANGE_RULES );
+	bus.Commit();
+	CHECK( s_other.calls == 1 );
+	CHECK( s_other.changes == ( SETTINGS_CHANGE_ALPHA | SETTINGS_CHANGE_COLOR ) );
+	CHECK( s_target.calls == 1 );
+	CHECK( s_target.changes == ( SETTINGS_CHANGE_PROCESSES | SETTINGS_CHANGE_RULES ) );
+	CHECK( s_rebuilds == 1 );
+	CHECK( bus.GetPending() == 0 );
+
+	// an unbalanced commit is ignored, publishing is immediate again
+	bus.Commit();
+	bus.Publish( SETTINGS_CHANGE_FADE );
+	CHECK( s_other.calls == 2 );
+	CHECK( s_other.changes == ( SETTINGS_CHANGE_ALPHA | SETTINGS_CHANGE_COLOR | SETTINGS_CHANGE_FADE ) );
+
+	// an empty transaction notifies nobody
+	bus.Begin();
+	bus.Commit();
+	CHECK( s_other.calls == 2 );
+	CHECK( s_target.calls == 1 );
+}
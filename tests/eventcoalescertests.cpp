@@ -0,0 +1,94 @@
+#include "theater.h"
+#include "testing.h"
+
+namespace Theater
+{
+	namespace
+	{
+		WindowEvent MakeEvent( WindowEventType type, uintptr_t window )
+		{
+			return WindowEvent{ type, 0, window };
+		}
+	} // namespace
+} // namespace Theater
+
+using namespace Theater;
+
+THEATER_TEST( eventcoalescer, OtherEventsGoThroughRightAway )
+{
+	WindowEventCoalescer coalescer;
+	for ( const auto type : { WindowEventType::Created, WindowEventType::Shown, WindowEventType::Hidden,
+	                          WindowEventType::Cloaked, WindowEventType::Uncloaked, WindowEventType::Destroyed } )
+		CHECK( coalescer.Push( MakeEvent( type, 1 ), 0 ) );
+
+	WindowEvent event = {};
+	CHECK( !coalescer.PopForeground( 1000, event ) );
+	CHECK( coalescer.GetTimeout( 0 ) == WindowEventCoalescer::NO_TIMEOUT );
+}
+
+THEATER_TEST( eventcoalescer, BurstActsOnTheLatestForeground )
+{
+	WindowEventCoalescer coalescer;
+	coalescer.SetDelay( 20 );
+
+	CHECK( !coalescer.Push( MakeEvent( WindowEventType::Foreground, 1 ), 100 ) );
+	CHECK( !coalescer.Push( MakeEvent( WindowEventType::Foreground, 2 ), 105 ) );
+	CHECK( !coalescer.Push( MakeEvent( WindowEventType::Foreground, 3 ), 110 ) );
+
+	// the delay runs from the first change of the burst, later ones don't push it out
+	WindowEvent event = {};
+	CHECK( coalescer.GetTimeout( 110 ) == 10 );
+	CHECK( !coalescer.PopForeground( 119, event ) );
+	REQUIRE( coalescer.PopForeground( 120, event ) );
+	CHECK( event.window == 3 );
+	CHECK( coalescer.GetCoalescedCount() == 2 );
+
+	// over, the next change starts a burst of its own
+	CHECK( !coalescer.PopForeground( 200, event ) );
+	CHECK( coalescer.GetTimeout( 200 ) == WindowEventCoalescer::NO_TIMEOUT );
+	coalescer.Push( MakeEvent( WindowEventType::Foreground, 4 ), 300 );
+	CHECK( coalescer.GetTimeout( 300 ) == 20 );
+	CHECK( coalescer.GetTimeout( 400 ) == 0 );
+}
+
+THEATER_TEST( eventcoalescer, DestroyedWindowDropsItsPendingForeground )
+{
+	WindowEventCoalescer coalescer;
+	coalescer.Push( MakeEvent( WindowEventType::Foreground, 1 ), 0 );
+
+	// another window going away leaves the change alone
+	CHECK( coalescer.Push( MakeEvent( WindowEventType::Destroyed, 2 ), 1 ) );
+	CHECK( coalescer.GetTimeout( 1 ) != WindowEventCoalescer::NO_TIMEOUT );
+
+	CHECK( coalescer.Push( MakeEvent( WindowEventType::Destroyed, 1 ), 2 ) );
+	WindowEvent event = {};
+	CHECK( !coalescer.PopForeground( 1000, event ) );
+	CHECK( coalescer.GetCoalescedCount() == 1 );
+}
+
+THEATER_TEST( eventcoalescer, ZeroDelayHandsEveryChangeOver )
+{
+	WindowEventCoalescer coalescer;
+	coalescer.SetDelay( 0 );
+
+	WindowEvent event = {};
+	for ( uintptr_t window = 1; window <= 3; window++ )
+	{
+		coalescer.Push( MakeEvent( WindowEventType::Foreground, window ), 50 );
+		REQUIRE( coalescer.PopForeground( 50, event ) );
+		CHECK( event.window == window );
+	}
+
+	CHECK( coalescer.GetCoalescedCount() == 0 );
+}
+
+THEATER_TEST( eventcoalescer, ClearDropsThePendingChange )
+{
+	WindowEventCoalescer coalescer;
+	coalescer.Push( MakeEvent( WindowEventType::Foreground, 1 ), 0 );
+	coalescer.Clear();
+
+	WindowEvent event = {};
+	CHECK( !coalescer.PopForeground( 1000, event ) );
+	CHECK( coalescer.GetTimeout( 0 ) == WindowEventCoalescer::NO_TIMEOUT );
+}
@@ -0,0 +1,469 @@
+#include "theater.h"
+#include "testing.h"
+#include <map>
+
+namespace Theater
+{
+	namespace
+	{
+		// Hook callbacks are plain functions, what they see goes through globals
+		SimulatedDesktop*        s_desktop = nullptr;
+		EventLogWriter*          s_writer  = nullptr;
+		std::vector<WindowEvent> s_events;
+
+		void OnRecorded( const WindowEvent& event )
+		{
+			s_events.emplace_back( event );
+			if ( s_writer != nullptr )
+				s_writer->Write( *s_desktop, event );
+		}
+
+		// A game started from its launcher next to a few windows of every kind, and the dimmer of our own process
+		void Record( SimulatedDesktop& desktop, EventLogWriter& writer )
+		{
+			s_desktop = &desktop;
+			s_writer  = &writer;
+			s_events.clear();
+
+			desktop.AddMonitor( L"\\\\.\\DISPLAY1", PlatformRect{ 0, 0, 1920, 1080 } );
+			desktop.AddMonitor( L"\\\\.\\DISPLAY2", PlatformRect{ -2560, -200, 0, 1240 } );
+
+			const uint32_t self     = desktop.StartProcess( L"C:\\Program Files\\Theater\\theater.exe" );
+			const uint32_t launcher = desktop.StartProcess( L"C:\\Games\\Launcher\\launcher.exe" );
+			const uint32_t shell    = desktop.StartProcess( L"C:\\Windows\\explorer.exe" );
+			const uint32_t game     = desktop.StartProcess( L"D:\\Spiele\\Überspiel\\game.exe" );
+			desktop.SetCurrentProcess( self );
+
+			SimulatedDesktop::WindowParams params = {};
+			params.pid                            = shell;
+			params.className                      = L"Shell_TrayWnd";
+			params.rect                           = PlatformRect{ 0, 1040, 1920, 1080 };
+			params.topmost                        = true;
+			desktop.AddWindow( params );
+
+			params                  = {};
+			params.pid              = launcher;
+			params.className        = L"LauncherMain";
+			params.title            = L"Launcher \U0001F3AE";
+			params.rect             = PlatformRect{ -2000, 100, -800, 900 };
+			const auto launcherMain = desktop.AddWindow( params );
+
+			params.className = L"LauncherSplash";
+			params.title     = L"";
+			params.owner     = launcherMain;
+			params.visible   = false;
+			desktop.AddWindow( params );
+
+			params           = {};
+			params.pid       = shell;
+			params.className = L"ApplicationFrameWindow";
+			params.title     = L"Settings";
+			const auto store = desktop.AddWindow( params );
+			desktop.SetWindowCloaked( store, true );
+
+			params           = {};
+			params.pid       = self;
+			params.className = L"TheaterDimmerWindow";
+			params.rect      = PlatformRect{ 0, 0, 1920, 1080 };
+			desktop.AddWindow( params );
+
+			ProcessNameSet targetNames;
+			ProcessNameSet companionNames;
+			targetNames.Add( L"game.exe" );
+			targetNames.Add( L"Überspiel.exe" );
+			companionNames.Add( L"discord.exe" );
+			writer.Begin( desktop, self, targetNames, companionNames );
+			desktop.StartEventHooks( OnRecorded );
+
+			// delays from nothing to well past a two byte varint
+			desktop.Advance( 16 );
+			desktop.SetForegroundWindow( launcherMain );
+			desktop.DispatchEvents();
+
+			desktop.Advance( 70000 );
+			params                = {};
+			params.pid            = game;
+			params.className      = L"UnrealWindow";
+			params.title          = L"Überspiel";
+			params.rect           = PlatformRect{ -2560, -200, 0, 1240 };
+			const auto gameWindow = desktop.AddWindow( params );
+			desktop.DispatchEvents();
+
+			desktop.Advance( 3 );
+			desktop.SetForegroundWindow( gameWindow );
+			desktop.SetWindowCloaked( store, false );
+			desktop.DispatchEvents();
+
+			desktop.Advance( 1000 );
+			desktop.ShowWindow( launcherMain, false );
+			desktop.DispatchEvents();
+
+			desktop.Advance( 250 );
+			desktop.DestroyWindow( gameWindow );
+			desktop.SetWindowCloaked( store, true );
+			desktop.DispatchEvents();
+
+			desktop.StopEventHooks();
+			s_writer = nullptr;
+		}
+
+		// Builds the recorded desktop again and plays the events on it, the way a replay does
+		class Rebuild
+		{
+		public:
+			void Run( const EventLog& log )
+			{
+				s_desktop = &this->desktop;
+				s_events.clear();
+
+				for ( const auto& monitor : log.monitors )
+					this->desktop.AddMonitor( monitor.device, monitor.rect );
+
+				for ( const auto& step : log.steps )
+				{
+					if ( step.record == EventLogRecord::Process )
+					{
+						const auto& process     = log.processes[step.index];
+						this->pids[process.pid] = this->desktop.StartProcess( process.path );
+					}
+					else if ( step.record == EventLogRecord::Window )
+					{
+						// windows created while recording are added when their event comes
+						const auto& window = log.windows[step.index];
+						if ( this->hooked )
+							this->created[window.id] = &window;
+						else
+							Add( window, window.visible );
+					}
+					else
+					{
+						Play( log.events[step.index] );
+					}
+				}
+
+				this->desktop.StopEventHooks();
+			}
+
+			SimulatedDesktop                                    desktop;
+			std::map<uint32_t, uint32_t>                        pids;
+			std::map<Platform::WindowId, Platform::WindowId>    windows;
+			std::map<Platform::WindowId, const EventLogWindow*> created;
+			bool                                                hooked = false;
+
+		private:
+			void Add( const EventLogWindow& window, bool visible )
+			{
+				const bool owned = window.owner != Platform::NO_WINDOW;
+
+				SimulatedDesktop::WindowParams params = {};
+				params.pid                            = this->pids[window.pid];
+				params.owner                          = owned ? this->windows[window.owner] : Platform::NO_WINDOW;
+				params.className                      = window.className;
+				params.title                          = window.title;
+				params.rect                           = window.rect;
+				params.visible                        = visible;
+				params.topmost                        = window.topmost;
+
+				const auto added = this->desktop.AddWindow( params );
+				if ( window.cloaked )
+					this->desktop.SetWindowCloaked( added, true );
+
+				this->windows[window.id] = added;
+			}
+
+			void Play( const EventLogEvent& event )
+			{
+				if ( !this->hooked )
+				{
+					this->desktop.StartEventHooks( OnRecorded );
+					this->hooked = true;
+				}
+
+				this->desktop.Advance( event.delay );
+				switch ( event.type )
+				{
+				case WindowEventType::Created:
+					Add( *this->created[event.window], false );
+					break;
+				case WindowEventType::Foreground:
+					this->desktop.SetForegroundWindow( this->windows[event.window] );
+					break;
+				case WindowEventType::Destroyed:
+					this->desktop.DestroyWindow( this->windows[event.window] );
+					break;
+				case WindowEventType::Shown:
+				case WindowEventType::Hidden:
+					this->desktop.ShowWindow( this->windows[event.window], event.type == WindowEventType::Shown );
+					break;
+				case WindowEventType::Cloaked:
+				case WindowEventType::Uncloaked:
+					this->desktop.SetWindowCloaked( this->windows[event.window],
+					                                event.type == WindowEventType::Cloaked );
+					break;
+				default:
+					break;
+				}
+
+				this->desktop.DispatchEvents();
+			}
+		};
+
+		// Hand written logs for the failure cases
+		class LogBuilder
+		{
+		public:
+			LogBuilder( uint32_t version = 1 )
+			{
+				this->bytes = { 'T', 'H', 'E', 'L' };
+				Varint( version );
+			}
+
+			LogBuilder& Record( EventLogRecord record )
+			{
+				this->bytes.emplace_back( static_cast<uint8_t>( record ) );
+				return *this;
+			}
+
+			LogBuilder& Varint( uint64_t value )
+			{
+				for ( ; value >= 0x80; value >>= 7 )
+					this->bytes.emplace_back( static_cast<uint8_t>( value | 0x80 ) );
+
+				this->bytes.emplace_back( static_cast<uint8_t>( value ) );
+				return *this;
+			}
+
+			LogBuilder& String( const char* value )
+			{
+				Record( EventLogRecord::String );
+				Varint( strlen( value ) );
+				for ( const char* c = value; *c != '\0'; c++ )
+					Varint( static_cast<uint8_t>( *c ) );
+
+				return *this;
+			}
+
+			LogBuilder& Rect()
+			{
+				return Varint( 0 ).Varint( 0 ).Varint( 3840 ).Varint( 2160 );
+			}
+
+			bool Read() const
+			{
+				EventLog log;
+				return ReadEventLog( this->bytes.data(), this->bytes.size(), log );
+			}
+
+			std::vector<uint8_t> bytes;
+		};
+	} // namespace
+} // namespace Theater
+
+using namespace Theater;
+
+THEATER_TEST( eventlog, RoundTripThroughTheSimulatedDesktop )
+{
+	SimulatedDesktop recorded;
+	EventLogWriter   writer;
+	Record( recorded, writer );
+	const std::vector<WindowEvent> events = s_events;
+
+	EventLog log;
+	REQUIRE( ReadEventLog( writer.GetBytes().data(), writer.GetBytes().size(), log ) );
+	CHECK( log.targetNames == std::vector<std::wstring>( { L"game.exe", L"Überspiel.exe" } ) );
+	CHECK( log.companionNames == std::vector<std::wstring>( { L"discord.exe" } ) );
+	REQUIRE( log.monitors.size() == 2 );
+	CHECK( log.monitors[1].device == L"\\\\.\\DISPLAY2" );
+	CHECK( log.monitors[1].rect.left == -2560 );
+	CHECK( log.monitors[1].rect.top == -200 );
+
+	// our own process and dimmer are left out, every other process is written once ahead of its first window
+	REQUIRE( log.processes.size() == 3 );
+	for ( const auto& process : log.processes )
+		CHECK( process.path.find( L"theater.exe" ) == std::wstring::npos );
+	CHECK( log.processes[2].path == L"D:\\Spiele\\Überspiel\\game.exe" );
+	CHECK( log.windows.size() == 5 );
+	CHECK( log.steps.size() == log.processes.size() + log.windows.size() + log.events.size() );
+
+	// every event the hooks delivered, with the time between them
+	REQUIRE( log.events.size() == events.size() );
+	for ( size_t i = 0; i < events.size(); i++ )
+	{
+		CHECK( log.events[i].type == events[i].type );
+		CHECK( log.events[i].window == events[i].window );
+		CHECK( log.events[i].delay == ( i == 0 ? 0 : events[i].time - events[i - 1].time ) );
+	}
+
+	// the desktop built from the log looks the same and plays back the same events
+	Rebuild rebuilt;
+	rebuilt.Run( log );
+	REQUIRE( s_events.size() == events.size() );
+	for ( size_t i = 0; i < events.size(); i++ )
+	{
+		CHECK( s_events[i].type == events[i].type );
+		CHECK( s_events[i].window == rebuilt.windows[events[i].window] );
+		CHECK( i == 0 || s_events[i].time - s_events[i - 1].time == events[i].time - events[i - 1].time );
+	}
+
+	std::vector<Platform::WindowId> zOrder;
+	for ( const auto window : recorded.GetZOrder() )
+	{
+		if ( rebuilt.windows.count( window ) != 0 )
+			zOrder.emplace_back( rebuilt.windows[window] );
+	}
+	CHECK( zOrder == rebuilt.desktop.GetZOrder() );
+	CHECK( zOrder.size() == recorded.GetZOrder().size() - 1 );
+
+	for ( const auto& entry : rebuilt.windows )
+	{
+		const Platform::WindowId a = entry.first;
+		const Platform::WindowId b = entry.second;
+		wchar_t                  classA[256];
+		wchar_t                  classB[256];
+		wchar_t                  titleA[256];
+		wchar_t                  titleB[256];
+		CHECK( std::wstring( classA, recorded.GetWindowClassName( a, classA, 256 ) ) ==
+		       std::wstring( classB, rebuilt.desktop.GetWindowClassName( b, classB, 256 ) ) );
+		CHECK( std::wstring( titleA, recorded.GetWindowTitle( a, titleA, 256 ) ) ==
+		       std::wstring( titleB, rebuilt.desktop.GetWindowTitle( b, titleB, 256 ) ) );
+		CHECK( recorded.IsWindowVisible( a ) == rebuilt.desktop.IsWindowVisible( b ) );
+		CHECK( recorded.IsWindowCloaked( a ) == rebuilt.desktop.IsWindowCloaked( b ) );
+		CHECK( recorded.IsWindowTopmost( a ) == rebuilt.desktop.IsWindowTopmost( b ) );
+
+		PlatformRect rectA = {};
+		PlatformRect rectB = {};
+		CHECK( recorded.GetWindowRect( a, rectA ) == rebuilt.desktop.GetWindowRect( b, rectB ) );
+		CHECK( rectA.left == rectB.left && rectA.top == rectB.top && rectA.right == rectB.right &&
+		       rectA.bottom == rectB.bottom );
+
+		std::wstring pathA;
+		std::wstring pathB;
+		std::wstring name;
+		recorded.QueryProcessPath( recorded.GetWindowProcessId( a ), pathA, name );
+		rebuilt.desktop.QueryProcessPath( rebuilt.desktop.GetWindowProcessId( b ), pathB, name );
+		CHECK( pathA == pathB );
+
+		const Platform::WindowId owner = recorded.GetWindowOwner( a );
+		CHECK( ( owner == Platform::NO_WINDOW ? Platform::NO_WINDOW : rebuilt.windows[owner] ) ==
+		       rebuilt.desktop.GetWindowOwner( b ) );
+	}
+}
+
+THEATER_TEST( eventlog, StringsAreWrittenOnce )
+{
+	// a browser with a hundred windows of the same class and title
+	const std::wstring className = L"Chrome_WidgetWin_1_With_A_Long_Class_Name";
+	SimulatedDesktop   desktop;
+	const uint32_t     pid = desktop.StartProcess( L"C:\\Program Files\\Google\\Chrome\\Application\\chrome.exe" );
+
+	EventLogWriter writer;
+	size_t         sizes[2] = {};
+	for ( auto& size : sizes )
+	{
+		SimulatedDesktop::WindowParams params = {};
+		params.pid                            = pid;
+		params.className                      = className;
+		params.title                          = L"New Tab - Google Chrome";
+		for ( uint32_t i = 0; i < 100; i++ )
+			desktop.AddWindow( params );
+
+		writer.Begin( desktop, 0, ProcessNameSet(), ProcessNameSet() );
+		size = writer.GetBytes().size();
+	}
+
+	// the hundred more windows only add their ids, rects and flags
+	CHECK( ( sizes[1] - sizes[0] ) / 100 < className.size() );
+
+	EventLog log;
+	REQUIRE( ReadEventLog( writer.GetBytes().data(), writer.GetBytes().size(), log ) );
+	REQUIRE( log.windows.size() == 200 );
+	CHECK( log.processes.size() == 1 );
+	CHECK( log.windows[199].className == className );
+	CHECK( log.windows[199].title == L"New Tab - Google Chrome" );
+}
+
+THEATER_TEST( eventlog, TruncatedLogFailsCleanly )
+{
+	SimulatedDesktop recorded;
+	EventLogWriter   writer;
+	Record( recorded, writer );
+
+	EventLog full;
+	REQUIRE( ReadEventLog( writer.GetBytes().data(), writer.GetBytes().size(), full ) );
+
+	// cut anywhere, a log either fails or reads as the records written before the cut
+	uint32_t failures = 0;
+	uint32_t accepted = 0;
+	for ( size_t size = 0; size < writer.GetBytes().size(); size++ )
+	{
+		std::vector<uint8_t> bytes( writer.GetBytes().begin(), writer.GetBytes().begin() + size );
+
+		EventLog log;
+		if ( !ReadEventLog( bytes.data(), bytes.size(), log ) )
+			continue;
+
+		accepted++;
+		failures += log.steps.size() <= full.steps.size() ? 0 : 1;
+		failures += log.windows.size() <= full.windows.size() ? 0 : 1;
+		for ( size_t i = 0; i < log.events.size(); i++ )
+		{
+			const auto& event = log.events[i];
+			failures += event.type == full.events[i].type && event.window == full.events[i].window ? 0 : 1;
+		}
+	}
+
+	CHECK( failures == 0 );
+	CHECK( accepted > 0 );
+
+	// the last event lost its window
+	EventLog log;
+	CHECK( !ReadEventLog( writer.GetBytes().data(), writer.GetBytes().size() - 1, log ) );
+	CHECK( !ReadEventLog( writer.GetBytes().data(), 0, log ) );
+}
+
+THEATER_TEST( eventlog, WrongVersionFails )
+{
+	CHECK( LogBuilder().Read() );
+	CHECK( !LogBuilder( 0 ).Read() );
+	CHECK( !LogBuilder( 2 ).Read() );
+	CHECK( !LogBuilder( 1u << 31 ).Read() );
+
+	LogBuilder magic;
+	magic.bytes[3] = 'X';
+	CHECK( !magic.Read() );
+
+	// a version that doesn't fit its type
+	LogBuilder huge;
+	huge.bytes.resize( 4 );
+	huge.Varint( 0x100000001ull );
+	CHECK( !huge.Read() );
+}
+
+THEATER_TEST( eventlog, OutOfRangeStringReferenceFails )
+{
+	CHECK( LogBuilder().String( "game.exe" ).Record( EventLogRecord::TargetName ).Varint( 0 ).Read() );
+	CHECK( !LogBuilder().String( "game.exe" ).Record( EventLogRecord::TargetName ).Varint( 1 ).Read() );
+	CHECK( !LogBuilder().Record( EventLogRecord::CompanionName ).Varint( 0 ).Read() );
+	CHECK( !LogBuilder().Record( EventLogRecord::Monitor ).Varint( 0 ).Rect().Read() );
+
+	// strings are only known once defined, a reference ahead of its definition fails too
+	CHECK( !LogBuilder().Record( EventLogRecord::Process ).Varint( 42 ).Varint( 0 ).String( "game.exe" ).Read() );
+
+	// the title of a window past the strings
+	LogBuilder window;
+	window.String( "game.exe" ).String( "UnrealWindow" );
+	window.Record( EventLogRecord::Process ).Varint( 42 ).Varint( 0 );
+	window.Record( EventLogRecord::Window ).Varint( 7 ).Varint( 0 ).Varint( 42 ).Varint( 1 );
+	LogBuilder valid = window;
+	window.Varint( 2 ).Rect().Varint( 1 );
+	valid.Varint( 1 ).Rect().Varint( 1 );
+	CHECK( !window.Read() );
+	CHECK( valid.Read() );
+
+	// nor does anything else out of range
+	CHECK( !LogBuilder().Record( static_cast<EventLogRecord>( 0 ) ).Read() );
+	CHECK( !LogBuilder().Record( static_cast<EventLogRecord>( 200 ) ).Read() );
+	CHECK( !LogBuilder().Record( EventLogRecord::Event ).Varint( 100 ).Varint( 0 ).Varint( 7 ).Read() );
+	CHECK( !LogBuilder().String( "x" ).Record( EventLogRecord::Process ).Varint( 1ull << 40 ).Varint( 0 ).Read() );
+	CHECK( !LogBuilder().Record( EventLogRecord::String ).Varint( 1ull << 40 ).Read() );
+}
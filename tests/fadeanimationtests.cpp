@@ -0,0 +1,263 @@
+#include "theater.h"
+#include "testing.h"
+
+namespace Theater
+{
+	namespace
+	{
+		// Time only moves when the test says so
+		class VirtualClock final : public AnimationClock
+		{
+		public:
+			uint64_t GetTimeMicroseconds() const override
+			{
+				return this->now;
+			}
+
+			void Advance( uint64_t microseconds )
+			{
+				this->now += microseconds;
+			}
+
+		private:
+			uint64_t now = 1000000;
+		};
+
+		constexpr Easing EASINGS[] = { Easing::Linear, Easing::EaseIn, Easing::EaseOut, Easing::EaseInOut };
+	} // namespace
+} // namespace Theater
+
+using namespace Theater;
+
+THEATER_TEST( fadeanimation, EasingNamesRoundTrip )
+{
+	for ( const auto easing : EASINGS )
+	{
+		Easing parsed = Easing::Linear;
+		CHECK( ParseEasing( GetEasingName( easing ), parsed ) );
+		CHECK( parsed == easing );
+	}
+
+	Easing parsed = Easing::Linear;
+	CHECK( !ParseEasing( L"bounce", parsed ) );
+}
+
+THEATER_TEST( fadeanimation, EasingsRunFromZeroToOne )
+{
+	for ( const auto easing : EASINGS )
+	{
+		CHECK( ApplyEasing( easing, 0.0f ) == 0.0f );
+		CHECK( ApplyEasing( easing, 1.0f ) == 1.0f );
+		CHECK( ApplyEasing( easing, -1.0f ) == 0.0f );
+		CHECK( ApplyEasing( easing, 2.0f ) == 1.0f );
+
+		float former = 0.0f;
+		for ( uint32_t i = 1; i <= 100; i++ )
+		{
+			const float value = ApplyEasing( easing, i / 100.0f );
+			CHECK( value >= former );
+			former = value;
+		}
+	}
+
+	CHECK( ApplyEasing( Easing::EaseIn, 0.5f ) < 0.5f );
+	CHECK( ApplyEasing( Easing::EaseOut, 0.5f ) > 0.5f );
+	CHECK( ApplyEasing( Easing::EaseInOut, 0.5f ) == 0.5f );
+}
+
+THEATER_TEST( fadeanimation, FadeFollowsTheClockNotTheTicks )
+{
+	VirtualClock  clock;
+	FadeAnimation fade;
+	fade.SetClock( &clock );
+	fade.SetDuration( 500 );
+	fade.Reset( 0.0f );
+	fade.Start( 1.0f );
+	CHECK( fade.IsRunning() );
+
+	// a late timer lands on the same curve, only fewer points of it
+	uint8_t alpha = 0;
+	clock.Advance( 250000 );
+	CHECK( fade.Tick( alpha ) );
+	CHECK( alpha == 128 );
+
+	clock.Advance( 13000 );
+	CHECK( fade.Tick( alpha ) );
+	CHECK( alpha == 134 );
+
+	clock.Advance( 1000000 );
+	CHECK( fade.Tick( alpha ) );
+	CHECK( alpha == 255 );
+	CHECK( !fade.IsRunning() );
+	CHECK( !fade.Tick( alpha ) );
+}
+
+THEATER_TEST( fadeanimation, TickReportsEachByteOnce )
+{
+	for ( const auto easing : EASINGS )
+	{
+		VirtualClock  clock;
+		FadeAnimation fade;
+		fade.SetClock( &clock );
+		fade.SetDuration( 10000 );
+		fade.SetEasing( easing );
+		fade.Reset( 0.0f );
+		fade.Start( 1.0f );
+
+		// far more ticks than bytes
+		uint32_t changes = 0;
+		uint8_t  former  = 0;
+		while ( fade.IsRunning() )
+		{
+			clock.Advance( 1000 );
+
+			uint8_t alpha = 0;
+			if ( !fade.Tick( alpha ) )
+				continue;
+
+			CHECK( alpha > former );
+			former = alpha;
+			changes++;
+		}
+
+		CHECK( former == 255 );
+		CHECK( changes == 255 );
+	}
+}
+
+THEATER_TEST( fadeanimation, FadeOutRetargetsFromTheCurrentAlpha )
+{
+	VirtualClock  clock;
+	FadeAnimation fade;
+	fade.SetClock( &clock );
+	fade.SetDuration( 500 );
+	fade.Reset( 0.0f );
+	fade.Start( 0.8f );
+
+	// switched away 250 ms in, at 0.4, the fade out covers half the span and lasts 250 ms
+	uint8_t alpha = 0;
+	clock.Advance( 250000 );
+	fade.Tick( alpha );
+	fade.Start( 0.0f );
+	CHECK( std::fabs( fade.GetAlpha() - 0.4f ) < 1e-4f );
+	CHECK( fade.GetTargetAlpha() == 0.0f );
+
+	clock.Advance( 125000 );
+	CHECK( fade.Tick( alpha ) );
+	CHECK( alpha == 51 );
+
+	// and back again before it's done, without going through zero, 0.6 to cover takes 375 ms
+	fade.Start( 0.8f );
+	clock.Advance( 281250 );
+	CHECK( fade.Tick( alpha ) );
+	CHECK( alpha == 166 );
+
+	clock.Advance( 1000000 );
+	CHECK( fade.Tick( alpha ) );
+	CHECK( alpha == 204 );
+	CHECK( !fade.IsRunning() );
+}
+
+THEATER_TEST( fadeanimation, FadeFromRestLastsTheConfiguredDuration )
+{
+	// the default alpha and a half dimmed one both take the 500 ms the settings ask for, in and out
+	for ( const float target : { 200.0f / 255.0f, 128.0f / 255.0f, 1.0f } )
+	{
+		VirtualClock  clock;
+		FadeAnimation fade;
+		fade.SetClock( &clock );
+		fade.SetDuration( 500 );
+		fade.Reset( 0.0f );
+
+		for ( const float to : { target, 0.0f } )
+		{
+			fade.Start( to );
+
+			uint8_t alpha = 0;
+			clock.Advance( 499000 );
+			fade.Tick( alpha );
+			CHECK( fade.IsRunning() );
+
+			clock.Advance( 1000 );
+			fade.Tick( alpha );
+			CHECK( !fade.IsRunning() );
+			CHECK( fade.GetAlpha() == to );
+		}
+	}
+}
+
+THEATER_TEST( fadeanimation, RetargetingWithoutTicksStillStartsMidFlight )
+{
+	VirtualClock  clock;
+	FadeAnimation fade;
+	fade.SetClock( &clock );
+	fade.SetDuration( 1000 );
+	fade.Reset( 1.0f );
+	fade.Start( 0.0f );
+
+	// the timer didn't get to run at all
+	clock.Advance( 250000 );
+	fade.Start( 1.0f );
+	CHECK( std::fabs( fade.GetAlpha() - 0.75f ) < 1e-4f );
+
+	clock.Advance( 250000 );
+	uint8_t alpha = 0;
+	CHECK( !fade.Tick( alpha ) );
+	CHECK( !fade.IsRunning() );
+	CHECK( fade.GetAlpha() == 1.0f );
+}
+
+THEATER_TEST( fadeanimation, ZeroDurationJumpsToTheTarget )
+{
+	VirtualClock  clock;
+	FadeAnimation fade;
+	fade.SetClock( &clock );
+	fade.SetDuration( 0 );
+	fade.Reset( 0.0f );
+	fade.Start( 0.5f );
+
+	uint8_t alpha = 0;
+	CHECK( fade.Tick( alpha ) );
+	CHECK( alpha == 128 );
+	CHECK( !fade.IsRunning() );
+
+	// starting towards where it already is changes nothing
+	fade.SetDuration( 500 );
+	fade.Start( 0.5f );
+	CHECK( !fade.Tick( alpha ) );
+	CHECK( !fade.IsRunning() );
+}
+
+// A 60 Hz timer tick over a fade, most of them don't change the byte
+THEATER_BENCHMARK( fadeanimation, Tick )
+{
+	const uint32_t fades = quick ? 100 : 100000;
+
+	VirtualClock  clock;
+	FadeAnimation fade;
+	fade.SetClock( &clock );
+	fade.SetDuration( 500 );
+	fade.SetEasing( Easing::EaseInOut );
+	fade.Reset( 0.0f );
+
+	uint64_t       ticks   = 0;
+	uint64_t       changes = 0;
+	const uint64_t start   = GetTestTimeNanoseconds();
+	for ( uint32_t i = 0; i < fades; i++ )
+	{
+		fade.Start( i % 2 == 0 ? 0.8f : 0.0f );
+		while ( fade.IsRunning() )
+		{
+			clock.Advance( 16667 );
+
+			uint8_t alpha = 0;
+			changes += fade.Tick( alpha ) ? 1 : 0;
+			ticks++;
+		}
+	}
+	const uint64_t elapsed = GetTestTimeNanoseconds() - start;
+
+	KeepValue( changes );
+	ReportBenchmark( "tick", static_cast<double>( elapsed ) / ticks, "ns" );
+	ReportBenchmark( "byte changes", 100.0 * changes / ticks, "%" );
+}
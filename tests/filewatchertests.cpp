@@ -0,0 +1,151 @@
+#include "theater.h"
+#include "testing.h"
+#include <filesystem>
+#include <fstream>
+
+namespace Theater
+{
+	namespace
+	{
+		constexpr uint32_t DEBOUNCE = 50;
+
+		// A directory of its own for every test with a watcher on settings.json in it
+		class WatchedDirectory
+		{
+		public:
+			WatchedDirectory()
+			{
+				static uint32_t s_counter = 0;
+
+				this->directory = std::filesystem::temp_directory_path() /
+				                  ( "theater-watcher-" + std::to_string( GetTestTimeNanoseconds() ) + "-" +
+				                    std::to_string( s_counter++ ) );
+				std::filesystem::create_directories( this->directory );
+				this->opened = this->watcher.Open( this->directory.wstring(), L"settings.json" );
+				this->watcher.SetDebounce( DEBOUNCE );
+			}
+
+			~WatchedDirectory()
+			{
+				this->watcher.Close();
+
+				std::error_code error;
+				std::filesystem::remove_all( this->directory, error );
+			}
+
+			void Write( const char* name, const std::string& content ) const
+			{
+				std::ofstream file( this->directory / name, std::ios::binary | std::ios::trunc );
+				file << content;
+			}
+
+			// Wakes the watcher after a delay in which a change would have been reported
+			std::thread WakeLater() const
+			{
+				return std::thread( [this]() {
+					std::this_thread::sleep_for( std::chrono::milliseconds( DEBOUNCE * 4 ) );
+					this->watcher.Wake();
+				} );
+			}
+
+			std::filesystem::path directory;
+			mutable FileWatcher   watcher;
+			bool                  opened = false;
+		};
+	} // namespace
+} // namespace Theater
+
+using namespace Theater;
+
+THEATER_TEST( filewatcher, BurstOfWritesIsReportedOnce )
+{
+	WatchedDirectory watched;
+	REQUIRE( watched.opened );
+
+	// a tool rewriting the file in place, one write every 10 ms, each shorter than the debounce
+	const uint64_t start = GetTestTimeNanoseconds();
+	std::thread    writer( [&watched]() {
+		for ( uint32_t i = 0; i < 20; i++ )
+		{
+			watched.Write( "settings.json", "{ \"alpha\": " + std::to_string( i ) + " }" );
+			std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+		}
+	} );
+
+	CHECK( watched.watcher.Wait() == FileWatcher::WaitResult::Changed );
+	const uint64_t elapsed = GetTestTimeNanoseconds() - start;
+	writer.join();
+
+	// only once the writes stopped, and nothing left over for the next wait
+	CHECK( elapsed >= ( 190 + DEBOUNCE ) * 1000000ull );
+	std::thread waker = watched.WakeLater();
+	CHECK( watched.watcher.Wait() == FileWatcher::WaitResult::Woken );
+	waker.join();
+}
+
+THEATER_TEST( filewatcher, ReplacingByRenameIsReported )
+{
+	WatchedDirectory watched;
+	REQUIRE( watched.opened );
+	watched.Write( "settings.json", "{}" );
+	CHECK( watched.watcher.Wait() == FileWatcher::WaitResult::Changed );
+
+	// the way editors and the persister save
+	watched.Write( "settings.json.tmp", "{ \"alpha\": 1 }" );
+	std::filesystem::rename( watched.directory / "settings.json.tmp", watched.directory / "settings.json" );
+	CHECK( watched.watcher.Wait() == FileWatcher::WaitResult::Changed );
+
+	std::filesystem::remove( watched.directory / "settings.json" );
+	CHECK( watched.watcher.Wait() == FileWatcher::WaitResult::Changed );
+}
+
+THEATER_TEST( filewatcher, OtherFilesAreNotReported )
+{
+	WatchedDirectory watched;
+	REQUIRE( watched.opened );
+
+	// the snapshot and backup next to settings.json, and a name it is the start of
+	watched.Write( "settings.bin", "snapshot" );
+	watched.Write( "settings.json.bak", "{}" );
+	watched.Write( "settings.jso", "{}" );
+	std::filesystem::create_directories( watched.directory / "logs" );
+	watched.Write( "logs/settings.json", "{}" );
+
+	std::thread waker = watched.WakeLater();
+	CHECK( watched.watcher.Wait() == FileWatcher::WaitResult::Woken );
+	waker.join();
+}
+
+THEATER_TEST( filewatcher, WakeReturnsWoken )
+{
+	WatchedDirectory watched;
+	REQUIRE( watched.opened );
+
+	// before the wait, and from another thread while blocked
+	watched.watcher.Wake();
+	CHECK( watched.watcher.Wait() == FileWatcher::WaitResult::Woken );
+
+	std::thread waker = watched.WakeLater();
+	CHECK( watched.watcher.Wait() == FileWatcher::WaitResult::Woken );
+	waker.join();
+
+	// a wake during the debounce wins over the pending change, the way the app stops its reload thread
+	watched.Write( "settings.json", "{}" );
+	watched.watcher.SetDebounce( 10000 );
+	waker = watched.WakeLater();
+	CHECK( watched.watcher.Wait() == FileWatcher::WaitResult::Woken );
+	waker.join();
+}
+
+THEATER_TEST( filewatcher, ClosedWatcherFails )
+{
+	FileWatcher watcher;
+	CHECK( watcher.Wait() == FileWatcher::WaitResult::Error );
+	CHECK( !watcher.Open( L"/nonexistent/theater", L"settings.json" ) );
+	CHECK( watcher.Wait() == FileWatcher::WaitResult::Error );
+
+	WatchedDirectory watched;
+	REQUIRE( watched.opened );
+	watched.watcher.Close();
+	CHECK( watched.watcher.Wait() == FileWatcher::WaitResult::Error );
+}
@@ -0,0 +1,162 @@
+#include "theater.h"
+#include "testing.h"
+#include <random>
+
+namespace Theater
+{
+	namespace
+	{
+		constexpr SimdLevel SIMD_LEVELS[] = { SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2 };
+
+		struct Span
+		{
+			size_t         count;
+			float          dx;
+			float          dy;
+			GradientParams params;
+			uint32_t       color;
+		};
+
+		// Counts around the vector widths, offsets that are neither whole nor half pixels, near the center and far off
+		Span MakeSpan( std::mt19937& random )
+		{
+			std::uniform_real_distribution<float> nearOffset( -70.0f, 3.0f );
+			std::uniform_real_distribution<float> farOffset( -3000.0f, 3000.0f );
+			std::uniform_real_distribution<float> unit( 0.0f, 1.0f );
+
+			Span span                 = {};
+			span.count                = random() % 70;
+			span.dx                   = random() % 2 == 0 ? nearOffset( random ) : farOffset( random );
+			span.dy                   = random() % 2 == 0 ? nearOffset( random ) : farOffset( random );
+			span.params.kind          = random() % 2 == 0 ? GradientKind::Radial : GradientKind::Linear;
+			span.params.radius        = 1.0f + unit( random ) * 4000.0f;
+			span.params.innerCoverage = unit( random );
+			span.color                = random() & 0xFFFFFF;
+			return span;
+		}
+
+		std::vector<uint32_t> Render( SimdLevel level, const Span& span )
+		{
+			std::vector<uint32_t> row( span.count + 1, 0xDEADBEEF );
+			RenderGradientSpan( level, row.data(), span.count, span.dx, span.dy, span.params, span.color );
+			return row;
+		}
+
+		uint32_t ReferencePixel( const Span& span, size_t i )
+		{
+			const double   x        = static_cast<double>( span.dx ) + i;
+			const double   dy       = span.params.kind == GradientKind::Radial ? span.dy : 0.0;
+			const double   t        = std::min( std::sqrt( x * x + dy * dy ) / span.params.radius, 1.0 );
+			const double   inner    = span.params.innerCoverage;
+			const double   coverage = inner + ( 1.0 - inner ) * t;
+			const uint32_t pixel    = 0xFF000000u | span.color;
+
+			uint32_t result = 0;
+			for ( uint32_t shift = 0; shift < 32; shift += 8 )
+				result |= static_cast<uint32_t>( ( ( pixel >> shift ) & 0xFF ) * coverage + 0.5 ) << shift;
+
+			return result;
+		}
+	} // namespace
+} // namespace Theater
+
+using namespace Theater;
+
+THEATER_TEST( gradientkernel, KernelsAgreeBitForBit )
+{
+	std::mt19937 random( 1010 );
+	for ( uint32_t i = 0; i < 20000; i++ )
+	{
+		const Span span   = MakeSpan( random );
+		const auto scalar = Render( SimdLevel::Scalar, span );
+		CHECK( scalar[span.count] == 0xDEADBEEF );
+		for ( const auto level : SIMD_LEVELS )
+			CHECK( Render( level, span ) == scalar );
+	}
+}
+
+THEATER_TEST( gradientkernel, MatchesTheReferenceGradient )
+{
+	std::mt19937 random( 1011 );
+	uint32_t     maxError = 0;
+	for ( uint32_t i = 0; i < 5000; i++ )
+	{
+		const Span span = MakeSpan( random );
+		const auto row  = Render( GetSimdLevel(), span );
+		for ( size_t j = 0; j < span.count; j++ )
+		{
+			const uint32_t expected = ReferencePixel( span, j );
+			for ( uint32_t shift = 0; shift < 32; shift += 8 )
+			{
+				const int32_t difference = static_cast<int32_t>( ( row[j] >> shift ) & 0xFF ) -
+				                           static_cast<int32_t>( ( expected >> shift ) & 0xFF );
+				maxError = std::max( maxError, static_cast<uint32_t>( std::abs( difference ) ) );
+			}
+		}
+	}
+
+	CHECK( maxError <= 1 );
+}
+
+THEATER_TEST( gradientkernel, ReachesTheColorAtTheRadius )
+{
+	const GradientParams params = { GradientKind::Radial, 100.0f, 0.0f };
+	for ( const auto level : SIMD_LEVELS )
+	{
+		uint32_t row[9] = {};
+		RenderGradientSpan( level, row, 9, -4.0f, 0.0f, params, 0x204080 );
+		CHECK( row[4] == 0 ); // the center is fully clear with no inner coverage
+
+		RenderGradientSpan( level, row, 9, 100.0f, 0.0f, params, 0x204080 );
+		for ( const auto pixel : row )
+			CHECK( pixel == 0xFF204080u );
+
+		// a flat color needs no kernel
+		RenderGradientSpan( level, row, 9, 0.0f, 0.0f, { GradientKind::None, 0.0f, 0.0f }, 0x80112233u );
+		for ( const auto pixel : row )
+			CHECK( pixel == 0x80112233u );
+	}
+}
+
+// Every row of a monitor sized gradient, the work a gradient change costs the dimmer
+THEATER_BENCHMARK( gradientkernel, Frame )
+{
+	struct Size
+	{
+		const char* name;
+		uint32_t    width;
+		uint32_t    height;
+	};
+
+	const Size     sizes[] = { { "4k", 3840, 2160 }, { "8k", 7680, 4320 } };
+	const uint32_t runs    = quick ? 1 : 10;
+
+	const GradientParams params = { GradientKind::Radial, 1500.0f, 0.25f };
+	for ( const auto& size : sizes )
+	{
+		const uint32_t        width  = quick ? size.width / 8 : size.width;
+		const uint32_t        height = quick ? size.height / 8 : size.height;
+		std::vector<uint32_t> pixels( static_cast<size_t>( width ) * height );
+		for ( const auto level : SIMD_LEVELS )
+		{
+			if ( level > GetSimdLevel() )
+				continue;
+
+			const float    centerX = width * 0.5f;
+			const float    centerY = height * 0.5f;
+			const uint64_t start   = GetTestTimeNanoseconds();
+			for ( uint32_t i = 0; i < runs; i++ )
+			{
+				for ( uint32_t y = 0; y < height; y++ )
+					RenderGradientSpan( level, pixels.data() + static_cast<size_t>( y ) * width, width,
+					                    0.5f - centerX, y + 0.5f - centerY, params, 0x102030 );
+			}
+			const uint64_t elapsed = GetTestTimeNanoseconds() - start;
+
+			const std::string metric = std::string( size.name ) + " " + GetSimdLevelName( level );
+			KeepValue( pixels[pixels.size() / 2] );
+			ReportBenchmark( metric.c_str(), static_cast<double>( width ) * height * runs * 1000.0 / elapsed,
+			                 "MP/s" );
+		}
+	}
+}
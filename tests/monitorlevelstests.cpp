@@ -0,0 +1,130 @@
+#include "theater.h"
+#include "testing.h"
+
+namespace Theater
+{
+	namespace
+	{
+		// Dimmer windows on the simulated desktop, the fake backend counting SetWindowAlpha calls
+		struct DimmerWindows
+		{
+			SimulatedDesktop                   desktop;
+			MonitorLevels                      levels;
+			std::vector<std::wstring>          devices;
+			std::vector<Platform::WindowId>    windows;
+			std::vector<MonitorLevels::Change> changes;
+
+			explicit DimmerWindows( size_t count )
+			{
+				const uint32_t pid = this->desktop.StartProcess( L"C:\\Theater\\theater.exe" );
+				for ( size_t i = 0; i < count; i++ )
+					AddMonitor( pid );
+
+				this->levels.SetBaseAlpha( 200 );
+				this->levels.SetBaseColor( 0x000000 );
+				this->levels.Assign( this->devices.data(), this->devices.size() );
+			}
+
+			void AddMonitor( uint32_t pid )
+			{
+				SimulatedDesktop::WindowParams params = {};
+				params.pid                            = pid;
+				params.rect                           = PlatformRect{ 0, 0, 1920, 1080 };
+				this->windows.emplace_back( this->desktop.AddWindow( params ) );
+				this->devices.emplace_back( L"\\\\.\\DISPLAY" + std::to_wstring( this->devices.size() + 1 ) );
+			}
+
+			// One tick of the fade, returns how many windows were given an alpha
+			size_t Tick( float fade )
+			{
+				const size_t before = this->desktop.GetWindowAlphaCount();
+				this->levels.SetFade( fade );
+				this->levels.Apply( this->desktop, this->windows.data(), this->changes );
+				return this->desktop.GetWindowAlphaCount() - before;
+			}
+		};
+	} // namespace
+} // namespace Theater
+
+using namespace Theater;
+
+THEATER_TEST( monitorlevels, UnchangedLevelTouchesNoWindow )
+{
+	DimmerWindows dimmers( 3 );
+
+	// newly bound monitors are presented once, at zero
+	CHECK( dimmers.Tick( 0.0f ) == 3 );
+	CHECK( dimmers.changes.size() == 3 );
+	CHECK( dimmers.Tick( 0.0f ) == 0 );
+	CHECK( dimmers.changes.empty() );
+
+	// a 500 ms fade at 60 Hz towards 200, each window is only touched when its byte changes
+	size_t calls = 0;
+	for ( int i = 1; i <= 30; i++ )
+		calls += dimmers.Tick( i / 30.0f * ( 200.0f / 255.0f ) );
+	CHECK( calls == 3 * 30 );
+	for ( const auto window : dimmers.windows )
+		CHECK( dimmers.desktop.GetWindowAlpha( window ) == 200 );
+
+	// the fade is over but the timer keeps ticking until it's stopped
+	for ( int i = 0; i < 60; i++ )
+		CHECK( dimmers.Tick( 200.0f / 255.0f ) == 0 );
+	CHECK( dimmers.changes.empty() );
+}
+
+THEATER_TEST( monitorlevels, SlowFadeSkipsTicksWithinTheSameByte )
+{
+	DimmerWindows dimmers( 2 );
+	dimmers.levels.SetOverrides( { MonitorLevel{ L"\\\\.\\DISPLAY2", 30, MonitorLevel::GLOBAL } } );
+	dimmers.Tick( 0.0f );
+
+	// the chat monitor only goes up to 30, most ticks round to a byte it already has
+	size_t secondary = 0;
+	for ( int i = 1; i <= 300; i++ )
+	{
+		dimmers.Tick( i / 300.0f * ( 200.0f / 255.0f ) );
+		for ( const auto& change : dimmers.changes )
+			secondary += change.index == 1 ? 1 : 0;
+	}
+
+	CHECK( secondary == 30 );
+	CHECK( dimmers.desktop.GetWindowAlpha( dimmers.windows[0] ) == 200 );
+	CHECK( dimmers.desktop.GetWindowAlpha( dimmers.windows[1] ) == 30 );
+}
+
+THEATER_TEST( monitorlevels, ColorChangeIsReportedWithoutAnAlpha )
+{
+	DimmerWindows dimmers( 2 );
+	dimmers.Tick( 0.5f );
+
+	dimmers.levels.SetOverrides( { MonitorLevel{ L"\\\\.\\DISPLAY1", MonitorLevel::GLOBAL, 0x203040 } } );
+	CHECK( dimmers.Tick( 0.5f ) == 0 );
+	REQUIRE( dimmers.changes.size() == 1 );
+	CHECK( dimmers.changes[0].index == 0 );
+	CHECK( dimmers.changes[0].flags == MonitorLevels::COLOR_CHANGED );
+	CHECK( dimmers.levels.GetColor( 0 ) == 0x203040 );
+
+	// same color again
+	dimmers.levels.SetOverrides( { MonitorLevel{ L"\\\\.\\DISPLAY1", MonitorLevel::GLOBAL, 0x203040 } } );
+	CHECK( dimmers.Tick( 0.5f ) == 0 );
+	CHECK( dimmers.changes.empty() );
+}
+
+THEATER_TEST( monitorlevels, MonitorsKeptAcrossATopologyChangeStayUntouched )
+{
+	DimmerWindows dimmers( 2 );
+	dimmers.Tick( 0.5f );
+
+	// a third monitor is plugged in, it's the only window presented
+	const uint32_t pid = dimmers.desktop.StartProcess( L"C:\\Theater\\theater.exe" );
+	dimmers.AddMonitor( pid );
+	dimmers.levels.Assign( dimmers.devices.data(), dimmers.devices.size() );
+	CHECK( dimmers.Tick( 0.5f ) == 1 );
+	REQUIRE( dimmers.changes.size() == 1 );
+	CHECK( dimmers.changes[0].index == 2 );
+
+	// a window moved to another monitor is presented again
+	dimmers.levels.Invalidate( 0 );
+	CHECK( dimmers.Tick( 0.5f ) == 1 );
+	CHECK( dimmers.Tick( 0.5f ) == 0 );
+}
@@ -0,0 +1,248 @@
+#include "theater.h"
+#include "testing.h"
+#include <random>
+
+namespace Theater
+{
+	namespace
+	{
+		MonitorLayout Monitor( const wchar_t* device, int32_t left, int32_t top, int32_t width, int32_t height )
+		{
+			return MonitorLayout{ device, left, top, left + width, top + height };
+		}
+
+		// A laptop panel with a 4K screen to its right
+		const MonitorLayout LAPTOP   = Monitor( L"\\\\.\\DISPLAY1", 0, 0, 1920, 1080 );
+		const MonitorLayout EXTERNAL = Monitor( L"\\\\.\\DISPLAY2", 1920, 0, 3840, 2160 );
+		const MonitorLayout TV       = Monitor( L"\\\\.\\DISPLAY3", -1920, 0, 1920, 1080 );
+
+		// The dimmer windows as the dimmer keeps them, one per monitor, each knowing where it is
+		struct Windows
+		{
+			std::vector<MonitorLayout> layouts;
+			std::vector<uint32_t>      ids;
+			uint32_t                   nextId  = 1;
+			uint32_t                   created = 0;
+			uint32_t                   moved   = 0;
+			uint32_t                   retired = 0;
+
+			void Apply( const std::vector<MonitorLayout>& next )
+			{
+				MonitorTopologyDiff diff;
+				DiffMonitorTopology( this->layouts, next, diff );
+
+				std::vector<uint32_t> ids;
+				for ( const auto& entry : diff.entries )
+				{
+					switch ( entry.action )
+					{
+					case MonitorAction::Keep:
+						ids.emplace_back( this->ids[entry.source] );
+						break;
+					case MonitorAction::Move:
+						ids.emplace_back( this->ids[entry.source] );
+						this->moved++;
+						break;
+					case MonitorAction::Create:
+						ids.emplace_back( this->nextId++ );
+						this->created++;
+						break;
+					}
+				}
+
+				this->retired += static_cast<uint32_t>( diff.retired.size() );
+				this->layouts = next;
+				this->ids     = ids;
+			}
+		};
+
+		// Every former monitor ends up either as the source of exactly one entry or retired, never both
+		bool IsConsistent( const std::vector<MonitorLayout>& former, const std::vector<MonitorLayout>& next,
+		                   const MonitorTopologyDiff& diff )
+		{
+			if ( diff.entries.size() != next.size() )
+				return false;
+
+			std::vector<uint32_t> uses( former.size(), 0 );
+			for ( size_t i = 0; i < diff.entries.size(); i++ )
+			{
+				const auto& entry = diff.entries[i];
+				if ( entry.action == MonitorAction::Create )
+				{
+					if ( entry.source != MonitorTopologyDiff::NO_SOURCE )
+						return false;
+					continue;
+				}
+
+				if ( entry.source >= former.size() )
+					return false;
+				uses[entry.source]++;
+
+				const auto& a    = former[entry.source];
+				const auto& b    = next[i];
+				const bool  same = a.left == b.left && a.top == b.top && a.right == b.right && a.bottom == b.bottom;
+				if ( same != ( entry.action == MonitorAction::Keep ) )
+					return false;
+			}
+
+			for ( const auto index : diff.retired )
+			{
+				if ( index >= former.size() )
+					return false;
+				uses[index]++;
+			}
+
+			return std::all_of( uses.begin(), uses.end(), []( uint32_t count ) { return count == 1; } );
+		}
+
+		std::vector<MonitorLayout> MakeTopology( std::mt19937& random )
+		{
+			static const wchar_t* const DEVICES[] = { L"\\\\.\\DISPLAY1", L"\\\\.\\DISPLAY2", L"\\\\.\\DISPLAY3",
+				                                      L"\\\\.\\DISPLAY4", L"\\\\.\\DISPLAY5", L"" };
+
+			std::vector<MonitorLayout> layouts;
+			const uint32_t             count = random() % 5;
+			int32_t                    left  = -1920 * static_cast<int32_t>( random() % 2 );
+			for ( uint32_t i = 0; i < count; i++ )
+			{
+				const int32_t width  = random() % 2 == 0 ? 1920 : 2560;
+				const int32_t height = random() % 2 == 0 ? 1080 : 1440;
+				layouts.emplace_back( Monitor( DEVICES[random() % 6], left, 0, width, height ) );
+				left += width;
+			}
+
+			return layouts;
+		}
+	} // namespace
+} // namespace Theater
+
+using namespace Theater;
+
+THEATER_TEST( monitortopology, UnchangedTopologyKeepsEveryWindow )
+{
+	const std::vector<MonitorLayout> layouts = { LAPTOP, EXTERNAL, TV };
+
+	MonitorTopologyDiff diff;
+	DiffMonitorTopology( layouts, layouts, diff );
+	REQUIRE( diff.entries.size() == 3 );
+	for ( size_t i = 0; i < 3; i++ )
+	{
+		CHECK( diff.entries[i].action == MonitorAction::Keep );
+		CHECK( diff.entries[i].source == i );
+	}
+	CHECK( diff.retired.empty() );
+
+	// the order Windows enumerates them in doesn't matter
+	DiffMonitorTopology( layouts, { TV, LAPTOP, EXTERNAL }, diff );
+	CHECK( diff.entries[0].source == 2 );
+	CHECK( diff.entries[1].source == 0 );
+	CHECK( diff.entries[2].source == 1 );
+	CHECK( diff.entries[0].action == MonitorAction::Keep );
+}
+
+THEATER_TEST( monitortopology, DockingCreatesOnlyTheNewMonitor )
+{
+	Windows windows;
+	windows.Apply( { LAPTOP } );
+	CHECK( windows.created == 1 );
+
+	windows.Apply( { LAPTOP, EXTERNAL } );
+	CHECK( windows.created == 2 );
+	CHECK( windows.moved == 0 );
+	CHECK( windows.ids == std::vector<uint32_t>( { 1, 2 } ) );
+
+	// undocking retires it, the laptop's window stays where it is
+	windows.Apply( { LAPTOP } );
+	CHECK( windows.retired == 1 );
+	CHECK( windows.moved == 0 );
+	CHECK( windows.ids == std::vector<uint32_t>( { 1 } ) );
+}
+
+THEATER_TEST( monitortopology, DpiChangeMovesTheWindowOfTheSameDevice )
+{
+	MonitorLayout scaled = EXTERNAL;
+	scaled.right         = scaled.left + 2560;
+	scaled.bottom        = scaled.top + 1440;
+
+	MonitorTopologyDiff diff;
+	DiffMonitorTopology( { LAPTOP, EXTERNAL }, { LAPTOP, scaled }, diff );
+	CHECK( diff.entries[0].action == MonitorAction::Keep );
+	CHECK( diff.entries[1].action == MonitorAction::Move );
+	CHECK( diff.entries[1].source == 1 );
+	CHECK( diff.retired.empty() );
+
+	// the primary switched sides, both windows follow their device rather than their old place
+	const MonitorLayout left  = Monitor( L"\\\\.\\DISPLAY2", 0, 0, 1920, 1080 );
+	const MonitorLayout right = Monitor( L"\\\\.\\DISPLAY1", 1920, 0, 1920, 1080 );
+	DiffMonitorTopology( { Monitor( L"\\\\.\\DISPLAY1", 0, 0, 1920, 1080 ),
+	                       Monitor( L"\\\\.\\DISPLAY2", 1920, 0, 1920, 1080 ) },
+	                     { left, right }, diff );
+	CHECK( diff.entries[0].source == 1 );
+	CHECK( diff.entries[1].source == 0 );
+	CHECK( diff.entries[0].action == MonitorAction::Move );
+	CHECK( diff.entries[1].action == MonitorAction::Move );
+}
+
+THEATER_TEST( monitortopology, RenamedDeviceInTheSamePlaceIsKept )
+{
+	// a TV turned off and on again comes back under another name
+	MonitorLayout renamed = TV;
+	renamed.device        = L"\\\\.\\DISPLAY7";
+
+	MonitorTopologyDiff diff;
+	DiffMonitorTopology( { LAPTOP, TV }, { renamed, LAPTOP }, diff );
+	CHECK( diff.entries[0].action == MonitorAction::Keep );
+	CHECK( diff.entries[0].source == 1 );
+	CHECK( diff.entries[1].source == 0 );
+	CHECK( diff.retired.empty() );
+}
+
+THEATER_TEST( monitortopology, UnmatchedMonitorsReuseTheMostOverlappingWindow )
+{
+	// a driver update renamed the devices while the resolution changed
+	const MonitorLayout a = Monitor( L"\\\\.\\DISPLAY5", 0, 0, 2560, 1440 );
+	const MonitorLayout b = Monitor( L"\\\\.\\DISPLAY6", 2560, 0, 1920, 1080 );
+
+	MonitorTopologyDiff diff;
+	DiffMonitorTopology( { LAPTOP, EXTERNAL }, { b, a }, diff );
+	CHECK( diff.entries[0].source == 1 );
+	CHECK( diff.entries[1].source == 0 );
+	CHECK( diff.entries[0].action == MonitorAction::Move );
+	CHECK( diff.entries[1].action == MonitorAction::Move );
+
+	// with nothing overlapping they are still moved rather than recreated
+	const MonitorLayout distant = Monitor( L"\\\\.\\DISPLAY9", 10000, 0, 1920, 1080 );
+	DiffMonitorTopology( { LAPTOP }, { distant }, diff );
+	CHECK( diff.entries[0].action == MonitorAction::Move );
+	CHECK( diff.entries[0].source == 0 );
+	CHECK( diff.retired.empty() );
+}
+
+THEATER_TEST( monitortopology, ScriptedChangesTouchAsFewWindowsAsPossible )
+{
+	std::mt19937 random( 11 );
+	Windows      windows;
+	uint32_t     failures = 0;
+	for ( uint32_t i = 0; i < 20000; i++ )
+	{
+		const std::vector<MonitorLayout> former = windows.layouts;
+		const std::vector<MonitorLayout> next   = MakeTopology( random );
+		const uint32_t                   before = windows.created + windows.retired;
+
+		MonitorTopologyDiff diff;
+		DiffMonitorTopology( former, next, diff );
+		failures += IsConsistent( former, next, diff ) ? 0 : 1;
+
+		// windows are only created or retired for the difference in count
+		windows.Apply( next );
+		const size_t churn = next.size() > former.size() ? next.size() - former.size() : former.size() - next.size();
+		failures += windows.created + windows.retired - before == churn ? 0 : 1;
+
+		// and no window is shared between two monitors
+		std::vector<uint32_t> ids = windows.ids;
+		std::sort( ids.begin(), ids.end() );
+		failures += std::adjacent_find( ids.begin(), ids.end() ) == ids.end() ? 0 : 1;
+	}
+
+	CHECK( failures == 0 );
+}
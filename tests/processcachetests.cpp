@@ -0,0 +1,254 @@
+#include "theater.h"
+#include "testing.h"
+
+namespace Theater
+{
+	namespace
+	{
+		Platform::WindowId AddWindow( SimulatedDesktop& desktop, uint32_t pid )
+		{
+			SimulatedDesktop::WindowParams params = {};
+			params.pid                            = pid;
+			params.rect                           = PlatformRect{ 0, 0, 800, 600 };
+			return desktop.AddWindow( params );
+		}
+
+		ProcessCache::ProcessId MakeProcessId( uint32_t pid, uint64_t creationTime )
+		{
+			ProcessCache::ProcessId id = {};
+			id.pid                     = pid;
+			id.creationTime            = creationTime;
+			return id;
+		}
+	} // namespace
+} // namespace Theater
+
+using namespace Theater;
+
+THEATER_TEST( processcache, WindowKeepsItsDecisionUntilInvalidated )
+{
+	ProcessCache cache;
+	const auto   game = MakeProcessId( 1000, 5 );
+	cache.InsertProcess( game, L"C:\\Games\\game.exe", L"game" );
+	cache.InsertWindow( 0x10, game, true );
+
+	const auto window = cache.LookupWindow( 0x10, 1000 );
+	REQUIRE( window != nullptr );
+	CHECK( window->process == game );
+	CHECK( window->isTarget );
+	CHECK( cache.IsDecisionValid( *window ) );
+
+	// new settings, the process is still known but the decision has to be taken again
+	cache.InvalidateDecisions();
+	CHECK( !cache.IsDecisionValid( *cache.LookupWindow( 0x10, 1000 ) ) );
+	CHECK( cache.LookupProcess( game ) != nullptr );
+
+	cache.UpdateDecision( 0x10, false );
+	CHECK( cache.IsDecisionValid( *cache.LookupWindow( 0x10, 1000 ) ) );
+	CHECK( !cache.LookupWindow( 0x10, 1000 )->isTarget );
+}
+
+THEATER_TEST( processcache, RecycledWindowIdOfAnotherProcessMisses )
+{
+	ProcessCache cache;
+	const auto   game = MakeProcessId( 1000, 5 );
+	cache.InsertProcess( game, L"C:\\Games\\game.exe", L"game" );
+	cache.InsertWindow( 0x10, game, true );
+
+	CHECK( cache.LookupWindow( 0x10, 1004 ) == nullptr );
+	CHECK( cache.LookupWindow( 0x20, 1000 ) == nullptr );
+}
+
+THEATER_TEST( processcache, LastWindowTakesItsProcessAlong )
+{
+	ProcessCache cache;
+	const auto   game = MakeProcessId( 1000, 5 );
+	cache.InsertProcess( game, L"C:\\Games\\game.exe", L"game" );
+	cache.InsertWindow( 0x10, game, true );
+	cache.InsertWindow( 0x20, game, false );
+	CHECK( cache.LookupProcess( game )->windows.size() == 2 );
+
+	cache.RemoveWindow( 0x10 );
+	REQUIRE( cache.LookupProcess( game ) != nullptr );
+	CHECK( cache.LookupProcess( game )->windows == std::vector<ProcessCache::WindowId>{ 0x20 } );
+
+	cache.RemoveWindow( 0x20 );
+	CHECK( cache.LookupProcess( game ) == nullptr );
+	CHECK( cache.GetWindowCount() == 0 );
+	CHECK( cache.GetProcessCount() == 0 );
+}
+
+THEATER_TEST( processcache, RecycledPidEvictsTheExitedProcess )
+{
+	ProcessCache cache;
+	const auto   exited = MakeProcessId( 1000, 5 );
+	cache.InsertProcess( exited, L"C:\\Games\\game.exe", L"game" );
+	cache.InsertWindow( 0x10, exited, true );
+
+	// the window's destruction was never seen, the pid now belongs to another process
+	const auto recycled = MakeProcessId( 1000, 9 );
+	cache.InsertProcess( recycled, L"C:\\Apps\\editor.exe", L"editor" );
+	CHECK( cache.LookupProcess( exited ) == nullptr );
+	CHECK( cache.LookupWindow( 0x10, 1000 ) == nullptr );
+	REQUIRE( cache.LookupProcess( recycled ) != nullptr );
+	CHECK( cache.LookupProcess( recycled )->name == L"editor" );
+	CHECK( cache.GetProcessCount() == 1 );
+
+	// the same instance again keeps its windows
+	cache.InsertWindow( 0x20, recycled, false );
+	cache.InsertProcess( recycled, L"C:\\Apps\\editor.exe", L"editor" );
+	CHECK( cache.LookupWindow( 0x20, 1000 ) != nullptr );
+}
+
+THEATER_TEST( processcache, ResolverQueriesEachProcessOnce )
+{
+	SimulatedDesktop desktop;
+	const uint32_t   game   = desktop.StartProcess( L"C:\\Games\\game.exe" );
+	const uint32_t   other  = desktop.StartProcess( L"C:\\Apps\\editor.exe" );
+	const auto       first  = AddWindow( desktop, game );
+	const auto       second = AddWindow( desktop, game );
+	const auto       editor = AddWindow( desktop, other );
+
+	ProcessNameSet names;
+	names.Add( L"game" );
+	TargetResolver resolver;
+	resolver.SetPlatform( &desktop );
+	resolver.Configure( names, {} );
+
+	bool isTarget = false;
+	for ( int i = 0; i < 100; i++ )
+	{
+		CHECK( resolver.Resolve( first, isTarget ) && isTarget );
+		CHECK( resolver.Resolve( second, isTarget ) && isTarget );
+		CHECK( resolver.Resolve( editor, isTarget ) && !isTarget );
+	}
+	CHECK( desktop.GetProcessQueryCount() == 2 );
+
+	// new settings keep the processes
+	names.Add( L"editor" );
+	resolver.Configure( names, {} );
+	CHECK( resolver.Resolve( editor, isTarget ) && isTarget );
+	CHECK( desktop.GetProcessQueryCount() == 2 );
+}
+
+THEATER_TEST( processcache, ResolverForgetsWhatWentAway )
+{
+	SimulatedDesktop desktop;
+	const uint32_t   game   = desktop.StartProcess( L"C:\\Games\\game.exe" );
+	const auto       window = AddWindow( desktop, game );
+
+	ProcessNameSet names;
+	names.Add( L"game" );
+	TargetResolver resolver;
+	resolver.SetPlatform( &desktop );
+	resolver.Configure( names, {} );
+
+	bool isTarget = false;
+	CHECK( resolver.Resolve( window, isTarget ) && isTarget );
+	resolver.RemoveWindow( window );
+	CHECK( resolver.GetProcessCache().GetWindowCount() == 0 );
+	CHECK( resolver.GetProcessCache().GetProcessCount() == 0 );
+
+	// a process that's gone can't be resolved any more
+	desktop.EndProcess( game );
+	CHECK( !resolver.Resolve( window, isTarget ) );
+}
+
+// The simulated platform answers from memory, the real one opens the process and asks for its image name.
+// The uncached path measured here is a lower bound of what every foreground change used to cost.
+THEATER_BENCHMARK( processcache, Lookup )
+{
+	const uint32_t count = quick ? 1000 : 1000000;
+
+	SimulatedDesktop                desktop;
+	std::vector<Platform::WindowId> windows;
+	for ( uint32_t i = 0; i < 64; i++ )
+	{
+		const uint32_t pid = desktop.StartProcess( L"C:\\Apps\\app" + std::to_wstring( i ) + L".exe" );
+		windows.emplace_back( AddWindow( desktop, pid ) );
+		windows.emplace_back( AddWindow( desktop, pid ) );
+	}
+
+	ProcessNameSet names;
+	names.Add( L"app7" );
+	TargetResolver resolver;
+	resolver.SetPlatform( &desktop );
+	resolver.Configure( names, {} );
+
+	ProcessNameMatcher matcher;
+	matcher.Build( names.begin(), names.end() );
+
+	// what App::OnWinEvent did before the cache, query everything and match the name
+	{
+		uint64_t       targets = 0;
+		const uint64_t start   = GetTestTimeNanoseconds();
+		for ( uint32_t i = 0; i < count; i++ )
+		{
+			const auto              window = windows[i % windows.size()];
+			const uint32_t          pid    = desktop.GetWindowProcessId( window );
+			ProcessCache::ProcessId id     = {};
+			std::wstring            path;
+			std::wstring            name;
+			if ( desktop.QueryProcessId( pid, id ) && desktop.QueryProcessPath( pid, path, name ) )
+				targets += matcher.Contains( name ) ? 1 : 0;
+		}
+		const uint64_t elapsed = GetTestTimeNanoseconds() - start;
+
+		KeepValue( targets );
+		ReportBenchmark( "uncached", static_cast<double>( elapsed ) / count, "ns" );
+	}
+
+	// alt-tabbing between known windows
+	{
+		uint64_t targets  = 0;
+		bool     isTarget = false;
+		for ( const auto window : windows )
+			resolver.Resolve( window, isTarget );
+
+		const uint64_t start = GetTestTimeNanoseconds();
+		for ( uint32_t i = 0; i < count; i++ )
+		{
+			resolver.Resolve( windows[i % windows.size()], isTarget );
+			targets += isTarget ? 1 : 0;
+		}
+		const uint64_t elapsed = GetTestTimeNanoseconds() - start;
+
+		KeepValue( targets );
+		ReportBenchmark( "hit", static_cast<double>( elapsed ) / count, "ns" );
+	}
+
+	// a new window of a known process
+	{
+		uint64_t       targets  = 0;
+		bool           isTarget = false;
+		const uint64_t start    = GetTestTimeNanoseconds();
+		for ( uint32_t i = 0; i < count; i++ )
+		{
+			const auto window = windows[i % windows.size()];
+			resolver.RemoveWindow( window );
+			resolver.Resolve( window, isTarget );
+			targets += isTarget ? 1 : 0;
+		}
+		const uint64_t elapsed = GetTestTimeNanoseconds() - start;
+
+		KeepValue( targets );
+		ReportBenchmark( "window miss", static_cast<double>( elapsed ) / count, "ns" );
+	}
+
+	// nothing known, the process is queried on top of the uncached path
+	{
+		uint64_t       targets  = 0;
+		bool           isTarget = false;
+		const uint64_t start    = GetTestTimeNanoseconds();
+		for ( uint32_t i = 0; i < count; i++ )
+		{
+			resolver.Clear();
+			resolver.Resolve( windows[i % windows.size()], isTarget );
+			targets += isTarget ? 1 : 0;
+		}
+		const uint64_t elapsed = GetTestTimeNanoseconds() - start;
+
+		KeepValue( targets );
+		ReportBenchmark( "process miss", static_cast<double>( elapsed ) / count, "ns" );
+	}
+}
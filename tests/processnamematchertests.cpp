@@ -0,0 +1,240 @@
+#include "theater.h"
+#include "testing.h"
+#include <random>
+#include <set>
+
+namespace Theater
+{
+	namespace
+	{
+		// Around every edge of the ASCII fast path and the ranges the scalar folding knows about
+		const wchar_t FOLD_ALPHABET[] = { L'@',    L'A',    L'M',    L'Z',    L'[',    L'`',    L'a',    L'z',
+		                                  L'{',    L'.',    L'\\',   0x7F,    0x80,    0xB5,    0xC9,    0xD7,
+		                                  0xDE,    0xDF,    0xFF,    0x130,   0x141,   0x178,   0x17F,   0x3A3,
+		                                  0x3C2,   0x38E,   0x401,   0x416,   0x462,   0xFF21,  0xFF41,  0xFFFF };
+
+		std::wstring MakeString( std::mt19937& random, size_t length, bool asciiOnly )
+		{
+			std::wstring result;
+			for ( size_t i = 0; i < length; i++ )
+			{
+				const size_t count = asciiOnly ? 12 : sizeof( FOLD_ALPHABET ) / sizeof( FOLD_ALPHABET[0] );
+				result += FOLD_ALPHABET[random() % count];
+			}
+
+			return result;
+		}
+
+		std::wstring FoldScalar( std::wstring_view text )
+		{
+			std::wstring result;
+			for ( const wchar_t c : text )
+				result += ProcessNameMatcher::FoldChar( c );
+
+			return result;
+		}
+
+		std::wstring ChangeCase( std::mt19937& random, std::wstring_view text )
+		{
+			std::wstring result( text );
+			for ( auto& c : result )
+			{
+				if ( random() % 2 == 0 && c >= L'a' && c <= L'z' )
+					c = static_cast<wchar_t>( c - 0x20 );
+			}
+
+			return result;
+		}
+
+		std::wstring ToUpperCase( std::wstring text )
+		{
+			for ( auto& c : text )
+			{
+				if ( c >= L'a' && c <= L'z' )
+					c = static_cast<wchar_t>( c - 0x20 );
+			}
+
+			return text;
+		}
+
+		std::wstring MakeName( uint32_t i )
+		{
+			return L"GameLauncher" + std::to_wstring( i ) + L".exe";
+		}
+	} // namespace
+} // namespace Theater
+
+using namespace Theater;
+
+THEATER_TEST( processnamematcher, SimdFoldAgreesWithTheScalarFold )
+{
+	std::mt19937 random( 2 );
+	for ( uint32_t i = 0; i < 50000; i++ )
+	{
+		// ASCII runs longer than a vector, with the odd non ASCII block or unaligned start
+		const size_t       length = random() % 70;
+		const std::wstring text   = MakeString( random, length, random() % 4 != 0 );
+		const size_t       offset = random() % 4;
+
+		std::vector<wchar_t> folded( offset + length + 1, L'#' );
+		ProcessNameMatcher::Fold( text.data(), folded.data() + offset, length );
+
+		CHECK( std::wstring_view( folded.data() + offset, length ) == FoldScalar( text ) );
+		CHECK( folded[offset + length] == L'#' );
+	}
+}
+
+THEATER_TEST( processnamematcher, FoldingIsStable )
+{
+	const uint32_t last = sizeof( wchar_t ) == 2 ? 0xFFFF : 0x10FFFF;
+	for ( uint32_t c = 0; c <= last; c++ )
+	{
+		const wchar_t folded = ProcessNameMatcher::FoldChar( static_cast<wchar_t>( c ) );
+		CHECK( ProcessNameMatcher::FoldChar( folded ) == folded );
+	}
+
+	CHECK( ProcessNameMatcher::FoldChar( L'Q' ) == L'q' );
+	CHECK( ProcessNameMatcher::FoldChar( 0xC9 ) == 0xE9 );
+	CHECK( ProcessNameMatcher::FoldChar( 0xD7 ) == 0xD7 );
+	CHECK( ProcessNameMatcher::FoldChar( 0x178 ) == 0xFF );
+	CHECK( ProcessNameMatcher::FoldChar( 0x3A3 ) == ProcessNameMatcher::FoldChar( 0x3C2 ) );
+	CHECK( ProcessNameMatcher::FoldChar( 0x401 ) == 0x451 );
+	CHECK( ProcessNameMatcher::FoldChar( 0xFF21 ) == 0xFF41 );
+}
+
+THEATER_TEST( processnamematcher, FoldsEveryScript )
+{
+	// Latin Extended-B, IPA pairs, Armenian, Georgian, Cherokee folding to its capitals, Glagolitic
+	CHECK( ProcessNameMatcher::FoldChar( 0x1F1 ) == 0x1F3 );
+	CHECK( ProcessNameMatcher::FoldChar( 0x1F2 ) == 0x1F3 );
+	CHECK( ProcessNameMatcher::FoldChar( 0x181 ) == 0x253 );
+	CHECK( ProcessNameMatcher::FoldChar( 0x531 ) == 0x561 );
+	CHECK( ProcessNameMatcher::FoldChar( 0x10A0 ) == 0x2D00 );
+	CHECK( ProcessNameMatcher::FoldChar( 0x1C90 ) == 0x10D0 );
+	CHECK( ProcessNameMatcher::FoldChar( 0xAB70 ) == 0x13A0 );
+	CHECK( ProcessNameMatcher::FoldChar( 0x13F8 ) == 0x13F0 );
+	CHECK( ProcessNameMatcher::FoldChar( 0x2C00 ) == 0x2C30 );
+
+	// the S entries, and full foldings to several characters left alone
+	CHECK( ProcessNameMatcher::FoldChar( 0x1E9E ) == 0xDF );
+	CHECK( ProcessNameMatcher::FoldChar( 0x1F88 ) == 0x1F80 );
+	CHECK( ProcessNameMatcher::FoldChar( 0xDF ) == 0xDF );
+	CHECK( ProcessNameMatcher::FoldChar( 0x130 ) == 0x130 );
+	CHECK( ProcessNameMatcher::FoldChar( 0xFB00 ) == 0xFB00 );
+
+	// compatibility letters
+	CHECK( ProcessNameMatcher::FoldChar( 0x212A ) == L'k' );
+	CHECK( ProcessNameMatcher::FoldChar( 0x2126 ) == 0x3C9 );
+
+	if constexpr ( sizeof( wchar_t ) == 4 )
+	{
+		// Deseret and Adlam
+		CHECK( ProcessNameMatcher::FoldChar( static_cast<wchar_t>( 0x10400 ) ) == static_cast<wchar_t>( 0x10428 ) );
+		CHECK( ProcessNameMatcher::FoldChar( static_cast<wchar_t>( 0x1E900 ) ) == static_cast<wchar_t>( 0x1E922 ) );
+	}
+
+	// a Georgian game under its capital letters
+	const std::wstring names[] = { L"\u10D7\u10D0\u10DB\u10D0\u10E8\u10D8.exe" };
+	ProcessNameMatcher matcher;
+	matcher.Build( std::begin( names ), std::end( names ) );
+	CHECK( matcher.Contains( L"\u1C97\u1C90\u1C9B\u1C90\u1CA8\u1C98.EXE" ) );
+}
+
+THEATER_TEST( processnamematcher, MatchesInAnyCase )
+{
+	const std::wstring tooLong( ProcessNameMatcher::MAX_NAME_LENGTH + 1, L'a' );
+	const std::wstring names[] = { L"Game.exe", L"GAME.EXE", L"\u00c9diteur.exe", L"", tooLong };
+
+	ProcessNameMatcher matcher;
+	CHECK( !matcher.Contains( L"game.exe" ) );
+
+	matcher.Build( std::begin( names ), std::end( names ) );
+	CHECK( matcher.GetCount() == 2 );
+	CHECK( matcher.Contains( L"gAmE.eXe" ) );
+	CHECK( matcher.Contains( L"\u00e9DITEUR.EXE" ) );
+	CHECK( !matcher.Contains( L"game.ex" ) );
+	CHECK( !matcher.Contains( L"" ) );
+	CHECK( !matcher.Contains( tooLong ) );
+
+	// a view into a larger buffer, the way a path's file name is looked up
+	const std::wstring path = L"C:\\Games\\GAME.exe\\";
+	CHECK( matcher.Contains( std::wstring_view( path ).substr( 9, 8 ) ) );
+
+	matcher.Clear();
+	CHECK( matcher.GetCount() == 0 );
+	CHECK( !matcher.Contains( L"game.exe" ) );
+}
+
+THEATER_TEST( processnamematcher, AgreesWithAFoldedSet )
+{
+	std::mt19937 random( 22 );
+	for ( uint32_t round = 0; round < 20; round++ )
+	{
+		std::vector<std::wstring> names;
+		std::set<std::wstring>    reference;
+		for ( uint32_t i = 0; i < 1 + random() % 3000; i++ )
+		{
+			names.emplace_back( MakeString( random, 1 + random() % 24, random() % 2 == 0 ) );
+			reference.emplace( FoldScalar( names.back() ) );
+		}
+
+		ProcessNameMatcher matcher;
+		matcher.Build( names.begin(), names.end() );
+		CHECK( matcher.GetCount() == reference.size() );
+
+		uint32_t mismatches = 0;
+		for ( uint32_t i = 0; i < 2000; i++ )
+		{
+			const std::wstring name = i % 2 == 0 ? ChangeCase( random, names[random() % names.size()] )
+			                                     : MakeString( random, 1 + random() % 24, random() % 2 == 0 );
+			mismatches += matcher.Contains( name ) != ( reference.count( FoldScalar( name ) ) == 1 ) ? 1 : 0;
+		}
+		CHECK( mismatches == 0 );
+	}
+}
+
+// The lookup every foreground change and every new window costs, with the executable name in another case
+THEATER_BENCHMARK( processnamematcher, Lookup )
+{
+	const uint32_t counts[]    = { 10, 1000, 100000 };
+	const uint32_t lookupCount = quick ? 10000 : 1000000;
+
+	for ( const auto count : counts )
+	{
+		std::vector<std::wstring> names;
+		for ( uint32_t i = 0; i < count; i++ )
+			names.emplace_back( MakeName( i ) );
+
+		ProcessNameMatcher matcher;
+		const uint64_t     buildStart = GetTestTimeNanoseconds();
+		matcher.Build( names.begin(), names.end() );
+		const uint64_t buildTime = GetTestTimeNanoseconds() - buildStart;
+
+		std::vector<std::wstring> hits;
+		std::vector<std::wstring> misses;
+		for ( uint32_t i = 0; i < 1024; i++ )
+		{
+			hits.emplace_back( ToUpperCase( MakeName( ( i * 7919 ) % count ) ) );
+
+			// as long as the names, not turned away by the length alone
+			misses.emplace_back( hits.back() );
+			misses.back().back() = L'X';
+		}
+
+		uint64_t       found = 0;
+		const uint64_t start = GetTestTimeNanoseconds();
+		for ( uint32_t i = 0; i < lookupCount; i++ )
+			found += matcher.Contains( hits[i % 1024] ) ? 1 : 0;
+		const uint64_t hitTime = GetTestTimeNanoseconds() - start;
+
+		for ( uint32_t i = 0; i < lookupCount; i++ )
+			found += matcher.Contains( misses[i % 1024] ) ? 1 : 0;
+		const uint64_t missTime = GetTestTimeNanoseconds() - start - hitTime;
+
+		KeepValue( found );
+		const std::string label = std::to_string( count ) + " names";
+		ReportBenchmark( ( label + " build" ).c_str(), buildTime / 1e3, "us" );
+		ReportBenchmark( ( label + " hit" ).c_str(), static_cast<double>( hitTime ) / lookupCount, "ns" );
+		ReportBenchmark( ( label + " miss" ).c_str(), static_cast<double>( missTime ) / lookupCount, "ns" );
+	}
+}
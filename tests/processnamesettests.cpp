@@ -0,0 +1,204 @@
+#include "theater.h"
+#include "testing.h"
+#include <map>
+#include <random>
+
+namespace Theater
+{
+	namespace
+	{
+		std::wstring FoldName( std::wstring_view name )
+		{
+			std::wstring folded( name );
+			ProcessNameMatcher::Fold( name.data(), folded.data(), name.size() );
+			return folded;
+		}
+
+		// Few distinct names in mixed case, so adds and removes keep running into each other
+		std::wstring MakeName( std::mt19937& random )
+		{
+			const wchar_t* const bases[] = { L"game", L"GAME", L"Editor", L"\u00c9diteur", L"player" };
+			std::wstring         name    = bases[random() % 5] + std::to_wstring( random() % 300 );
+			return name + ( random() % 2 == 0 ? L".exe" : L".EXE" );
+		}
+
+		// About the length of a real executable name
+		std::wstring MakeBenchmarkName( uint32_t i )
+		{
+			return L"GameLauncher" + std::to_wstring( i ) + L".exe";
+		}
+	} // namespace
+} // namespace Theater
+
+using namespace Theater;
+
+THEATER_TEST( processnameset, DuplicatesInAnyCaseAreRejected )
+{
+	ProcessNameSet set;
+	CHECK( set.Add( L"Game.exe" ) );
+	CHECK( !set.Add( L"GAME.EXE" ) );
+	CHECK( !set.Add( L"game.exe" ) );
+	CHECK( set.Add( L"\u00c9diteur.exe" ) );
+	CHECK( !set.Add( L"\u00e9diteur.exe" ) );
+
+	CHECK( !set.Add( L"" ) );
+	CHECK( !set.Add( std::wstring( ProcessNameMatcher::MAX_NAME_LENGTH + 1, L'a' ) ) );
+	CHECK( set.Add( std::wstring( ProcessNameMatcher::MAX_NAME_LENGTH, L'a' ) ) );
+
+	// the set keeps the case the name was added with
+	REQUIRE( set.GetCount() == 3 );
+	CHECK( set.Get( 0 ) == L"Game.exe" );
+	CHECK( set.Contains( L"gAmE.ExE" ) );
+	CHECK( !set.Contains( L"Game" ) );
+
+	CHECK( !set.Remove( L"other.exe" ) );
+	CHECK( set.Remove( L"GAME.exe" ) );
+	CHECK( !set.Contains( L"Game.exe" ) );
+	CHECK( set.GetCount() == 2 );
+}
+
+THEATER_TEST( processnameset, HoldsMoreThanAFewHundredNames )
+{
+	ProcessNameSet set;
+	for ( uint32_t i = 0; i < 5000; i++ )
+		CHECK( set.Add( MakeBenchmarkName( i ) ) );
+	REQUIRE( set.GetCount() == 5000 );
+
+	// every other name goes, enough to compact the arena
+	for ( uint32_t i = 0; i < 5000; i += 2 )
+		CHECK( set.Remove( MakeBenchmarkName( i ) ) );
+
+	size_t count = 0;
+	for ( const auto name : set )
+	{
+		CHECK( set.Contains( name ) );
+		count++;
+	}
+	CHECK( count == 2500 );
+
+	for ( uint32_t i = 0; i < 5000; i++ )
+		CHECK( set.Contains( MakeBenchmarkName( i ) ) == ( i % 2 == 1 ) );
+}
+
+THEATER_TEST( processnameset, AgreesWithAFoldedMap )
+{
+	// folded name to the name as added
+	std::map<std::wstring, std::wstring> reference;
+	ProcessNameSet                       set;
+
+	std::mt19937 random( 17 );
+	uint32_t     mismatches = 0;
+	for ( uint32_t i = 0; i < 200000; i++ )
+	{
+		const std::wstring name   = MakeName( random );
+		const std::wstring folded = FoldName( name );
+		switch ( random() % 4 )
+		{
+		case 0:
+		case 1:
+			mismatches += set.Add( name ) != reference.emplace( folded, name ).second ? 1 : 0;
+			break;
+		case 2:
+			mismatches += set.Remove( name ) != ( reference.erase( folded ) == 1 ) ? 1 : 0;
+			break;
+		case 3:
+			mismatches += set.Contains( name ) != ( reference.count( folded ) == 1 ) ? 1 : 0;
+			break;
+		}
+
+		if ( random() % 50000 == 0 )
+		{
+			set.Clear();
+			reference.clear();
+		}
+	}
+
+	CHECK( mismatches == 0 );
+	REQUIRE( set.GetCount() == reference.size() );
+	for ( const auto name : set )
+	{
+		const auto iter = reference.find( FoldName( name ) );
+		REQUIRE( iter != reference.end() );
+		CHECK( iter->second == name );
+	}
+}
+
+THEATER_TEST( processnameset, EqualityKeepsCaseAndOrder )
+{
+	ProcessNameSet a;
+	ProcessNameSet b;
+	a.Add( L"one.exe" );
+	a.Add( L"two.exe" );
+	b.Add( L"one.exe" );
+	b.Add( L"two.exe" );
+	CHECK( a == b );
+
+	b.Remove( L"one.exe" );
+	b.Add( L"one.exe" );
+	CHECK( a != b );
+
+	ProcessNameSet c;
+	c.Add( L"ONE.exe" );
+	c.Add( L"two.exe" );
+	CHECK( a != c );
+}
+
+// A hundred thousand names in the settings, what each costs to hold and to look up
+THEATER_BENCHMARK( processnameset, HundredThousandNames )
+{
+	const uint32_t count = quick ? 10000 : 100000;
+	const uint32_t runs  = quick ? 1 : 10;
+
+	std::vector<std::wstring> names;
+	std::vector<std::wstring> missing;
+	std::vector<std::wstring> folded;
+	size_t                    characters = 0;
+	for ( uint32_t i = 0; i < count; i++ )
+	{
+		names.emplace_back( MakeBenchmarkName( i ) );
+		missing.emplace_back( MakeBenchmarkName( count + i ) );
+		folded.emplace_back( FoldName( names.back() ) );
+		characters += names.back().size();
+	}
+	ReportBenchmark( "name length", static_cast<double>( characters ) / count, "chars" );
+
+	uint64_t addTime    = 0;
+	uint64_t hitTime    = 0;
+	uint64_t missTime   = 0;
+	uint64_t removeTime = 0;
+	uint64_t found      = 0;
+	size_t   memory     = 0;
+	for ( uint32_t run = 0; run < runs; run++ )
+	{
+		ProcessNameSet set;
+		uint64_t       start = GetTestTimeNanoseconds();
+		for ( const auto& name : names )
+			set.Add( name );
+		addTime += GetTestTimeNanoseconds() - start;
+		memory = set.GetMemoryUsage();
+
+		// looked up in another case than added
+		start = GetTestTimeNanoseconds();
+		for ( const auto& name : folded )
+			found += set.Contains( name ) ? 1 : 0;
+		hitTime += GetTestTimeNanoseconds() - start;
+
+		start = GetTestTimeNanoseconds();
+		for ( const auto& name : missing )
+			found += set.Contains( name ) ? 1 : 0;
+		missTime += GetTestTimeNanoseconds() - start;
+
+		start = GetTestTimeNanoseconds();
+		for ( const auto& name : names )
+			set.Remove( name );
+		removeTime += GetTestTimeNanoseconds() - start;
+	}
+
+	const double operations = static_cast<double>( count ) * runs;
+	KeepValue( found );
+	ReportBenchmark( "memory", static_cast<double>( memory ) / count, "B/entry" );
+	ReportBenchmark( "add", addTime / operations, "ns" );
+	ReportBenchmark( "contains hit", hitTime / operations, "ns" );
+	ReportBenchmark( "contains miss", missTime / operations, "ns" );
+	ReportBenchmark( "remove", removeTime / operations, "ns" );
+}
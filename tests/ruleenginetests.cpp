@@ -0,0 +1,396 @@
+#include "theater.h"
+#include "testing.h"
+#include <cstdio>
+#include <random>
+
+namespace Theater
+{
+	namespace
+	{
+		bool IsSeparator( wchar_t c )
+		{
+			return c == L'\\' || c == L'/';
+		}
+
+		bool IsSameChar( wchar_t patternChar, wchar_t c, bool separatorAware )
+		{
+			if ( separatorAware && IsSeparator( patternChar ) )
+				return IsSeparator( c );
+
+			if ( separatorAware && IsSeparator( c ) )
+				return false;
+
+			return ProcessNameMatcher::FoldChar( patternChar ) == ProcessNameMatcher::FoldChar( c );
+		}
+
+		// Backtracking glob matcher written from the syntax rules alone, the automaton has to agree with it
+		bool MatchGlob( std::wstring_view pattern, std::wstring_view input, bool separatorAware )
+		{
+			if ( pattern.empty() )
+				return input.empty();
+
+			if ( pattern.size() >= 2 && pattern[0] == L'*' && pattern[1] == L'*' )
+			{
+				const auto rest = pattern.substr( 2 );
+				if ( separatorAware && !rest.empty() && IsSeparator( rest[0] ) &&
+				     MatchGlob( rest.substr( 1 ), input, separatorAware ) )
+					return true;
+
+				for ( size_t i = 0; i <= input.size(); i++ )
+				{
+					if ( MatchGlob( rest, input.substr( i ), separatorAware ) )
+						return true;
+				}
+
+				return false;
+			}
+
+			if ( pattern[0] == L'*' )
+			{
+				for ( size_t i = 0; i <= input.size(); i++ )
+				{
+					if ( MatchGlob( pattern.substr( 1 ), input.substr( i ), separatorAware ) )
+						return true;
+					if ( i < input.size() && separatorAware && IsSeparator( input[i] ) )
+						return false;
+				}
+
+				return false;
+			}
+
+			if ( input.empty() )
+				return false;
+
+			const bool same = pattern[0] == L'?' ? !( separatorAware && IsSeparator( input[0] ) )
+			                                     : IsSameChar( pattern[0], input[0], separatorAware );
+			return same && MatchGlob( pattern.substr( 1 ), input.substr( 1 ), separatorAware );
+		}
+
+		bool MatchLiteral( std::wstring_view pattern, std::wstring_view input, bool separatorAware )
+		{
+			if ( pattern.size() != input.size() )
+				return false;
+
+			for ( size_t i = 0; i < pattern.size(); i++ )
+			{
+				if ( !IsSameChar( pattern[i], input[i], separatorAware ) )
+					return false;
+			}
+
+			return true;
+		}
+
+		bool MatchReference( const Rule& rule, std::wstring_view input, bool separatorAware )
+		{
+			if ( rule.pattern.empty() )
+				return false;
+
+			switch ( rule.op )
+			{
+			case RuleOperator::Equals:
+				return MatchLiteral( rule.pattern, input, separatorAware );
+			case RuleOperator::Contains:
+				for ( size_t i = 0; i + rule.pattern.size() <= input.size(); i++ )
+				{
+					if ( MatchLiteral( rule.pattern, input.substr( i, rule.pattern.size() ), separatorAware ) )
+						return true;
+				}
+				return false;
+			case RuleOperator::Glob:
+				return MatchGlob( rule.pattern, input, separatorAware );
+			}
+
+			return false;
+		}
+
+		// ASCII with everything else escaped, whatever the C locale is
+		std::string Describe( std::wstring_view text )
+		{
+			std::string result;
+			for ( const wchar_t c : text )
+			{
+				char escaped[16] = {};
+				if ( c >= 0x20 && c < 0x7F )
+					escaped[0] = static_cast<char>( c );
+				else
+					snprintf( escaped, sizeof( escaped ), "\\u%04X", static_cast<uint32_t>( c ) );
+				result += escaped;
+			}
+
+			return result;
+		}
+
+		// Small alphabets so that random patterns and inputs actually meet, case and separators included
+		std::wstring MakeString( std::mt19937& random, const wchar_t* alphabet, size_t maxLength )
+		{
+			const size_t alphabetSize = wcslen( alphabet );
+			const size_t length       = random() % ( maxLength + 1 );
+
+			std::wstring result;
+			for ( size_t i = 0; i < length; i++ )
+				result += alphabet[random() % alphabetSize];
+
+			return result;
+		}
+	} // namespace
+} // namespace Theater
+
+using namespace Theater;
+
+THEATER_TEST( ruleengine, FieldAndOperatorNamesRoundTrip )
+{
+	for ( size_t i = 0; i < static_cast<size_t>( RuleField::Count ); i++ )
+	{
+		RuleField field = RuleField::Count;
+		CHECK( ParseRuleField( GetRuleFieldName( static_cast<RuleField>( i ) ), field ) );
+		CHECK( field == static_cast<RuleField>( i ) );
+	}
+
+	for ( const auto op : { RuleOperator::Equals, RuleOperator::Contains, RuleOperator::Glob } )
+	{
+		RuleOperator parsed = RuleOperator::Equals;
+		CHECK( ParseRuleOperator( GetRuleOperatorName( op ), parsed ) );
+		CHECK( parsed == op );
+	}
+
+	RuleField    field = RuleField::Name;
+	RuleOperator op    = RuleOperator::Equals;
+	CHECK( !ParseRuleField( L"Path", field ) );
+	CHECK( !ParseRuleField( L"", field ) );
+	CHECK( !ParseRuleOperator( L"matches", op ) );
+}
+
+THEATER_TEST( ruleengine, RulesOnlyLookAtTheirField )
+{
+	RuleEngine engine;
+	CHECK( engine.IsEmpty() );
+	CHECK( !engine.Match( { L"game.exe", L"C:\\Games\\game.exe", L"UnrealWindow", L"Fullscreen" } ) );
+
+	engine.Compile( { Rule{ RuleField::Class, RuleOperator::Equals, L"UnrealWindow" } } );
+	CHECK( !engine.IsEmpty() );
+	CHECK( engine.UsesField( RuleField::Class ) );
+	CHECK( !engine.UsesField( RuleField::Title ) );
+	CHECK( engine.Match( { L"", L"", L"UnrealWindow", L"" } ) );
+	CHECK( engine.Match( { L"", L"", L"UNREALWINDOW", L"" } ) );
+	CHECK( !engine.Match( { L"UnrealWindow", L"UnrealWindow", L"", L"UnrealWindow" } ) );
+	CHECK( !engine.Match( { L"", L"", L"UnrealWindow2", L"" } ) );
+
+	engine.Compile( { Rule{ RuleField::Title, RuleOperator::Contains, L"Fullscreen" } } );
+	CHECK( engine.Match( { L"", L"", L"", L"Game - FULLSCREEN" } ) );
+	CHECK( engine.Match( { L"", L"", L"", L"Fullscreen" } ) );
+	CHECK( !engine.Match( { L"", L"", L"", L"Full screen" } ) );
+	CHECK( !engine.Match( { L"", L"", L"Fullscreen", L"" } ) );
+
+	// compiling again drops the former rules
+	CHECK( !engine.UsesField( RuleField::Class ) );
+	engine.Clear();
+	CHECK( engine.IsEmpty() );
+}
+
+THEATER_TEST( ruleengine, OnlyPathGlobsStopAtSeparators )
+{
+	RuleEngine engine;
+	engine.Compile( { Rule{ RuleField::Path, RuleOperator::Glob, L"C:\\Games\\**\\*.exe" },
+	                  Rule{ RuleField::Path, RuleOperator::Glob, L"D:\\Tools\\*.exe" },
+	                  Rule{ RuleField::Title, RuleOperator::Glob, L"Chapter ?*" } } );
+
+	CHECK( engine.Match( { L"", L"C:\\Games\\game.exe", L"", L"" } ) );
+	CHECK( engine.Match( { L"", L"c:/games/Studio/Title/Game.EXE", L"", L"" } ) );
+	CHECK( !engine.Match( { L"", L"C:\\Games.exe", L"", L"" } ) );
+	CHECK( !engine.Match( { L"", L"C:\\Games\\game.exe\\", L"", L"" } ) );
+	CHECK( !engine.Match( { L"", L"E:\\Games\\game.exe", L"", L"" } ) );
+
+	CHECK( engine.Match( { L"", L"D:\\Tools\\tool.exe", L"", L"" } ) );
+	CHECK( !engine.Match( { L"", L"D:\\Tools\\bin\\tool.exe", L"", L"" } ) );
+
+	// a title is no path, '*' and '?' go over slashes
+	CHECK( engine.Match( { L"", L"", L"", L"Chapter 1/Act 2" } ) );
+	CHECK( engine.Match( { L"", L"", L"", L"chapter \\" } ) );
+	CHECK( !engine.Match( { L"", L"", L"", L"Chapter " } ) );
+}
+
+THEATER_TEST( ruleengine, EmptyPatternsNeverMatch )
+{
+	RuleEngine engine;
+	engine.Compile( { Rule{ RuleField::Name, RuleOperator::Equals, L"" },
+	                  Rule{ RuleField::Title, RuleOperator::Contains, L"" },
+	                  Rule{ RuleField::Path, RuleOperator::Glob, L"" } } );
+
+	CHECK( !engine.Match( { L"", L"", L"", L"" } ) );
+	CHECK( !engine.Match( { L"game.exe", L"C:\\game.exe", L"Window", L"Title" } ) );
+}
+
+THEATER_TEST( ruleengine, GlobAgreesWithTheReferenceMatcher )
+{
+	constexpr uint32_t AUTOMATA             = 3000;
+	constexpr uint32_t INPUTS_PER_AUTOMATON = 64;
+
+	std::mt19937 random( 20261018 );
+	uint32_t     matches    = 0;
+	uint32_t     mismatches = 0;
+	for ( uint32_t i = 0; i < AUTOMATA && mismatches < 10; i++ )
+	{
+		const bool separatorAware = i % 2 == 0;
+
+		GlobAutomaton     automaton;
+		std::vector<Rule> rules( 1 + random() % 4 );
+		automaton.SetSeparatorAware( separatorAware );
+		for ( auto& rule : rules )
+		{
+			rule.field   = RuleField::Path;
+			rule.op      = static_cast<RuleOperator>( random() % 3 );
+			rule.pattern = MakeString( random, L"aAb\\/?**\u00e9", 7 );
+			automaton.Add( rule.op, rule.pattern );
+		}
+
+		for ( uint32_t j = 0; j < INPUTS_PER_AUTOMATON; j++ )
+		{
+			const std::wstring input = MakeString( random, L"aAbB\\/.\u00e9\u00c9", 10 );
+
+			bool expected = false;
+			for ( const auto& rule : rules )
+				expected |= MatchReference( rule, input, separatorAware );
+
+			if ( automaton.Match( input ) != expected )
+			{
+				mismatches++;
+				std::wstring patterns;
+				for ( const auto& rule : rules )
+					patterns += L" " + std::wstring( GetRuleOperatorName( rule.op ) ) + L" '" + rule.pattern + L"'";
+				printf( "    mismatch on '%s' with%s%s\n", Describe( input ).c_str(), Describe( patterns ).c_str(),
+				        separatorAware ? " (separator aware)" : "" );
+			}
+
+			matches += expected ? 1 : 0;
+		}
+	}
+
+	CHECK( mismatches == 0 );
+
+	// the alphabets are meant to make both outcomes common
+	CHECK( matches > AUTOMATA * INPUTS_PER_AUTOMATON / 20 );
+}
+
+THEATER_TEST( ruleengine, GlobAgreesAfterTheStateCacheFills )
+{
+	// enough distinct paths to go over the state limit a few times over
+	GlobAutomaton automaton;
+	automaton.SetSeparatorAware( true );
+
+	std::vector<std::wstring> patterns;
+	for ( uint32_t i = 0; i < 200; i++ )
+	{
+		patterns.emplace_back( L"c:\\games\\**\\game" + std::to_wstring( i ) + L"*.exe" );
+		automaton.Add( RuleOperator::Glob, patterns.back() );
+	}
+
+	std::mt19937 random( 7 );
+	uint32_t     mismatches = 0;
+	for ( uint32_t i = 0; i < 20000; i++ )
+	{
+		const std::wstring input = L"C:\\Games\\" + MakeString( random, L"ab\\", 3 ) + L"\\game" +
+		                           std::to_wstring( random() % 400 ) + MakeString( random, L"x_", 2 ) + L".exe";
+
+		bool expected = false;
+		for ( const auto& pattern : patterns )
+			expected |= MatchGlob( pattern, input, true );
+
+		mismatches += automaton.Match( input ) != expected ? 1 : 0;
+	}
+
+	CHECK( mismatches == 0 );
+}
+
+// Ten thousand rules of every kind, the way a large settings.json would have them
+THEATER_BENCHMARK( ruleengine, TenThousandRules )
+{
+	const uint32_t ruleCount  = quick ? 1000 : 10000;
+	const uint32_t matchCount = quick ? 1000 : 1000000;
+
+	std::vector<Rule> rules;
+	for ( uint32_t i = 0; i < ruleCount; i++ )
+	{
+		const std::wstring id = std::to_wstring( i );
+		switch ( i % 4 )
+		{
+		case 0:
+			rules.emplace_back(
+			    Rule{ RuleField::Path, RuleOperator::Glob, L"D:\\Games\\**\\Title" + id + L"\\*.exe" } );
+			break;
+		case 1:
+			rules.emplace_back( Rule{ RuleField::Name, RuleOperator::Equals, L"game" + id } );
+			break;
+		case 2:
+			rules.emplace_back( Rule{ RuleField::Class, RuleOperator::Equals, L"Engine" + id + L"Window" } );
+			break;
+		case 3:
+			rules.emplace_back( Rule{ RuleField::Title, RuleOperator::Contains, L"Fullscreen " + id } );
+			break;
+		}
+	}
+
+	RuleEngine     engine;
+	const uint64_t compileStart = GetTestTimeNanoseconds();
+	engine.Compile( rules );
+	ReportBenchmark( "compile", ( GetTestTimeNanoseconds() - compileStart ) / 1e6, "ms" );
+
+	const std::wstring paths[] = { L"D:\\Games\\Studio\\Title42\\Binaries\\Title42.exe",
+	                               L"D:\\Games\\Studio\\Title42\\Title42.exe",
+	                               L"C:\\Program Files\\Editor\\editor.exe" };
+	const std::wstring titles[] = { L"Fullscreen 977 - Title", L"Document - Editor", L"Untitled" };
+
+	// the first matches build the states they go through
+	const uint64_t firstStart = GetTestTimeNanoseconds();
+	uint64_t       targets    = 0;
+	for ( uint32_t i = 0; i < 3; i++ )
+		targets += engine.Match( { L"editor", paths[i], L"EditorWindow", titles[i] } ) ? 1 : 0;
+	ReportBenchmark( "first match", ( GetTestTimeNanoseconds() - firstStart ) / 3e3, "us" );
+
+	const uint64_t start = GetTestTimeNanoseconds();
+	for ( uint32_t i = 0; i < matchCount; i++ )
+		targets += engine.Match( { L"editor", paths[i % 3], L"EditorWindow", titles[i % 3] } ) ? 1 : 0;
+	const uint64_t elapsed = GetTestTimeNanoseconds() - start;
+
+	KeepValue( targets );
+	ReportBenchmark( "match", static_cast<double>( elapsed ) / matchCount, "ns" );
+}
+
+// The same events against more and more rules, once the automata are warm the cost only follows the input
+THEATER_BENCHMARK( ruleengine, RuleCount )
+{
+	const uint32_t counts[]   = { 10, 100, 1000, 10000 };
+	const uint32_t matchCount = quick ? 1000 : 200000;
+
+	const RuleEngine::Input inputs[] = {
+		{ L"editor.exe", L"C:\\Program Files\\Editor\\editor.exe", L"EditorWindow", L"Document - Editor" },
+		{ L"title7.exe", L"D:\\Games\\Studio\\Title7\\Binaries\\Title7.exe", L"Engine7Window", L"Title 7" },
+	};
+
+	for ( const auto count : counts )
+	{
+		std::vector<Rule> rules;
+		for ( uint32_t i = 0; i < count; i++ )
+		{
+			const std::wstring id = std::to_wstring( i );
+			rules.emplace_back( Rule{ RuleField::Path, RuleOperator::Glob, L"D:\\Games\\**\\Title" + id + L".exe" } );
+			rules.emplace_back( Rule{ RuleField::Class, RuleOperator::Equals, L"Engine" + id + L"Window" } );
+			rules.emplace_back( Rule{ RuleField::Title, RuleOperator::Contains, L"Fullscreen " + id } );
+		}
+
+		RuleEngine engine;
+		engine.Compile( rules );
+
+		uint64_t targets = 0;
+		for ( const auto& input : inputs )
+			targets += engine.Match( input ) ? 1 : 0;
+
+		const uint64_t start = GetTestTimeNanoseconds();
+		for ( uint32_t i = 0; i < matchCount; i++ )
+			targets += engine.Match( inputs[i % 2] ) ? 1 : 0;
+		const uint64_t elapsed = GetTestTimeNanoseconds() - start;
+
+		KeepValue( targets );
+		const std::string metric = std::to_string( rules.size() ) + " rules";
+		ReportBenchmark( metric.c_str(), static_cast<double>( elapsed ) / matchCount, "ns" );
+	}
+}
@@ -0,0 +1,106 @@
+#include "theater.h"
+#include "testing.h"
+
+namespace Theater
+{
+	namespace
+	{
+		SettingsData MakeData()
+		{
+			SettingsData data;
+			data.processNames.Add( L"game.exe" );
+			data.processNames.Add( L"other.exe" );
+			data.companionNames.Add( L"overlay.exe" );
+			data.rules.emplace_back( Rule{ RuleField::Class, RuleOperator::Equals, L"Engine" } );
+			data.monitorLevels.emplace_back( MonitorLevel{ L"\\\\.\\DISPLAY2", 100, MonitorLevel::GLOBAL } );
+			return data;
+		}
+
+		// One edit per group, and the change it has to be reported as
+		struct Edit
+		{
+			uint32_t change;
+			void ( *apply )( SettingsData& data );
+		};
+
+		const Edit EDITS[] = {
+			{ SETTINGS_CHANGE_ENABLED, []( SettingsData& data ) { data.enabled = false; } },
+			{ SETTINGS_CHANGE_ALPHA, []( SettingsData& data ) { data.alpha = 10; } },
+			{ SETTINGS_CHANGE_COLOR, []( SettingsData& data ) { data.color = 0x123456; } },
+			{ SETTINGS_CHANGE_FADE, []( SettingsData& data ) { data.fadeDuration = 900; } },
+			{ SETTINGS_CHANGE_FADE, []( SettingsData& data ) { data.fadeEasing = Easing::EaseOut; } },
+			{ SETTINGS_CHANGE_SPOTLIGHT, []( SettingsData& data ) { data.spotlight = true; } },
+			{ SETTINGS_CHANGE_SPOTLIGHT, []( SettingsData& data ) { data.spotlightFeather = 8; } },
+			{ SETTINGS_CHANGE_GRADIENT, []( SettingsData& data ) { data.gradient.kind = GradientKind::Linear; } },
+			{ SETTINGS_CHANGE_GRADIENT, []( SettingsData& data ) { data.gradient.radius = 10.0f; } },
+			{ SETTINGS_CHANGE_GRADIENT, []( SettingsData& data ) { data.gradient.innerCoverage = 1.0f; } },
+			{ SETTINGS_CHANGE_PROCESSES, []( SettingsData& data ) { data.processNames.Add( L"new.exe" ); } },
+			{ SETTINGS_CHANGE_PROCESSES, []( SettingsData& data ) { data.processNames.Remove( L"game.exe" ); } },
+			{ SETTINGS_CHANGE_COMPANIONS, []( SettingsData& data ) { data.companionNames.Clear(); } },
+			{ SETTINGS_CHANGE_RULES, []( SettingsData& data ) { data.rules[0].pattern = L"Other"; } },
+			{ SETTINGS_CHANGE_RULES, []( SettingsData& data ) { data.rules[0].op = RuleOperator::Glob; } },
+			{ SETTINGS_CHANGE_RULES, []( SettingsData& data ) { data.rules.emplace_back( data.rules[0] ); } },
+			{ SETTINGS_CHANGE_MONITORS, []( SettingsData& data ) { data.monitorLevels[0].alpha = 5; } },
+			{ SETTINGS_CHANGE_MONITORS, []( SettingsData& data ) { data.monitorLevels[0].color = 0; } },
+			{ SETTINGS_CHANGE_MONITORS, []( SettingsData& data ) { data.monitorLevels.clear(); } },
+		};
+	} // namespace
+} // namespace Theater
+
+using namespace Theater;
+
+THEATER_TEST( settingsdata, EachEditReportsOnlyItsGroup )
+{
+	CHECK( DiffSettings( MakeData(), MakeData() ) == 0 );
+
+	for ( const auto& edit : EDITS )
+	{
+		SettingsData next = MakeData();
+		edit.apply( next );
+		CHECK( DiffSettings( MakeData(), next ) == edit.change );
+		CHECK( DiffSettings( next, MakeData() ) == edit.change );
+	}
+
+	// every edit at once reports every group
+	SettingsData next = MakeData();
+	for ( const auto& edit : EDITS )
+		edit.apply( next );
+	CHECK( DiffSettings( MakeData(), next ) == SETTINGS_CHANGE_ALL );
+}
+
+THEATER_TEST( settingsdata, NameCaseAndOrderAreChanges )
+{
+	// matching ignores case but the file is written back the way it was typed
+	SettingsData next = MakeData();
+	next.processNames.Clear();
+	next.processNames.Add( L"GAME.exe" );
+	next.processNames.Add( L"other.exe" );
+	CHECK( DiffSettings( MakeData(), next ) == SETTINGS_CHANGE_PROCESSES );
+
+	next.processNames.Clear();
+	next.processNames.Add( L"other.exe" );
+	next.processNames.Add( L"game.exe" );
+	CHECK( DiffSettings( MakeData(), next ) == SETTINGS_CHANGE_PROCESSES );
+}
+
+THEATER_TEST( settingsdata, MergeCopiesOnlyTheGivenGroups )
+{
+	SettingsData edited = MakeData();
+	for ( const auto& edit : EDITS )
+		edit.apply( edited );
+
+	// a reload that only applies what the listeners were told about
+	SettingsData data = MakeData();
+	MergeSettings( edited, SETTINGS_CHANGE_ALPHA | SETTINGS_CHANGE_RULES, data );
+	CHECK( data.alpha == 10 );
+	CHECK( data.rules.size() == 2 );
+	const uint32_t merged = SETTINGS_CHANGE_ALPHA | SETTINGS_CHANGE_RULES;
+	CHECK( DiffSettings( MakeData(), data ) == merged );
+	CHECK( DiffSettings( edited, data ) == ( SETTINGS_CHANGE_ALL & ~merged ) );
+
+	MergeSettings( edited, DiffSettings( data, edited ), data );
+	CHECK( DiffSettings( edited, data ) == 0 );
+
+	MergeSettings( MakeData(), 0, data );
+	CHECK( DiffSettings( edited, data ) == 0 );
+}
@@ -0,0 +1,147 @@
+#include "theater.h"
+#include "testing.h"
+#include <filesystem>
+
+namespace Theater
+{
+	namespace
+	{
+		// A settings directory of its own for every test, removed along with whatever was written to it
+		class TemporarySettings
+		{
+		public:
+			TemporarySettings()
+			{
+				static uint32_t s_counter = 0;
+
+				this->directory = std::filesystem::temp_directory_path() /
+				                  ( "theater-settings-" + std::to_string( GetTestTimeNanoseconds() ) + "-" +
+				                    std::to_string( s_counter++ ) );
+				std::filesystem::create_directories( this->directory );
+				this->file.SetDirectory( this->directory.wstring() );
+			}
+
+			~TemporarySettings()
+			{
+				std::error_code error;
+				std::filesystem::remove_all( this->directory, error );
+			}
+
+			bool Write( const SettingsData& data, const std::string& json, uint64_t& contentHash ) const
+			{
+				return this->file.Write( data, reinterpret_cast<const uint8_t*>( json.data() ), json.size(),
+				                         contentHash );
+			}
+
+			// What a change notification would find in settings.json
+			uint64_t HashOnDisk() const
+			{
+				MappedFile json;
+				if ( !json.Open( this->file.GetFilename() ) )
+					return 0;
+
+				return GetContentHash( json.GetData(), json.GetSize() );
+			}
+
+			std::filesystem::path directory;
+			SettingsFile          file;
+		};
+
+		SettingsData MakeData( uint8_t alpha )
+		{
+			SettingsData data;
+			data.alpha = alpha;
+			data.processNames.Add( L"game" );
+			return data;
+		}
+	} // namespace
+} // namespace Theater
+
+using namespace Theater;
+
+THEATER_TEST( settingsfile, WriteReportsTheHashOfTheFileOnDisk )
+{
+	TemporarySettings settings;
+	CHECK( !settings.file.Exists() );
+
+	uint64_t written = 0;
+	REQUIRE( settings.Write( MakeData( 120 ), "{ \"alpha\": 120 }", written ) );
+	CHECK( settings.file.Exists() );
+	CHECK( written != 0 );
+	CHECK( written == settings.HashOnDisk() );
+
+	uint64_t rewritten = 0;
+	REQUIRE( settings.Write( MakeData( 121 ), "{ \"alpha\": 121 }", rewritten ) );
+	CHECK( rewritten != written );
+	CHECK( rewritten == settings.HashOnDisk() );
+}
+
+THEATER_TEST( settingsfile, SnapshotHandsBackTheHashAfterARestart )
+{
+	TemporarySettings settings;
+
+	uint64_t written = 0;
+	REQUIRE( settings.Write( MakeData( 90 ), "{ \"alpha\": 90 }", written ) );
+
+	// a fresh instance knows nothing but the directory, like the next start
+	SettingsFile restarted;
+	restarted.SetDirectory( settings.directory.wstring() );
+
+	SettingsData data;
+	uint64_t     loaded = 0;
+	REQUIRE( restarted.ReadSnapshot( data, loaded ) );
+	CHECK( loaded == written );
+	CHECK( loaded == settings.HashOnDisk() );
+	CHECK( data.alpha == 90 );
+	CHECK( data.processNames.Contains( L"game" ) );
+}
+
+THEATER_TEST( settingsfile, ExternalEditIsToldApartFromOurWrite )
+{
+	TemporarySettings settings;
+
+	uint64_t written = 0;
+	REQUIRE( settings.Write( MakeData( 90 ), "{ \"alpha\": 90 }", written ) );
+
+	// an editor saving something else, the snapshot no longer matches settings.json
+	const std::string edited = "{ \"alpha\": 200, \"enabled\": false }";
+	REQUIRE( WriteFileAtomic( settings.file.GetFilename(), reinterpret_cast<const uint8_t*>( edited.data() ),
+	                          edited.size(), nullptr ) );
+	CHECK( settings.HashOnDisk() != written );
+
+	SettingsData data;
+	uint64_t     loaded = 0;
+	CHECK( !settings.file.ReadSnapshot( data, loaded ) );
+
+	// once the edit is read it gets a snapshot of its own
+	settings.file.UpdateSnapshot( MakeData( 200 ), settings.HashOnDisk() );
+	REQUIRE( settings.file.ReadSnapshot( data, loaded ) );
+	CHECK( loaded == settings.HashOnDisk() );
+	CHECK( data.alpha == 200 );
+}
+
+THEATER_TEST( settingsfile, FormerContentBecomesTheBackup )
+{
+	TemporarySettings settings;
+
+	uint64_t written = 0;
+	REQUIRE( settings.Write( MakeData( 1 ), "{ \"alpha\": 1 }", written ) );
+	REQUIRE( settings.Write( MakeData( 2 ), "{ \"alpha\": 2 }", written ) );
+
+	MappedFile backup;
+	REQUIRE( backup.Open( settings.file.GetBackupFilename() ) );
+	const std::string content( reinterpret_cast<const char*>( backup.GetData() ), backup.GetSize() );
+	CHECK( content == "{ \"alpha\": 1 }" );
+}
+
+THEATER_TEST( settingsfile, SnapshotWithoutSettingsIsDropped )
+{
+	TemporarySettings settings;
+
+	uint64_t written = 0;
+	REQUIRE( settings.Write( MakeData( 1 ), "{ \"alpha\": 1 }", written ) );
+	REQUIRE( std::filesystem::remove( settings.file.GetFilename() ) );
+
+	settings.file.UpdateSnapshot( MakeData( 1 ), written );
+	CHECK( !std::filesystem::exists( settings.file.GetSnapshotFilename() ) );
+}
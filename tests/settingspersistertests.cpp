@@ -0,0 +1,316 @@
+#include "theater.h"
+#include "testing.h"
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+#if !defined( _WIN32 )
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace Theater
+{
+	namespace
+	{
+		// The write callback is a plain function, the faults it injects are set up through these
+		std::atomic<uint32_t> s_failuresLeft;
+		std::atomic<uint32_t> s_attempts;
+		std::atomic<uint32_t> s_finished;
+		std::atomic<bool>     s_blocked;
+		std::mutex            s_writtenLock;
+		std::vector<uint8_t>  s_written; // alpha of every successful write
+
+		void ResetWrites()
+		{
+			s_failuresLeft = 0;
+			s_attempts     = 0;
+			s_finished     = 0;
+			s_blocked      = false;
+
+			std::lock_guard<std::mutex> guard( s_writtenLock );
+			s_written.clear();
+		}
+
+		bool WriteWithFaults( const SettingsData& data, uint64_t& contentHash )
+		{
+			s_attempts++;
+			while ( s_blocked )
+				std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+
+			bool success = true;
+			for ( uint32_t left = s_failuresLeft; left != 0; left = s_failuresLeft )
+			{
+				if ( s_failuresLeft.compare_exchange_weak( left, left - 1 ) )
+				{
+					success = false;
+					break;
+				}
+			}
+
+			if ( success )
+			{
+				std::lock_guard<std::mutex> guard( s_writtenLock );
+				s_written.emplace_back( data.alpha );
+				contentHash = data.alpha;
+			}
+
+			s_finished++;
+			return success;
+		}
+
+		SettingsData MakeData( uint8_t alpha )
+		{
+			SettingsData data;
+			data.alpha = alpha;
+			return data;
+		}
+
+		// Polls TakeWritten, the retries run on their own schedule
+		bool WaitForConfirmation( SettingsPersister& persister, SettingsData& data, uint64_t& generation,
+		                          uint64_t& contentHash )
+		{
+			const uint64_t timeout = GetTestTimeNanoseconds() + 5000000000ull;
+			while ( !persister.TakeWritten( data, generation, contentHash ) )
+			{
+				if ( GetTestTimeNanoseconds() > timeout )
+					return false;
+
+				std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+			}
+
+			return true;
+		}
+
+		// Generation k of settings.json, big enough for a kill to land in the middle of writing it
+		std::string MakeGeneration( uint32_t generation )
+		{
+			return "{ \"generation\": " + std::to_string( generation ) + ", \"padding\": \"" +
+			       std::string( 256 * 1024, static_cast<char>( 'a' + generation % 26 ) ) + "\" }\n";
+		}
+
+		// The generation a file holds, -1 when it is missing and -2 when it's anything but a complete generation
+		int64_t ReadGeneration( const std::wstring& filename )
+		{
+			std::ifstream file( std::filesystem::path( filename ), std::ios::binary );
+			if ( !file )
+				return -1;
+
+			const std::string content( ( std::istreambuf_iterator<char>( file ) ), std::istreambuf_iterator<char>() );
+			const std::string key = "{ \"generation\": ";
+			if ( content.compare( 0, key.size(), key ) != 0 )
+				return -2;
+
+			const uint32_t generation =
+			    static_cast<uint32_t>( std::strtoul( content.c_str() + key.size(), nullptr, 10 ) );
+			return content == MakeGeneration( generation ) ? generation : -2;
+		}
+	} // namespace
+} // namespace Theater
+
+using namespace Theater;
+
+THEATER_TEST( settingspersister, FailedWritesAreRetriedUntilConfirmed )
+{
+	ResetWrites();
+	s_failuresLeft = 3;
+
+	SettingsPersister persister;
+	REQUIRE( persister.Start( WriteWithFaults, 1 ) );
+
+	const uint64_t scheduled = persister.Schedule( MakeData( 10 ) );
+	CHECK( !persister.Flush() );
+
+	SettingsData written;
+	uint64_t     generation  = 0;
+	uint64_t     contentHash = 0;
+	CHECK( !persister.TakeWritten( written, generation, contentHash ) );
+	CHECK( persister.IsPending() );
+
+	REQUIRE( WaitForConfirmation( persister, written, generation, contentHash ) );
+	CHECK( generation == scheduled );
+	CHECK( written.alpha == 10 );
+	CHECK( contentHash == 10 );
+	CHECK( s_attempts == 4 );
+	CHECK( !persister.IsPending() );
+	CHECK( !persister.TakeWritten( written, generation, contentHash ) );
+}
+
+THEATER_TEST( settingspersister, NothingIsConfirmedWhileWritesFail )
+{
+	ResetWrites();
+	s_failuresLeft = 1000;
+
+	SettingsPersister persister;
+	REQUIRE( persister.Start( WriteWithFaults, 1 ) );
+
+	persister.Schedule( MakeData( 10 ) );
+	CHECK( !persister.Flush() );
+	std::this_thread::sleep_for( std::chrono::milliseconds( 20 ) );
+
+	SettingsData written;
+	uint64_t     generation  = 0;
+	uint64_t     contentHash = 0;
+	CHECK( !persister.TakeWritten( written, generation, contentHash ) );
+
+	// the last attempt on the way out fails too, there is still nothing to report
+	persister.Stop();
+	CHECK( !persister.TakeWritten( written, generation, contentHash ) );
+	CHECK( s_written.empty() );
+}
+
+THEATER_TEST( settingspersister, NewerDataReplacesFailedData )
+{
+	ResetWrites();
+	s_failuresLeft = 1;
+
+	SettingsPersister persister;
+	REQUIRE( persister.Start( WriteWithFaults, 1000 ) );
+
+	const uint64_t first = persister.Schedule( MakeData( 10 ) );
+	CHECK( !persister.Flush() );
+	CHECK( persister.IsPending() );
+
+	const uint64_t second = persister.Schedule( MakeData( 20 ) );
+	CHECK( second > first );
+	CHECK( persister.Flush() );
+
+	SettingsData written;
+	uint64_t     generation  = 0;
+	uint64_t     contentHash = 0;
+	REQUIRE( persister.TakeWritten( written, generation, contentHash ) );
+	CHECK( generation == second );
+	CHECK( written.alpha == 20 );
+
+	const std::vector<uint8_t> expected = { 20 };
+	CHECK( s_written == expected );
+}
+
+THEATER_TEST( settingspersister, EveryConfirmationIsTakenOnce )
+{
+	ResetWrites();
+
+	SettingsPersister persister;
+	REQUIRE( persister.Start( WriteWithFaults, 1000 ) );
+
+	SettingsData   written;
+	uint64_t       generation  = 0;
+	uint64_t       contentHash = 0;
+	const uint64_t first       = persister.Schedule( MakeData( 10 ) );
+	CHECK( persister.Flush() );
+	REQUIRE( persister.TakeWritten( written, generation, contentHash ) );
+	CHECK( generation == first );
+	CHECK( !persister.TakeWritten( written, generation, contentHash ) );
+
+	const uint64_t second = persister.Schedule( MakeData( 20 ) );
+	CHECK( !persister.TakeWritten( written, generation, contentHash ) );
+	CHECK( persister.Flush() );
+	REQUIRE( persister.TakeWritten( written, generation, contentHash ) );
+	CHECK( generation == second );
+	CHECK( written.alpha == 20 );
+	CHECK( contentHash == 20 );
+}
+
+THEATER_TEST( settingspersister, WaitForWriteWaitsForTheWriteInProgress )
+{
+	ResetWrites();
+	s_blocked = true;
+
+	SettingsPersister persister;
+	REQUIRE( persister.Start( WriteWithFaults, 1 ) );
+
+	persister.Schedule( MakeData( 10 ) );
+	while ( s_attempts == 0 )
+		std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+
+	std::thread release( []() {
+		std::this_thread::sleep_for( std::chrono::milliseconds( 20 ) );
+		s_blocked = false;
+	} );
+
+	persister.WaitForWrite();
+	CHECK( s_finished == 1 );
+	release.join();
+
+	SettingsData written;
+	uint64_t     generation  = 0;
+	uint64_t     contentHash = 0;
+	CHECK( persister.TakeWritten( written, generation, contentHash ) );
+}
+
+THEATER_TEST( settingspersister, StopWritesWhatIsPending )
+{
+	ResetWrites();
+
+	SettingsPersister persister;
+	REQUIRE( persister.Start( WriteWithFaults, SettingsPersister::MAX_DELAY ) );
+
+	const uint64_t scheduled = persister.Schedule( MakeData( 30 ) );
+	persister.Stop();
+	CHECK( s_attempts == 1 );
+
+	SettingsData written;
+	uint64_t     generation  = 0;
+	uint64_t     contentHash = 0;
+	REQUIRE( persister.TakeWritten( written, generation, contentHash ) );
+	CHECK( generation == scheduled );
+	CHECK( written.alpha == 30 );
+}
+
+#if !defined( _WIN32 )
+THEATER_TEST( settingspersister, KilledWriterLeavesACompleteGeneration )
+{
+	const std::filesystem::path directory =
+	    std::filesystem::temp_directory_path() / ( "theater-killed-" + std::to_string( GetTestTimeNanoseconds() ) );
+	std::filesystem::create_directories( directory );
+
+	SettingsFile file;
+	file.SetDirectory( directory.wstring() );
+	const std::wstring filename = file.GetFilename();
+	const std::wstring backup   = file.GetBackupFilename();
+
+	const std::string first = MakeGeneration( 0 );
+	REQUIRE( WriteFileAtomic( filename.c_str(), reinterpret_cast<const uint8_t*>( first.data() ), first.size(),
+	                          backup.c_str() ) );
+
+	// the app killed at a random point of a save, over and over, each time starting from what the last one left
+	std::mt19937 random( 16 );
+	int64_t      current  = 0;
+	uint32_t     failures = 0;
+	uint32_t     advanced = 0;
+	for ( uint32_t round = 0; round < 40; round++ )
+	{
+		const pid_t child = fork();
+		REQUIRE( child >= 0 );
+		if ( child == 0 )
+		{
+			for ( uint32_t generation = static_cast<uint32_t>( current ) + 1;; generation++ )
+			{
+				const std::string content = MakeGeneration( generation );
+				WriteFileAtomic( filename.c_str(), reinterpret_cast<const uint8_t*>( content.data() ), content.size(),
+				                 backup.c_str() );
+			}
+		}
+
+		std::this_thread::sleep_for( std::chrono::microseconds( random() % 20000 ) );
+		kill( child, SIGKILL );
+		int status = 0;
+		waitpid( child, &status, 0 );
+
+		// either the former or a newer generation in full, and the one before it or the same one as the backup
+		const int64_t next   = ReadGeneration( filename );
+		const int64_t former = ReadGeneration( backup );
+		failures += next >= current ? 0 : 1;
+		failures += former == next || former == next - 1 || ( next == 0 && former == -1 ) ? 0 : 1;
+		advanced += next > current ? 1 : 0;
+		current = std::max( current, next );
+	}
+
+	CHECK( failures == 0 );
+	CHECK( advanced > 0 );
+
+	std::error_code error;
+	std::filesystem::remove_all( directory, error );
+}
+#endif
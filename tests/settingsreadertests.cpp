@@ -0,0 +1,295 @@
+#include "theater.h"
+#include "testing.h"
+#include <random>
+
+namespace Theater
+{
+	namespace
+	{
+		const char FULL_SETTINGS[] = R"({
+			"version": 1,
+			"enabled": false,
+			"alpha": 150,
+			"color": [ 16, 32, 48 ],
+			"fadeDuration": 750,
+			"fadeEasing": "ease-in-out",
+			"spotlight": true,
+			"spotlightFeather": 48,
+			"gradient": "radial",
+			"gradientRadius": 900,
+			"gradientInner": 0.5,
+			"processes": [ "game.exe", "other.exe" ],
+			"companions": [ "overlay.exe" ],
+			"rules": [
+				{ "field": "path", "glob": "D:\\Games\\**\\*.exe" },
+				{ "field": "title", "contains": "Fullscreen" }
+			],
+			"monitors": [ { "device": "\\\\.\\DISPLAY2", "alpha": 100, "color": [ 1, 2, 3 ] } ]
+		})";
+
+		bool Read( const std::string& json, SettingsData& data )
+		{
+			return ReadSettings( json.data(), json.size(), data );
+		}
+
+		// Values none of the tests' documents use, to tell what a read left alone
+		SettingsData MakeDefaults()
+		{
+			SettingsData data;
+			data.alpha        = 77;
+			data.color        = 0x0A0B0C;
+			data.fadeDuration = 123;
+			data.processNames.Add( L"kept.exe" );
+			data.rules.emplace_back( Rule{ RuleField::Class, RuleOperator::Equals, L"Kept" } );
+			return data;
+		}
+
+		std::string MakeDocument( uint32_t ruleCount, uint32_t nameCount )
+		{
+			std::string json = R"({ "version": 1, "alpha": 180, "color": [ 0, 0, 0 ], "processes": [ )";
+			for ( uint32_t i = 0; i < nameCount; i++ )
+				json += ( i == 0 ? "\"game" : ", \"game" ) + std::to_string( i ) + ".exe\"";
+
+			json += R"( ], "rules": [ )";
+			for ( uint32_t i = 0; i < ruleCount; i++ )
+			{
+				const std::string id = std::to_string( i );
+				json += i == 0 ? "\n" : ",\n";
+				switch ( i % 3 )
+				{
+				case 0:
+					json += R"({ "field": "path", "glob": "D:\\Games\\**\\)" + id + R"(\\*.exe" })";
+					break;
+				case 1:
+					json += R"({ "field": "class", "equals": "Engine)" + id + R"(" })";
+					break;
+				case 2:
+					json += R"({ "field": "title", "contains": "Fullscreen )" + id + R"(" })";
+					break;
+				}
+			}
+
+			return json + "\n] }";
+		}
+	} // namespace
+} // namespace Theater
+
+using namespace Theater;
+
+THEATER_TEST( settingsreader, ReadsEveryKey )
+{
+	SettingsData data;
+	REQUIRE( Read( FULL_SETTINGS, data ) );
+	CHECK( !data.enabled );
+	CHECK( data.alpha == 150 );
+	CHECK( data.color == 0x302010 );
+	CHECK( data.fadeDuration == 750 );
+	CHECK( data.fadeEasing == Easing::EaseInOut );
+	CHECK( data.spotlight );
+	CHECK( data.spotlightFeather == 48 );
+	CHECK( data.gradient.kind == GradientKind::Radial );
+	CHECK( data.gradient.radius == 900.0f );
+	CHECK( data.gradient.innerCoverage == 0.5f );
+	CHECK( data.processNames.GetCount() == 2 );
+	CHECK( data.processNames.Contains( L"GAME.exe" ) );
+	CHECK( data.companionNames.Contains( L"overlay.exe" ) );
+
+	REQUIRE( data.rules.size() == 2 );
+	CHECK( data.rules[0].field == RuleField::Path );
+	CHECK( data.rules[0].op == RuleOperator::Glob );
+	CHECK( data.rules[0].pattern == L"D:\\Games\\**\\*.exe" );
+	CHECK( data.rules[1].op == RuleOperator::Contains );
+
+	REQUIRE( data.monitorLevels.size() == 1 );
+	CHECK( data.monitorLevels[0].device == L"\\\\.\\DISPLAY2" );
+	CHECK( data.monitorLevels[0].alpha == 100 );
+	CHECK( data.monitorLevels[0].color == 0x030201 );
+}
+
+THEATER_TEST( settingsreader, MissingKeysKeepTheirValues )
+{
+	SettingsData data = MakeDefaults();
+	REQUIRE( Read( R"({ "version": 1, "alpha": 90 })", data ) );
+	CHECK( data.alpha == 90 );
+	CHECK( data.color == 0x0A0B0C );
+	CHECK( data.fadeDuration == 123 );
+	CHECK( data.processNames.Contains( L"kept.exe" ) );
+	CHECK( data.rules.size() == 1 );
+
+	// without a supported version nothing is taken, not even what was read before finding out
+	const SettingsData before = data;
+	CHECK( !Read( R"({ "alpha": 10 })", data ) );
+	CHECK( !Read( R"({ "alpha": 10, "version": 2 })", data ) );
+	CHECK( !Read( R"([ 1 ])", data ) );
+	CHECK( !Read( "", data ) );
+	CHECK( data.alpha == 90 );
+	CHECK( DiffSettings( before, data ) == 0 );
+}
+
+THEATER_TEST( settingsreader, WrongTypesLeaveTheValueAlone )
+{
+	SettingsData data = MakeDefaults();
+	REQUIRE( Read( R"({
+		"version": 1,
+		"alpha": "high",
+		"enabled": 0,
+		"color": [ 1, 2 ],
+		"fadeDuration": 1.5,
+		"fadeEasing": "bounce",
+		"gradient": 3,
+		"processes": "game.exe",
+		"companions": { "name": "overlay.exe" }
+	})",
+	               data ) );
+	CHECK( data.alpha == 77 );
+	CHECK( data.enabled );
+	CHECK( data.color == 0x0A0B0C );
+	CHECK( data.fadeDuration == 123 );
+	CHECK( data.fadeEasing == Easing::Linear );
+	CHECK( data.gradient.kind == GradientKind::None );
+	CHECK( data.processNames.Contains( L"kept.exe" ) );
+	CHECK( data.companionNames.IsEmpty() );
+
+	// elements of the wrong type are dropped one by one, out of range numbers are clamped
+	REQUIRE( Read( R"({
+		"version": 1,
+		"alpha": 1000,
+		"color": [ 300, "green", -5 ],
+		"processes": [ "game.exe", 7, null, [ "nested.exe" ], "" ],
+		"rules": [
+			{ "field": "size", "equals": "x" },
+			{ "field": "class" },
+			{ "field": 1, "equals": "x" },
+			"class",
+			{ "glob": "*.exe", "field": "name", "contains": "ignored" }
+		],
+		"monitors": [ { "alpha": 10 }, { "device": "\\\\.\\DISPLAY1", "alpha": "dim" } ]
+	})",
+	               data ) );
+	CHECK( data.alpha == 255 );
+	CHECK( data.color == 0x0000FF );
+	CHECK( data.processNames.GetCount() == 1 );
+	CHECK( data.processNames.Contains( L"game.exe" ) );
+	REQUIRE( data.rules.size() == 1 );
+	CHECK( data.rules[0].field == RuleField::Name );
+	CHECK( data.rules[0].op == RuleOperator::Glob );
+	CHECK( data.rules[0].pattern == L"*.exe" );
+	REQUIRE( data.monitorLevels.size() == 1 );
+	CHECK( data.monitorLevels[0].alpha == MonitorLevel::GLOBAL );
+}
+
+THEATER_TEST( settingsreader, UnknownNestedValuesAreSkipped )
+{
+	// known names inside unknown values must not be taken for settings
+	SettingsData data = MakeDefaults();
+	REQUIRE( Read( R"({
+		"version": 1,
+		"plugins": { "alpha": 5, "processes": [ "plugin.exe" ], "deep": [ [ { "rules": [ { "field": "name" } ] } ] ] },
+		"history": [ { "alpha": 6 }, [ "color", [ 1, 2, 3 ] ] ],
+		"alpha": 60,
+		"rules": [ { "field": "class", "comment": { "equals": "NotAPattern" }, "equals": "Engine" } ],
+		"monitors": [ { "device": "\\\\.\\DISPLAY1", "extra": { "alpha": 1 }, "alpha": 30 } ]
+	})",
+	               data ) );
+	CHECK( data.alpha == 60 );
+	CHECK( data.processNames.Contains( L"kept.exe" ) );
+	CHECK( !data.processNames.Contains( L"plugin.exe" ) );
+	REQUIRE( data.rules.size() == 1 );
+	CHECK( data.rules[0].pattern == L"Engine" );
+	REQUIRE( data.monitorLevels.size() == 1 );
+	CHECK( data.monitorLevels[0].alpha == 30 );
+}
+
+THEATER_TEST( settingsreader, CharactersPastTheBmpStayWhole )
+{
+	// U+1F3AE, four UTF-8 bytes, as is and escaped as a surrogate pair
+	SettingsData data;
+	REQUIRE( Read( "{ \"version\": 1, \"processes\": [ \"\xF0\x9F\x8E\xAE" "game.exe\", \"caf\xC3\xA9.exe\" ] }",
+	               data ) );
+	CHECK( data.processNames.Contains( L"\U0001F3AEgame.exe" ) );
+	CHECK( data.processNames.Contains( L"CAF\u00c9.EXE" ) );
+
+	REQUIRE( Read( R"({ "version": 1, "companions": [ "\ud83c\udfaeoverlay.exe" ] })", data ) );
+	CHECK( data.companionNames.Contains( L"\U0001F3AEoverlay.exe" ) );
+}
+
+// Fuzz target for the loader, cut or mangled files must fail without touching the settings or read to sane values.
+// Worth running with THEATER_SANITIZER=address.
+THEATER_TEST( settingsreader, TruncatedOrCorruptInputFailsCleanly )
+{
+	const std::string  full     = FULL_SETTINGS;
+	const SettingsData defaults = MakeDefaults();
+	for ( size_t size = 0; size < full.size(); size++ )
+	{
+		SettingsData data = defaults;
+		CHECK( !ReadSettings( full.data(), size, data ) );
+		CHECK( DiffSettings( defaults, data ) == 0 );
+	}
+
+	const char   tokens[] = { '{', '}', '[', ']', '"', ',', ':', '\\', '0', '-', 'e', '\0', '\xC3', '\xF0' };
+	std::mt19937 random( 1313 );
+	uint32_t     parsed = 0;
+	for ( uint32_t i = 0; i < 20000; i++ )
+	{
+		std::string    json  = full;
+		const uint32_t edits = 1 + random() % 3;
+		for ( uint32_t j = 0; j < edits; j++ )
+		{
+			const size_t offset = random() % json.size();
+			switch ( random() % 3 )
+			{
+			case 0:
+				json[offset] = tokens[random() % sizeof( tokens )];
+				break;
+			case 1:
+				json.erase( offset, 1 + random() % 8 );
+				break;
+			case 2:
+				json.insert( offset, 1, tokens[random() % sizeof( tokens )] );
+				break;
+			}
+		}
+
+		SettingsData data = defaults;
+		if ( !Read( json, data ) )
+		{
+			CHECK( DiffSettings( defaults, data ) == 0 );
+			continue;
+		}
+
+		parsed++;
+		CHECK( data.fadeDuration <= 10000 );
+		CHECK( data.spotlightFeather <= 1024 );
+		CHECK( data.gradient.radius >= 1.0f );
+		CHECK( data.gradient.innerCoverage >= 0.0f && data.gradient.innerCoverage <= 1.0f );
+		for ( const auto& level : data.monitorLevels )
+			CHECK( level.alpha >= MonitorLevel::GLOBAL && level.alpha <= 255 );
+	}
+
+	// edits inside strings still parse, the checks above ran on something
+	CHECK( parsed > 0 );
+}
+
+// Startup without a snapshot, a settings.json of ten thousand rules and a thousand process names streamed in
+THEATER_BENCHMARK( settingsreader, LoadTenThousandRules )
+{
+	const uint32_t    ruleCount = quick ? 1000 : 10000;
+	const uint32_t    runs      = quick ? 2 : 20;
+	const std::string json      = MakeDocument( ruleCount, 1000 );
+	ReportBenchmark( "settings.json size", json.size() / 1024.0, "KB" );
+
+	uint64_t rules = 0;
+	uint64_t start = GetTestTimeNanoseconds();
+	for ( uint32_t i = 0; i < runs; i++ )
+	{
+		SettingsData data;
+		CHECK( Read( json, data ) );
+		rules += data.rules.size();
+	}
+	const uint64_t elapsed = GetTestTimeNanoseconds() - start;
+
+	KeepValue( rules );
+	CHECK( rules == static_cast<uint64_t>( ruleCount ) * runs );
+	ReportBenchmark( "read", elapsed / 1e6 / runs, "ms" );
+	ReportBenchmark( "per rule", static_cast<double>( elapsed ) / runs / ruleCount, "ns" );
+}
@@ -0,0 +1,199 @@
+#include "theater.h"
+#include "testing.h"
+#include <random>
+
+namespace Theater
+{
+	namespace
+	{
+		constexpr size_t SNAPSHOT_HEADER = 40;
+
+		const SettingsSource SOURCE = { 1234, 5678 };
+
+		SettingsData MakeData( uint32_t ruleCount, uint32_t nameCount )
+		{
+			SettingsData data;
+			data.alpha            = 150;
+			data.color            = 0x102030;
+			data.fadeEasing       = Easing::EaseInOut;
+			data.spotlight        = true;
+			data.spotlightFeather = 48;
+			data.gradient         = { GradientKind::Radial, 900.0f, 0.5f };
+
+			for ( uint32_t i = 0; i < nameCount; i++ )
+				data.processNames.Add( L"game" + std::to_wstring( i ) );
+			data.companionNames.Add( L"overlay" );
+
+			for ( uint32_t i = 0; i < ruleCount; i++ )
+			{
+				const std::wstring id = std::to_wstring( i );
+				switch ( i % 3 )
+				{
+				case 0:
+					data.rules.emplace_back(
+					    Rule{ RuleField::Path, RuleOperator::Glob, L"D:\\Games\\**\\" + id + L"\\*.exe" } );
+					break;
+				case 1:
+					data.rules.emplace_back( Rule{ RuleField::Class, RuleOperator::Equals, L"Engine" + id } );
+					break;
+				case 2:
+					data.rules.emplace_back( Rule{ RuleField::Title, RuleOperator::Contains, L"Fullscreen " + id } );
+					break;
+				}
+			}
+
+			data.monitorLevels.emplace_back( MonitorLevel{ L"\\\\.\\DISPLAY2", 100, MonitorLevel::GLOBAL } );
+			return data;
+		}
+
+		// Patches the payload size and checksum at the end of the header, so corrupt content gets past them
+		void Seal( std::vector<uint8_t>& bytes )
+		{
+			const size_t payloadSize = bytes.size() - SNAPSHOT_HEADER;
+			uint32_t     checksum    = 2166136261u;
+			for ( size_t i = SNAPSHOT_HEADER; i < bytes.size(); i++ )
+			{
+				checksum ^= bytes[i];
+				checksum *= 16777619u;
+			}
+
+			for ( size_t i = 0; i < 4; i++ )
+			{
+				bytes[SNAPSHOT_HEADER - 8 + i] = static_cast<uint8_t>( payloadSize >> ( i * 8 ) );
+				bytes[SNAPSHOT_HEADER - 4 + i] = static_cast<uint8_t>( checksum >> ( i * 8 ) );
+			}
+		}
+
+		bool Read( const std::vector<uint8_t>& bytes, SettingsData& data )
+		{
+			uint64_t contentHash = 0;
+			return ReadSettingsSnapshot( bytes.data(), bytes.size(), SOURCE, data, contentHash );
+		}
+	} // namespace
+} // namespace Theater
+
+using namespace Theater;
+
+THEATER_TEST( settingssnapshot, RoundTripKeepsEveryValue )
+{
+	const SettingsData   written = MakeData( 30, 5 );
+	std::vector<uint8_t> bytes;
+	REQUIRE( WriteSettingsSnapshot( written, SOURCE, 0xABCDEF, bytes ) );
+
+	SettingsData read;
+	uint64_t     contentHash = 0;
+	REQUIRE( ReadSettingsSnapshot( bytes.data(), bytes.size(), SOURCE, read, contentHash ) );
+	CHECK( contentHash == 0xABCDEF );
+	CHECK( DiffSettings( written, read ) == 0 );
+	CHECK( read.rules.size() == 30 );
+	CHECK( read.rules[2].pattern == L"Fullscreen 2" );
+}
+
+THEATER_TEST( settingssnapshot, StaleOrTruncatedSnapshotIsRejected )
+{
+	std::vector<uint8_t> bytes;
+	REQUIRE( WriteSettingsSnapshot( MakeData( 10, 3 ), SOURCE, 1, bytes ) );
+
+	SettingsData   data;
+	uint64_t       contentHash = 0;
+	SettingsSource edited      = SOURCE;
+	edited.writeTime++;
+	CHECK( !ReadSettingsSnapshot( bytes.data(), bytes.size(), edited, data, contentHash ) );
+
+	for ( size_t size = 0; size < bytes.size(); size++ )
+		CHECK( !ReadSettingsSnapshot( bytes.data(), size, SOURCE, data, contentHash ) );
+
+	// a flipped bit anywhere in the payload fails the checksum
+	for ( size_t i = SNAPSHOT_HEADER; i < bytes.size(); i += 7 )
+	{
+		bytes[i] ^= 0x10;
+		CHECK( !Read( bytes, data ) );
+		bytes[i] ^= 0x10;
+	}
+
+	CHECK( Read( bytes, data ) );
+}
+
+// Fuzz target for the decoder, corrupt payloads with a valid checksum must fail cleanly or decode to sane values.
+// Worth running with THEATER_SANITIZER=address.
+THEATER_TEST( settingssnapshot, CorruptPayloadIsRangeChecked )
+{
+	std::vector<uint8_t> original;
+	REQUIRE( WriteSettingsSnapshot( MakeData( 12, 4 ), SOURCE, 1, original ) );
+
+	std::mt19937 random( 4242 );
+	uint32_t     decoded = 0;
+	for ( uint32_t i = 0; i < 20000; i++ )
+	{
+		std::vector<uint8_t> bytes = original;
+		const uint32_t       edits = 1 + random() % 4;
+		for ( uint32_t j = 0; j < edits && bytes.size() > SNAPSHOT_HEADER; j++ )
+		{
+			const size_t offset = SNAPSHOT_HEADER + random() % ( bytes.size() - SNAPSHOT_HEADER );
+			switch ( random() % 4 )
+			{
+			case 0:
+				bytes[offset] = static_cast<uint8_t>( random() );
+				break;
+			case 1:
+				bytes[offset] = 0xFF;
+				break;
+			case 2:
+				bytes.resize( offset );
+				break;
+			case 3:
+				bytes.insert( bytes.begin() + offset, static_cast<uint8_t>( random() ) );
+				break;
+			}
+		}
+		Seal( bytes );
+
+		SettingsData data;
+		if ( !Read( bytes, data ) )
+			continue;
+
+		decoded++;
+		CHECK( data.fadeEasing <= Easing::EaseInOut );
+		CHECK( data.gradient.kind <= GradientKind::Linear );
+		CHECK( data.gradient.innerCoverage >= 0.0f && data.gradient.innerCoverage <= 1.0f );
+		for ( const auto& rule : data.rules )
+			CHECK( rule.field < RuleField::Count && rule.op <= RuleOperator::Glob );
+		for ( const auto& level : data.monitorLevels )
+			CHECK( level.alpha >= MonitorLevel::GLOBAL && level.alpha <= 255 );
+	}
+
+	// edits to plain values still decode, the checks above ran on something
+	CHECK( decoded > 0 );
+}
+
+// Startup with a settings.json of ten thousand rules: the snapshot is decoded and the rules compiled
+THEATER_BENCHMARK( settingssnapshot, LoadTenThousandRules )
+{
+	const uint32_t ruleCount = quick ? 1000 : 10000;
+	const uint32_t runs      = quick ? 2 : 20;
+
+	std::vector<uint8_t> bytes;
+	WriteSettingsSnapshot( MakeData( ruleCount, 1000 ), SOURCE, 1, bytes );
+	ReportBenchmark( "snapshot size", bytes.size() / 1024.0, "KB" );
+
+	uint64_t readTime    = 0;
+	uint64_t compileTime = 0;
+	uint64_t rules       = 0;
+	for ( uint32_t i = 0; i < runs; i++ )
+	{
+		SettingsData   data;
+		const uint64_t start = GetTestTimeNanoseconds();
+		Read( bytes, data );
+		const uint64_t read = GetTestTimeNanoseconds();
+
+		RuleEngine engine;
+		engine.Compile( data.rules );
+		compileTime += GetTestTimeNanoseconds() - read;
+		readTime += read - start;
+		rules += data.rules.size();
+	}
+
+	KeepValue( rules );
+	ReportBenchmark( "read", readTime / 1e6 / runs, "ms" );
+	ReportBenchmark( "compile", compileTime / 1e6 / runs, "ms" );
+}
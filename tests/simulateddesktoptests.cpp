@@ -0,0 +1,145 @@
+#include "theater.h"
+#include "testing.h"
+
+namespace Theater
+{
+	namespace
+	{
+		std::vector<WindowEvent> s_events;
+
+		void OnEvent( const WindowEvent& event )
+		{
+			s_events.emplace_back( event );
+		}
+
+		Platform::WindowId AddWindow( SimulatedDesktop& desktop, uint32_t pid, bool topmost = false )
+		{
+			SimulatedDesktop::WindowParams params = {};
+			params.pid                            = pid;
+			params.rect                           = PlatformRect{ 0, 0, 100, 100 };
+			params.topmost                        = topmost;
+			return desktop.AddWindow( params );
+		}
+	} // namespace
+} // namespace Theater
+
+using namespace Theater;
+
+THEATER_TEST( simulateddesktop, NewWindowsGoOnTopOfTheirBand )
+{
+	SimulatedDesktop desktop;
+	const uint32_t   pid     = desktop.StartProcess( L"C:\\Games\\game.exe" );
+	const auto       normal  = AddWindow( desktop, pid );
+	const auto       topmost = AddWindow( desktop, pid, true );
+	const auto       later   = AddWindow( desktop, pid );
+
+	const std::vector<Platform::WindowId> expected = { topmost, later, normal };
+	CHECK( desktop.GetZOrder() == expected );
+	CHECK( desktop.GetTopWindow() == topmost );
+	CHECK( desktop.GetWindowBelow( topmost ) == later );
+	CHECK( desktop.GetWindowAbove( later ) == topmost );
+	CHECK( desktop.GetWindowAbove( topmost ) == Platform::NO_WINDOW );
+	CHECK( desktop.GetWindowBelow( normal ) == Platform::NO_WINDOW );
+}
+
+THEATER_TEST( simulateddesktop, ProcessNameIsTheFileName )
+{
+	SimulatedDesktop desktop;
+	const uint32_t   pid = desktop.StartProcess( L"C:\\Program Files\\Game\\Game.Launcher.exe" );
+
+	std::wstring path;
+	std::wstring name;
+	CHECK( desktop.QueryProcessPath( pid, path, name ) );
+	CHECK( name == L"Game.Launcher" );
+
+	ProcessCache::ProcessId id = {};
+	CHECK( desktop.QueryProcessId( pid, id ) );
+	CHECK( id.pid == pid );
+
+	desktop.EndProcess( pid );
+	CHECK( !desktop.QueryProcessPath( pid, path, name ) );
+}
+
+THEATER_TEST( simulateddesktop, HooksSeeChangesInOrderAndSkipTheCurrentProcess )
+{
+	SimulatedDesktop desktop;
+	const uint32_t   own   = desktop.StartProcess( L"theater.exe" );
+	const uint32_t   other = desktop.StartProcess( L"game.exe" );
+	desktop.SetCurrentProcess( own );
+
+	// nothing is queued before the hooks are installed
+	AddWindow( desktop, other );
+	s_events.clear();
+	CHECK( desktop.StartEventHooks( &OnEvent ) );
+	CHECK( desktop.DispatchEvents() == 0 );
+
+	AddWindow( desktop, own );
+	const auto window = AddWindow( desktop, other );
+	desktop.SetForegroundWindow( window );
+	desktop.SetWindowCloaked( window, true );
+	desktop.DestroyWindow( window );
+	CHECK( desktop.DispatchEvents() == 6 );
+
+	const WindowEventType expected[] = { WindowEventType::Created,    WindowEventType::Shown,
+	                                     WindowEventType::Foreground, WindowEventType::Cloaked,
+	                                     WindowEventType::Hidden,     WindowEventType::Destroyed };
+	REQUIRE( s_events.size() == 6 );
+	for ( size_t i = 0; i < s_events.size(); i++ )
+	{
+		CHECK( s_events[i].type == expected[i] );
+		CHECK( s_events[i].window == window );
+	}
+
+	desktop.StopEventHooks();
+}
+
+THEATER_TEST( simulateddesktop, LocationHookOnlyFollowsOneProcess )
+{
+	SimulatedDesktop desktop;
+	const uint32_t   followed = desktop.StartProcess( L"game.exe" );
+	const uint32_t   other    = desktop.StartProcess( L"browser.exe" );
+	const auto       target   = AddWindow( desktop, followed );
+	const auto       ignored  = AddWindow( desktop, other );
+
+	CHECK( !desktop.StartLocationHook( followed ) ); // needs the event hooks first
+	CHECK( desktop.StartEventHooks( &OnEvent ) );
+	CHECK( desktop.StartLocationHook( followed ) );
+
+	s_events.clear();
+	desktop.SetWindowRect( target, PlatformRect{ 10, 10, 110, 110 } );
+	desktop.SetWindowRect( ignored, PlatformRect{ 10, 10, 110, 110 } );
+	desktop.DispatchEvents();
+	REQUIRE( s_events.size() == 1 );
+	CHECK( s_events[0].type == WindowEventType::LocationChanged );
+	CHECK( s_events[0].window == target );
+
+	PlatformRect rect = {};
+	CHECK( desktop.GetWindowRect( target, rect ) && rect.left == 10 && rect.bottom == 110 );
+
+	desktop.StopEventHooks();
+}
+
+THEATER_TEST( simulateddesktop, MovesAreAllOrNothing )
+{
+	SimulatedDesktop desktop;
+	const uint32_t   pid    = desktop.StartProcess( L"game.exe" );
+	const auto       bottom = AddWindow( desktop, pid );
+	const auto       middle = AddWindow( desktop, pid );
+	const auto       top    = AddWindow( desktop, pid, true );
+
+	// top was topmost, sending it to the bottom drops that
+	CHECK( desktop.MoveWindowsToBottom( &top, 1 ) );
+	CHECK( !desktop.IsWindowTopmost( top ) );
+	CHECK( desktop.GetZOrder().back() == top );
+
+	const Platform::WindowId gone[] = { bottom, 0x1234 };
+	CHECK( !desktop.MoveWindowsBelow( middle, gone, 2 ) );
+	CHECK( !desktop.MoveWindowsToBottom( gone, 2 ) );
+
+	const Platform::WindowId chained[] = { top, bottom };
+	CHECK( desktop.MoveWindowsBelow( middle, chained, 2 ) );
+
+	const std::vector<Platform::WindowId> expected = { middle, top, bottom };
+	CHECK( desktop.GetZOrder() == expected );
+	CHECK( desktop.GetZOrderMoveCount() == 3 );
+}
@@ -0,0 +1,124 @@
+#include "theater.h"
+#include "testing.h"
+#include <map>
+#include <random>
+
+namespace Theater
+{
+	namespace
+	{
+		typedef SlotMap<uint64_t>::Handle Handle;
+
+		bool IsSameHandle( const Handle& a, const Handle& b )
+		{
+			return a.index == b.index && a.generation == b.generation;
+		}
+	} // namespace
+} // namespace Theater
+
+using namespace Theater;
+
+THEATER_TEST( slotmap, RemovedHandleNeverResolvesAgain )
+{
+	SlotMap<uint64_t> map;
+	const Handle      first  = map.Insert( 1 );
+	const Handle      second = map.Insert( 2 );
+	REQUIRE( map.Get( first ) != nullptr );
+	CHECK( *map.Get( first ) == 1 );
+	CHECK( *map.Get( second ) == 2 );
+
+	CHECK( map.Remove( first ) );
+	CHECK( !map.Remove( first ) );
+	CHECK( map.Get( first ) == nullptr );
+	CHECK( *map.Get( second ) == 2 );
+
+	// the slot is reused under a new generation
+	const Handle reused = map.Insert( 3 );
+	CHECK( reused.index == first.index );
+	CHECK( !IsSameHandle( reused, first ) );
+	CHECK( map.Get( first ) == nullptr );
+	CHECK( *map.Get( reused ) == 3 );
+
+	CHECK( map.Get( Handle{ 100, 0 } ) == nullptr );
+}
+
+THEATER_TEST( slotmap, ClearInvalidatesEveryHandle )
+{
+	SlotMap<uint64_t>   map;
+	std::vector<Handle> handles;
+	for ( uint64_t i = 0; i < 10; i++ )
+		handles.emplace_back( map.Insert( i ) );
+	map.Remove( handles[3] );
+
+	map.Clear();
+	CHECK( map.GetCount() == 0 );
+	CHECK( map.begin() == map.end() );
+	for ( const auto& handle : handles )
+		CHECK( map.Get( handle ) == nullptr );
+
+	// the slots are all free again, none of the new handles matches an old one
+	for ( uint64_t i = 0; i < 10; i++ )
+	{
+		const Handle handle = map.Insert( i );
+		for ( const auto& old : handles )
+			CHECK( !IsSameHandle( handle, old ) );
+	}
+	CHECK( map.GetCount() == 10 );
+}
+
+THEATER_TEST( slotmap, AgreesWithAMap )
+{
+	// value to handle, every value is unique
+	std::map<uint64_t, Handle> reference;
+	std::vector<Handle>        removed;
+	SlotMap<uint64_t>          map;
+
+	std::mt19937 random( 4 );
+	uint64_t     nextValue  = 0;
+	uint32_t     mismatches = 0;
+	for ( uint32_t i = 0; i < 100000; i++ )
+	{
+		// grows and shrinks in waves so slots keep being reused
+		const bool growing = ( i / 5000 ) % 2 == 0;
+		if ( reference.empty() || random() % 10 < ( growing ? 7u : 3u ) )
+		{
+			const uint64_t value = nextValue++;
+			reference.emplace( value, map.Insert( value ) );
+		}
+		else
+		{
+			auto iter = reference.begin();
+			std::advance( iter, random() % reference.size() );
+			mismatches += map.Remove( iter->second ) ? 0 : 1;
+			removed.emplace_back( iter->second );
+			reference.erase( iter );
+		}
+
+		if ( random() % 20000 == 0 )
+		{
+			for ( const auto& entry : reference )
+				removed.emplace_back( entry.second );
+			reference.clear();
+			map.Clear();
+		}
+	}
+
+	CHECK( mismatches == 0 );
+	REQUIRE( map.GetCount() == reference.size() );
+	for ( const auto& entry : reference )
+	{
+		const uint64_t* value = map.Get( entry.second );
+		CHECK( value != nullptr && *value == entry.first );
+	}
+
+	for ( const auto& handle : removed )
+		CHECK( map.Get( handle ) == nullptr );
+
+	// iteration sees every value once, in whatever order removals left them
+	std::vector<uint64_t> values( map.begin(), map.end() );
+	std::sort( values.begin(), values.end() );
+	std::vector<uint64_t> expected;
+	for ( const auto& entry : reference )
+		expected.emplace_back( entry.first );
+	CHECK( values == expected );
+}
@@ -0,0 +1,260 @@
+#include "theater.h"
+#include "testing.h"
+
+namespace Theater
+{
+	namespace
+	{
+		typedef SpotlightSurface::Rect Rect;
+
+		constexpr SimdLevel SIMD_LEVELS[] = { SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2 };
+
+		struct Scene
+		{
+			uint32_t       width;
+			uint32_t       height;
+			GradientParams gradient;
+			Rect           target;
+			bool           hole;
+			uint32_t       feather;
+		};
+
+		// Odd sizes leave tails behind every vector loop, targets reach over the edges
+		const Scene SCENES[] = {
+			{ 333, 201, { GradientKind::None, 0.0f, 0.0f }, { 100, 50, 220, 140 }, true, 0 },
+			{ 333, 201, { GradientKind::None, 0.0f, 0.0f }, { 100, 50, 220, 140 }, true, 29 },
+			{ 333, 201, { GradientKind::Radial, 150.0f, 0.2f }, { -40, 120, 90, 260 }, true, 17 },
+			{ 257, 130, { GradientKind::Radial, 90.0f, 0.0f }, {}, false, 0 },
+			{ 257, 130, { GradientKind::Linear, 60.0f, 0.5f }, { 200, -10, 300, 40 }, true, 8 },
+		};
+
+		struct Image
+		{
+			uint32_t              width  = 0;
+			uint32_t              height = 0;
+			std::vector<uint32_t> pixels;
+
+			Image( uint32_t width, uint32_t height ) : width( width ), height( height ), pixels( width * height )
+			{
+			}
+		};
+
+		void Setup( SpotlightSurface& surface, const Scene& scene, SimdLevel level )
+		{
+			surface.SetSimdLevel( level );
+			surface.Resize( scene.width, scene.height );
+			surface.SetColor( 0x20, 0x40, 0xC0 );
+			surface.SetGradient( scene.gradient );
+			surface.SetTarget( scene.target );
+			surface.SetHole( scene.hole, scene.feather );
+		}
+
+		Image Render( const Scene& scene, SimdLevel level )
+		{
+			SpotlightSurface surface;
+			Setup( surface, scene, level );
+
+			Image image( scene.width, scene.height );
+			surface.Render( image.pixels.data(), image.width );
+			return image;
+		}
+
+		uint32_t ScaleReference( uint32_t pixel, double coverage )
+		{
+			uint32_t result = 0;
+			for ( uint32_t shift = 0; shift < 32; shift += 8 )
+				result |= static_cast<uint32_t>( ( ( pixel >> shift ) & 0xFF ) * coverage + 0.5 ) << shift;
+
+			return result;
+		}
+
+		double DistanceReference( double c, double low, double high )
+		{
+			return c < low ? low - c : ( c > high ? c - high : 0.0 );
+		}
+
+		// The image as described by SpotlightSurface, in double precision and one pixel at a time
+		uint32_t ReferencePixel( const Scene& scene, uint32_t x, uint32_t y )
+		{
+			const double px    = x + 0.5;
+			const double py    = y + 0.5;
+			uint32_t     pixel = 0xFF2040C0u;
+
+			if ( scene.gradient.kind != GradientKind::None )
+			{
+				const Rect&  target   = scene.target;
+				const bool   centered = target.IsEmpty();
+				const double cx       = centered ? scene.width * 0.5 : ( target.left + target.right ) * 0.5;
+				const double cy       = centered ? scene.height * 0.5 : ( target.top + target.bottom ) * 0.5;
+				const double dy       = scene.gradient.kind == GradientKind::Radial ? py - cy : 0.0;
+				const double d        = std::sqrt( ( px - cx ) * ( px - cx ) + dy * dy );
+				const double t        = std::min( d / scene.gradient.radius, 1.0 );
+				const double inner    = scene.gradient.innerCoverage;
+				pixel                 = ScaleReference( pixel, inner + ( 1.0 - inner ) * t );
+			}
+
+			if ( scene.hole && !scene.target.IsEmpty() )
+			{
+				const double dx = DistanceReference( px, scene.target.left, scene.target.right );
+				const double dy = DistanceReference( py, scene.target.top, scene.target.bottom );
+				const double d  = std::sqrt( dx * dx + dy * dy );
+				if ( scene.feather == 0 )
+					pixel = d > 0.0 ? pixel : 0;
+				else if ( d < scene.feather )
+					pixel = ScaleReference( pixel, d / scene.feather );
+			}
+
+			return pixel;
+		}
+
+		uint32_t GetChannelError( uint32_t a, uint32_t b )
+		{
+			uint32_t error = 0;
+			for ( uint32_t shift = 0; shift < 32; shift += 8 )
+			{
+				const int32_t difference =
+				    static_cast<int32_t>( ( a >> shift ) & 0xFF ) - static_cast<int32_t>( ( b >> shift ) & 0xFF );
+				error = std::max( error, static_cast<uint32_t>( std::abs( difference ) ) );
+			}
+
+			return error;
+		}
+	} // namespace
+} // namespace Theater
+
+using namespace Theater;
+
+THEATER_TEST( spotlightsurface, MatchesTheReferenceImage )
+{
+	for ( const auto& scene : SCENES )
+	{
+		const Image image    = Render( scene, SimdLevel::Scalar );
+		uint32_t    maxError = 0;
+		for ( uint32_t y = 0; y < scene.height; y++ )
+		{
+			for ( uint32_t x = 0; x < scene.width; x++ )
+			{
+				const uint32_t pixel = image.pixels[y * scene.width + x];
+				maxError             = std::max( maxError, GetChannelError( pixel, ReferencePixel( scene, x, y ) ) );
+			}
+		}
+
+		// float against double and a rounding step on either side
+		CHECK( maxError <= 1 );
+	}
+}
+
+THEATER_TEST( spotlightsurface, EveryKernelRendersTheSameImage )
+{
+	for ( const auto& scene : SCENES )
+	{
+		const Image scalar = Render( scene, SimdLevel::Scalar );
+		for ( const auto level : SIMD_LEVELS )
+			CHECK( Render( scene, level ).pixels == scalar.pixels );
+	}
+}
+
+THEATER_TEST( spotlightsurface, MovedTargetRendersLikeAFreshSurface )
+{
+	// the gradient is shifted along with the target, the flat color only re-renders the rows around the hole
+	const Scene scenes[] = { SCENES[1], SCENES[2], SCENES[4] };
+	const Rect  moves[]  = { { 12, 7, 12, 7 }, { -30, 0, -30, 0 }, { 5, -45, 5, -45 } };
+	for ( const auto& scene : scenes )
+	{
+		for ( const auto level : SIMD_LEVELS )
+		{
+			SpotlightSurface surface;
+			Setup( surface, scene, level );
+
+			Image image( scene.width, scene.height );
+			surface.Render( image.pixels.data(), image.width );
+
+			Scene moved = scene;
+			for ( const auto& move : moves )
+			{
+				moved.target = { moved.target.left + move.left, moved.target.top + move.top,
+				                 moved.target.right + move.right, moved.target.bottom + move.bottom };
+				surface.SetTarget( moved.target );
+
+				uint32_t firstRow = 0;
+				uint32_t rowCount = 0;
+				CHECK( surface.GetDirtyRows( firstRow, rowCount ) );
+				surface.Render( image.pixels.data(), image.width );
+				CHECK( !surface.GetDirtyRows( firstRow, rowCount ) );
+				CHECK( image.pixels == Render( moved, level ).pixels );
+			}
+		}
+	}
+}
+
+THEATER_TEST( spotlightsurface, HoleChangesOnlyDirtyTheRowsAroundIt )
+{
+	SpotlightSurface surface;
+	Setup( surface, SCENES[1], GetSimdLevel() );
+
+	Image image( SCENES[1].width, SCENES[1].height );
+	surface.Render( image.pixels.data(), image.width );
+
+	uint32_t firstRow = 0;
+	uint32_t rowCount = 0;
+	surface.SetHole( true, 10 );
+	REQUIRE( surface.GetDirtyRows( firstRow, rowCount ) );
+	CHECK( firstRow == 50 - 29 );
+	CHECK( rowCount == ( 140 + 29 ) - ( 50 - 29 ) );
+
+	// setting what is already set leaves the image alone
+	surface.Render( image.pixels.data(), image.width );
+	surface.SetColor( 0x20, 0x40, 0xC0 );
+	surface.SetHole( true, 10 );
+	CHECK( !surface.GetDirtyRows( firstRow, rowCount ) );
+}
+
+// A full re-render, what a color, gradient or monitor change costs
+THEATER_BENCHMARK( spotlightsurface, FullRender )
+{
+	struct Size
+	{
+		const char* name;
+		uint32_t    width;
+		uint32_t    height;
+	};
+
+	const Size     sizes[] = { { "4k", 3840, 2160 }, { "8k", 7680, 4320 } };
+	const uint32_t runs    = quick ? 1 : 10;
+
+	for ( const auto& size : sizes )
+	{
+		const uint32_t width  = quick ? size.width / 8 : size.width;
+		const uint32_t height = quick ? size.height / 8 : size.height;
+		const int32_t  w      = static_cast<int32_t>( width );
+		const int32_t  h      = static_cast<int32_t>( height );
+		const Rect     target = { w / 4, h / 4, w * 3 / 4, h * 3 / 4 };
+
+		Image image( width, height );
+		for ( const auto level : SIMD_LEVELS )
+		{
+			if ( level > GetSimdLevel() )
+				continue;
+
+			SpotlightSurface surface;
+			surface.SetSimdLevel( level );
+			surface.Resize( width, height );
+			surface.SetTarget( target );
+			surface.SetHole( true, 32 );
+
+			const uint64_t start = GetTestTimeNanoseconds();
+			for ( uint32_t i = 0; i < runs; i++ )
+			{
+				// alternating keeps every run a full render
+				surface.SetGradient( { i % 2 == 0 ? GradientKind::Radial : GradientKind::Linear, 1500.0f, 0.25f } );
+				surface.Render( image.pixels.data(), width );
+			}
+			const uint64_t elapsed = GetTestTimeNanoseconds() - start;
+
+			const std::string metric = std::string( size.name ) + " " + GetSimdLevelName( level );
+			KeepValue( image.pixels[width * height / 2] );
+			ReportBenchmark( metric.c_str(), static_cast<double>( width ) * height * runs * 1000.0 / elapsed,
+			                 "MP/s" );
+		}
+	}
+}
@@ -0,0 +1,147 @@
+#include "theater.h"
+#include "testing.h"
+
+namespace Theater
+{
+	namespace
+	{
+		typedef SpscRing<WindowEvent, 1024> EventRing;
+
+		// The hook side, pushes count events numbered through window and waits whenever the ring is full
+		void ProduceEvents( EventRing& ring, uint64_t count )
+		{
+			for ( uint64_t i = 1; i <= count; i++ )
+			{
+				const WindowEvent event = { WindowEventType::Shown, static_cast<uint32_t>( i ),
+				                            static_cast<uintptr_t>( i ) };
+				while ( !ring.Push( event ) )
+					std::this_thread::yield();
+			}
+		}
+
+		// The worker side, returns how many events arrived in order before the first one that didn't
+		uint64_t ConsumeEvents( EventRing& ring, uint64_t count )
+		{
+			WindowEvent event    = {};
+			uint64_t    received = 0;
+			while ( received < count )
+			{
+				if ( !ring.Pop( event ) )
+				{
+					std::this_thread::yield();
+					continue;
+				}
+
+				if ( event.window != received + 1 || event.time != static_cast<uint32_t>( received + 1 ) )
+					return received;
+
+				received++;
+			}
+
+			return received;
+		}
+	} // namespace
+} // namespace Theater
+
+using namespace Theater;
+
+THEATER_TEST( spscring, PopsInPushOrderAcrossTheWrap )
+{
+	SpscRing<uint32_t, 4> ring;
+	CHECK( ring.IsEmpty() );
+	CHECK( ring.GetCapacity() == 4 );
+
+	uint32_t next     = 0;
+	uint32_t expected = 0;
+	for ( uint32_t round = 0; round < 100; round++ )
+	{
+		// a varying fill level moves the indices over the end of the storage at every offset
+		const uint32_t fill = 1 + round % 4;
+		for ( uint32_t i = 0; i < fill; i++ )
+			CHECK( ring.Push( next++ ) );
+
+		uint32_t value = 0;
+		for ( uint32_t i = 0; i < fill; i++ )
+		{
+			REQUIRE( ring.Pop( value ) );
+			CHECK( value == expected++ );
+		}
+
+		CHECK( ring.IsEmpty() );
+	}
+}
+
+THEATER_TEST( spscring, FullRingRejectsPushes )
+{
+	SpscRing<uint32_t, 4> ring;
+	for ( uint32_t i = 0; i < 4; i++ )
+		CHECK( ring.Push( i ) );
+
+	CHECK( !ring.Push( 4 ) );
+	CHECK( !ring.IsEmpty() );
+
+	uint32_t value = 0;
+	CHECK( ring.Pop( value ) );
+	CHECK( value == 0 );
+	CHECK( ring.Push( 4 ) );
+	CHECK( !ring.Push( 5 ) );
+
+	for ( uint32_t i = 1; i <= 4; i++ )
+	{
+		CHECK( ring.Pop( value ) );
+		CHECK( value == i );
+	}
+
+	CHECK( !ring.Pop( value ) );
+	CHECK( ring.IsEmpty() );
+}
+
+// Meant for THEATER_SANITIZER=thread as well, the indices are the only synchronization between the two sides
+THEATER_TEST( spscring, TwoThreadsLoseNothing )
+{
+	constexpr uint64_t COUNT = 200000;
+
+	EventRing   ring;
+	std::thread producer( [&ring]() { ProduceEvents( ring, COUNT ); } );
+	const auto  received = ConsumeEvents( ring, COUNT );
+	producer.join();
+
+	CHECK( received == COUNT );
+	CHECK( ring.IsEmpty() );
+}
+
+THEATER_BENCHMARK( spscring, Throughput )
+{
+	const uint64_t count = quick ? 100000 : 20000000;
+
+	// hook thread to worker thread, the path every window event takes
+	{
+		EventRing      ring;
+		const uint64_t start = GetTestTimeNanoseconds();
+		std::thread    producer( [&ring, count]() { ProduceEvents( ring, count ); } );
+		const auto     received = ConsumeEvents( ring, count );
+		producer.join();
+		const uint64_t elapsed = GetTestTimeNanoseconds() - start;
+
+		KeepValue( received );
+		ReportBenchmark( "cross-thread", count * 1000.0 / elapsed, "Mevents/s" );
+	}
+
+	// the cost of each side without the other thread's cache traffic
+	{
+		EventRing      ring;
+		WindowEvent    event = {};
+		uint64_t       sum   = 0;
+		const uint64_t start = GetTestTimeNanoseconds();
+		for ( uint64_t i = 0; i < count; i++ )
+		{
+			ring.Push( { WindowEventType::Shown, 0, static_cast<uintptr_t>( i ) } );
+			ring.Pop( event );
+			sum += event.window;
+		}
+		const uint64_t elapsed = GetTestTimeNanoseconds() - start;
+
+		KeepValue( sum );
+		ReportBenchmark( "push-pop", static_cast<double>( elapsed ) / count, "ns" );
+	}
+}
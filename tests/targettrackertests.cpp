@@ -0,0 +1,231 @@
+#include "theater.h"
+#include "testing.h"
+
+namespace Theater
+{
+	namespace
+	{
+		// The hook callback is a plain function, like the app's, so it reaches the tracker through globals
+		SimulatedDesktop* s_desktop  = nullptr;
+		TargetTracker*    s_tracker  = nullptr;
+		uint32_t          s_accepted = 0;
+		uint32_t          s_rejected = 0;
+
+		void OnEvent( const WindowEvent& event )
+		{
+			if ( s_tracker->Push( event, s_desktop->GetTime() ) )
+				s_accepted++;
+			else
+				s_rejected++;
+		}
+
+		// Two 1080p monitors side by side and a game window on the left one, its moves reported by the location hook
+		class TrackedDesktop
+		{
+		public:
+			TrackedDesktop()
+			{
+				s_desktop  = &this->desktop;
+				s_tracker  = &this->tracker;
+				s_accepted = 0;
+				s_rejected = 0;
+
+				this->desktop.AddMonitor( L"\\\\.\\DISPLAY1", LEFT );
+				this->desktop.AddMonitor( L"\\\\.\\DISPLAY2", RIGHT );
+				this->tracker.SetMonitors( { LEFT, RIGHT } );
+
+				this->pid = this->desktop.StartProcess( L"C:\\Games\\game.exe" );
+				SimulatedDesktop::WindowParams params = {};
+				params.pid                            = this->pid;
+				params.rect                           = PlatformRect{ 100, 100, 900, 700 };
+				this->window                          = this->desktop.AddWindow( params );
+
+				this->desktop.StartEventHooks( OnEvent );
+				this->desktop.StartLocationHook( this->pid );
+				this->desktop.DispatchEvents();
+				s_accepted = 0;
+				s_rejected = 0;
+			}
+
+			~TrackedDesktop()
+			{
+				this->desktop.StopEventHooks();
+				s_desktop = nullptr;
+				s_tracker = nullptr;
+			}
+
+			// Where the mouse put the window, and the tracker's pass of the message loop right after
+			bool MoveAndPop( const PlatformRect& rect, uint32_t& changes )
+			{
+				this->desktop.SetWindowRect( this->window, rect );
+				this->desktop.DispatchEvents();
+				return this->tracker.Pop( this->desktop, this->desktop.GetTime(), changes );
+			}
+
+			static constexpr PlatformRect LEFT  = { 0, 0, 1920, 1080 };
+			static constexpr PlatformRect RIGHT = { 1920, 0, 3840, 1080 };
+
+			SimulatedDesktop   desktop;
+			TargetTracker      tracker;
+			uint32_t           pid    = 0;
+			Platform::WindowId window = Platform::NO_WINDOW;
+		};
+
+		PlatformRect Offset( const PlatformRect& rect, int32_t x, int32_t y )
+		{
+			return PlatformRect{ rect.left + x, rect.top + y, rect.right + x, rect.bottom + y };
+		}
+	} // namespace
+} // namespace Theater
+
+using namespace Theater;
+
+THEATER_TEST( targettracker, DragAtMouseRateIsReadOncePerFrame )
+{
+	TrackedDesktop tracked;
+	REQUIRE( tracked.tracker.Track( tracked.desktop, tracked.window ) );
+	CHECK( tracked.tracker.GetMonitorMask() == 1 );
+
+	// a 1 kHz mouse dragging the window a pixel a millisecond across both monitors
+	const PlatformRect start   = tracked.tracker.GetRect();
+	uint32_t           pops    = 0;
+	uint32_t           moved   = 0;
+	uint32_t           resized = 0;
+	uint32_t           crossed = 0;
+	uint64_t           lastPop = 0;
+	uint64_t           closest = ~0ull;
+	for ( int32_t ms = 1; ms <= 2000; ms++ )
+	{
+		tracked.desktop.Advance( 1 );
+
+		uint32_t changes = 0;
+		if ( !tracked.MoveAndPop( Offset( start, ms, 0 ), changes ) )
+		{
+			CHECK( tracked.tracker.GetTimeout( tracked.desktop.GetTime() ) <= TargetTracker::DEFAULT_FRAME_PERIOD );
+			continue;
+		}
+
+		if ( pops > 0 )
+			closest = std::min<uint64_t>( closest, tracked.desktop.GetTime() - lastPop );
+		lastPop = tracked.desktop.GetTime();
+		pops++;
+
+		moved += ( changes & TargetTracker::TARGET_MOVED ) != 0 ? 1 : 0;
+		resized += ( changes & TargetTracker::TARGET_RESIZED ) != 0 ? 1 : 0;
+		crossed += ( changes & TargetTracker::TARGET_MONITORS_CHANGED ) != 0 ? 1 : 0;
+	}
+
+	// every event was taken, at most one read per frame period
+	CHECK( s_accepted == 2000 );
+	CHECK( s_rejected == 0 );
+	CHECK( closest >= TargetTracker::DEFAULT_FRAME_PERIOD );
+	CHECK( pops <= 2000 / TargetTracker::DEFAULT_FRAME_PERIOD + 1 );
+	CHECK( pops >= 2000 / TargetTracker::DEFAULT_FRAME_PERIOD - 1 );
+	CHECK( tracked.tracker.GetCoalescedCount() >= 2000 - pops - 1 );
+	CHECK( moved == pops );
+	CHECK( resized == 0 );
+
+	// onto both monitors, then off the left one
+	CHECK( crossed == 2 );
+
+	// the end of the drag is read once its frame is over, at the latest position
+	tracked.desktop.Advance( TargetTracker::DEFAULT_FRAME_PERIOD );
+	uint32_t changes = 0;
+	tracked.tracker.Pop( tracked.desktop, tracked.desktop.GetTime(), changes );
+	const PlatformRect end = Offset( start, 2000, 0 );
+	CHECK( tracked.tracker.GetRect().left == end.left );
+	CHECK( tracked.tracker.GetRect().right == end.right );
+	CHECK( tracked.tracker.GetMonitorMask() == 2 );
+	CHECK( tracked.tracker.GetTimeout( tracked.desktop.GetTime() ) == TargetTracker::NO_TIMEOUT );
+}
+
+THEATER_TEST( targettracker, MoveAloneOnlyReportsMoved )
+{
+	TrackedDesktop tracked;
+	REQUIRE( tracked.tracker.Track( tracked.desktop, tracked.window ) );
+	const PlatformRect start = tracked.tracker.GetRect();
+
+	// a quiet target is read on the spot
+	uint32_t changes = 0;
+	REQUIRE( tracked.MoveAndPop( Offset( start, 50, 20 ), changes ) );
+	CHECK( changes == TargetTracker::TARGET_MOVED );
+
+	// a location event without a change, like a restore to the same place, reports nothing
+	tracked.desktop.Advance( TargetTracker::DEFAULT_FRAME_PERIOD );
+	changes = 0;
+	CHECK( !tracked.MoveAndPop( Offset( start, 50, 20 ), changes ) );
+	CHECK( s_accepted == 2 );
+}
+
+THEATER_TEST( targettracker, ResizeAndMonitorCrossingAreReported )
+{
+	TrackedDesktop tracked;
+	REQUIRE( tracked.tracker.Track( tracked.desktop, tracked.window ) );
+
+	// dragging the bottom right corner keeps the origin
+	uint32_t changes = 0;
+	REQUIRE( tracked.MoveAndPop( PlatformRect{ 100, 100, 1000, 800 }, changes ) );
+	CHECK( changes == TargetTracker::TARGET_RESIZED );
+
+	// the left edge moves the origin too
+	tracked.desktop.Advance( TargetTracker::DEFAULT_FRAME_PERIOD );
+	REQUIRE( tracked.MoveAndPop( PlatformRect{ 50, 100, 1000, 800 }, changes ) );
+	CHECK( changes == ( TargetTracker::TARGET_MOVED | TargetTracker::TARGET_RESIZED ) );
+
+	// snapped to the other monitor
+	tracked.desktop.Advance( TargetTracker::DEFAULT_FRAME_PERIOD );
+	REQUIRE( tracked.MoveAndPop( PlatformRect{ 2000, 100, 2950, 800 }, changes ) );
+	CHECK( changes == ( TargetTracker::TARGET_MOVED | TargetTracker::TARGET_MONITORS_CHANGED ) );
+	CHECK( tracked.tracker.GetMonitorMask() == 2 );
+
+	// maximized over it, same monitor
+	tracked.desktop.Advance( TargetTracker::DEFAULT_FRAME_PERIOD );
+	REQUIRE( tracked.MoveAndPop( TrackedDesktop::RIGHT, changes ) );
+	CHECK( changes == ( TargetTracker::TARGET_MOVED | TargetTracker::TARGET_RESIZED ) );
+
+	// spanning both
+	tracked.desktop.Advance( TargetTracker::DEFAULT_FRAME_PERIOD );
+	REQUIRE( tracked.MoveAndPop( PlatformRect{ 1000, 0, 3000, 1080 }, changes ) );
+	CHECK( changes ==
+	       ( TargetTracker::TARGET_MOVED | TargetTracker::TARGET_RESIZED | TargetTracker::TARGET_MONITORS_CHANGED ) );
+	CHECK( tracked.tracker.GetMonitorMask() == 3 );
+}
+
+THEATER_TEST( targettracker, EventsOfOtherWindowsAreRejected )
+{
+	TrackedDesktop tracked;
+	SimulatedDesktop::WindowParams params = {};
+	params.pid                            = tracked.pid;
+	params.rect                           = PlatformRect{ 0, 0, 200, 200 };
+	const Platform::WindowId launcher     = tracked.desktop.AddWindow( params );
+	tracked.desktop.DispatchEvents();
+
+	// nothing tracked yet
+	const WindowEvent moved = { WindowEventType::LocationChanged, 0, tracked.window };
+	CHECK( !tracked.tracker.Push( moved, 0 ) );
+
+	REQUIRE( tracked.tracker.Track( tracked.desktop, tracked.window ) );
+	s_accepted = 0;
+	s_rejected = 0;
+
+	// another window of the same process goes through the same hook
+	uint32_t changes = 0;
+	tracked.desktop.SetWindowRect( launcher, PlatformRect{ 10, 10, 210, 210 } );
+	tracked.desktop.DispatchEvents();
+	CHECK( s_accepted == 0 );
+	CHECK( s_rejected == 1 );
+	CHECK( !tracked.tracker.Pop( tracked.desktop, tracked.desktop.GetTime(), changes ) );
+	CHECK( tracked.tracker.GetTimeout( tracked.desktop.GetTime() ) == TargetTracker::NO_TIMEOUT );
+
+	// and the target's own events other than location changes
+	const WindowEvent foreground = { WindowEventType::Foreground, 0, tracked.window };
+	const WindowEvent shown      = { WindowEventType::Shown, 0, tracked.window };
+	CHECK( !tracked.tracker.Push( foreground, 0 ) );
+	CHECK( !tracked.tracker.Push( shown, 0 ) );
+	CHECK( tracked.tracker.Push( moved, 0 ) );
+
+	// once cleared the target's moves don't count either
+	tracked.tracker.Clear();
+	CHECK( !tracked.tracker.Push( moved, 0 ) );
+	CHECK( tracked.tracker.GetTimeout( 0 ) == TargetTracker::NO_TIMEOUT );
+}
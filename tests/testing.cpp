@@ -0,0 +1,119 @@
+#include "theater.h"
+#include "testing.h"
+#include <cstdio>
+
+namespace Theater
+{
+	namespace
+	{
+		struct TestCase
+		{
+			const char*       suite;
+			const char*       name;
+			TESTFUNCTION      test;
+			BENCHMARKFUNCTION benchmark;
+		};
+
+		// filled by static initializers, so it has to be constructed on first use
+		std::vector<TestCase>& GetTestCases()
+		{
+			static std::vector<TestCase> testCases;
+			return testCases;
+		}
+
+		size_t            s_failureCount = 0;
+		const TestCase*   s_running      = nullptr;
+		volatile uint64_t s_keptValue    = 0;
+	} // namespace
+
+	bool RegisterTest( const char* suite, const char* name, TESTFUNCTION function )
+	{
+		GetTestCases().emplace_back( TestCase{ suite, name, function, nullptr } );
+		return true;
+	}
+
+	bool RegisterBenchmark( const char* suite, const char* name, BENCHMARKFUNCTION function )
+	{
+		GetTestCases().emplace_back( TestCase{ suite, name, nullptr, function } );
+		return true;
+	}
+
+	void ReportTestFailure( const char* file, int line, const char* expression )
+	{
+		s_failureCount++;
+		fprintf( stderr, "%s:%d: %s.%s: CHECK( %s ) failed\n", file, line, s_running->suite, s_running->name,
+		         expression );
+	}
+
+	void ReportBenchmark( const char* metric, double value, const char* unit )
+	{
+		printf( "  %-40s %12.3f %s\n", metric, value, unit );
+	}
+
+	uint64_t GetTestTimeNanoseconds()
+	{
+		const auto now = std::chrono::steady_clock::now().time_since_epoch();
+		return static_cast<uint64_t>( std::chrono::duration_cast<std::chrono::nanoseconds>( now ).count() );
+	}
+
+	void KeepValue( uint64_t value )
+	{
+		s_keptValue = s_keptValue + value;
+	}
+} // namespace Theater
+
+int main( int argc, char** argv )
+{
+	using namespace Theater;
+
+	bool        benchmark = false;
+	bool        quick     = false;
+	const char* suite     = nullptr;
+	for ( int i = 1; i < argc; i++ )
+	{
+		if ( strcmp( argv[i], "--benchmark" ) == 0 )
+			benchmark = true;
+		else if ( strcmp( argv[i], "--quick" ) == 0 )
+			quick = true;
+		else
+			suite = argv[i];
+	}
+
+	if ( suite == nullptr )
+	{
+		fprintf( stderr, "usage: %s [--benchmark [--quick]] suite\n", argv[0] );
+		return 1;
+	}
+
+	size_t ran    = 0;
+	size_t failed = 0;
+	for ( const auto& testCase : GetTestCases() )
+	{
+		const bool runnable = benchmark ? testCase.benchmark != nullptr : testCase.test != nullptr;
+		if ( !runnable || strcmp( testCase.suite, suite ) != 0 )
+			continue;
+
+		printf( "%s.%s\n", testCase.suite, testCase.name );
+		fflush( stdout );
+
+		const size_t failures = s_failureCount;
+		s_running             = &testCase;
+		if ( benchmark )
+			testCase.benchmark( quick );
+		else
+			testCase.test();
+
+		ran++;
+		if ( s_failureCount != failures )
+			failed++;
+	}
+
+	if ( ran == 0 )
+	{
+		fprintf( stderr, "%s: nothing to run in %s\n", argv[0], suite );
+		return 1;
+	}
+
+	printf( "%zu run, %zu failed\n", ran, failed );
+	return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#define THEATER_TEST( suite, name )                                                                                    \
+	static void Test_##suite##_##name();                                                                               \
+	static const bool s_test_##suite##_##name = Theater::RegisterTest( #suite, #name, &Test_##suite##_##name );        \
+	static void       Test_##suite##_##name()
+
+#define THEATER_BENCHMARK( suite, name )                                                                               \
+	static void Benchmark_##suite##_##name( bool quick );                                                              \
+	static const bool s_benchmark_##suite##_##name =                                                                   \
+	    Theater::RegisterBenchmark( #suite, #name, &Benchmark_##suite##_##name );                                      \
+	static void Benchmark_##suite##_##name( bool quick )
+
+#define CHECK( expression )                                                                                            \
+	do                                                                                                                 \
+	{                                                                                                                  \
+		if ( !( expression ) )                                                                                         \
+			Theater::ReportTestFailure( __FILE__, __LINE__, #expression );                                             \
+	} while ( false )
+
+#define REQUIRE( expression )                                                                                          \
+	do                                                                                                                 \
+	{                                                                                                                  \
+		if ( !( expression ) )                                                                                         \
+		{                                                                                                              \
+			Theater::ReportTestFailure( __FILE__, __LINE__, #expression );                                             \
+			return;                                                                                                    \
+		}                                                                                                              \
+	} while ( false )
+
+namespace Theater
+{
+	// Self registering test cases and benchmarks, no framework needed.
+	// theater_tests <suite> runs the tests of a suite, theater_tests --benchmark [--quick] <suite> its benchmarks.
+	// A failed CHECK marks the running test failed and carries on, a failed REQUIRE also leaves the test.
+	typedef void ( *TESTFUNCTION )();
+	typedef void ( *BENCHMARKFUNCTION )( bool quick ); // quick runs only make sure the benchmark still works
+
+	bool RegisterTest( const char* suite, const char* name, TESTFUNCTION function );
+	bool RegisterBenchmark( const char* suite, const char* name, BENCHMARKFUNCTION function );
+	void ReportTestFailure( const char* file, int line, const char* expression );
+
+	// Prints one result line of the running benchmark
+	void     ReportBenchmark( const char* metric, double value, const char* unit );
+	uint64_t GetTestTimeNanoseconds();
+
+	// Keeps the optimizer from dropping a computation whose result is otherwise unused
+	void KeepValue( uint64_t value );
+} // namespace Theater
\ No newline at end of file
@@ -0,0 +1,212 @@
+#include "theater.h"
+#include "testing.h"
+
+namespace Theater
+{
+	namespace
+	{
+		// A game with a few windows among those of other processes, the resolver targets the game
+		struct SessionDesktop
+		{
+			SimulatedDesktop                desktop;
+			WindowRegistry                  registry;
+			TargetResolver                  resolver;
+			TheaterSession                  session;
+			uint32_t                        gamePid = 0;
+			std::vector<Platform::WindowId> gameWindows;
+			std::vector<Platform::WindowId> otherWindows;
+
+			SessionDesktop( size_t gameWindowCount, size_t otherWindowCount )
+			{
+				this->gamePid = this->desktop.StartProcess( L"C:\\Games\\game.exe" );
+				for ( size_t i = 0; i < gameWindowCount; i++ )
+					this->gameWindows.emplace_back( AddWindow( this->gamePid ) );
+
+				// a handful of windows per process
+				uint32_t pid = 0;
+				for ( size_t i = 0; i < otherWindowCount; i++ )
+				{
+					if ( i % 4 == 0 )
+						pid = this->desktop.StartProcess( L"C:\\Apps\\app" + std::to_wstring( i / 4 ) + L".exe" );
+					this->otherWindows.emplace_back( AddWindow( pid ) );
+				}
+
+				ProcessNameSet names;
+				names.Add( L"game" );
+				this->resolver.SetPlatform( &this->desktop );
+				this->resolver.Configure( names, {} );
+				this->registry.Init( &this->desktop );
+			}
+
+			Platform::WindowId AddWindow( uint32_t pid )
+			{
+				SimulatedDesktop::WindowParams params = {};
+				params.pid                            = pid;
+				params.rect                           = PlatformRect{ 0, 0, 800, 600 };
+				params.visible                        = true;
+				return this->desktop.AddWindow( params );
+			}
+
+			// A window of pid shown once the registry started, passed on the way the event hooks do
+			Platform::WindowId ShowWindow( uint32_t pid )
+			{
+				const auto window = AddWindow( pid );
+				this->registry.OnWindowShown( window, true );
+
+				const WindowEvent event = { WindowEventType::Shown, 0, window };
+				this->session.OnWindowEvent( event, this->resolver, this->registry, nullptr );
+				return window;
+			}
+
+			void HideWindow( Platform::WindowId window )
+			{
+				this->desktop.ShowWindow( window, false );
+				this->registry.OnWindowShown( window, false );
+
+				const WindowEvent event = { WindowEventType::Hidden, 0, window };
+				this->session.OnWindowEvent( event, this->resolver, this->registry, nullptr );
+			}
+
+			TheaterSession::Transition Focus( Platform::WindowId window )
+			{
+				TheaterSession::Transition transition = TheaterSession::Transition::Stop;
+				this->session.OnForeground( window, this->resolver, this->registry, nullptr, transition );
+				return transition;
+			}
+		};
+	} // namespace
+} // namespace Theater
+
+using namespace Theater;
+
+// Meant for THEATER_SANITIZER=thread. Another thread keeps changing the registry under its lock the way the UI
+// thread does, the session may only touch the registry while holding that lock.
+THEATER_TEST( theatersession, RegistryIsOnlyReadUnderItsLock )
+{
+	SessionDesktop desktop( 3, 64 );
+	std::mutex     registryLock;
+
+	std::atomic<bool> done{ false };
+	std::thread       ui( [&]() {
+		const auto& others = desktop.otherWindows;
+		for ( size_t i = 0; !done.load(); i++ )
+		{
+			std::lock_guard<std::mutex> lock( registryLock );
+			desktop.registry.OnWindowShown( others[i % others.size()], ( i / others.size() ) % 2 == 0 );
+			desktop.registry.GetVisibleWindows();
+		}
+	} );
+
+	const auto& game   = desktop.gameWindows;
+	const auto& others = desktop.otherWindows;
+	size_t      starts = 0;
+	for ( uint32_t i = 0; i < 2000; i++ )
+	{
+		const auto window = i % 3 == 2 ? others[i % others.size()] : game[i % game.size()];
+
+		TheaterSession::Transition transition = TheaterSession::Transition::Stop;
+		if ( desktop.session.OnForeground( window, desktop.resolver, desktop.registry, &registryLock, transition ) )
+		{
+			const bool isGame = std::find( game.begin(), game.end(), window ) != game.end();
+			CHECK( ( transition != TheaterSession::Transition::Stop ) == isGame );
+			starts += transition == TheaterSession::Transition::Start ? 1 : 0;
+		}
+
+		const WindowEvent event = { WindowEventType::Shown, i, others[( i * 7 ) % others.size()] };
+		desktop.session.OnWindowEvent( event, desktop.resolver, desktop.registry, &registryLock );
+	}
+
+	done.store( true );
+	ui.join();
+
+	CHECK( starts > 0 );
+}
+
+THEATER_TEST( theatersession, WindowsShownDuringASessionJoinIt )
+{
+	SessionDesktop desktop( 2, 40 );
+	CHECK( desktop.Focus( desktop.gameWindows[0] ) == TheaterSession::Transition::Start );
+	CHECK( desktop.session.GetWindowCount() == 2 );
+
+	// a launcher popup of the game, then a chat window of something else
+	const auto popup = desktop.ShowWindow( desktop.gamePid );
+	const auto chat  = desktop.ShowWindow( desktop.desktop.StartProcess( L"C:\\Apps\\chat.exe" ) );
+	CHECK( desktop.session.Contains( popup ) );
+	CHECK( !desktop.session.Contains( chat ) );
+	CHECK( desktop.Focus( popup ) == TheaterSession::Transition::Switch );
+	CHECK( desktop.session.GetFocus() == popup );
+
+	desktop.HideWindow( popup );
+	CHECK( !desktop.session.Contains( popup ) );
+	CHECK( desktop.session.GetWindowCount() == 2 );
+}
+
+THEATER_TEST( theatersession, WindowsShownWithoutASessionWaitForTheNextStart )
+{
+	SessionDesktop desktop( 2, 40 );
+	CHECK( desktop.Focus( desktop.gameWindows[0] ) == TheaterSession::Transition::Start );
+	CHECK( desktop.Focus( desktop.otherWindows[0] ) == TheaterSession::Transition::Stop );
+
+	// while the game is in the background other programs come and go, none of them gets its process queried
+	const size_t queries = desktop.desktop.GetProcessQueryCount();
+	for ( uint32_t i = 0; i < 12; i++ )
+		desktop.ShowWindow( desktop.desktop.StartProcess( L"C:\\Apps\\late" + std::to_wstring( i ) + L".exe" ) );
+	const auto late = desktop.ShowWindow( desktop.gamePid );
+	CHECK( desktop.desktop.GetProcessQueryCount() == queries );
+
+	// the game's window shown in the meantime is still part of the next session
+	CHECK( desktop.Focus( desktop.gameWindows[1] ) == TheaterSession::Transition::Start );
+	CHECK( desktop.session.Contains( late ) );
+	CHECK( desktop.session.GetWindowCount() == 3 );
+}
+
+// Focus moving inside a session and windows showing up during and outside of one, the events the session sees most
+THEATER_BENCHMARK( theatersession, Membership )
+{
+	const uint32_t runs = quick ? 1000 : 1000000;
+
+	SessionDesktop desktop( 8, 400 );
+	const auto&    game   = desktop.gameWindows;
+	const auto&    others = desktop.otherWindows;
+	CHECK( desktop.Focus( game[0] ) == TheaterSession::Transition::Start );
+
+	uint64_t switches = 0;
+	uint64_t start    = GetTestTimeNanoseconds();
+	for ( uint32_t i = 0; i < runs; i++ )
+		switches += desktop.Focus( game[i % game.size()] ) == TheaterSession::Transition::Switch ? 1 : 0;
+	ReportBenchmark( "focus switch", static_cast<double>( GetTestTimeNanoseconds() - start ) / runs, "ns" );
+
+	std::vector<Platform::WindowId> companions;
+	start = GetTestTimeNanoseconds();
+	for ( uint32_t i = 0; i < runs; i++ )
+	{
+		desktop.session.GetCompanions( game[i % game.size()], companions );
+		switches += companions.size();
+	}
+	ReportBenchmark( "companions", static_cast<double>( GetTestTimeNanoseconds() - start ) / runs, "ns" );
+
+	// others being shown again, resolved from the cache
+	start = GetTestTimeNanoseconds();
+	for ( uint32_t i = 0; i < runs; i++ )
+	{
+		const WindowEvent event = { WindowEventType::Shown, i, others[i % others.size()] };
+		desktop.session.OnWindowEvent( event, desktop.resolver, desktop.registry, nullptr );
+	}
+	ReportBenchmark( "shown in session", static_cast<double>( GetTestTimeNanoseconds() - start ) / runs, "ns" );
+
+	CHECK( desktop.Focus( others[0] ) == TheaterSession::Transition::Stop );
+	start = GetTestTimeNanoseconds();
+	for ( uint32_t i = 0; i < runs; i++ )
+	{
+		const WindowEvent event = { WindowEventType::Shown, i, others[i % others.size()] };
+		desktop.session.OnWindowEvent( event, desktop.resolver, desktop.registry, nullptr );
+	}
+	ReportBenchmark( "shown without session", static_cast<double>( GetTestTimeNanoseconds() - start ) / runs, "ns" );
+
+	// the first start after that walks the registry again
+	start = GetTestTimeNanoseconds();
+	CHECK( desktop.Focus( game[0] ) == TheaterSession::Transition::Start );
+	ReportBenchmark( "start", ( GetTestTimeNanoseconds() - start ) / 1e3, "us" );
+
+	KeepValue( switches );
+}
@@ -0,0 +1,218 @@
+#include "theater.h"
+#include "testing.h"
+#include <memory>
+
+namespace Theater
+{
+	namespace
+	{
+		const char* const NAMES[] = { "dispatch", "resolve", "arrange", "fade", "present" };
+
+		// Every field derived from the index, a span mixing two writes can't pass for a real one
+		TraceSpan MakeSpan( uint64_t index )
+		{
+			return TraceSpan{ NAMES[index % 5], index * 3, index * 3 + 1, index };
+		}
+
+		bool IsWhole( const TraceSpan& span )
+		{
+			return span.name == NAMES[span.arg % 5] && span.start == span.arg * 3 && span.end == span.arg * 3 + 1;
+		}
+
+		void WriteSpans( TraceRing& ring, uint64_t count, std::atomic<bool>& done )
+		{
+			for ( uint64_t i = 0; i < count; i++ )
+				ring.Write( MakeSpan( i ) );
+
+			done = true;
+		}
+	} // namespace
+} // namespace Theater
+
+using namespace Theater;
+
+THEATER_TEST( tracerecorder, RingKeepsTheLatestSpansOldestFirst )
+{
+	auto ring = std::make_unique<TraceRing>( 1 );
+
+	std::vector<TraceSpan> spans;
+	ring->Read( spans );
+	CHECK( spans.empty() );
+
+	for ( uint64_t i = 0; i < 100; i++ )
+		ring->Write( MakeSpan( i ) );
+	ring->Read( spans );
+	REQUIRE( spans.size() == 100 );
+	CHECK( spans.front().arg == 0 );
+	CHECK( spans.back().arg == 99 );
+
+	// past the capacity the oldest are overwritten, what is left stays in order
+	for ( uint64_t i = 100; i < TraceRing::CAPACITY * 2 + 10; i++ )
+		ring->Write( MakeSpan( i ) );
+
+	spans.clear();
+	ring->Read( spans );
+	REQUIRE( spans.size() == TraceRing::CAPACITY );
+	uint32_t failures = 0;
+	for ( size_t i = 0; i < spans.size(); i++ )
+		failures += IsWhole( spans[i] ) && spans[i].arg == TraceRing::CAPACITY + 10 + i ? 0 : 1;
+	CHECK( failures == 0 );
+
+	// reading appends
+	ring->Read( spans );
+	CHECK( spans.size() == TraceRing::CAPACITY * 2 );
+}
+
+THEATER_TEST( tracerecorder, ConcurrentReaderSkipsTornSpans )
+{
+	// the writer laps the ring over and over while a reader copies it
+	auto              ring  = std::make_unique<TraceRing>( 1 );
+	const uint64_t    count = TraceRing::CAPACITY * 500;
+	std::atomic<bool> done{ false };
+	std::thread       writer( [&ring, &done, count]() { WriteSpans( *ring, count, done ); } );
+
+	uint32_t               reads    = 0;
+	uint32_t               failures = 0;
+	std::vector<TraceSpan> spans;
+	while ( !done || reads == 0 )
+	{
+		spans.clear();
+		ring->Read( spans );
+		reads++;
+
+		// never a mix of two spans, never out of order, never more than one lap of the ring
+		for ( size_t i = 0; i < spans.size(); i++ )
+		{
+			failures += IsWhole( spans[i] ) ? 0 : 1;
+			failures += i == 0 || spans[i].arg > spans[i - 1].arg ? 0 : 1;
+		}
+
+		if ( !spans.empty() )
+			failures += spans.back().arg - spans.front().arg < TraceRing::CAPACITY ? 0 : 1;
+	}
+	writer.join();
+
+	CHECK( failures == 0 );
+	CHECK( reads > 0 );
+
+	// once the writer is done every slot reads whole again
+	spans.clear();
+	ring->Read( spans );
+	REQUIRE( spans.size() == TraceRing::CAPACITY );
+	CHECK( spans.back().arg == count - 1 );
+}
+
+THEATER_TEST( tracerecorder, EveryThreadWritesItsOwnRing )
+{
+	static const char* const THREAD_NAMES[] = { "tracerecorder-a", "tracerecorder-b", "tracerecorder-c" };
+
+	// the threads are gone by the time their spans are read
+	std::vector<std::thread> threads;
+	for ( uint32_t t = 0; t < 3; t++ )
+	{
+		threads.emplace_back( [t]() {
+			SetTraceThreadName( THREAD_NAMES[t] );
+			for ( uint64_t i = 0; i < 1000; i++ )
+				RecordTraceSpan( NAMES[t], i, i + 1, t );
+		} );
+	}
+	for ( auto& thread : threads )
+		thread.join();
+
+	std::vector<TraceThread> traced;
+	ReadTraceThreads( traced );
+
+	std::vector<uint32_t> threadIds;
+	for ( const auto& thread : traced )
+	{
+		for ( uint32_t t = 0; t < 3; t++ )
+		{
+			if ( thread.threadName != THREAD_NAMES[t] )
+				continue;
+
+			threadIds.emplace_back( thread.threadId );
+			CHECK( thread.spans.size() == 1000 );
+			const bool own = std::all_of( thread.spans.begin(), thread.spans.end(),
+			                              [t]( const TraceSpan& span ) { return span.arg == t; } );
+			CHECK( own );
+		}
+	}
+
+	REQUIRE( threadIds.size() == 3 );
+	std::sort( threadIds.begin(), threadIds.end() );
+	CHECK( std::adjacent_find( threadIds.begin(), threadIds.end() ) == threadIds.end() );
+}
+
+THEATER_TEST( tracerecorder, ScopeOnlyRecordsWhileEnabled )
+{
+	static const char* const THREAD_NAME = "tracerecorder-scope";
+
+	std::thread thread( []() {
+		SetTraceThreadName( THREAD_NAME );
+		{
+			TraceScope trace( "disabled" );
+		}
+
+		EnableTracing( true );
+		{
+			TraceScope trace( "enabled", 42 );
+		}
+		EnableTracing( false );
+	} );
+	thread.join();
+
+	std::vector<TraceThread> traced;
+	ReadTraceThreads( traced );
+	const auto iter = std::find_if( traced.begin(), traced.end(),
+	                                []( const TraceThread& thread ) { return thread.threadName == THREAD_NAME; } );
+	REQUIRE( iter != traced.end() );
+	REQUIRE( iter->spans.size() == 1 );
+	CHECK( strcmp( iter->spans[0].name, "enabled" ) == 0 );
+	CHECK( iter->spans[0].arg == 42 );
+	CHECK( iter->spans[0].end >= iter->spans[0].start );
+}
+
+THEATER_BENCHMARK( tracerecorder, SpanOverhead )
+{
+	const uint64_t count = quick ? 10000 : 10000000;
+
+	// what every traced stage pays with tracing off, and with it on
+	{
+		const uint64_t start = GetTestTimeNanoseconds();
+		for ( uint64_t i = 0; i < count; i++ )
+			TraceScope trace( "benchmark", i );
+		const uint64_t elapsed = GetTestTimeNanoseconds() - start;
+
+		ReportBenchmark( "disabled scope", static_cast<double>( elapsed ) / count, "ns/span" );
+	}
+
+	std::thread thread( [count]() {
+		EnableTracing( true );
+		const uint64_t start = GetTestTimeNanoseconds();
+		for ( uint64_t i = 0; i < count; i++ )
+			TraceScope trace( "benchmark", i );
+		const uint64_t elapsed = GetTestTimeNanoseconds() - start;
+		EnableTracing( false );
+
+		ReportBenchmark( "enabled scope", static_cast<double>( elapsed ) / count, "ns/span" );
+	} );
+	thread.join();
+
+	// the ring alone, without the clock reads
+	{
+		auto           ring  = std::make_unique<TraceRing>( 1 );
+		const uint64_t start = GetTestTimeNanoseconds();
+		for ( uint64_t i = 0; i < count; i++ )
+			ring->Write( TraceSpan{ "benchmark", i, i, i } );
+		const uint64_t elapsed = GetTestTimeNanoseconds() - start;
+
+		std::vector<TraceSpan> spans;
+		const uint64_t         readStart = GetTestTimeNanoseconds();
+		ring->Read( spans );
+		const uint64_t readElapsed = GetTestTimeNanoseconds() - readStart;
+
+		KeepValue( spans.size() );
+		ReportBenchmark( "ring write", static_cast<double>( elapsed ) / count, "ns/span" );
+		ReportBenchmark( "ring read", static_cast<double>( readElapsed ) / spans.size(), "ns/span" );
+	}
+}
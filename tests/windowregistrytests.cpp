@@ -0,0 +1,243 @@
+#include "theater.h"
+#include "testing.h"
+#include <random>
+
+namespace Theater
+{
+	namespace
+	{
+		WindowRegistry* s_registry = nullptr;
+
+		void OnEvent( const WindowEvent& event )
+		{
+			s_registry->OnWindowEvent( event );
+		}
+
+		Platform::WindowId AddWindow( SimulatedDesktop& desktop, uint32_t pid, bool visible, bool child = false )
+		{
+			SimulatedDesktop::WindowParams params = {};
+			params.pid                            = pid;
+			params.rect                           = PlatformRect{ 0, 0, 100, 100 };
+			params.visible                        = visible;
+			params.child                          = child;
+			return desktop.AddWindow( params );
+		}
+
+		// Windows coming and going the way a busy desktop has them, tool windows and cloaked UWP frames included
+		struct EventStream
+		{
+			SimulatedDesktop                desktop;
+			std::vector<Platform::WindowId> windows;
+			std::mt19937                    random;
+			uint32_t                        pid;
+
+			explicit EventStream( uint32_t seed ) : random( seed )
+			{
+				this->pid = this->desktop.StartProcess( L"C:\\Games\\game.exe" );
+			}
+
+			void Step()
+			{
+				const uint32_t action = this->random() % 10;
+				if ( this->windows.empty() || action < 3 )
+				{
+					const bool child = this->random() % 5 == 0;
+					this->windows.emplace_back( AddWindow( this->desktop, this->pid, this->random() % 3 != 0, child ) );
+					if ( this->random() % 4 == 0 )
+						this->desktop.SetWindowCloaked( this->windows.back(), true );
+					return;
+				}
+
+				const size_t             index  = this->random() % this->windows.size();
+				const Platform::WindowId window = this->windows[index];
+				switch ( action )
+				{
+				case 3:
+				case 4:
+					this->desktop.DestroyWindow( window );
+					this->windows[index] = this->windows.back();
+					this->windows.pop_back();
+					break;
+				case 5:
+				case 6:
+					this->desktop.ShowWindow( window, !this->desktop.IsWindowVisible( window ) );
+					break;
+				case 7:
+				case 8:
+					this->desktop.SetWindowCloaked( window, !this->desktop.IsWindowCloaked( window ) );
+					break;
+				default:
+					this->desktop.SetForegroundWindow( window );
+					break;
+				}
+			}
+
+			std::vector<Platform::WindowId> GetVisibleWindows() const
+			{
+				std::vector<Platform::WindowId> visible;
+				for ( const auto window : this->windows )
+				{
+					if ( this->desktop.IsTopLevelWindow( window ) && this->desktop.IsWindowVisible( window ) &&
+					     !this->desktop.IsWindowCloaked( window ) )
+						visible.emplace_back( window );
+				}
+
+				std::sort( visible.begin(), visible.end() );
+				return visible;
+			}
+
+			size_t GetTopLevelCount() const
+			{
+				return static_cast<size_t>( std::count_if( this->windows.begin(), this->windows.end(),
+				                                           [this]( Platform::WindowId window )
+				                                           { return this->desktop.IsTopLevelWindow( window ); } ) );
+			}
+		};
+
+		std::vector<Platform::WindowId> GetSortedVisibleWindows( const WindowRegistry& registry )
+		{
+			std::vector<Platform::WindowId> visible = registry.GetVisibleWindows();
+			std::sort( visible.begin(), visible.end() );
+			return visible;
+		}
+	} // namespace
+} // namespace Theater
+
+using namespace Theater;
+
+THEATER_TEST( windowregistry, HiddenCloakedWindowStaysCloakedWhenShown )
+{
+	// a UWP frame suspended in the background, hidden and cloaked before the registry starts
+	SimulatedDesktop desktop;
+	const uint32_t   pid    = desktop.StartProcess( L"C:\\Windows\\ApplicationFrameHost.exe" );
+	const auto       window = AddWindow( desktop, pid, false );
+	desktop.SetWindowCloaked( window, true );
+
+	WindowRegistry registry;
+	s_registry = &registry;
+	registry.Init( &desktop );
+	desktop.StartEventHooks( &OnEvent );
+	CHECK( registry.Contains( window ) );
+
+	desktop.ShowWindow( window, true );
+	desktop.DispatchEvents();
+	CHECK( !registry.IsWindowVisible( window ) );
+	CHECK( registry.GetVisibleWindows().empty() );
+
+	desktop.SetWindowCloaked( window, false );
+	desktop.DispatchEvents();
+	CHECK( registry.IsWindowVisible( window ) );
+	CHECK( registry.GetVisibleWindows().size() == 1 );
+}
+
+THEATER_TEST( windowregistry, FollowsTheEventStream )
+{
+	for ( uint32_t seed = 0; seed < 20; seed++ )
+	{
+		// part of the desktop is there before the registry enumerates it
+		EventStream stream( seed );
+		for ( uint32_t i = 0; i < 200; i++ )
+			stream.Step();
+
+		WindowRegistry registry;
+		s_registry = &registry;
+		registry.Init( &stream.desktop );
+		stream.desktop.StartEventHooks( &OnEvent );
+
+		uint32_t mismatches = 0;
+		for ( uint32_t i = 0; i < 5000; i++ )
+		{
+			stream.Step();
+
+			// the hooks deliver late, several changes at once
+			if ( stream.random() % 4 != 0 )
+				continue;
+
+			stream.desktop.DispatchEvents();
+			mismatches += GetSortedVisibleWindows( registry ) != stream.GetVisibleWindows() ? 1 : 0;
+			mismatches += registry.GetCount() != stream.GetTopLevelCount() ? 1 : 0;
+		}
+		CHECK( mismatches == 0 );
+
+		stream.desktop.DispatchEvents();
+		for ( const auto window : stream.windows )
+			CHECK( registry.Contains( window ) == stream.desktop.IsTopLevelWindow( window ) );
+	}
+}
+
+THEATER_TEST( windowregistry, CloseForgetsEverything )
+{
+	EventStream stream( 99 );
+	for ( uint32_t i = 0; i < 100; i++ )
+		stream.Step();
+
+	WindowRegistry registry;
+	CHECK( !registry.IsInitialized() );
+	registry.Init( &stream.desktop );
+	CHECK( registry.IsInitialized() );
+	CHECK( registry.GetCount() == stream.GetTopLevelCount() );
+
+	registry.Close();
+	CHECK( !registry.IsInitialized() );
+	CHECK( registry.GetCount() == 0 );
+	CHECK( registry.GetVisibleWindows().empty() );
+
+	// events coming in after closing are dropped
+	registry.OnWindowCreated( stream.windows[0] );
+	registry.OnWindowShown( stream.windows[0], true );
+	CHECK( registry.GetCount() == 0 );
+}
+
+// What starting theater mode costs with a live registry against enumerating and querying every window, and what
+// keeping the registry live costs per event
+THEATER_BENCHMARK( windowregistry, Snapshot )
+{
+	const uint32_t runs = quick ? 100 : 10000;
+
+	// a few hundred windows, a good part of them hidden or cloaked
+	EventStream stream( 7 );
+	for ( uint32_t i = 0; i < 4000; i++ )
+		stream.Step();
+
+	WindowRegistry registry;
+	s_registry = &registry;
+	registry.Init( &stream.desktop );
+	stream.desktop.StartEventHooks( &OnEvent );
+	ReportBenchmark( "top level", static_cast<double>( registry.GetCount() ), "windows" );
+
+	uint64_t visible = 0;
+	uint64_t start   = GetTestTimeNanoseconds();
+	for ( uint32_t i = 0; i < runs; i++ )
+	{
+		std::vector<Platform::WindowId> windows;
+		stream.desktop.EnumTopLevelWindows( windows );
+		for ( const auto window : windows )
+		{
+			if ( stream.desktop.IsWindowVisible( window ) && !stream.desktop.IsWindowCloaked( window ) )
+				visible++;
+		}
+	}
+	ReportBenchmark( "enumerate", ( GetTestTimeNanoseconds() - start ) / 1e3 / runs, "us" );
+
+	// a change between activations has the snapshot rebuilt once
+	const auto toggled = registry.GetVisibleWindows().front();
+	start              = GetTestTimeNanoseconds();
+	for ( uint32_t i = 0; i < runs; i++ )
+	{
+		registry.OnWindowCloaked( toggled, i % 2 == 0 );
+		visible += registry.GetVisibleWindows().size();
+	}
+	ReportBenchmark( "snapshot", ( GetTestTimeNanoseconds() - start ) / 1e3 / runs, "us" );
+
+	uint64_t events = 0;
+	start           = GetTestTimeNanoseconds();
+	for ( uint32_t i = 0; i < runs; i++ )
+	{
+		stream.Step();
+		events += stream.desktop.DispatchEvents();
+	}
+	const uint64_t elapsed = GetTestTimeNanoseconds() - start;
+
+	KeepValue( visible );
+	ReportBenchmark( "event", static_cast<double>( elapsed ) / std::max<uint64_t>( events, 1 ), "ns" );
+}
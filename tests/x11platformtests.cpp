@@ -0,0 +1,641 @@
+#include "theater.h"
+#include "testing.h"
+#include <X11/Xatom.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace Theater
+{
+	namespace
+	{
+		constexpr uint64_t WAIT_NANOSECONDS = 5000000000ull;
+
+		// An Xvfb server of its own for every test, it picks a free display and reports it through -displayfd
+		// once it accepts connections
+		class XvfbServer
+		{
+		public:
+			XvfbServer()
+			{
+				// X11Platform::Open calls it too, but it has to come before the first connection of the process
+				XInitThreads();
+
+				const char* executable = getenv( "THEATER_XVFB" );
+				if ( executable == nullptr || executable[0] == 0 )
+					executable = "Xvfb";
+
+				int ready[2] = {};
+				if ( pipe( ready ) != 0 )
+					return;
+
+				this->pid = fork();
+				if ( this->pid == 0 )
+				{
+					close( ready[0] );
+					const std::string displayFd = std::to_string( ready[1] );
+					execlp( executable, executable, "-displayfd", displayFd.c_str(), "-screen", "0", "1920x1080x24",
+					        "-nolisten", "tcp", "-noreset", static_cast<char*>( nullptr ) );
+					_exit( 127 );
+				}
+
+				close( ready[1] );
+				std::string number;
+				pollfd      pipeFd = { ready[0], POLLIN, 0 };
+				while ( this->pid > 0 && poll( &pipeFd, 1, static_cast<int>( WAIT_NANOSECONDS / 1000000 ) ) > 0 )
+				{
+					char       c      = 0;
+					const auto length = read( ready[0], &c, 1 );
+					if ( length <= 0 || c == '\n' )
+						break;
+					number += c;
+				}
+				close( ready[0] );
+
+				if ( !number.empty() )
+					this->display = ":" + number;
+			}
+
+			~XvfbServer()
+			{
+				if ( this->pid <= 0 )
+					return;
+
+				kill( this->pid, SIGTERM );
+				waitpid( this->pid, nullptr, 0 );
+			}
+
+			bool IsRunning() const
+			{
+				return !this->display.empty();
+			}
+
+			const char* GetDisplay() const
+			{
+				return this->display.c_str();
+			}
+
+		private:
+			pid_t       pid = -1;
+			std::string display;
+		};
+
+		// A process for test windows to claim through _NET_WM_PID, our own windows are never reported.
+		// Without a program it is a fork of the tests, so its executable is theirs. Once constructed the program
+		// runs, the pipe is closed by the exec.
+		class ChildProcess
+		{
+		public:
+			explicit ChildProcess( const char* program )
+			{
+				int started[2] = {};
+				if ( pipe2( started, O_CLOEXEC ) != 0 )
+					return;
+
+				this->pid = fork();
+				if ( this->pid == 0 )
+				{
+					close( started[0] );
+					if ( program != nullptr )
+						execl( program, program, "60", static_cast<char*>( nullptr ) );
+
+					close( started[1] );
+					pause();
+					_exit( 0 );
+				}
+
+				close( started[1] );
+				char c = 0;
+				while ( this->pid > 0 && read( started[0], &c, 1 ) > 0 )
+				{
+				}
+				close( started[0] );
+			}
+
+			~ChildProcess()
+			{
+				if ( this->pid <= 0 )
+					return;
+
+				kill( this->pid, SIGKILL );
+				waitpid( this->pid, nullptr, 0 );
+			}
+
+			uint32_t GetPid() const
+			{
+				return static_cast<uint32_t>( this->pid );
+			}
+
+		private:
+			pid_t pid = -1;
+		};
+
+		// Plays the EWMH window manager on a connection of its own, Xvfb has none. Clients get WM_STATE and
+		// _NET_WM_PID, the root _NET_CLIENT_LIST and _NET_ACTIVE_WINDOW, and _NET_RESTACK_WINDOW requests are obeyed.
+		class WindowManager
+		{
+		public:
+			explicit WindowManager( const char* displayName )
+			{
+				this->display = XOpenDisplay( displayName );
+				if ( this->display == nullptr )
+					return;
+
+				this->root = DefaultRootWindow( this->display );
+				XSelectInput( this->display, this->root, SubstructureNotifyMask );
+				XSync( this->display, False );
+			}
+
+			~WindowManager()
+			{
+				if ( this->display != nullptr )
+					XCloseDisplay( this->display );
+			}
+
+			bool IsOpen() const
+			{
+				return this->display != nullptr;
+			}
+
+			// Unlisted clients are mapped but left out of _NET_CLIENT_LIST
+			Window AddClient( uint32_t pid, const PlatformRect& rect, const char* name, bool listed = true )
+			{
+				const unsigned int width  = static_cast<unsigned int>( rect.right - rect.left );
+				const unsigned int height = static_cast<unsigned int>( rect.bottom - rect.top );
+				const Window       window =
+				    XCreateSimpleWindow( this->display, this->root, rect.left, rect.top, width, height, 0, 0, 0 );
+				XStoreName( this->display, window, name );
+
+				const long state[2] = { NormalState, None };
+				XChangeProperty( this->display, window, GetAtom( "WM_STATE" ), GetAtom( "WM_STATE" ), 32,
+				                 PropModeReplace, reinterpret_cast<const unsigned char*>( state ), 2 );
+				const long windowPid = static_cast<long>( pid );
+				XChangeProperty( this->display, window, GetAtom( "_NET_WM_PID" ), XA_CARDINAL, 32, PropModeReplace,
+				                 reinterpret_cast<const unsigned char*>( &windowPid ), 1 );
+				XMapWindow( this->display, window );
+				XSync( this->display, False );
+
+				if ( listed )
+				{
+					this->clients.emplace_back( window );
+					UpdateClientList();
+				}
+				return window;
+			}
+
+			void RemoveClient( Window window )
+			{
+				this->clients.erase( std::remove( this->clients.begin(), this->clients.end(), window ),
+				                     this->clients.end() );
+				UpdateClientList();
+				XDestroyWindow( this->display, window );
+				XSync( this->display, False );
+			}
+
+			void Activate( Window window )
+			{
+				const long active = static_cast<long>( window );
+				XChangeProperty( this->display, this->root, GetAtom( "_NET_ACTIVE_WINDOW" ), XA_WINDOW, 32,
+				                 PropModeReplace, reinterpret_cast<const unsigned char*>( &active ), 1 );
+				XSync( this->display, False );
+			}
+
+			void Move( Window window, int x, int y )
+			{
+				XMoveWindow( this->display, window, x, y );
+				XSync( this->display, False );
+			}
+
+			// What a window manager would do with the restack requests sent so far
+			void Serve()
+			{
+				XSync( this->display, False );
+				while ( XPending( this->display ) > 0 )
+				{
+					XEvent event;
+					XNextEvent( this->display, &event );
+					if ( event.type != ClientMessage || event.xclient.message_type != GetAtom( "_NET_RESTACK_WINDOW" ) )
+						continue;
+
+					XWindowChanges changes = {};
+					changes.sibling        = static_cast<Window>( event.xclient.data.l[1] );
+					changes.stack_mode     = static_cast<int>( event.xclient.data.l[2] );
+					XConfigureWindow( this->display, event.xclient.window,
+					                  changes.sibling != None ? CWSibling | CWStackMode : CWStackMode, &changes );
+				}
+				XSync( this->display, False );
+			}
+
+			// Position of window among the children of the root, bottom to top, -1 when it isn't one
+			int GetStackingIndex( Window window ) const
+			{
+				Window       rootWindow = None;
+				Window       parent     = None;
+				Window*      children   = nullptr;
+				unsigned int count      = 0;
+				if ( !XQueryTree( this->display, this->root, &rootWindow, &parent, &children, &count ) )
+					return -1;
+
+				int index = -1;
+				for ( unsigned int i = 0; i < count; i++ )
+				{
+					if ( children[i] == window )
+						index = static_cast<int>( i );
+				}
+
+				if ( children != nullptr )
+					XFree( children );
+				return index;
+			}
+
+			bool IsMapped( Window window ) const
+			{
+				XWindowAttributes attributes = {};
+				return XGetWindowAttributes( this->display, window, &attributes ) != 0 &&
+				       attributes.map_state != IsUnmapped;
+			}
+
+			unsigned long GetOpacity( Window window ) const
+			{
+				Atom           actualType   = None;
+				int            actualFormat = 0;
+				unsigned long  count        = 0;
+				unsigned long  bytesAfter   = 0;
+				unsigned char* data         = nullptr;
+				unsigned long  opacity      = 0;
+				if ( XGetWindowProperty( this->display, window, GetAtom( "_NET_WM_WINDOW_OPACITY" ), 0, 1, False,
+				                         XA_CARDINAL, &actualType, &actualFormat, &count, &bytesAfter,
+				                         &data ) == Success &&
+				     data != nullptr )
+				{
+					if ( count == 1 && actualFormat == 32 )
+						opacity = reinterpret_cast<const unsigned long*>( data )[0];
+					XFree( data );
+				}
+
+				return opacity;
+			}
+
+		private:
+			Atom GetAtom( const char* name ) const
+			{
+				return XInternAtom( this->display, name, False );
+			}
+
+			void UpdateClientList()
+			{
+				std::vector<long> list( this->clients.begin(), this->clients.end() );
+				XChangeProperty( this->display, this->root, GetAtom( "_NET_CLIENT_LIST" ), XA_WINDOW, 32,
+				                 PropModeReplace, reinterpret_cast<const unsigned char*>( list.data() ),
+				                 static_cast<int>( list.size() ) );
+				XSync( this->display, False );
+			}
+
+		private:
+			Display*            display = nullptr;
+			Window              root    = None;
+			std::vector<Window> clients;
+		};
+
+		// The hook callback is a plain function, like the app's, so the events it gets are kept in a global
+		std::vector<WindowEvent> s_events;
+
+		void OnEvent( const WindowEvent& event )
+		{
+			s_events.emplace_back( event );
+		}
+
+		// Everything the server sent for requests made so far, the window manager synced its own already
+		void Settle( X11Platform& platform )
+		{
+			XSync( platform.GetDisplay(), False );
+			platform.DispatchEvents();
+		}
+
+		bool HasEvent( WindowEventType type, Platform::WindowId window )
+		{
+			return std::any_of( s_events.begin(), s_events.end(), [type, window]( const WindowEvent& event ) {
+				return event.type == type && event.window == window;
+			} );
+		}
+
+		// Steps the app until done says so or the wait is over, the window manager serves restacks in between
+		template<typename Done>
+		bool StepUntil( X11App& app, WindowManager& windowManager, Done done )
+		{
+			const uint64_t deadline = GetTestTimeNanoseconds() + WAIT_NANOSECONDS;
+			while ( !done() )
+			{
+				if ( GetTestTimeNanoseconds() > deadline )
+					return false;
+
+				app.Step( std::min<uint32_t>( app.GetTimeout(), 10 ) );
+				windowManager.Serve();
+			}
+
+			return true;
+		}
+	} // namespace
+} // namespace Theater
+
+using namespace Theater;
+
+THEATER_TEST( x11platform, MonitorsComeFromXRandR )
+{
+	XvfbServer server;
+	REQUIRE( server.IsRunning() );
+
+	X11Platform platform;
+	REQUIRE( platform.Open( server.GetDisplay() ) );
+	CHECK( platform.IsOpen() );
+	CHECK( platform.GetConnectionNumber() >= 0 );
+
+	// Xvfb's single screen is its single XRandR monitor
+	std::vector<PlatformMonitor> monitors;
+	platform.EnumMonitors( monitors );
+	REQUIRE( monitors.size() == 1 );
+	CHECK( monitors[0].rect.left == 0 );
+	CHECK( monitors[0].rect.top == 0 );
+	CHECK( monitors[0].rect.right == 1920 );
+	CHECK( monitors[0].rect.bottom == 1080 );
+	CHECK( !monitors[0].device.empty() );
+
+	platform.Close();
+	CHECK( !platform.IsOpen() );
+	CHECK( platform.GetConnectionNumber() == -1 );
+}
+
+THEATER_TEST( x11platform, ClientListChangesAreReported )
+{
+	XvfbServer server;
+	REQUIRE( server.IsRunning() );
+	WindowManager windowManager( server.GetDisplay() );
+	REQUIRE( windowManager.IsOpen() );
+	ChildProcess child( nullptr );
+
+	X11Platform platform;
+	REQUIRE( platform.Open( server.GetDisplay() ) );
+
+	// clients already listed are the starting point
+	const Window before = windowManager.AddClient( child.GetPid(), PlatformRect{ 0, 0, 100, 100 }, "before" );
+	s_events.clear();
+	REQUIRE( platform.StartEventHooks( OnEvent ) );
+
+	std::vector<Platform::WindowId> windows;
+	platform.EnumTopLevelWindows( windows );
+	CHECK( windows.size() == 1 && windows[0] == before );
+	CHECK( platform.IsTopLevelWindow( before ) );
+	CHECK( platform.IsWindowVisible( before ) );
+	CHECK( platform.GetWindowProcessId( before ) == child.GetPid() );
+
+	const Window added = windowManager.AddClient( child.GetPid(), PlatformRect{ 100, 100, 300, 300 }, "added" );
+	Settle( platform );
+	CHECK( HasEvent( WindowEventType::Created, added ) );
+	CHECK( HasEvent( WindowEventType::Shown, added ) );
+	CHECK( !HasEvent( WindowEventType::Created, before ) );
+
+	wchar_t title[32] = {};
+	CHECK( platform.GetWindowTitle( added, title, 32 ) == 5 );
+	CHECK( wcscmp( title, L"added" ) == 0 );
+
+	PlatformRect rect = {};
+	REQUIRE( platform.GetWindowRect( added, rect ) );
+	CHECK( rect.left == 100 && rect.top == 100 && rect.right == 300 && rect.bottom == 300 );
+
+	// the process's own windows are left out, like the Win32 hooks do
+	s_events.clear();
+	const uint32_t ownPid = static_cast<uint32_t>( getpid() );
+	const Window   own    = windowManager.AddClient( ownPid, PlatformRect{ 0, 0, 50, 50 }, "own" );
+	Settle( platform );
+	CHECK( s_events.empty() );
+
+	windowManager.RemoveClient( added );
+	Settle( platform );
+	CHECK( HasEvent( WindowEventType::Destroyed, added ) );
+	CHECK( !HasEvent( WindowEventType::Destroyed, before ) );
+
+	// nothing once the hooks are gone
+	platform.StopEventHooks();
+	s_events.clear();
+	windowManager.RemoveClient( before );
+	windowManager.RemoveClient( own );
+	Settle( platform );
+	CHECK( s_events.empty() );
+}
+
+THEATER_TEST( x11platform, ActiveWindowIsTheForeground )
+{
+	XvfbServer server;
+	REQUIRE( server.IsRunning() );
+	WindowManager windowManager( server.GetDisplay() );
+	REQUIRE( windowManager.IsOpen() );
+	ChildProcess child( nullptr );
+
+	X11Platform platform;
+	REQUIRE( platform.Open( server.GetDisplay() ) );
+	const Window first  = windowManager.AddClient( child.GetPid(), PlatformRect{ 0, 0, 100, 100 }, "first" );
+	const Window second = windowManager.AddClient( child.GetPid(), PlatformRect{ 0, 0, 100, 100 }, "second" );
+	REQUIRE( platform.StartEventHooks( OnEvent ) );
+	s_events.clear();
+
+	windowManager.Activate( first );
+	Settle( platform );
+	REQUIRE( s_events.size() == 1 );
+	CHECK( s_events[0].type == WindowEventType::Foreground );
+	CHECK( s_events[0].window == first );
+
+	windowManager.Activate( second );
+	Settle( platform );
+	REQUIRE( s_events.size() == 2 );
+	CHECK( s_events[1].type == WindowEventType::Foreground );
+	CHECK( s_events[1].window == second );
+
+	// a window manager may activate a window before it lists it
+	s_events.clear();
+	const Window unlisted = windowManager.AddClient( child.GetPid(), PlatformRect{ 0, 0, 100, 100 }, "new", false );
+	windowManager.Activate( unlisted );
+	Settle( platform );
+	CHECK( HasEvent( WindowEventType::Foreground, unlisted ) );
+}
+
+THEATER_TEST( x11platform, LocationHookFollowsOnlyTheTrackedProcess )
+{
+	XvfbServer server;
+	REQUIRE( server.IsRunning() );
+	WindowManager windowManager( server.GetDisplay() );
+	REQUIRE( windowManager.IsOpen() );
+	ChildProcess game( nullptr );
+	ChildProcess other( "/bin/sleep" );
+
+	X11Platform platform;
+	REQUIRE( platform.Open( server.GetDisplay() ) );
+	CHECK( !platform.StartLocationHook( game.GetPid() ) );
+	REQUIRE( platform.StartEventHooks( OnEvent ) );
+
+	const Window target = windowManager.AddClient( game.GetPid(), PlatformRect{ 0, 0, 800, 600 }, "game" );
+	const Window window = windowManager.AddClient( other.GetPid(), PlatformRect{ 0, 0, 800, 600 }, "other" );
+	Settle( platform );
+
+	// moves are only reported while the hook is on, and only for windows of its process
+	s_events.clear();
+	windowManager.Move( target, 10, 10 );
+	Settle( platform );
+	CHECK( s_events.empty() );
+
+	REQUIRE( platform.StartLocationHook( game.GetPid() ) );
+	windowManager.Move( target, 20, 20 );
+	windowManager.Move( window, 20, 20 );
+	Settle( platform );
+	REQUIRE( s_events.size() == 1 );
+	CHECK( s_events[0].type == WindowEventType::LocationChanged );
+	CHECK( s_events[0].window == target );
+
+	PlatformRect rect = {};
+	REQUIRE( platform.GetWindowRect( target, rect ) );
+	CHECK( rect.left == 20 && rect.top == 20 );
+
+	platform.StopLocationHook();
+	s_events.clear();
+	windowManager.Move( target, 30, 30 );
+	Settle( platform );
+	CHECK( s_events.empty() );
+}
+
+THEATER_TEST( x11platform, ProcessesAreReadFromProc )
+{
+	ChildProcess child( nullptr );
+	ChildProcess sleeper( "/bin/sleep" );
+	X11Platform  platform;
+
+	// the fork runs the tests' executable, the other one was replaced by sleep
+	std::wstring path;
+	std::wstring name;
+	REQUIRE( platform.QueryProcessPath( static_cast<uint32_t>( getpid() ), path, name ) );
+	const std::wstring ownName = name;
+	CHECK( !path.empty() && path[0] == L'/' );
+	REQUIRE( platform.QueryProcessPath( child.GetPid(), path, name ) );
+	CHECK( name == ownName );
+	REQUIRE( platform.QueryProcessPath( sleeper.GetPid(), path, name ) );
+	CHECK( name == L"sleep" );
+
+	// the start time tells instances apart, it stays the same for the same one
+	ProcessCache::ProcessId first  = {};
+	ProcessCache::ProcessId second = {};
+	REQUIRE( platform.QueryProcessId( child.GetPid(), first ) );
+	REQUIRE( platform.QueryProcessId( child.GetPid(), second ) );
+	CHECK( first.pid == child.GetPid() );
+	CHECK( first.creationTime == second.creationTime );
+
+	CHECK( !platform.QueryProcessId( 0, first ) );
+	CHECK( !platform.QueryProcessPath( 0, path, name ) );
+}
+
+THEATER_TEST( x11platform, DimmerCoversEveryMonitor )
+{
+	XvfbServer server;
+	REQUIRE( server.IsRunning() );
+	WindowManager windowManager( server.GetDisplay() );
+	REQUIRE( windowManager.IsOpen() );
+
+	X11Platform platform;
+	REQUIRE( platform.Open( server.GetDisplay() ) );
+	REQUIRE( platform.StartEventHooks( OnEvent ) );
+	s_events.clear();
+
+	X11Dimmer dimmer;
+	REQUIRE( dimmer.Init( &platform ) );
+	std::vector<PlatformMonitor> monitors;
+	platform.EnumMonitors( monitors );
+	REQUIRE( dimmer.GetWindowCount() == monitors.size() );
+
+	for ( size_t i = 0; i < dimmer.GetWindowCount(); i++ )
+	{
+		const Platform::WindowId window = dimmer.GetWindow( i );
+		CHECK( dimmer.IsDimmerWindow( window ) );
+		CHECK( !platform.IsTopLevelWindow( window ) );
+
+		PlatformRect rect = {};
+		REQUIRE( platform.GetWindowRect( window, rect ) );
+		CHECK( rect.left == monitors[i].rect.left && rect.right == monitors[i].rect.right );
+		CHECK( rect.top == monitors[i].rect.top && rect.bottom == monitors[i].rect.bottom );
+	}
+
+	// alpha goes through the opacity property, a deeper fade is more opaque
+	const Window window = static_cast<Window>( dimmer.GetWindow( 0 ) );
+	dimmer.SetLevels( 200, std::vector<MonitorLevel>() );
+	dimmer.SetAlpha( 0.25f );
+	dimmer.Show( true );
+	XSync( platform.GetDisplay(), False );
+	CHECK( windowManager.IsMapped( window ) );
+	const unsigned long quarter = windowManager.GetOpacity( window );
+	dimmer.SetAlpha( 200 / 255.0f );
+	XSync( platform.GetDisplay(), False );
+	CHECK( windowManager.GetOpacity( window ) > quarter );
+
+	dimmer.Show( false );
+	XSync( platform.GetDisplay(), False );
+	CHECK( !windowManager.IsMapped( window ) );
+
+	// override-redirect windows of our own, the hooks never see them
+	Settle( platform );
+	CHECK( s_events.empty() );
+	dimmer.Close();
+	CHECK( dimmer.GetWindowCount() == 0 );
+}
+
+THEATER_TEST( x11platform, AppDimsAroundTheTarget )
+{
+	XvfbServer server;
+	REQUIRE( server.IsRunning() );
+	WindowManager windowManager( server.GetDisplay() );
+	REQUIRE( windowManager.IsOpen() );
+	ChildProcess game( nullptr );
+	ChildProcess other( "/bin/sleep" );
+
+	const Window background = windowManager.AddClient( other.GetPid(), PlatformRect{ 0, 0, 1920, 1080 }, "desktop" );
+	const Window target     = windowManager.AddClient( game.GetPid(), PlatformRect{ 100, 100, 900, 700 }, "game" );
+
+	// the tests' executable is the target, a fork of it is what owns the game window
+	std::wstring path;
+	std::wstring name;
+	X11Platform  platform;
+	REQUIRE( platform.QueryProcessPath( game.GetPid(), path, name ) );
+
+	SettingsData settings;
+	settings.processNames.Add( name );
+	settings.fadeDuration = 50;
+
+	X11App app;
+	REQUIRE( app.Init( server.GetDisplay(), settings ) );
+	REQUIRE( app.GetDimmer().GetWindowCount() == 1 );
+	const Window dimmerWindow = static_cast<Window>( app.GetDimmer().GetWindow( 0 ) );
+	CHECK( !app.IsDimmerShown() );
+
+	// the game comes to the front, the dimmer fades in between it and the rest
+	windowManager.Activate( target );
+	CHECK( StepUntil( app, windowManager, [&app]() { return app.IsTheaterShown() && !app.GetFade().IsRunning(); } ) );
+	CHECK( app.GetTarget() == target );
+	CHECK( app.IsDimmerShown() );
+	CHECK( windowManager.IsMapped( dimmerWindow ) );
+	CHECK( windowManager.GetOpacity( dimmerWindow ) > 0 );
+	CHECK( windowManager.GetStackingIndex( target ) > windowManager.GetStackingIndex( dimmerWindow ) );
+	CHECK( windowManager.GetStackingIndex( dimmerWindow ) > windowManager.GetStackingIndex( background ) );
+	CHECK( app.GetTracker().GetWindow() == target );
+
+	// the target is followed while the session is on
+	windowManager.Move( target, 200, 200 );
+	CHECK( StepUntil( app, windowManager, [&app]() { return app.GetTracker().GetRect().left == 200; } ) );
+
+	// focus goes elsewhere, the dimmer fades out and is hidden
+	windowManager.Activate( background );
+	CHECK( StepUntil( app, windowManager, [&app]() { return !app.IsDimmerShown(); } ) );
+	CHECK( !app.IsTheaterShown() );
+	CHECK( app.GetTarget() == Platform::NO_WINDOW );
+	CHECK( !windowManager.IsMapped( dimmerWindow ) );
+
+	app.Close();
+}
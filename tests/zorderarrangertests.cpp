@@ -0,0 +1,288 @@
+#include "theater.h"
+#include "testing.h"
+#include <cstdio>
+#include <random>
+
+namespace Theater
+{
+	namespace
+	{
+		const PlatformRect LEFT_MONITOR  = { 0, 0, 1920, 1080 };
+		const PlatformRect RIGHT_MONITOR = { 1920, 0, 3840, 1080 };
+
+		// Two monitors with a dimmer each, windows are added on top of what's there
+		struct ArrangedDesktop
+		{
+			SimulatedDesktop          desktop;
+			WindowRegistry            registry;
+			ZOrderArranger            arranger;
+			std::vector<ZOrderDimmer> dimmers;
+			uint32_t                  self = 0;
+			uint32_t                  pid  = 0;
+
+			ArrangedDesktop()
+			{
+				this->self = this->desktop.StartProcess( L"theater.exe" );
+				this->pid  = this->desktop.StartProcess( L"apps.exe" );
+				this->desktop.SetCurrentProcess( this->self );
+				this->desktop.AddMonitor( L"\\\\.\\DISPLAY1", LEFT_MONITOR );
+				this->desktop.AddMonitor( L"\\\\.\\DISPLAY2", RIGHT_MONITOR );
+			}
+
+			Platform::WindowId AddWindow( const PlatformRect& rect, bool topmost = false )
+			{
+				SimulatedDesktop::WindowParams params = {};
+				params.pid                            = this->pid;
+				params.rect                           = rect;
+				params.topmost                        = topmost;
+				return this->desktop.AddWindow( params );
+			}
+
+			void AddDimmers()
+			{
+				for ( const auto& monitor : { LEFT_MONITOR, RIGHT_MONITOR } )
+				{
+					SimulatedDesktop::WindowParams params = {};
+					params.pid                            = this->self;
+					params.rect                           = monitor;
+					this->dimmers.emplace_back( ZOrderDimmer{ this->desktop.AddWindow( params ), monitor } );
+				}
+
+				this->arranger.SetDimmers( this->dimmers );
+			}
+
+			ZOrderStrategy Arrange( Platform::WindowId target, const std::vector<Platform::WindowId>& companions )
+			{
+				this->registry.Init( &this->desktop );
+				return this->arranger.Arrange( this->desktop, target, companions, this->registry, nullptr );
+			}
+
+			size_t IndexOf( Platform::WindowId window ) const
+			{
+				const auto& zOrder = this->desktop.GetZOrder();
+				return static_cast<size_t>( std::find( zOrder.begin(), zOrder.end(), window ) - zOrder.begin() );
+			}
+		};
+
+		uint64_t GetMonitors( const ArrangedDesktop& arranged, Platform::WindowId window )
+		{
+			PlatformRect rect = {};
+			arranged.desktop.GetWindowRect( window, rect );
+
+			uint64_t monitors = 0;
+			for ( size_t i = 0; i < arranged.dimmers.size(); i++ )
+			{
+				if ( IntersectPlatformRects( rect, arranged.dimmers[i].monitor ) )
+					monitors |= 1ull << i;
+			}
+
+			return monitors;
+		}
+
+		// The target and its companions are above every dimmer, and every dimmer is above every other window of its
+		// monitor. Topmost windows have a band of their own and windows owned by the target always stay above it,
+		// both are left out.
+		bool IsArranged( const ArrangedDesktop& arranged, Platform::WindowId target,
+		                 const std::vector<Platform::WindowId>& companions )
+		{
+			const auto& desktop = arranged.desktop;
+			for ( size_t i = 0; i < arranged.dimmers.size(); i++ )
+			{
+				const auto   dimmer      = arranged.dimmers[i].window;
+				const size_t dimmerIndex = arranged.IndexOf( dimmer );
+				if ( arranged.IndexOf( target ) > dimmerIndex )
+					return false;
+
+				for ( const auto window : desktop.GetZOrder() )
+				{
+					if ( window == target || !desktop.IsWindowVisible( window ) )
+						continue;
+
+					const auto isWindow    = [window]( const ZOrderDimmer& other ) { return other.window == window; };
+					const bool isDimmer    = std::any_of( arranged.dimmers.begin(), arranged.dimmers.end(), isWindow );
+					const bool isCompanion = std::binary_search( companions.begin(), companions.end(), window );
+					if ( isCompanion && arranged.IndexOf( window ) > dimmerIndex )
+						return false;
+
+					if ( isDimmer || isCompanion || desktop.IsWindowTopmost( window ) ||
+					     desktop.GetWindowOwner( window ) == target )
+						continue;
+
+					const bool overlaps = ( GetMonitors( arranged, window ) & ( 1ull << i ) ) != 0;
+					if ( overlaps && arranged.IndexOf( window ) < dimmerIndex )
+						return false;
+				}
+			}
+
+			return true;
+		}
+
+		// Random windows over, across and off both monitors, the dimmers and the target shuffled in among them
+		void BuildRandomDesktop( std::mt19937& random, ArrangedDesktop& arranged, Platform::WindowId& target,
+		                         std::vector<Platform::WindowId>& companions )
+		{
+			std::uniform_int_distribution<int32_t>  pickX( -600, 3800 );
+			std::uniform_int_distribution<int32_t>  pickY( -300, 1000 );
+			std::uniform_int_distribution<int32_t>  pickSize( 50, 2400 );
+			std::uniform_int_distribution<uint32_t> pickPercent( 0, 99 );
+			std::uniform_int_distribution<uint32_t> pickCount( 0, 12 );
+
+			arranged.AddDimmers();
+			target = arranged.AddWindow( { pickX( random ), pickY( random ), 0, 0 } );
+			PlatformRect targetRect = {};
+			arranged.desktop.GetWindowRect( target, targetRect );
+			targetRect.right  = targetRect.left + pickSize( random );
+			targetRect.bottom = targetRect.top + pickSize( random );
+			arranged.desktop.SetWindowRect( target, targetRect );
+
+			std::vector<Platform::WindowId> shuffled = { target, arranged.dimmers[0].window,
+				                                         arranged.dimmers[1].window };
+			const uint32_t                  count    = pickCount( random );
+			for ( uint32_t i = 0; i < count; i++ )
+			{
+				const int32_t x = pickX( random );
+				const int32_t y = pickY( random );
+
+				SimulatedDesktop::WindowParams params = {};
+				params.pid                            = arranged.pid;
+				params.rect                           = { x, y, x + pickSize( random ), y + pickSize( random ) };
+				params.topmost                        = pickPercent( random ) < 10;
+				params.owner                          = pickPercent( random ) < 10 ? target : Platform::NO_WINDOW;
+
+				const auto window = arranged.desktop.AddWindow( params );
+				if ( pickPercent( random ) < 10 )
+					arranged.desktop.ShowWindow( window, false );
+				if ( pickPercent( random ) < 20 )
+					companions.emplace_back( window );
+				if ( !params.topmost )
+					shuffled.emplace_back( window );
+			}
+
+			// only within the band of the windows that aren't topmost, moving one doesn't change its band
+			for ( int pass = 0; pass < 3; pass++ )
+			{
+				for ( const auto window : shuffled )
+				{
+					std::uniform_int_distribution<size_t> pickAnchor( 0, shuffled.size() - 1 );
+					const auto                            anchor = shuffled[pickAnchor( random )];
+					arranged.desktop.MoveWindowsBelow( anchor, &window, 1 );
+				}
+			}
+
+			if ( pickPercent( random ) < 25 )
+				arranged.desktop.SetForegroundWindow( target );
+
+			std::sort( companions.begin(), companions.end() );
+		}
+	} // namespace
+} // namespace Theater
+
+using namespace Theater;
+
+THEATER_TEST( zorderarranger, DimmersRightBelowTheTargetStayPut )
+{
+	ArrangedDesktop arranged;
+	const auto      other = arranged.AddWindow( LEFT_MONITOR );
+	arranged.AddDimmers();
+
+	// new windows go on top, the target lands right above the dimmers
+	const auto target = arranged.AddWindow( LEFT_MONITOR );
+	CHECK( arranged.Arrange( target, {} ) == ZOrderStrategy::None );
+	CHECK( arranged.desktop.GetZOrderMoveCount() == 0 );
+	CHECK( arranged.IndexOf( other ) == 3 );
+}
+
+THEATER_TEST( zorderarranger, TargetOnTopGetsTheDimmersSlottedBelow )
+{
+	ArrangedDesktop arranged;
+	arranged.AddDimmers();
+	const auto other  = arranged.AddWindow( RIGHT_MONITOR );
+	const auto target = arranged.AddWindow( LEFT_MONITOR );
+
+	CHECK( arranged.Arrange( target, {} ) == ZOrderStrategy::InsertBelowTarget );
+	const std::vector<Platform::WindowId> expected = { target, arranged.dimmers[0].window,
+		                                               arranged.dimmers[1].window, other };
+	CHECK( arranged.desktop.GetZOrder() == expected );
+}
+
+THEATER_TEST( zorderarranger, OnlyWindowsCoveringTheTargetArePushedDown )
+{
+	ArrangedDesktop arranged;
+	const auto      target = arranged.AddWindow( LEFT_MONITOR );
+	arranged.AddDimmers();
+	arranged.desktop.SetForegroundWindow( target );
+	const auto covering  = arranged.AddWindow( { 100, 100, 500, 500 } );
+	const auto offscreen = arranged.AddWindow( { -900, -900, -800, -800 } );
+
+	CHECK( arranged.Arrange( target, {} ) == ZOrderStrategy::PushToBottom );
+	CHECK( arranged.desktop.GetZOrder().back() == covering );
+	CHECK( arranged.IndexOf( offscreen ) < arranged.IndexOf( target ) );
+	CHECK( arranged.arranger.GetSavedMoves() == 1 );
+}
+
+THEATER_TEST( zorderarranger, HiddenCompanionsAreLeftOut )
+{
+	ArrangedDesktop arranged;
+	const auto      companion = arranged.AddWindow( RIGHT_MONITOR );
+	arranged.AddDimmers();
+	const auto hidden = arranged.AddWindow( RIGHT_MONITOR );
+	const auto target    = arranged.AddWindow( LEFT_MONITOR );
+	arranged.desktop.ShowWindow( hidden, false );
+
+	// a hidden window in the batch would fail it, the visible companion still has to make it above the dimmers
+	CHECK( arranged.Arrange( target, { companion, hidden } ) == ZOrderStrategy::InsertBelowTarget );
+	CHECK( arranged.IndexOf( companion ) == 1 );
+	CHECK( arranged.IndexOf( arranged.dimmers[0].window ) == 2 );
+}
+
+THEATER_TEST( zorderarranger, DimmerAboveTheTargetEndsBelowIt )
+{
+	// [dimmer, X, target] on one monitor, pushing X down alone would leave the target dimmed
+	ArrangedDesktop arranged;
+	arranged.AddDimmers();
+	const auto target = arranged.AddWindow( LEFT_MONITOR );
+	const auto other  = arranged.AddWindow( { 100, 100, 500, 500 } );
+	const auto dimmer = arranged.dimmers[0].window;
+	arranged.desktop.SetForegroundWindow( dimmer );
+
+	const std::vector<Platform::WindowId> before = { dimmer, other, target, arranged.dimmers[1].window };
+	REQUIRE( arranged.desktop.GetZOrder() == before );
+
+	CHECK( arranged.Arrange( target, {} ) == ZOrderStrategy::PushToBottom );
+	CHECK( IsArranged( arranged, target, {} ) );
+	CHECK( arranged.IndexOf( target ) < arranged.IndexOf( dimmer ) );
+	CHECK( arranged.desktop.GetZOrder().back() == other );
+}
+
+THEATER_TEST( zorderarranger, RandomDesktopsEndArranged )
+{
+	for ( uint32_t seed = 1; seed <= 2000; seed++ )
+	{
+		std::mt19937 random( seed );
+
+		ArrangedDesktop                 arranged;
+		Platform::WindowId              target = Platform::NO_WINDOW;
+		std::vector<Platform::WindowId> companions;
+		BuildRandomDesktop( random, arranged, target, companions );
+
+		std::vector<Platform::WindowId> visibleCompanions;
+		for ( const auto companion : companions )
+		{
+			if ( arranged.desktop.IsWindowVisible( companion ) )
+				visibleCompanions.emplace_back( companion );
+		}
+
+		arranged.Arrange( target, companions );
+		const bool isArranged = IsArranged( arranged, target, visibleCompanions );
+		CHECK( isArranged );
+		if ( !isArranged )
+		{
+			fprintf( stderr, "  seed %u\n", seed );
+			return;
+		}
+
+		// and stays that way when arranged again
+		arranged.Arrange( target, companions );
+		CHECK( IsArranged( arranged, target, visibleCompanions ) );
+	}
+}
@@ -0,0 +1,276 @@
+#include "theater.h"
+#include "testing.h"
+#include <random>
+
+namespace Theater
+{
+	namespace
+	{
+		constexpr uintptr_t TARGET = 1;
+		constexpr uint64_t  LEFT   = 1 << 0;
+		constexpr uint64_t  RIGHT  = 1 << 1;
+
+		ZOrderWindow Window( uintptr_t id, uint64_t monitors, bool topmost = false )
+		{
+			return ZOrderWindow{ id, monitors, topmost, false, false, false };
+		}
+
+		ZOrderWindow Dimmer( uintptr_t id, uint64_t monitor )
+		{
+			return ZOrderWindow{ id, monitor, false, true, false, false };
+		}
+
+		ZOrderWindow Owned( uintptr_t id, uint64_t monitors )
+		{
+			return ZOrderWindow{ id, monitors, false, false, true, false };
+		}
+
+		ZOrderWindow Companion( uintptr_t id, uint64_t monitors )
+		{
+			return ZOrderWindow{ id, monitors, false, false, false, true };
+		}
+
+		// Random desktop of count windows over up to four monitors, top to bottom, with a dimmer per monitor
+		std::vector<ZOrderWindow> MakeStack( std::mt19937& random, size_t count, std::vector<uintptr_t>& dimmers )
+		{
+			std::vector<ZOrderWindow> stack;
+			const uint64_t            monitorCount = 1 + random() % 4;
+			for ( uintptr_t i = 0; i < count; i++ )
+			{
+				const uint64_t monitors = ( random() % ( ( 1u << monitorCount ) - 1 ) ) + 1;
+				switch ( random() % 12 )
+				{
+				case 0:
+					stack.emplace_back( Owned( 100 + i, monitors ) );
+					break;
+				case 1:
+					stack.emplace_back( Companion( 100 + i, monitors ) );
+					break;
+				default:
+					stack.emplace_back( Window( 100 + i, monitors ) );
+					break;
+				}
+			}
+
+			for ( uint64_t i = 0; i < monitorCount; i++ )
+			{
+				dimmers.emplace_back( 10 + i );
+				stack.insert( stack.begin() + random() % ( stack.size() + 1 ), Dimmer( 10 + i, 1ull << i ) );
+			}
+
+			const uint64_t targetMonitors = ( random() % ( ( 1u << monitorCount ) - 1 ) ) + 1;
+			stack.insert( stack.begin() + random() % ( stack.size() + 1 ), Window( TARGET, targetMonitors ) );
+			return stack;
+		}
+
+		size_t IndexOf( const std::vector<ZOrderWindow>& stack, uintptr_t id )
+		{
+			for ( size_t i = 0; i < stack.size(); i++ )
+			{
+				if ( stack[i].id == id )
+					return i;
+			}
+
+			return stack.size();
+		}
+
+		// What the arranger does with the moves: push them to the bottom in order, then chain the dimmers
+		std::vector<ZOrderWindow> Apply( const std::vector<ZOrderWindow>& stack, const ZOrderMoves& moves,
+		                                 const std::vector<uintptr_t>& dimmers )
+		{
+			std::vector<ZOrderWindow> result;
+			std::vector<ZOrderWindow> pushed;
+			for ( const auto& window : stack )
+			{
+				const bool moved =
+				    std::find( moves.windows.begin(), moves.windows.end(), window.id ) != moves.windows.end();
+				( moved ? pushed : result ).emplace_back( window );
+			}
+			result.insert( result.end(), pushed.begin(), pushed.end() );
+
+			if ( !moves.chainBelowTarget )
+				return result;
+
+			std::vector<uintptr_t> companions;
+			for ( const auto& window : stack )
+			{
+				if ( window.companion )
+					companions.emplace_back( window.id );
+			}
+
+			std::vector<uintptr_t> chain;
+			PlanZOrderChain( result, TARGET, companions, dimmers, chain );
+
+			std::vector<ZOrderWindow> chained;
+			for ( const auto id : chain )
+			{
+				const size_t index = IndexOf( result, id );
+				chained.emplace_back( result[index] );
+				result.erase( result.begin() + index );
+			}
+			result.insert( result.begin() + IndexOf( result, TARGET ) + 1, chained.begin(), chained.end() );
+			return result;
+		}
+
+		// Nothing the user sees through the dimmers covers the target, and every dimmer covers whatever it overlaps
+		bool IsArranged( const std::vector<ZOrderWindow>& stack )
+		{
+			const size_t target = IndexOf( stack, TARGET );
+			for ( size_t i = 0; i < stack.size(); i++ )
+			{
+				const auto& window = stack[i];
+				if ( window.dimmer || window.ownedByTarget || window.companion || window.id == TARGET )
+					continue;
+
+				if ( i < target && ( window.monitors & stack[target].monitors ) != 0 )
+					return false;
+
+				for ( size_t j = i + 1; j < stack.size(); j++ )
+				{
+					if ( stack[j].dimmer && ( window.monitors & stack[j].monitors ) != 0 )
+						return false;
+				}
+			}
+
+			return true;
+		}
+	} // namespace
+} // namespace Theater
+
+using namespace Theater;
+
+THEATER_TEST( zorderplanner, TargetOnTopWithItsDimmersBelowIsLeftAlone )
+{
+	const std::vector<ZOrderWindow> stack = {
+		Window( 50, LEFT, true ), Owned( 51, LEFT ),    Window( TARGET, LEFT ), Companion( 52, RIGHT ),
+		Dimmer( 10, LEFT ),       Dimmer( 11, RIGHT ), Window( 53, LEFT | RIGHT ),
+	};
+	CHECK( PlanZOrder( stack, TARGET, 1, 2 ) == ZOrderStrategy::None );
+
+	// without dimmers there's nothing to slot
+	CHECK( PlanZOrder( { Window( TARGET, LEFT ), Window( 2, LEFT ) }, TARGET, 0, 0 ) == ZOrderStrategy::None );
+}
+
+THEATER_TEST( zorderplanner, TargetOnTopGetsTheDimmersInserted )
+{
+	// a constant number of moves whatever is below
+	CHECK( PlanZOrder( { Window( TARGET, LEFT ), Window( 2, LEFT ), Dimmer( 10, LEFT ), Dimmer( 11, RIGHT ) },
+	                   TARGET, 0, 2 ) == ZOrderStrategy::InsertBelowTarget );
+	CHECK( PlanZOrder( { Dimmer( 10, LEFT ), Window( TARGET, LEFT ), Dimmer( 11, RIGHT ) }, TARGET, 0, 2 ) ==
+	       ZOrderStrategy::InsertBelowTarget );
+
+	// a companion that isn't next to the target yet
+	CHECK( PlanZOrder( { Window( TARGET, LEFT ), Dimmer( 10, LEFT ), Companion( 2, LEFT ) }, TARGET, 1, 1 ) ==
+	       ZOrderStrategy::InsertBelowTarget );
+}
+
+THEATER_TEST( zorderplanner, FallsBackToPushingWhenTheTargetIsCovered )
+{
+	CHECK( PlanZOrder( { Window( 2, RIGHT ), Window( TARGET, LEFT ), Dimmer( 10, LEFT ) }, TARGET, 0, 1 ) ==
+	       ZOrderStrategy::PushToBottom );
+
+	// dimmers can't go into the topmost band
+	CHECK( PlanZOrder( { Window( TARGET, LEFT, true ), Dimmer( 10, LEFT ) }, TARGET, 0, 1 ) ==
+	       ZOrderStrategy::PushToBottom );
+
+	// a target that isn't in the stack anymore
+	CHECK( PlanZOrder( { Window( 2, LEFT ), Dimmer( 10, LEFT ) }, TARGET, 0, 1 ) == ZOrderStrategy::PushToBottom );
+}
+
+THEATER_TEST( zorderplanner, ChainKeepsCompanionsAlreadyAboveTheDimmers )
+{
+	const std::vector<ZOrderWindow> stack = {
+		Companion( 2, LEFT ), Window( TARGET, LEFT ), Dimmer( 10, LEFT ), Companion( 3, LEFT ), Dimmer( 11, RIGHT ),
+	};
+
+	std::vector<uintptr_t> chain;
+	PlanZOrderChain( stack, TARGET, { 2, 3 }, { 10, 11 }, chain );
+	CHECK( chain == std::vector<uintptr_t>( { 3, 10, 11 } ) );
+
+	// under a dimmer it has to come down along with the others
+	const std::vector<ZOrderWindow> covered = {
+		Dimmer( 10, LEFT ), Companion( 2, LEFT ), Window( TARGET, LEFT ), Dimmer( 11, RIGHT ),
+	};
+	PlanZOrderChain( covered, TARGET, { 2 }, { 10, 11 }, chain );
+	CHECK( chain == std::vector<uintptr_t>( { 2, 10, 11 } ) );
+}
+
+THEATER_TEST( zorderplanner, MovesOnlyWhatCoversTheTargetOrADimmer )
+{
+	const std::vector<ZOrderWindow> stack = {
+		Window( 2, RIGHT ), Window( 3, LEFT ), Owned( 4, LEFT ), Window( TARGET, LEFT ),
+		Window( 5, LEFT ),  Dimmer( 10, LEFT ), Window( 6, RIGHT ), Dimmer( 11, RIGHT ), Window( 7, LEFT ),
+	};
+
+	ZOrderMoves moves;
+	PlanZOrderMoves( stack, TARGET, moves );
+	CHECK( !moves.chainBelowTarget );
+	CHECK( moves.windows == std::vector<uintptr_t>( { 2, 3, 5, 6 } ) );
+	CHECK( moves.savedMoves == 1 );
+	CHECK( IsArranged( Apply( stack, moves, { 10, 11 } ) ) );
+}
+
+THEATER_TEST( zorderplanner, RandomStacksEndArranged )
+{
+	std::mt19937 random( 5 );
+	uint32_t     failures = 0;
+	for ( uint32_t i = 0; i < 20000; i++ )
+	{
+		std::vector<uintptr_t> dimmers;
+		const auto             stack = MakeStack( random, random() % 40, dimmers );
+
+		ZOrderMoves moves;
+		PlanZOrderMoves( stack, TARGET, moves );
+		failures += IsArranged( Apply( stack, moves, dimmers ) ) ? 0 : 1;
+
+		// anything pushed down overlapped the target or a dimmer
+		uint64_t covered = stack[IndexOf( stack, TARGET )].monitors;
+		for ( const auto id : dimmers )
+			covered |= stack[IndexOf( stack, id )].monitors;
+		for ( const auto id : moves.windows )
+			failures += ( stack[IndexOf( stack, id )].monitors & covered ) != 0 ? 0 : 1;
+	}
+
+	CHECK( failures == 0 );
+}
+
+// Planning on desktops from a handful of windows to a few thousand, with the moves each strategy would take
+THEATER_BENCHMARK( zorderplanner, SyntheticStacks )
+{
+	const size_t   counts[] = { 20, 400, 4000 };
+	const uint32_t runs     = quick ? 100 : 10000;
+
+	std::mt19937 random( 55 );
+	for ( const auto count : counts )
+	{
+		std::vector<uintptr_t> dimmers;
+		auto                   stack = MakeStack( random, count, dimmers );
+
+		// the target was just activated, it's on top and has no companions
+		const size_t target = IndexOf( stack, TARGET );
+		std::rotate( stack.begin(), stack.begin() + target, stack.begin() + target + 1 );
+		stack.erase( std::remove_if( stack.begin(), stack.end(),
+		                             []( const ZOrderWindow& window ) { return window.companion; } ),
+		             stack.end() );
+		const std::vector<uintptr_t> companions;
+
+		uint64_t               planned = 0;
+		ZOrderMoves            moves;
+		std::vector<uintptr_t> chain;
+		const uint64_t         start = GetTestTimeNanoseconds();
+		for ( uint32_t i = 0; i < runs; i++ )
+		{
+			planned += static_cast<uint64_t>( PlanZOrder( stack, TARGET, companions.size(), dimmers.size() ) );
+			PlanZOrderChain( stack, TARGET, companions, dimmers, chain );
+			PlanZOrderMoves( stack, TARGET, moves );
+			planned += chain.size() + moves.windows.size();
+		}
+		const uint64_t elapsed = GetTestTimeNanoseconds() - start;
+
+		KeepValue( planned );
+		const std::string label = std::to_string( count ) + " windows";
+		ReportBenchmark( ( label + " plan" ).c_str(), static_cast<double>( elapsed ) / runs, "ns" );
+		ReportBenchmark( ( label + " insert moves" ).c_str(), static_cast<double>( chain.size() ), "moves" );
+		ReportBenchmark( ( label + " push moves" ).c_str(), static_cast<double>( moves.windows.size() ), "moves" );
+	}
+}